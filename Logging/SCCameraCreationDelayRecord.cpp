@@ -0,0 +1,182 @@
+//
+//  SCCameraCreationDelayRecord.cpp
+//  Snapchat
+//
+
+#include "SCCameraCreationDelayRecord.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace {
+
+const double kUnsetTime = std::numeric_limits<double>::quiet_NaN();
+
+size_t SplitIndex(SC::CameraCreationSplit split)
+{
+    return (size_t)split;
+}
+
+uint32_t ClampedMilliseconds(double seconds)
+{
+    double milliseconds = seconds * 1000;
+    if (!(milliseconds > 0)) {
+        return 0;
+    }
+    return milliseconds < std::numeric_limits<uint32_t>::max() ? (uint32_t)milliseconds
+                                                                : std::numeric_limits<uint32_t>::max();
+}
+
+void AppendJSONString(std::string &output, const char *string)
+{
+    output += '"';
+    for (const char *cursor = string; *cursor; ++cursor) {
+        unsigned char character = (unsigned char)*cursor;
+        if (character == '"' || character == '\\') {
+            output += '\\';
+            output += (char)character;
+        } else if (character < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+            output += escaped;
+        } else {
+            output += (char)character;
+        }
+    }
+    output += '"';
+}
+
+} // namespace
+
+namespace SC {
+
+bool CameraCreationDelaySnapshot::hasSplit(CameraCreationSplit split) const
+{
+    return !std::isnan(splitOffsets[SplitIndex(split)]);
+}
+
+uint32_t CameraCreationDelaySnapshot::splitMilliseconds(CameraCreationSplit split) const
+{
+    return ClampedMilliseconds(splitOffsets[SplitIndex(split)]);
+}
+
+uint32_t CameraCreationDelaySnapshot::latencyMilliseconds() const
+{
+    return ClampedMilliseconds(endTime - startTime + startTimeAdjustment);
+}
+
+CameraCreationDelayRecord::CameraCreationDelayRecord()
+{
+    cancel();
+}
+
+void CameraCreationDelayRecord::start(double time)
+{
+    cancel();
+    _startTime.store(time);
+}
+
+void CameraCreationDelayRecord::cancel()
+{
+    _startTime.store(kUnsetTime);
+    _startTimeAdjustment.store(0);
+    for (std::atomic<double> &splitOffset : _splitOffsets) {
+        splitOffset.store(kUnsetTime);
+    }
+    _completed.store(false);
+}
+
+bool CameraCreationDelayRecord::started() const
+{
+    return !std::isnan(_startTime.load());
+}
+
+void CameraCreationDelayRecord::mark(CameraCreationSplit split, double time)
+{
+    double timeOffset = time - _startTime.load();
+    if (split == CameraCreationSplit::RecordingGestureFinished) {
+        double preCaptureOperationFinished =
+            _splitOffsets[SplitIndex(CameraCreationSplit::PreCaptureOperationFinished)].load();
+        if (!std::isnan(preCaptureOperationFinished)) {
+            _startTimeAdjustment.store(preCaptureOperationFinished - timeOffset);
+        }
+    }
+    _splitOffsets[SplitIndex(split)].store(timeOffset + _startTimeAdjustment.load());
+}
+
+bool CameraCreationDelayRecord::has(CameraCreationSplit split) const
+{
+    return !std::isnan(_splitOffsets[SplitIndex(split)].load());
+}
+
+bool CameraCreationDelayRecord::complete(double endTime, CameraCreationDelaySnapshot &snapshot)
+{
+    if (!started() || _completed.exchange(true)) {
+        return false;
+    }
+    snapshot.startTime = _startTime.load();
+    snapshot.endTime = endTime;
+    snapshot.startTimeAdjustment = _startTimeAdjustment.load();
+    for (size_t index = 0; index < kCameraCreationSplitCount; ++index) {
+        snapshot.splitOffsets[index] = _splitOffsets[index].load();
+    }
+    return true;
+}
+
+std::string CameraCreationDelaySplitsJSON(const CameraCreationDelaySnapshot &snapshot,
+                                          const std::array<const char *, kCameraCreationSplitCount> &names)
+{
+    std::string output = "{";
+    for (size_t index = 0; index < kCameraCreationSplitCount; ++index) {
+        CameraCreationSplit split = (CameraCreationSplit)index;
+        if (!names[index] || !snapshot.hasSplit(split)) {
+            continue;
+        }
+        if (output.size() > 1) {
+            output += ',';
+        }
+        AppendJSONString(output, names[index]);
+        char value[16];
+        snprintf(value, sizeof(value), ":%u", snapshot.splitMilliseconds(split));
+        output += value;
+    }
+    output += '}';
+    return output;
+}
+
+void CameraCreationDelaySummary::add(const CameraCreationDelaySnapshot &snapshot)
+{
+    _latencies.record(snapshot.latencyMilliseconds());
+    for (size_t index = 0; index < kCameraCreationSplitCount; ++index) {
+        CameraCreationSplit split = (CameraCreationSplit)index;
+        if (snapshot.hasSplit(split)) {
+            _splits[index].record(snapshot.splitMilliseconds(split));
+        }
+    }
+}
+
+uint32_t CameraCreationDelaySummary::latencyAtPercentile(double percentile) const
+{
+    return _latencies.valueAtPercentile(percentile);
+}
+
+uint32_t CameraCreationDelaySummary::splitAtPercentile(CameraCreationSplit split, double percentile) const
+{
+    return _splits[SplitIndex(split)].valueAtPercentile(percentile);
+}
+
+uint64_t CameraCreationDelaySummary::splitCount(CameraCreationSplit split) const
+{
+    return _splits[SplitIndex(split)].count();
+}
+
+void CameraCreationDelaySummary::reset()
+{
+    _latencies.reset();
+    for (LatencyHistogram &histogram : _splits) {
+        histogram.reset();
+    }
+}
+
+} // namespace SC
@@ -0,0 +1,105 @@
+//
+//  SCCameraCreationDelayRecord.h
+//  Snapchat
+//
+//  Fixed schema record of the CAMERA_CREATION_DELAY split points. Split points are written with atomic stores from the
+//  threads reaching them, so that measuring the camera open path doesn't add queue hops to it. Completed sessions are
+//  copied out as plain snapshots, serialized with a small JSON writer and aggregated into percentile summaries. Only
+//  depends on the C++ standard library so that it can be built and exercised off device.
+//
+
+#pragma once
+
+#include "SCLatencyHistogram.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace SC {
+
+enum class CameraCreationSplit : size_t {
+    RecordingGestureFinished,
+    PreCaptureOperationRequested,
+    PreCaptureOperationFinished,
+    CameraCaptureContentReady,
+    PreviewLayoutReady,
+    PreviewAnimationFinish,
+    PreviewPlayerReady,
+};
+
+static const size_t kCameraCreationSplitCount = 7;
+
+// Times are in seconds of the same monotonic clock, offsets are relative to the start of the session
+struct CameraCreationDelaySnapshot {
+    double startTime;
+    double endTime;
+    double startTimeAdjustment;
+    // NaN for the split points the session didn't reach
+    std::array<double, kCameraCreationSplitCount> splitOffsets;
+
+    bool hasSplit(CameraCreationSplit split) const;
+
+    // Clamped to 0, like the latency
+    uint32_t splitMilliseconds(CameraCreationSplit split) const;
+    uint32_t latencyMilliseconds() const;
+};
+
+class CameraCreationDelayRecord {
+public:
+    CameraCreationDelayRecord();
+
+    // Starts a new session, dropping the split points of the previous one
+    void start(double time);
+    void cancel();
+    bool started() const;
+
+    /*
+     Records the split offset, adjusted like the split points reached after the recording gesture. Reaching the
+     recording gesture split moves the start of the session to the pre capture operation end, if it was reached.
+     */
+    void mark(CameraCreationSplit split, double time);
+    bool has(CameraCreationSplit split) const;
+
+    // Only the first call after start returns true and fills the snapshot, so a session completes once
+    bool complete(double endTime, CameraCreationDelaySnapshot &snapshot);
+
+private:
+    CameraCreationDelayRecord(const CameraCreationDelayRecord &) = delete;
+    CameraCreationDelayRecord &operator=(const CameraCreationDelayRecord &) = delete;
+
+    std::atomic<double> _startTime;
+    std::atomic<double> _startTimeAdjustment;
+    std::array<std::atomic<double>, kCameraCreationSplitCount> _splitOffsets;
+    std::atomic<bool> _completed;
+};
+
+// {"name":milliseconds,...} in split order, skipping the split points that weren't reached
+std::string CameraCreationDelaySplitsJSON(const CameraCreationDelaySnapshot &snapshot,
+                                          const std::array<const char *, kCameraCreationSplitCount> &names);
+
+// Percentiles of the latency and split points over many sessions, in milliseconds. Not thread safe.
+class CameraCreationDelaySummary {
+public:
+    void add(const CameraCreationDelaySnapshot &snapshot);
+
+    uint64_t sessionCount() const
+    {
+        return _latencies.count();
+    }
+
+    uint32_t latencyAtPercentile(double percentile) const;
+    uint32_t splitAtPercentile(CameraCreationSplit split, double percentile) const;
+    uint64_t splitCount(CameraCreationSplit split) const;
+
+    void reset();
+
+private:
+    // Milliseconds are recorded as microseconds would be, the histograms only need to be consistent
+    LatencyHistogram _latencies;
+    std::array<LatencyHistogram, kCameraCreationSplitCount> _splits;
+};
+
+} // namespace SC
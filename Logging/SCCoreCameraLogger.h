@@ -27,6 +27,12 @@ extern NSString *const kSCCameraCreationDelayEventStartTypeKey;
 extern NSString *const kSCCameraCreationDelayEventStartSubTypeKey;
 extern NSString *const kSCCameraCreationDelayEventAnalyticsVersion;
 
+/**
+ *  Local CAMERA_CREATION_DELAY summary, the split points are keyed by their submetric names
+ */
+extern NSString *const kSCCameraCreationDelaySummarySessionCountKey;
+extern NSString *const kSCCameraCreationDelaySummaryLatencyKey;
+
 @interface SCCoreCameraLogger : NSObject
 
 + (instancetype)sharedInstance;
@@ -63,4 +69,10 @@ extern NSString *const kSCCameraCreationDelayEventAnalyticsVersion;
 
 - (void)cancelCameraCreationDelayEvent;
 
+/**
+ *  Latency and split points in milliseconds at the given percentile (0-100), over the sessions logged since launch.
+ *  Empty until a session was logged.
+ */
+- (NSDictionary<NSString *, NSNumber *> *)cameraCreationDelaySummaryAtPercentile:(double)percentile;
+
 @end
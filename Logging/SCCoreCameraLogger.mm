@@ -0,0 +1,322 @@
+//
+//  SCCoreCameraLogger.mm
+//  Snapchat
+//
+//  Created by Chao Pang on 3/6/18.
+//
+
+#import "SCCoreCameraLogger.h"
+
+#import "SCCameraCreationDelayRecord.h"
+
+#import <BlizzardSchema/SCAEvents.h>
+#import <SCBase/SCMacros.h>
+#import <SCFoundation/SCQueuePerformer.h>
+#import <SCGhostToSnappable/SCGhostToSnappableSignal.h>
+#import <SCLogger/SCCameraMetrics+CameraCreationDelay.h>
+
+#include <mutex>
+#include <vector>
+
+static const char *kSCCoreCameraLoggerQueueLabel = "com.snapchat.core-camera-logger-queue";
+
+NSString *const kSCCameraCreationDelayEventStartTimeKey = @"start_time";
+NSString *const kSCCameraCreationDelayEventStartTimeAdjustmentKey = @"start_time_adjustment";
+NSString *const kSCCameraCreationDelayEventEndTimeKey = @"end_time";
+NSString *const kSCCameraCreationDelayEventCaptureSessionIdKey = @"capture_session_id";
+NSString *const kSCCameraCreationDelayEventFilterLensIdKey = @"filter_lens_id";
+NSString *const kSCCameraCreationDelayEventNightModeDetectedKey = @"night_mode_detected";
+NSString *const kSCCameraCreationDelayEventNightModeActiveKey = @"night_mode_active";
+NSString *const kSCCameraCreationDelayEventCameraApiKey = @"camera_api";
+NSString *const kSCCameraCreationDelayEventCameraLevelKey = @"camera_level";
+NSString *const kSCCameraCreationDelayEventCameraPositionKey = @"camera_position";
+NSString *const kSCCameraCreationDelayEventCameraOpenSourceKey = @"camera_open_source";
+NSString *const kSCCameraCreationDelayEventContentDurationKey = @"content_duration";
+NSString *const kSCCameraCreationDelayEventMediaTypeKey = @"media_type";
+NSString *const kSCCameraCreationDelayEventStartTypeKey = @"start_type";
+NSString *const kSCCameraCreationDelayEventStartSubTypeKey = @"start_sub_type";
+NSString *const kSCCameraCreationDelayEventAnalyticsVersion = @"ios_v1";
+
+NSString *const kSCCameraCreationDelaySummarySessionCountKey = @"session_count";
+NSString *const kSCCameraCreationDelaySummaryLatencyKey = @"latency";
+
+static inline NSUInteger SCTimeToMS(CFTimeInterval time)
+{
+    return (NSUInteger)(time * 1000);
+}
+
+static NSString *SCCameraCreationDelaySplitName(SC::CameraCreationSplit split)
+{
+    switch (split) {
+    case SC::CameraCreationSplit::RecordingGestureFinished:
+        return kSCCameraSubmetricsRecordingGestureFinished;
+    case SC::CameraCreationSplit::PreCaptureOperationRequested:
+        return kSCCameraSubmetricsPreCaptureOperationRequested;
+    case SC::CameraCreationSplit::PreCaptureOperationFinished:
+        return kSCCameraSubmetricsPreCaptureOperationFinished;
+    case SC::CameraCreationSplit::CameraCaptureContentReady:
+        return kSCCameraSubmetricsCameraCaptureContentReady;
+    case SC::CameraCreationSplit::PreviewLayoutReady:
+        return kSCCameraSubmetricsPreviewLayoutReady;
+    case SC::CameraCreationSplit::PreviewAnimationFinish:
+        return kSCCameraSubmetricsPreviewAnimationFinish;
+    case SC::CameraCreationSplit::PreviewPlayerReady:
+        return kSCCameraSubmetricsPreviewPlayerReady;
+    }
+}
+
+static NSString *SCCameraCreationDelaySplitsJSONString(const SC::CameraCreationDelaySnapshot &snapshot)
+{
+    std::array<const char *, SC::kCameraCreationSplitCount> names;
+    for (size_t index = 0; index < SC::kCameraCreationSplitCount; ++index) {
+        names[index] = SCCameraCreationDelaySplitName((SC::CameraCreationSplit)index).UTF8String;
+    }
+    return @(SC::CameraCreationDelaySplitsJSON(snapshot, names).c_str());
+}
+
+struct SCCameraCreationDelaySession {
+    NSDictionary *parameters;
+    SC::CameraCreationDelaySnapshot snapshot;
+};
+
+@implementation SCCoreCameraLogger {
+    SCQueuePerformer *_performer;
+    // Split points are stored from the calling threads, only completed sessions are handed over to the performer
+    SC::CameraCreationDelayRecord _cameraCreationDelayRecord;
+    std::mutex _cameraCreationDelayMutex;
+    // Guarded by _cameraCreationDelayMutex
+    NSMutableDictionary *_cameraCreationDelayParameters;
+    std::vector<SCCameraCreationDelaySession> _pendingCameraCreationDelaySessions;
+    SC::CameraCreationDelaySummary _cameraCreationDelaySummary;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _cameraCreationDelayParameters = [NSMutableDictionary dictionary];
+        _performer = [[SCQueuePerformer alloc] initWithLabel:kSCCoreCameraLoggerQueueLabel
+                                            qualityOfService:QOS_CLASS_UNSPECIFIED
+                                                   queueType:DISPATCH_QUEUE_SERIAL
+                                                     context:SCQueuePerformerContextCoreCamera];
+    }
+    return self;
+}
+
++ (instancetype)sharedInstance
+{
+    static SCCoreCameraLogger *sharedInstance;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[SCCoreCameraLogger alloc] init];
+    });
+    return sharedInstance;
+}
+
+// Camera creation delay metrics
+
+- (void)logCameraCreationDelayEventStartWithCaptureSessionId:(NSString *)captureSessionId
+                                                filterLensId:(NSString *)filterLensId
+                                      underLowLightCondition:(BOOL)underLowLightCondition
+                                           isNightModeActive:(BOOL)isNightModeActive
+                                                isBackCamera:(BOOL)isBackCamera
+                                                isMainCamera:(BOOL)isMainCamera
+{
+    CFTimeInterval startTime = CACurrentMediaTime();
+    std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+    [_cameraCreationDelayParameters removeAllObjects];
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventCaptureSessionIdKey] = captureSessionId ?: @"null";
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventFilterLensIdKey] = filterLensId ?: @"null";
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventNightModeDetectedKey] = @(underLowLightCondition);
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventNightModeActiveKey] = @(isNightModeActive);
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventCameraPositionKey] = isBackCamera ? @"back" : @"front";
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventCameraOpenSourceKey] =
+        isMainCamera ? @"main_camera" : @"reply_camera";
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventStartTypeKey] = SCLaunchType() ?: @"null";
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventStartSubTypeKey] = SCLaunchSubType() ?: @"null";
+    _cameraCreationDelayRecord.start(startTime);
+}
+
+- (void)logCameraCreationDelaySplitPointRecordingGestureFinished
+{
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::RecordingGestureFinished, CACurrentMediaTime());
+}
+
+- (void)logCameraCreationDelaySplitPointStillImageCaptureApi:(NSString *)api
+{
+    CFTimeInterval time = CACurrentMediaTime();
+    if (api) {
+        std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+        _cameraCreationDelayParameters[kSCCameraCreationDelayEventCameraApiKey] = api;
+    }
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::PreCaptureOperationRequested, time);
+}
+
+- (void)logCameraCreationDelaySplitPointPreCaptureOperationRequested
+{
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::PreCaptureOperationRequested, CACurrentMediaTime());
+}
+
+- (void)logCameraCreationDelaySplitPointPreCaptureOperationFinishedAt:(CFTimeInterval)time
+{
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::PreCaptureOperationFinished, time);
+}
+
+- (void)updatedCameraCreationDelayWithContentDuration:(CFTimeInterval)duration
+{
+    std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+    _cameraCreationDelayParameters[kSCCameraCreationDelayEventContentDurationKey] = @(SCTimeToMS(duration));
+}
+
+- (void)logCameraCreationDelaySplitPointCameraCaptureContentReady
+{
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::CameraCaptureContentReady, CACurrentMediaTime());
+}
+
+- (void)logCameraCreationDelaySplitPointPreviewFinishedPreparation
+{
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::CameraCaptureContentReady, CACurrentMediaTime());
+}
+
+- (void)logCameraCreationDelaySplitPointPreviewDisplayedForImage:(BOOL)isImage
+{
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::PreviewLayoutReady, CACurrentMediaTime());
+}
+
+- (void)logCameraCreationDelaySplitPointPreviewAnimationComplete:(BOOL)isImage
+{
+    CFTimeInterval time = CACurrentMediaTime();
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::PreviewAnimationFinish, time);
+    if (_cameraCreationDelayRecord.has(SC::CameraCreationSplit::PreviewPlayerReady)) {
+        [self _completeLogCameraCreationDelayEventWithIsImage:isImage atTime:time];
+    }
+}
+
+- (void)logCameraCreationDelaySplitPointPreviewFirstFramePlayed:(BOOL)isImage
+{
+    CFTimeInterval time = CACurrentMediaTime();
+    _cameraCreationDelayRecord.mark(SC::CameraCreationSplit::PreviewPlayerReady, time);
+    if (_cameraCreationDelayRecord.has(SC::CameraCreationSplit::PreviewAnimationFinish)) {
+        [self _completeLogCameraCreationDelayEventWithIsImage:isImage atTime:time];
+    }
+}
+
+- (void)cancelCameraCreationDelayEvent
+{
+    std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+    [_cameraCreationDelayParameters removeAllObjects];
+    _cameraCreationDelayRecord.cancel();
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)cameraCreationDelaySummaryAtPercentile:(double)percentile
+{
+    std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+    SC_GUARD_ELSE_RETURN_VALUE(_cameraCreationDelaySummary.sessionCount() > 0, @{});
+    NSMutableDictionary<NSString *, NSNumber *> *summary = [NSMutableDictionary dictionary];
+    summary[kSCCameraCreationDelaySummarySessionCountKey] = @(_cameraCreationDelaySummary.sessionCount());
+    summary[kSCCameraCreationDelaySummaryLatencyKey] = @(_cameraCreationDelaySummary.latencyAtPercentile(percentile));
+    for (size_t index = 0; index < SC::kCameraCreationSplitCount; ++index) {
+        SC::CameraCreationSplit split = (SC::CameraCreationSplit)index;
+        if (_cameraCreationDelaySummary.splitCount(split) > 0) {
+            summary[SCCameraCreationDelaySplitName(split)] =
+                @(_cameraCreationDelaySummary.splitAtPercentile(split, percentile));
+        }
+    }
+    return summary;
+}
+
+#pragma - Private methods
+
+- (void)_completeLogCameraCreationDelayEventWithIsImage:(BOOL)isImage atTime:(CFTimeInterval)time
+{
+    SCCameraCreationDelaySession session;
+    BOOL flushScheduled;
+    {
+        std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+        SC_GUARD_ELSE_RETURN(_cameraCreationDelayRecord.complete(time, session.snapshot));
+        NSMutableDictionary *parameters = [_cameraCreationDelayParameters mutableCopy];
+        parameters[kSCCameraCreationDelayEventMediaTypeKey] = isImage ? @"image" : @"video";
+        session.parameters = parameters;
+        [_cameraCreationDelayParameters removeAllObjects];
+        flushScheduled = !_pendingCameraCreationDelaySessions.empty();
+        _pendingCameraCreationDelaySessions.push_back(session);
+    }
+    SC_GUARD_ELSE_RETURN(!flushScheduled);
+    [_performer perform:^{
+        [self _flushCameraCreationDelaySessions];
+    }];
+}
+
+// Sessions completing while the performer is busy are logged in the same batch
+- (void)_flushCameraCreationDelaySessions
+{
+    SCAssertPerformer(_performer);
+    std::vector<SCCameraCreationDelaySession> sessions;
+    {
+        std::lock_guard<std::mutex> lock(_cameraCreationDelayMutex);
+        sessions.swap(_pendingCameraCreationDelaySessions);
+        for (const SCCameraCreationDelaySession &session : sessions) {
+            _cameraCreationDelaySummary.add(session.snapshot);
+        }
+    }
+    for (const SCCameraCreationDelaySession &session : sessions) {
+        [self _logCameraCreationDelayBlizzardEventWithParameters:session.parameters snapshot:session.snapshot];
+    }
+}
+
+- (void)_logCameraCreationDelayBlizzardEventWithParameters:(NSDictionary *)parameters
+                                                 snapshot:(const SC::CameraCreationDelaySnapshot &)snapshot
+{
+    SCAssertPerformer(_performer);
+    SCASharedCameraMetricParams *sharedCameraMetricsParams = [[SCASharedCameraMetricParams alloc] init];
+    [sharedCameraMetricsParams setAnalyticsVersion:kSCCameraCreationDelayEventAnalyticsVersion];
+    NSString *mediaType = parameters[kSCCameraCreationDelayEventMediaTypeKey];
+    if (mediaType) {
+        if ([mediaType isEqualToString:@"image"]) {
+            [sharedCameraMetricsParams setMediaType:SCAMediaType_IMAGE];
+        } else if ([mediaType isEqualToString:@"video"]) {
+            [sharedCameraMetricsParams setMediaType:SCAMediaType_VIDEO];
+        }
+    }
+    if (parameters[kSCCameraCreationDelayEventNightModeDetectedKey] &&
+        parameters[kSCCameraCreationDelayEventNightModeActiveKey]) {
+        BOOL isNightModeDetected = [parameters[kSCCameraCreationDelayEventNightModeDetectedKey] boolValue];
+        BOOL isNightModeActive = [parameters[kSCCameraCreationDelayEventNightModeActiveKey] boolValue];
+        if (!isNightModeDetected) {
+            [sharedCameraMetricsParams setLowLightStatus:SCALowLightStatus_NOT_DETECTED];
+        } else if (!isNightModeActive) {
+            [sharedCameraMetricsParams setLowLightStatus:SCALowLightStatus_DETECTED];
+        } else if (isNightModeActive) {
+            [sharedCameraMetricsParams setLowLightStatus:SCALowLightStatus_ENABLED];
+        }
+    }
+
+    [sharedCameraMetricsParams setPowerMode:[[NSProcessInfo processInfo] isLowPowerModeEnabled]
+                                                ? @"LOW_POWER_MODE_ENABLED"
+                                                : @"LOW_POWER_MODE_DISABLED"];
+    [sharedCameraMetricsParams setFilterLensId:parameters[kSCCameraCreationDelayEventFilterLensIdKey] ?: @"null"];
+    [sharedCameraMetricsParams
+        setCaptureSessionId:parameters[kSCCameraCreationDelayEventCaptureSessionIdKey] ?: @"null"];
+    [sharedCameraMetricsParams setCameraApi:parameters[kSCCameraCreationDelayEventCameraApiKey] ?: @"null"];
+    [sharedCameraMetricsParams setCameraPosition:parameters[kSCCameraCreationDelayEventCameraPositionKey] ?: @"null"];
+    [sharedCameraMetricsParams
+        setCameraOpenSource:parameters[kSCCameraCreationDelayEventCameraOpenSourceKey] ?: @"null"];
+    [sharedCameraMetricsParams setCameraLevel:parameters[kSCCameraCreationDelayEventCameraLevelKey] ?: @"null"];
+    [sharedCameraMetricsParams setStartType:parameters[kSCCameraCreationDelayEventStartTypeKey] ?: @"null"];
+    [sharedCameraMetricsParams setStartSubType:parameters[kSCCameraCreationDelayEventStartSubTypeKey] ?: @"null"];
+    [sharedCameraMetricsParams setSplits:SCCameraCreationDelaySplitsJSONString(snapshot)];
+
+    SCACameraSnapCreateDelay *creationDelay = [[SCACameraSnapCreateDelay alloc] init];
+    [creationDelay setLatencyMillis:snapshot.latencyMilliseconds()];
+
+    if (parameters[kSCCameraCreationDelayEventContentDurationKey]) {
+        CFTimeInterval contentDuration = [parameters[kSCCameraCreationDelayEventContentDurationKey] doubleValue];
+        [creationDelay setContentDurationMillis:SCTimeToMS(contentDuration)];
+    } else {
+        [creationDelay setContentDurationMillis:0];
+    }
+    [creationDelay setSharedCameraMetricParams:sharedCameraMetricsParams];
+    [[SCLogger sharedInstance] logUserTrackedEvent:creationDelay];
+}
+
+@end
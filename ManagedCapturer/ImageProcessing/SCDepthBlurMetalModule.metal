@@ -9,12 +9,33 @@
 using namespace metal;
 
 struct DepthBlurRenderData {
-    float depthRange;
-    float depthOffset;
-    float depthBlurForegroundThreshold;
-    float depthBlurBackgroundThreshold;
+    float defaultForegroundThreshold;
+    float backgroundThreshold;
 };
 
+// Written by kernel_depth_statistics earlier in the command buffer
+struct DepthStatistics {
+    uint minKey;
+    uint maxKey;
+    uint focusMaxKey;
+    uint padding;
+};
+
+static float depthFromOrderedKey(uint key) {
+    return as_type<float>(key ^ ((key & 0x80000000) ? 0x80000000 : 0xffffffff));
+}
+
+// Without valid depth values minKey is left at UINT_MAX, and a single value has no range either. The depth is then
+// taken as 0..1, like SCDepthNormalizingRangeOfHalfFloatPlane does on the CPU.
+static float2 depthOffsetAndRange(device const DepthStatistics &statistics) {
+    float depthOffset = depthFromOrderedKey(statistics.minKey);
+    float depthRange = depthFromOrderedKey(statistics.maxKey) - depthOffset;
+    if (statistics.minKey >= statistics.maxKey || isinf(depthRange)) {
+        return float2(0, 1);
+    }
+    return float2(depthOffset, depthRange);
+}
+
 kernel void kernel_depth_blur(texture2d<float, access::read> sourceYTexture [[texture(0)]],
                               texture2d<float, access::read> sourceUVTexture [[texture(1)]],
                               texture2d<float, access::read> sourceDepthTexture[[texture(2)]],
@@ -22,22 +43,35 @@ kernel void kernel_depth_blur(texture2d<float, access::read> sourceYTexture [[te
                               texture2d<float, access::write> destinationYTexture [[texture(4)]],
                               texture2d<float, access::write> destinationUVTexture [[texture(5)]],
                               constant DepthBlurRenderData &renderData [[buffer(0)]],
+                              device const DepthStatistics &statistics [[buffer(1)]],
                               uint2 gid [[thread_position_in_grid]],
                               uint2 size [[threads_per_grid]]) {
+    float2 depthOffsetAndRangeValue = depthOffsetAndRange(statistics);
+    float depthOffset = depthOffsetAndRangeValue.x;
+    float depthRange = depthOffsetAndRangeValue.y;
+    // The max around the focus point is the foreground, the 8 bit clamp matches the Core Image readback it replaces
+    float depthBlurForegroundThreshold = renderData.defaultForegroundThreshold;
+    if (statistics.focusMaxKey != 0) {
+        float focusDepthValue = saturate(depthFromOrderedKey(statistics.focusMaxKey));
+        depthBlurForegroundThreshold = (focusDepthValue - depthOffset) / depthRange;
+    }
+    float depthBlurBackgroundThreshold =
+        depthBlurForegroundThreshold > renderData.backgroundThreshold ? renderData.backgroundThreshold : 0;
+
     float2 valueUV = sourceUVTexture.read(gid).rg;
     float depthValue = sourceDepthTexture.read(uint2(gid.x/4, gid.y/4)).r;
-    float normalizedDepthValue = (depthValue - renderData.depthOffset) / renderData.depthRange;
+    float normalizedDepthValue = (depthValue - depthOffset) / depthRange;
     float valueYUnblurred = sourceYTexture.read(gid).r;
     float valueYBlurred = sourceBlurredYTexture.read(gid).r;
     
     float valueY = 0;
-    if (normalizedDepthValue > renderData.depthBlurForegroundThreshold) {
+    if (normalizedDepthValue > depthBlurForegroundThreshold) {
         valueY = valueYUnblurred;
-    } else if (normalizedDepthValue < renderData.depthBlurBackgroundThreshold) {
+    } else if (normalizedDepthValue < depthBlurBackgroundThreshold) {
         valueY = valueYBlurred;
     } else {
-        float blendRange = renderData.depthBlurForegroundThreshold - renderData.depthBlurBackgroundThreshold;
-        float normalizedBlendDepthValue = (normalizedDepthValue - renderData.depthBlurBackgroundThreshold) / blendRange;
+        float blendRange = depthBlurForegroundThreshold - depthBlurBackgroundThreshold;
+        float normalizedBlendDepthValue = (normalizedDepthValue - depthBlurBackgroundThreshold) / blendRange;
         valueY = valueYUnblurred * normalizedBlendDepthValue + valueYBlurred * (1 - normalizedBlendDepthValue);
     }
     
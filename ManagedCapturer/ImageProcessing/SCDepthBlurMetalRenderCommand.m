@@ -9,19 +9,25 @@
 #import "SCDepthBlurMetalRenderCommand.h"
 
 #import "SCCameraTweaks.h"
+#import "SCMetalUniformRing.h"
 #import "SCMetalUtils.h"
 
 #import <SCFoundation/NSString+SCFormat.h>
 
 @import MetalPerformanceShaders;
 
-@implementation SCDepthBlurMetalRenderCommand
+@implementation SCDepthBlurMetalRenderCommand {
+#if !TARGET_IPHONE_SIMULATOR
+    SCMetalUniformRing *_renderDataRing;
+    // Rebuilt only when the sigma tweak changes
+    MPSImageGaussianBlur *_blurKernel;
+#endif
+}
 
+// The thresholds relative to the depth range are computed by the shader, from the statistics buffer
 typedef struct DepthBlurRenderData {
-    float depthRange;
-    float depthOffset;
-    float depthBlurForegroundThreshold;
-    float depthBlurBackgroundThreshold;
+    float defaultForegroundThreshold;
+    float backgroundThreshold;
 } DepthBlurRenderData;
 
 #pragma mark - SCMetalRenderCommand
@@ -31,27 +37,29 @@ typedef struct DepthBlurRenderData {
                                    textureResource:(SCMetalTextureResource *)textureResource
 {
 #if !TARGET_IPHONE_SIMULATOR
-    CGFloat depthBlurForegroundThreshold = textureResource.depthBlurForegroundThreshold;
-    CGFloat depthBlurBackgroundThreshold =
-        textureResource.depthBlurForegroundThreshold > SCCameraTweaksDepthBlurBackgroundThreshold()
-            ? SCCameraTweaksDepthBlurBackgroundThreshold()
-            : 0;
     DepthBlurRenderData depthBlurRenderData = {
-        .depthRange = textureResource.depthRange,
-        .depthOffset = textureResource.depthOffset,
-        .depthBlurBackgroundThreshold = depthBlurBackgroundThreshold,
-        .depthBlurForegroundThreshold = depthBlurForegroundThreshold,
+        .defaultForegroundThreshold = SCCameraTweaksDepthBlurForegroundThreshold(),
+        .backgroundThreshold = SCCameraTweaksDepthBlurBackgroundThreshold(),
     };
-    id<MTLBuffer> depthBlurRenderDataBuffer =
-        [textureResource.device newBufferWithLength:sizeof(DepthBlurRenderData)
-                                            options:MTLResourceOptionCPUCacheModeDefault];
-    memcpy(depthBlurRenderDataBuffer.contents, &depthBlurRenderData, sizeof(DepthBlurRenderData));
-
-    MPSImageGaussianBlur *kernel =
-        [[MPSImageGaussianBlur alloc] initWithDevice:textureResource.device sigma:SCCameraTweaksBlurSigma()];
-    [kernel encodeToCommandBuffer:commandBuffer
-                    sourceTexture:textureResource.sourceYTexture
-               destinationTexture:textureResource.sourceBlurredYTexture];
+    if (!_renderDataRing) {
+        _renderDataRing =
+            [[SCMetalUniformRing alloc] initWithDevice:textureResource.device length:sizeof(DepthBlurRenderData)];
+    }
+    NSUInteger depthBlurRenderDataOffset = 0;
+    id<MTLBuffer> depthBlurRenderDataBuffer = [_renderDataRing bufferWithBytes:&depthBlurRenderData
+                                                                 commandBuffer:commandBuffer
+                                                                        offset:&depthBlurRenderDataOffset];
+    NSUInteger depthStatisticsOffset = 0;
+    id<MTLBuffer> depthStatisticsBuffer =
+        [textureResource depthStatisticsBufferForCommandBuffer:commandBuffer offset:&depthStatisticsOffset];
+
+    float sigma = SCCameraTweaksBlurSigma();
+    if (!_blurKernel || _blurKernel.sigma != sigma || _blurKernel.device != textureResource.device) {
+        _blurKernel = [[MPSImageGaussianBlur alloc] initWithDevice:textureResource.device sigma:sigma];
+    }
+    [_blurKernel encodeToCommandBuffer:commandBuffer
+                         sourceTexture:textureResource.sourceYTexture
+                    destinationTexture:textureResource.sourceBlurredYTexture];
 
     id<MTLComputeCommandEncoder> commandEncoder = [commandBuffer computeCommandEncoder];
     [commandEncoder setComputePipelineState:pipelineState];
@@ -62,7 +70,8 @@ typedef struct DepthBlurRenderData {
     [commandEncoder setTexture:textureResource.sourceBlurredYTexture atIndex:3];
     [commandEncoder setTexture:textureResource.destinationYTexture atIndex:4];
     [commandEncoder setTexture:textureResource.destinationUVTexture atIndex:5];
-    [commandEncoder setBuffer:depthBlurRenderDataBuffer offset:0 atIndex:0];
+    [commandEncoder setBuffer:depthBlurRenderDataBuffer offset:depthBlurRenderDataOffset atIndex:0];
+    [commandEncoder setBuffer:depthStatisticsBuffer offset:depthStatisticsOffset atIndex:1];
 
     return commandEncoder;
 #else
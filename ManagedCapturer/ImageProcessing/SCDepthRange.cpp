@@ -0,0 +1,145 @@
+//
+//  SCDepthRange.cpp
+//  Snapchat
+//
+
+#include "SCDepthRange.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint16_t kHalfFloatSignMask = 0x8000;
+const uint16_t kHalfFloatExponentMask = 0x7C00;
+
+// Flips negative values entirely and sets the sign bit of positive ones, so that keys compare like the values
+inline uint16_t OrderedKey(uint16_t bits)
+{
+    return bits ^ (uint16_t)(kHalfFloatSignMask | (uint16_t)(0 - (bits >> 15)));
+}
+
+inline uint16_t HalfFloatFromOrderedKey(uint16_t key)
+{
+    return (key & kHalfFloatSignMask) ? key ^ kHalfFloatSignMask : (uint16_t)~key;
+}
+
+// Written with selects only so that it vectorizes, NaNs are masked to keys that never win
+void ReduceRow(const uint16_t *row, size_t width, uint16_t *minimumKey, uint16_t *maximumKey)
+{
+    uint16_t rowMinimumKey = *minimumKey;
+    uint16_t rowMaximumKey = *maximumKey;
+    for (size_t index = 0; index < width; ++index) {
+        uint16_t bits = row[index];
+        uint16_t key = OrderedKey(bits);
+        uint16_t nanMask = (uint16_t)(bits & (uint16_t)~kHalfFloatSignMask) > kHalfFloatExponentMask ? UINT16_MAX : 0;
+        uint16_t minimumCandidate = key | nanMask;
+        uint16_t maximumCandidate = key & (uint16_t)~nanMask;
+        rowMinimumKey = minimumCandidate < rowMinimumKey ? minimumCandidate : rowMinimumKey;
+        rowMaximumKey = maximumCandidate > rowMaximumKey ? maximumCandidate : rowMaximumKey;
+    }
+    *minimumKey = rowMinimumKey;
+    *maximumKey = rowMaximumKey;
+}
+
+} // namespace
+
+int SCDepthRangeOfHalfFloatPlane(const void *baseAddress, size_t width, size_t height, size_t bytesPerRow,
+                                 SCDepthRange *range)
+{
+    if (!baseAddress || !range) {
+        return 0;
+    }
+    uint16_t minimumKey = UINT16_MAX;
+    uint16_t maximumKey = 0;
+    const uint8_t *rowAddress = (const uint8_t *)baseAddress;
+    for (size_t rowIndex = 0; rowIndex < height; ++rowIndex, rowAddress += bytesPerRow) {
+        ReduceRow((const uint16_t *)rowAddress, width, &minimumKey, &maximumKey);
+    }
+    if (minimumKey > maximumKey) {
+        return 0;
+    }
+    range->minimum = SCDepthHalfFloatToFloat(HalfFloatFromOrderedKey(minimumKey));
+    range->maximum = SCDepthHalfFloatToFloat(HalfFloatFromOrderedKey(maximumKey));
+    return 1;
+}
+
+SCDepthRange SCDepthNormalizingRangeOfHalfFloatPlane(const void *baseAddress, size_t width, size_t height,
+                                                     size_t bytesPerRow)
+{
+    SCDepthRange range;
+    if (!SCDepthRangeOfHalfFloatPlane(baseAddress, width, height, bytesPerRow, &range) ||
+        !(range.maximum > range.minimum) || std::isinf(range.maximum - range.minimum)) {
+        range.minimum = 0;
+        range.maximum = 1;
+    }
+    return range;
+}
+
+int SCDepthFocusRectMake(double focusX, double focusY, size_t width, size_t height, SCDepthRect *rect)
+{
+    if (!rect) {
+        return 0;
+    }
+    long long minX = (long long)floor(focusX * width) - kSCDepthFocusRectSize / 2;
+    long long minBottomUpY = (long long)floor(focusY * height) - kSCDepthFocusRectSize / 2;
+    long long minY = (long long)height - minBottomUpY - kSCDepthFocusRectSize;
+    long long maxX = std::min(minX + kSCDepthFocusRectSize, (long long)width);
+    long long maxY = std::min(minY + kSCDepthFocusRectSize, (long long)height);
+    minX = std::max(minX, 0LL);
+    minY = std::max(minY, 0LL);
+    if (minX >= maxX || minY >= maxY) {
+        return 0;
+    }
+    rect->x = (size_t)minX;
+    rect->y = (size_t)minY;
+    rect->width = (size_t)(maxX - minX);
+    rect->height = (size_t)(maxY - minY);
+    return 1;
+}
+
+int SCDepthMaximumOfHalfFloatPlaneRect(const void *baseAddress, size_t bytesPerRow, SCDepthRect rect,
+                                       float *maximum)
+{
+    if (!baseAddress || !maximum) {
+        return 0;
+    }
+    uint16_t minimumKey = UINT16_MAX;
+    uint16_t maximumKey = 0;
+    const uint8_t *rowAddress = (const uint8_t *)baseAddress + rect.y * bytesPerRow + rect.x * sizeof(uint16_t);
+    for (size_t rowIndex = 0; rowIndex < rect.height; ++rowIndex, rowAddress += bytesPerRow) {
+        ReduceRow((const uint16_t *)rowAddress, rect.width, &minimumKey, &maximumKey);
+    }
+    if (minimumKey > maximumKey) {
+        return 0;
+    }
+    *maximum = SCDepthHalfFloatToFloat(HalfFloatFromOrderedKey(maximumKey));
+    return 1;
+}
+
+float SCDepthHalfFloatToFloat(uint16_t bits)
+{
+    uint32_t sign = (uint32_t)(bits & kHalfFloatSignMask) << 16;
+    uint32_t exponent = (bits & kHalfFloatExponentMask) >> 10;
+    uint32_t mantissa = bits & 0x03FF;
+    uint32_t floatBits;
+    if (exponent == 0x1F) {
+        floatBits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        floatBits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        floatBits = sign;
+    } else {
+        // Subnormal, normalized for the wider exponent
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x0400)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        floatBits = sign | (exponent << 23) | ((mantissa & 0x03FF) << 13);
+    }
+    float value;
+    memcpy(&value, &floatBits, sizeof(value));
+    return value;
+}
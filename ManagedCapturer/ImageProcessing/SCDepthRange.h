@@ -0,0 +1,62 @@
+//
+//  SCDepthRange.h
+//  Snapchat
+//
+//  Min / max reduction of half float depth maps on the CPU. Half floats are mapped to 16 bit keys that sort like the
+//  values they encode, so the reduction is integer min / max over whole rows, which the compiler turns into SIMD code
+//  without needing half float arithmetic. Serves as the reference for kernel_depth_statistics, and as its fallback
+//  along with the focus rect statistics. Only depends on the C standard library, the interface is plain C so that it
+//  can be called from Objective-C.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct SCDepthRange {
+    float minimum;
+    float maximum;
+} SCDepthRange;
+
+// Pixels of a depth map, rows top down
+typedef struct SCDepthRect {
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+} SCDepthRect;
+
+// Side of the square around the focus point whose max depth is the depth blur foreground
+enum { kSCDepthFocusRectSize = 4 };
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Range of the non NaN values of the plane, returns 0 if there are none
+int SCDepthRangeOfHalfFloatPlane(const void *baseAddress, size_t width, size_t height, size_t bytesPerRow,
+                                 SCDepthRange *range);
+
+/*
+ Range to normalize the plane with. An empty plane, one with only NaNs or with a single value has no usable range,
+ its values are taken as they are, in 0..1. kernel_depth_statistics readers fall back the same way.
+ */
+SCDepthRange SCDepthNormalizingRangeOfHalfFloatPlane(const void *baseAddress, size_t width, size_t height,
+                                                     size_t bytesPerRow);
+
+/*
+ kSCDepthFocusRectSize square around the normalized focus point, clipped to the map. The point has a bottom left
+ origin like Core Image coordinates. Returns 0 if none of the square is in the map.
+ */
+int SCDepthFocusRectMake(double focusX, double focusY, size_t width, size_t height, SCDepthRect *rect);
+
+// Max of the non NaN values in rect, returns 0 if there are none
+int SCDepthMaximumOfHalfFloatPlaneRect(const void *baseAddress, size_t bytesPerRow, SCDepthRect rect,
+                                       float *maximum);
+
+float SCDepthHalfFloatToFloat(uint16_t bits);
+
+#ifdef __cplusplus
+}
+#endif
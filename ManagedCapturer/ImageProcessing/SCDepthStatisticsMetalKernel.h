@@ -0,0 +1,51 @@
+//
+//  SCDepthStatisticsMetalKernel.h
+//  Snapchat
+//
+
+#import "SCDepthRange.h"
+
+#import <CoreGraphics/CoreGraphics.h>
+#import <Foundation/Foundation.h>
+#if !TARGET_IPHONE_SIMULATOR
+#import <Metal/Metal.h>
+#endif
+
+/*
+ Layout of the buffer kernel_depth_statistics writes, keys compare like the depth values they encode. minKey is not
+ below maxKey when the depth map has no valid value or a single one, the readers then take the depth as 0..1.
+ */
+typedef struct SCDepthStatistics {
+    uint32_t minKey;
+    uint32_t maxKey;
+    // 0 when no valid depth value is in the focus rect
+    uint32_t focusMaxKey;
+    uint32_t padding;
+} SCDepthStatistics;
+
+// Statistics computed on the CPU, focusDepthMax is NULL without a valid depth value in the focus rect
+SCDepthStatistics SCDepthStatisticsMake(SCDepthRange range, const float *focusDepthMax);
+
+/*
+ @class SCDepthStatisticsMetalKernel
+    Encodes the SCDepthStatisticsMetalModule.metal reduction of a depth map: min, max and the max around the focus
+        point. The depth shaders of the same command buffer read the statistics buffer directly, so the values never
+        go through the CPU.
+ */
+@interface SCDepthStatisticsMetalKernel : NSObject
+
+#if !TARGET_IPHONE_SIMULATOR
+// pipelineState is the one of kernel_depth_statistics, the kernel is unavailable without it
+- (instancetype)initWithPipelineState:(id<MTLComputePipelineState>)pipelineState;
+
+/*
+ Returns the buffer the statistics will be written to at *offset once commandBuffer runs, nil if the kernel is
+    unavailable. focusPoint is normalized, the focus rect is the one of SCDepthFocusRectMake.
+ */
+- (id<MTLBuffer>)encodeToCommandBuffer:(id<MTLCommandBuffer>)commandBuffer
+                          depthTexture:(id<MTLTexture>)depthTexture
+                            focusPoint:(const CGPoint *)focusPoint
+                                offset:(NSUInteger *)offset;
+#endif
+
+@end
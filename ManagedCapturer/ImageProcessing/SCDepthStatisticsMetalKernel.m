@@ -0,0 +1,115 @@
+//
+//  SCDepthStatisticsMetalKernel.m
+//  Snapchat
+//
+
+#import "SCDepthStatisticsMetalKernel.h"
+
+#import "SCMetalUniformRing.h"
+
+#import <SCBase/SCMacros.h>
+#import <SCFoundation/SCLog.h>
+
+#if !TARGET_IPHONE_SIMULATOR
+// Must match kDepthStatisticsThreadgroupSize of the shader
+static NSUInteger const kSCDepthStatisticsThreadgroupWidth = 16;
+static NSUInteger const kSCDepthStatisticsThreadgroupHeight = 16;
+
+typedef struct DepthStatisticsRenderData {
+    uint32_t focusOrigin[2];
+    uint32_t focusSize[2];
+} DepthStatisticsRenderData;
+#endif
+
+static uint32_t SCDepthStatisticsOrderedKey(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits ^ ((bits & 0x80000000) ? 0xffffffff : 0x80000000);
+}
+
+SCDepthStatistics SCDepthStatisticsMake(SCDepthRange range, const float *focusDepthMax)
+{
+    SCDepthStatistics statistics = {
+        .minKey = SCDepthStatisticsOrderedKey(range.minimum),
+        .maxKey = SCDepthStatisticsOrderedKey(range.maximum),
+        .focusMaxKey = focusDepthMax ? SCDepthStatisticsOrderedKey(*focusDepthMax) : 0,
+    };
+    return statistics;
+}
+
+@implementation SCDepthStatisticsMetalKernel {
+#if !TARGET_IPHONE_SIMULATOR
+    id<MTLComputePipelineState> _pipelineState;
+    SCMetalUniformRing *_statisticsRing;
+#endif
+}
+
+#if !TARGET_IPHONE_SIMULATOR
+- (instancetype)initWithPipelineState:(id<MTLComputePipelineState>)pipelineState
+{
+    self = [super init];
+    if (self) {
+        if (pipelineState.maxTotalThreadsPerThreadgroup >=
+            kSCDepthStatisticsThreadgroupWidth * kSCDepthStatisticsThreadgroupHeight) {
+            _pipelineState = pipelineState;
+            _statisticsRing =
+                [[SCMetalUniformRing alloc] initWithDevice:pipelineState.device length:sizeof(SCDepthStatistics)];
+        } else {
+            SCLogGeneralError(@"[SCDepthStatisticsMetalKernel] Unavailable, pipeline state:%@", pipelineState);
+        }
+    }
+    return self;
+}
+
+- (id<MTLBuffer>)encodeToCommandBuffer:(id<MTLCommandBuffer>)commandBuffer
+                          depthTexture:(id<MTLTexture>)depthTexture
+                            focusPoint:(const CGPoint *)focusPoint
+                                offset:(NSUInteger *)offset
+{
+    SC_GUARD_ELSE_RETURN_VALUE(_pipelineState && depthTexture, nil);
+
+    SCDepthStatistics initialStatistics = {.minKey = UINT32_MAX};
+    id<MTLBuffer> statisticsBuffer =
+        [_statisticsRing bufferWithBytes:&initialStatistics commandBuffer:commandBuffer offset:offset];
+    DepthStatisticsRenderData renderData = [self _renderDataWithDepthTexture:depthTexture focusPoint:focusPoint];
+
+    id<MTLComputeCommandEncoder> commandEncoder = [commandBuffer computeCommandEncoder];
+    [commandEncoder setComputePipelineState:_pipelineState];
+    [commandEncoder setTexture:depthTexture atIndex:0];
+    [commandEncoder setBytes:&renderData length:sizeof(renderData) atIndex:0];
+    [commandEncoder setBuffer:statisticsBuffer offset:*offset atIndex:1];
+    MTLSize threadsPerThreadgroup =
+        MTLSizeMake(kSCDepthStatisticsThreadgroupWidth, kSCDepthStatisticsThreadgroupHeight, 1);
+    MTLSize threadgroupsPerGrid =
+        MTLSizeMake((depthTexture.width + kSCDepthStatisticsThreadgroupWidth - 1) / kSCDepthStatisticsThreadgroupWidth,
+                    (depthTexture.height + kSCDepthStatisticsThreadgroupHeight - 1) /
+                        kSCDepthStatisticsThreadgroupHeight,
+                    1);
+    [commandEncoder dispatchThreadgroups:threadgroupsPerGrid threadsPerThreadgroup:threadsPerThreadgroup];
+    [commandEncoder endEncoding];
+    return statisticsBuffer;
+}
+
+#pragma mark - Private methods
+
+- (DepthStatisticsRenderData)_renderDataWithDepthTexture:(id<MTLTexture>)depthTexture
+                                              focusPoint:(const CGPoint *)focusPoint
+{
+    DepthStatisticsRenderData renderData = {};
+    SC_GUARD_ELSE_RETURN_VALUE(focusPoint, renderData);
+
+    SCDepthRect focusRect;
+    BOOL hasFocusRect =
+        SCDepthFocusRectMake(focusPoint->x, focusPoint->y, depthTexture.width, depthTexture.height, &focusRect);
+    SC_GUARD_ELSE_RETURN_VALUE(hasFocusRect, renderData);
+
+    renderData.focusOrigin[0] = (uint32_t)focusRect.x;
+    renderData.focusOrigin[1] = (uint32_t)focusRect.y;
+    renderData.focusSize[0] = (uint32_t)focusRect.width;
+    renderData.focusSize[1] = (uint32_t)focusRect.height;
+    return renderData;
+}
+#endif
+
+@end
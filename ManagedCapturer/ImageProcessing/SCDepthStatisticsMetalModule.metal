@@ -0,0 +1,80 @@
+//
+//  SCDepthStatisticsMetalModule.metal
+//  Snapchat
+//
+//  Min, max and focus rect max of a depth map in one pass, for the depth shaders of the same command buffer. Values
+//  are reduced as keys that compare like the floats, so each threadgroup merges its result with a single atomic
+//  min / max. SCDepthRange.cpp is the CPU reference.
+//
+
+#include <metal_stdlib>
+using namespace metal;
+
+typedef struct DepthStatisticsRenderData {
+    uint2 focusOrigin;
+    // Zero without a focus point
+    uint2 focusSize;
+} DepthStatisticsRenderData;
+
+// Initialized to {UINT_MAX, 0, 0} by the encoder, so minKey stays above maxKey without a valid value in the map, and
+// a focus max key of 0 means no valid value in the focus rect. The readers fall back to a 0..1 range for the former.
+typedef struct DepthStatistics {
+    atomic_uint minKey;
+    atomic_uint maxKey;
+    atomic_uint focusMaxKey;
+    uint padding;
+} DepthStatistics;
+
+// The threadgroup must be kDepthStatisticsThreadgroupSize threads, a power of two
+constant uint kDepthStatisticsThreadgroupSize = 256;
+
+static uint depthStatisticsOrderedKey(float value) {
+    uint bits = as_type<uint>(value);
+    return bits ^ ((bits & 0x80000000) ? 0xffffffff : 0x80000000);
+}
+
+kernel void kernel_depth_statistics(texture2d<float, access::read> depthTexture [[texture(0)]],
+                                    constant DepthStatisticsRenderData &renderData [[buffer(0)]],
+                                    device DepthStatistics &statistics [[buffer(1)]],
+                                    uint2 gid [[thread_position_in_grid]],
+                                    uint tid [[thread_index_in_threadgroup]]) {
+    threadgroup uint minKeys[kDepthStatisticsThreadgroupSize];
+    threadgroup uint maxKeys[kDepthStatisticsThreadgroupSize];
+    threadgroup uint focusMaxKeys[kDepthStatisticsThreadgroupSize];
+
+    uint minKey = 0xffffffff;
+    uint maxKey = 0;
+    uint focusMaxKey = 0;
+    if (gid.x < depthTexture.get_width() && gid.y < depthTexture.get_height()) {
+        float value = depthTexture.read(gid).r;
+        if (!isnan(value)) {
+            uint key = depthStatisticsOrderedKey(value);
+            minKey = key;
+            maxKey = key;
+            if (all(gid >= renderData.focusOrigin) && all(gid < renderData.focusOrigin + renderData.focusSize)) {
+                focusMaxKey = key;
+            }
+        }
+    }
+    minKeys[tid] = minKey;
+    maxKeys[tid] = maxKey;
+    focusMaxKeys[tid] = focusMaxKey;
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    for (uint stride = kDepthStatisticsThreadgroupSize / 2; stride > 0; stride /= 2) {
+        if (tid < stride) {
+            minKeys[tid] = min(minKeys[tid], minKeys[tid + stride]);
+            maxKeys[tid] = max(maxKeys[tid], maxKeys[tid + stride]);
+            focusMaxKeys[tid] = max(focusMaxKeys[tid], focusMaxKeys[tid + stride]);
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+
+    if (tid == 0) {
+        atomic_fetch_min_explicit(&statistics.minKey, minKeys[0], memory_order_relaxed);
+        atomic_fetch_max_explicit(&statistics.maxKey, maxKeys[0], memory_order_relaxed);
+        if (focusMaxKeys[0] != 0) {
+            atomic_fetch_max_explicit(&statistics.focusMaxKey, focusMaxKeys[0], memory_order_relaxed);
+        }
+    }
+}
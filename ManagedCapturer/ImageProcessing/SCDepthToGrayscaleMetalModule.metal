@@ -8,19 +8,40 @@
 #include <metal_stdlib>
 using namespace metal;
 
-typedef struct DepthToGrayscaleRenderData {
-    float depthRange;
-    float depthOffset;
-} DepthToGrayscaleRenderData;
+// Written by kernel_depth_statistics earlier in the command buffer
+typedef struct DepthStatistics {
+    uint minKey;
+    uint maxKey;
+    uint focusMaxKey;
+    uint padding;
+} DepthStatistics;
+
+static float depthFromOrderedKey(uint key) {
+    return as_type<float>(key ^ ((key & 0x80000000) ? 0x80000000 : 0xffffffff));
+}
+
+// Without valid depth values minKey is left at UINT_MAX, and a single value has no range either. The depth is then
+// taken as 0..1, like SCDepthNormalizingRangeOfHalfFloatPlane does on the CPU.
+static float2 depthOffsetAndRange(device const DepthStatistics &statistics) {
+    float depthOffset = depthFromOrderedKey(statistics.minKey);
+    float depthRange = depthFromOrderedKey(statistics.maxKey) - depthOffset;
+    if (statistics.minKey >= statistics.maxKey || isinf(depthRange)) {
+        return float2(0, 1);
+    }
+    return float2(depthOffset, depthRange);
+}
 
 kernel void kernel_depth_to_grayscale(texture2d<float, access::read> sourceDepthTexture[[texture(0)]],
                                       texture2d<float, access::write> destinationYTexture [[texture(1)]],
                                       texture2d<float, access::write> destinationUVTexture [[texture(2)]],
-                                      constant DepthToGrayscaleRenderData &renderData [[buffer(0)]],
+                                      device const DepthStatistics &statistics [[buffer(0)]],
                                       uint2 gid [[thread_position_in_grid]],
                                       uint2 size [[threads_per_grid]]) {
     float depthValue = sourceDepthTexture.read(uint2(gid.x/4, gid.y/4)).r;
-    float normalizedDepthValue = (depthValue - renderData.depthOffset) / renderData.depthRange;
+    float2 depthOffsetAndRangeValue = depthOffsetAndRange(statistics);
+    float depthOffset = depthOffsetAndRangeValue.x;
+    float depthRange = depthOffsetAndRangeValue.y;
+    float normalizedDepthValue = (depthValue - depthOffset) / depthRange;
     
     destinationYTexture.write(normalizedDepthValue, gid);
     destinationUVTexture.write(float4(0.5, 0.5, 0, 0), gid);
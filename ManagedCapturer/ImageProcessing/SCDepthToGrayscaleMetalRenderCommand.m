@@ -17,11 +17,6 @@
 
 @implementation SCDepthToGrayscaleMetalRenderCommand
 
-typedef struct DepthToGrayscaleRenderData {
-    float depthRange;
-    float depthOffset;
-} DepthToGrayscaleRenderData;
-
 #pragma mark - SCMetalRenderCommand
 
 - (id<MTLComputeCommandEncoder>)encodeMetalCommand:(id<MTLCommandBuffer>)commandBuffer
@@ -29,13 +24,9 @@ typedef struct DepthToGrayscaleRenderData {
                                    textureResource:(SCMetalTextureResource *)textureResource
 {
 #if !TARGET_IPHONE_SIMULATOR
-    DepthToGrayscaleRenderData depthToGrayscaleRenderData = {
-        .depthRange = textureResource.depthRange, .depthOffset = textureResource.depthOffset,
-    };
-    id<MTLBuffer> depthToGrayscaleDataBuffer =
-        [textureResource.device newBufferWithLength:sizeof(DepthToGrayscaleRenderData)
-                                            options:MTLResourceOptionCPUCacheModeDefault];
-    memcpy(depthToGrayscaleDataBuffer.contents, &depthToGrayscaleRenderData, sizeof(DepthToGrayscaleRenderData));
+    NSUInteger depthStatisticsOffset = 0;
+    id<MTLBuffer> depthStatisticsBuffer =
+        [textureResource depthStatisticsBufferForCommandBuffer:commandBuffer offset:&depthStatisticsOffset];
 
     id<MTLComputeCommandEncoder> commandEncoder = [commandBuffer computeCommandEncoder];
     [commandEncoder setComputePipelineState:pipelineState];
@@ -43,7 +34,7 @@ typedef struct DepthToGrayscaleRenderData {
     [commandEncoder setTexture:textureResource.sourceDepthTexture atIndex:0];
     [commandEncoder setTexture:textureResource.destinationYTexture atIndex:1];
     [commandEncoder setTexture:textureResource.destinationUVTexture atIndex:2];
-    [commandEncoder setBuffer:depthToGrayscaleDataBuffer offset:0 atIndex:0];
+    [commandEncoder setBuffer:depthStatisticsBuffer offset:depthStatisticsOffset atIndex:0];
 
     return commandEncoder;
 #else
@@ -36,13 +36,23 @@
 @end
 
 /**
- NOTE: If we start chaining multiple metal modules we should
- not run them back to back but instead chain different render
- passes.
+ NOTE: render: runs the module standalone (own command buffer, blocking wait and copy back into the pixel buffer).
+ When several metal modules are chained, SCProcessingPipeline encodes them into a single command buffer through
+ encodeToCommandBuffer:textureResource: instead.
  */
 @interface SCMetalModule : NSObject <SCProcessingModule>
 
 // Designated initializer: SCMetalModule should always have a SCMetalRenderCommand
 - (instancetype)initWithMetalRenderCommand:(id<SCMetalRenderCommand>)metalRenderCommand;
 
+#if !TARGET_IPHONE_SIMULATOR
+/**
+ Encodes the render command and its dispatch into commandBuffer without committing it. This is what
+ SCProcessingPipeline uses to run several metal modules in one command buffer, chaining their texture resources.
+ Returns NO if nothing was encoded (e.g. the pipeline state failed to compile).
+ */
+- (BOOL)encodeToCommandBuffer:(id<MTLCommandBuffer>)commandBuffer
+              textureResource:(SCMetalTextureResource *)textureResource;
+#endif
+
 @end
@@ -9,18 +9,17 @@
 #import "SCMetalModule.h"
 
 #import "SCCameraTweaks.h"
+#import "SCMetalPipelineStateCache.h"
 
 #import <SCFoundation/SCAssertWrapper.h>
-#import <SCFoundation/SCLog.h>
 
 @interface SCMetalModule ()
 #if !TARGET_IPHONE_SIMULATOR
-@property (nonatomic, readonly) id<MTLLibrary> library;
 @property (nonatomic, readonly) id<MTLDevice> device;
-@property (nonatomic, readonly) id<MTLFunction> function;
 @property (nonatomic, readonly) id<MTLComputePipelineState> computePipelineState;
 @property (nonatomic, readonly) id<MTLCommandQueue> commandQueue;
 @property (nonatomic, readonly) CVMetalTextureCacheRef textureCache;
+@property (nonatomic, readonly) SCMetalTexturePool *texturePool;
 #endif
 @end
 
@@ -29,11 +28,10 @@
 }
 
 #if !TARGET_IPHONE_SIMULATOR
-@synthesize library = _library;
-@synthesize function = _function;
 @synthesize computePipelineState = _computePipelineState;
 @synthesize commandQueue = _commandQueue;
 @synthesize textureCache = _textureCache;
+@synthesize texturePool = _texturePool;
 #endif
 
 - (instancetype)initWithMetalRenderCommand:(id<SCMetalRenderCommand>)metalRenderCommand
@@ -51,20 +49,43 @@
 {
     CMSampleBufferRef input = renderData.sampleBuffer;
 #if !TARGET_IPHONE_SIMULATOR
-    id<MTLComputePipelineState> pipelineState = self.computePipelineState;
-    SC_GUARD_ELSE_RETURN_VALUE(pipelineState, input);
-
     CVMetalTextureCacheRef textureCache = self.textureCache;
     SC_GUARD_ELSE_RETURN_VALUE(textureCache, input);
 
     id<MTLCommandQueue> commandQueue = self.commandQueue;
     SC_GUARD_ELSE_RETURN_VALUE(commandQueue, input);
 
-    SCMetalTextureResource *textureResource =
-        [[SCMetalTextureResource alloc] initWithRenderData:renderData textureCache:textureCache device:self.device];
+    SCMetalTextureResource *textureResource = [[SCMetalTextureResource alloc] initWithRenderData:renderData
+                                                                                    textureCache:textureCache
+                                                                                          device:self.device
+                                                                                     texturePool:self.texturePool];
     id<MTLCommandBuffer> commandBuffer = [commandQueue commandBuffer];
+    if (![self encodeToCommandBuffer:commandBuffer textureResource:textureResource]) {
+        [textureResource returnTexturesToPool];
+        return input;
+    }
+
+    [commandBuffer commit];
+    [commandBuffer waitUntilCompleted];
+
+    CVImageBufferRef imageBuffer = CMSampleBufferGetImageBuffer(renderData.sampleBuffer);
+    SCMetalCopyTexture(textureResource.destinationYTexture, imageBuffer, 0);
+    SCMetalCopyTexture(textureResource.destinationUVTexture, imageBuffer, 1);
+    [textureResource returnTexturesToPool];
+#endif
+    return input;
+}
+
+#if !TARGET_IPHONE_SIMULATOR
+- (BOOL)encodeToCommandBuffer:(id<MTLCommandBuffer>)commandBuffer
+              textureResource:(SCMetalTextureResource *)textureResource
+{
+    id<MTLComputePipelineState> pipelineState = self.computePipelineState;
+    SC_GUARD_ELSE_RETURN_VALUE(pipelineState, NO);
+
     if (!_metalRenderCommand) {
         SCAssertFail(@"Metal module must be initialized with an SCMetalRenderCommand");
+        return NO;
     }
     id<MTLComputeCommandEncoder> commandEncoder = [_metalRenderCommand encodeMetalCommand:commandBuffer
                                                                             pipelineState:pipelineState
@@ -80,15 +101,9 @@
     [commandEncoder dispatchThreadgroups:threadgroupsPerGrid threadsPerThreadgroup:threadsPerThreadgroup];
 
     [commandEncoder endEncoding];
-    [commandBuffer commit];
-    [commandBuffer waitUntilCompleted];
-
-    CVImageBufferRef imageBuffer = CMSampleBufferGetImageBuffer(renderData.sampleBuffer);
-    SCMetalCopyTexture(textureResource.destinationYTexture, imageBuffer, 0);
-    SCMetalCopyTexture(textureResource.destinationUVTexture, imageBuffer, 1);
-#endif
-    return input;
+    return YES;
 }
+#endif
 
 - (BOOL)requiresDepthData
 {
@@ -99,37 +114,16 @@
 
 #if !TARGET_IPHONE_SIMULATOR
 
-- (id<MTLLibrary>)library
-{
-    if (!_library) {
-        NSString *libPath = [[NSBundle mainBundle] pathForResource:@"sccamera-default" ofType:@"metallib"];
-        NSError *error = nil;
-        _library = [self.device newLibraryWithFile:libPath error:&error];
-        if (error) {
-            SCLogGeneralError(@"Create metallib error: %@", error.description);
-        }
-    }
-    return _library;
-}
-
 - (id<MTLDevice>)device
 {
     return SCGetManagedCaptureMetalDevice();
 }
 
-- (id<MTLFunction>)function
-{
-    return [self.library newFunctionWithName:[_metalRenderCommand functionName]];
-}
-
 - (id<MTLComputePipelineState>)computePipelineState
 {
     if (!_computePipelineState) {
-        NSError *error = nil;
-        _computePipelineState = [self.device newComputePipelineStateWithFunction:self.function error:&error];
-        if (error) {
-            SCLogGeneralError(@"Error while creating compute pipeline state %@", error.description);
-        }
+        _computePipelineState =
+            [[SCMetalPipelineStateCache sharedCache] pipelineStateForFunctionName:[_metalRenderCommand functionName]];
     }
     return _computePipelineState;
 }
@@ -150,6 +144,14 @@
     return _textureCache;
 }
 
+- (SCMetalTexturePool *)texturePool
+{
+    if (!_texturePool) {
+        _texturePool = [[SCMetalTexturePool alloc] initWithDevice:self.device];
+    }
+    return _texturePool;
+}
+
 #endif
 
 @end
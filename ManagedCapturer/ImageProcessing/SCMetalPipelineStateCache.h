@@ -0,0 +1,29 @@
+//
+//  SCMetalPipelineStateCache.h
+//  Snapchat
+//
+
+#import <Foundation/Foundation.h>
+#if !TARGET_IPHONE_SIMULATOR
+#import <Metal/Metal.h>
+#endif
+
+/*
+ @class SCMetalPipelineStateCache
+    Compute pipeline states of the sccamera-default.metallib kernels, compiled once per process. The camera kernels
+        can be compiled ahead of time on a background queue, so that the first frame of a metal module doesn't pay
+        for it. Thread safe.
+ */
+@interface SCMetalPipelineStateCache : NSObject
+
++ (instancetype)sharedCache;
+
+// Compiles the pipeline states of every camera kernel in the background, once
+- (void)precompileCameraKernels;
+
+#if !TARGET_IPHONE_SIMULATOR
+// Compiles on the calling thread if the pipeline state isn't cached yet, nil if the kernel can't be compiled
+- (id<MTLComputePipelineState>)pipelineStateForFunctionName:(NSString *)functionName;
+#endif
+
+@end
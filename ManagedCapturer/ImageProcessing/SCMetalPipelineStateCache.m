@@ -0,0 +1,101 @@
+//
+//  SCMetalPipelineStateCache.m
+//  Snapchat
+//
+
+#import "SCMetalPipelineStateCache.h"
+
+#import "SCMetalUtils.h"
+
+#import <SCBase/SCMacros.h>
+#import <SCFoundation/SCLog.h>
+
+@import QuartzCore;
+
+@implementation SCMetalPipelineStateCache {
+#if !TARGET_IPHONE_SIMULATOR
+    // Guarded by @synchronized(self)
+    NSMutableDictionary<NSString *, id<MTLComputePipelineState>> *_pipelineStates;
+#endif
+}
+
++ (instancetype)sharedCache
+{
+    static SCMetalPipelineStateCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[SCMetalPipelineStateCache alloc] init];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+#if !TARGET_IPHONE_SIMULATOR
+        _pipelineStates = [NSMutableDictionary dictionary];
+#endif
+    }
+    return self;
+}
+
+- (void)precompileCameraKernels
+{
+#if !TARGET_IPHONE_SIMULATOR
+    SC_GUARD_ELSE_RETURN(SCDeviceSupportsMetal());
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            CFTimeInterval startTime = CACurrentMediaTime();
+            NSArray<NSString *> *functionNames = @[
+                @"kernel_exposure_adjust",
+                @"kernel_exposure_adjust_nightvision",
+                @"kernel_exposure_adjust_inverted_nightvision",
+                @"kernel_depth_statistics",
+                @"kernel_depth_blur",
+                @"kernel_depth_to_grayscale",
+                @"kernel_night_mode_enhancement",
+            ];
+            for (NSString *functionName in functionNames) {
+                [self pipelineStateForFunctionName:functionName];
+            }
+            SCLogGeneralInfo(@"[SCMetalPipelineStateCache] Precompiled %tu kernels in %.2fms", functionNames.count,
+                             (CACurrentMediaTime() - startTime) * 1000);
+        });
+    });
+#endif
+}
+
+#if !TARGET_IPHONE_SIMULATOR
+- (id<MTLComputePipelineState>)pipelineStateForFunctionName:(NSString *)functionName
+{
+    SC_GUARD_ELSE_RETURN_VALUE(functionName, nil);
+    @synchronized(self)
+    {
+        id<MTLComputePipelineState> pipelineState = _pipelineStates[functionName];
+        if (pipelineState) {
+            return pipelineState;
+        }
+    }
+    // Compiled outside of the lock, a kernel racing with the precompilation may be compiled twice
+    id<MTLFunction> function = [SCGetManagedCaptureMetalLibrary() newFunctionWithName:functionName];
+    SC_GUARD_ELSE_RETURN_VALUE(function, nil);
+    NSError *error = nil;
+    id<MTLComputePipelineState> pipelineState =
+        [SCGetManagedCaptureMetalDevice() newComputePipelineStateWithFunction:function error:&error];
+    if (!pipelineState) {
+        SCLogGeneralError(@"Error while creating compute pipeline state %@", error.description);
+        return nil;
+    }
+    @synchronized(self)
+    {
+        if (!_pipelineStates[functionName]) {
+            _pipelineStates[functionName] = pipelineState;
+        }
+        return _pipelineStates[functionName];
+    }
+}
+#endif
+
+@end
@@ -0,0 +1,40 @@
+//
+//  SCMetalTexturePool.h
+//  Snapchat
+//
+
+#import <Foundation/Foundation.h>
+#if !TARGET_IPHONE_SIMULATOR
+#import <Metal/Metal.h>
+#endif
+
+/*
+ @class SCMetalTexturePool
+    Recycles the shader writable textures of SCMetalTextureResource across frames, keyed by pixel format and size, so
+        that metal modules don't allocate their intermediate textures on every frame. Textures are only handed out
+        again once returned, which callers do after the command buffer using them completed.
+    Free textures are dropped when the app enters the background. Dequeue and return can be called from any thread.
+ */
+@interface SCMetalTexturePool : NSObject
+
+// Dequeues that found a free texture, and all dequeues
+@property (nonatomic, readonly) NSUInteger hitCount;
+@property (nonatomic, readonly) NSUInteger requestCount;
+// Bytes of the textures created by the pool that are free or handed out
+@property (nonatomic, readonly) NSUInteger residentBytes;
+
+#if !TARGET_IPHONE_SIMULATOR
+- (instancetype)initWithDevice:(id<MTLDevice>)device;
+
+- (id<MTLTexture>)dequeueTextureWithPixelFormat:(MTLPixelFormat)pixelFormat
+                                          width:(NSUInteger)width
+                                         height:(NSUInteger)height;
+
+// The textures must come from this pool, and the GPU must be done with them
+- (void)returnTextures:(NSArray<id<MTLTexture>> *)textures;
+#endif
+
+// Drops the free textures, handed out ones are still returned to the pool
+- (void)trim;
+
+@end
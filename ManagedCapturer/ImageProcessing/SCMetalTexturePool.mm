@@ -0,0 +1,185 @@
+//
+//  SCMetalTexturePool.mm
+//  Snapchat
+//
+
+#import "SCMetalTexturePool.h"
+
+#import <SCBase/SCMacros.h>
+#import <SCFoundation/SCLog.h>
+
+@import UIKit;
+
+#include <unordered_map>
+
+#if !TARGET_IPHONE_SIMULATOR
+// Enough for a few frames in flight through a chain of modules, extra returned textures are released
+static NSUInteger const kSCMetalTexturePoolMaxFreeTexturesPerKey = 6;
+
+static NSUInteger SCMetalTexturePoolBytesPerPixel(MTLPixelFormat pixelFormat)
+{
+    switch (pixelFormat) {
+    case MTLPixelFormatR8Unorm:
+        return 1;
+    case MTLPixelFormatRG8Unorm:
+    case MTLPixelFormatR16Float:
+        return 2;
+    case MTLPixelFormatRG16Float:
+    case MTLPixelFormatR32Float:
+        return 4;
+    default:
+        return 4;
+    }
+}
+
+static NSUInteger SCMetalTexturePoolBytes(MTLPixelFormat pixelFormat, NSUInteger width, NSUInteger height)
+{
+    return width * height * SCMetalTexturePoolBytesPerPixel(pixelFormat);
+}
+
+// Metal caps textures at 16384 pixels a side and pixel formats are below 1000, so the three fit in 64 bits
+static uint64_t SCMetalTexturePoolKey(MTLPixelFormat pixelFormat, NSUInteger width, NSUInteger height)
+{
+    return ((uint64_t)pixelFormat << 48) | ((uint64_t)(width & 0xFFFFFF) << 24) | (uint64_t)(height & 0xFFFFFF);
+}
+#endif
+
+@implementation SCMetalTexturePool {
+#if !TARGET_IPHONE_SIMULATOR
+    id<MTLDevice> _device;
+    // Guarded by @synchronized(self)
+    std::unordered_map<uint64_t, NSMutableArray<id<MTLTexture>> *> _freeTextures;
+#endif
+}
+
+@synthesize hitCount = _hitCount;
+@synthesize requestCount = _requestCount;
+@synthesize residentBytes = _residentBytes;
+
+#if !TARGET_IPHONE_SIMULATOR
+- (instancetype)initWithDevice:(id<MTLDevice>)device
+{
+    self = [super init];
+    if (self) {
+        _device = device;
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(_applicationDidEnterBackground)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (id<MTLTexture>)dequeueTextureWithPixelFormat:(MTLPixelFormat)pixelFormat
+                                          width:(NSUInteger)width
+                                         height:(NSUInteger)height
+{
+    uint64_t key = SCMetalTexturePoolKey(pixelFormat, width, height);
+    @synchronized(self)
+    {
+        ++_requestCount;
+        auto freeTextures = _freeTextures.find(key);
+        if (freeTextures != _freeTextures.end() && freeTextures->second.count > 0) {
+            id<MTLTexture> texture = freeTextures->second.lastObject;
+            [freeTextures->second removeLastObject];
+            ++_hitCount;
+            return texture;
+        }
+    }
+    MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:pixelFormat
+                                                                                                 width:width
+                                                                                                height:height
+                                                                                             mipmapped:NO];
+    textureDescriptor.usage |= MTLTextureUsageShaderWrite;
+    id<MTLTexture> texture = [_device newTextureWithDescriptor:textureDescriptor];
+    SC_GUARD_ELSE_RETURN_VALUE(texture, nil);
+    @synchronized(self)
+    {
+        _residentBytes += SCMetalTexturePoolBytes(pixelFormat, width, height);
+    }
+    return texture;
+}
+
+- (void)returnTextures:(NSArray<id<MTLTexture>> *)textures
+{
+    @synchronized(self)
+    {
+        for (id<MTLTexture> texture in textures) {
+            NSMutableArray<id<MTLTexture>> *&freeTextures =
+                _freeTextures[SCMetalTexturePoolKey(texture.pixelFormat, texture.width, texture.height)];
+            if (!freeTextures) {
+                freeTextures = [NSMutableArray array];
+            }
+            if (freeTextures.count < kSCMetalTexturePoolMaxFreeTexturesPerKey) {
+                [freeTextures addObject:texture];
+            } else {
+                _residentBytes -= [self _bytesOfTexture:texture];
+            }
+        }
+    }
+}
+#endif
+
+- (void)trim
+{
+#if !TARGET_IPHONE_SIMULATOR
+    NSUInteger trimmedBytes = 0;
+    @synchronized(self)
+    {
+        for (const auto &freeTextures : _freeTextures) {
+            for (id<MTLTexture> texture in freeTextures.second) {
+                trimmedBytes += [self _bytesOfTexture:texture];
+            }
+        }
+        _freeTextures.clear();
+        _residentBytes -= trimmedBytes;
+    }
+    SCLogGeneralInfo(@"[SCMetalTexturePool] Trimmed %tu bytes, %tu bytes still resident, hit rate %tu/%tu",
+                     trimmedBytes, self.residentBytes, self.hitCount, self.requestCount);
+#endif
+}
+
+- (NSUInteger)hitCount
+{
+    @synchronized(self)
+    {
+        return _hitCount;
+    }
+}
+
+- (NSUInteger)requestCount
+{
+    @synchronized(self)
+    {
+        return _requestCount;
+    }
+}
+
+- (NSUInteger)residentBytes
+{
+    @synchronized(self)
+    {
+        return _residentBytes;
+    }
+}
+
+#pragma mark - Private methods
+
+#if !TARGET_IPHONE_SIMULATOR
+- (NSUInteger)_bytesOfTexture:(id<MTLTexture>)texture
+{
+    return SCMetalTexturePoolBytes(texture.pixelFormat, texture.width, texture.height);
+}
+#endif
+
+- (void)_applicationDidEnterBackground
+{
+    [self trim];
+}
+
+@end
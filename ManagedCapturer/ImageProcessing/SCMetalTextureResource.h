@@ -7,6 +7,7 @@
 
 #import "SCProcessingModule.h"
 #import "SCCapturerDefines.h"
+#import "SCMetalTexturePool.h"
 
 #import <Foundation/Foundation.h>
 #if !TARGET_IPHONE_SIMULATOR
@@ -20,7 +21,10 @@
         selects which textures it needs. Textures are lazily initialiazed to optimize performance.
         Additionally, information pertaining to depth is provided if normalizing depth is desired:
         depthRange is the range of possible depth values [depthOffset, depthOffset + depthRange],
-        where depthOffset is the min depth value in the given depth map.
+        where depthOffset is the min depth value in the given depth map. A depth map without a usable range, e.g.
+        all NaN, has the range [0, 1].
+    Intermediate textures come from texturePool when one is given, the owner of the last resource of a chain returns
+        them with returnTexturesToPool once the GPU is done with them.
     NOTE: This class is NOT thread safe -- ensure any calls are made by a performer by calling
         SCAssertPerformer before actually accessing any textures
  */
@@ -48,7 +52,29 @@
 #if !TARGET_IPHONE_SIMULATOR
 - (instancetype)initWithRenderData:(RenderData)renderData
                       textureCache:(CVMetalTextureCacheRef)textureCache
-                            device:(id<MTLDevice>)device;
+                            device:(id<MTLDevice>)device
+                       texturePool:(SCMetalTexturePool *)texturePool;
+
+/*
+ Chains the resource after previousTextureResource for fused execution in one command buffer: the source textures
+    are the previous pass' destination textures. If the previous resource is itself chained, its source textures
+    (the destination of the pass before it) are free again and are reused as destination textures, so a chain of
+    any length ping-pongs between two intermediate texture pairs. The resource uses the texture pool of the previous
+    one and takes over its pooled textures.
+ */
+- (instancetype)initWithRenderData:(RenderData)renderData
+                      textureCache:(CVMetalTextureCacheRef)textureCache
+                            device:(id<MTLDevice>)device
+           previousTextureResource:(SCMetalTextureResource *)previousTextureResource;
+
+/*
+ Buffer of SCDepthStatistics at *offset for the depth shaders, encoded into commandBuffer the first time it is
+    requested. Falls back to the same statistics computed on the CPU if the kernel is unavailable.
+ */
+- (id<MTLBuffer>)depthStatisticsBufferForCommandBuffer:(id<MTLCommandBuffer>)commandBuffer offset:(NSUInteger *)offset;
+
+// Returns the pooled textures of the chain ending with this resource, they must not be used afterwards
+- (void)returnTexturesToPool;
 #endif
 
 @end
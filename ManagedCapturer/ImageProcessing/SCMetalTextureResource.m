@@ -9,12 +9,25 @@
 
 #import "SCCameraSettingUtils.h"
 #import "SCCameraTweaks.h"
+#import "SCDepthRange.h"
+#import "SCDepthStatisticsMetalKernel.h"
+#import "SCMetalPipelineStateCache.h"
 #import "SCMetalUtils.h"
 
-@import CoreImage;
+#import <SCBase/SCMacros.h>
 
 #if !TARGET_IPHONE_SIMULATOR
-static NSInteger const kSCFocusRectSize = 4;
+static SCDepthStatisticsMetalKernel *SCMetalTextureResourceDepthStatisticsKernel(void)
+{
+    static SCDepthStatisticsMetalKernel *kernel;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        id<MTLComputePipelineState> pipelineState =
+            [[SCMetalPipelineStateCache sharedCache] pipelineStateForFunctionName:@"kernel_depth_statistics"];
+        kernel = [[SCDepthStatisticsMetalKernel alloc] initWithPipelineState:pipelineState];
+    });
+    return kernel;
+}
 #endif
 
 @interface SCMetalTextureResource ()
@@ -26,7 +39,15 @@ static NSInteger const kSCFocusRectSize = 4;
 @implementation SCMetalTextureResource {
     RenderData _renderData;
     CVImageBufferRef _imageBuffer;
-    CIContext *_context;
+    // YES when the source textures are intermediate textures from a previous pass rather than the pixel buffer
+    BOOL _chained;
+    SCMetalTexturePool *_texturePool;
+    // Textures dequeued from _texturePool by this resource and the ones it is chained after
+    NSMutableArray<id<MTLTexture>> *_pooledTextures;
+    id<MTLBuffer> _depthStatisticsBuffer;
+    NSUInteger _depthStatisticsBufferOffset;
+    SCDepthRange _depthNormalizingRange;
+    BOOL _hasDepthNormalizingRange;
 }
 
 #if !TARGET_IPHONE_SIMULATOR
@@ -36,15 +57,13 @@ static NSInteger const kSCFocusRectSize = 4;
 @synthesize destinationUVTexture = _destinationUVTexture;
 @synthesize sourceBlurredYTexture = _sourceBlurredYTexture;
 @synthesize sourceDepthTexture = _sourceDepthTexture;
-@synthesize depthRange = _depthRange;
-@synthesize depthOffset = _depthOffset;
-@synthesize depthBlurForegroundThreshold = _depthBlurForegroundThreshold;
 @synthesize device = _device;
 @synthesize sampleBufferMetadata = _sampleBufferMetadata;
 
 - (instancetype)initWithRenderData:(RenderData)renderData
                       textureCache:(CVMetalTextureCacheRef)textureCache
                             device:(id<MTLDevice>)device
+                       texturePool:(SCMetalTexturePool *)texturePool
 {
     self = [super init];
     if (self) {
@@ -52,10 +71,39 @@ static NSInteger const kSCFocusRectSize = 4;
         _renderData = renderData;
         _textureCache = textureCache;
         _device = device;
-        _context = [CIContext contextWithOptions:@{ kCIContextWorkingFormat : @(kCIFormatRGBAh) }];
+        _texturePool = texturePool;
+        _pooledTextures = [NSMutableArray array];
     }
     return self;
 }
+
+- (instancetype)initWithRenderData:(RenderData)renderData
+                      textureCache:(CVMetalTextureCacheRef)textureCache
+                            device:(id<MTLDevice>)device
+           previousTextureResource:(SCMetalTextureResource *)previousTextureResource
+{
+    self = [self initWithRenderData:renderData
+                       textureCache:textureCache
+                             device:device
+                        texturePool:previousTextureResource->_texturePool];
+    if (self) {
+        _chained = YES;
+        _pooledTextures = previousTextureResource->_pooledTextures;
+        _sourceYTexture = previousTextureResource.destinationYTexture;
+        _sourceUVTexture = previousTextureResource.destinationUVTexture;
+        if (previousTextureResource->_chained) {
+            _destinationYTexture = previousTextureResource.sourceYTexture;
+            _destinationUVTexture = previousTextureResource.sourceUVTexture;
+        }
+    }
+    return self;
+}
+
+- (void)returnTexturesToPool
+{
+    [_texturePool returnTextures:_pooledTextures];
+    [_pooledTextures removeAllObjects];
+}
 #endif
 
 #if !TARGET_IPHONE_SIMULATOR
@@ -83,13 +131,7 @@ static NSInteger const kSCFocusRectSize = 4;
 - (id<MTLTexture>)destinationYTexture
 {
     if (!_destinationYTexture) {
-        MTLTextureDescriptor *textureDescriptor =
-            [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
-                                                               width:CVPixelBufferGetWidthOfPlane(_imageBuffer, 0)
-                                                              height:CVPixelBufferGetHeightOfPlane(_imageBuffer, 0)
-                                                           mipmapped:NO];
-        textureDescriptor.usage |= MTLTextureUsageShaderWrite;
-        _destinationYTexture = [_device newTextureWithDescriptor:textureDescriptor];
+        _destinationYTexture = [self _intermediateTextureWithPixelFormat:MTLPixelFormatR8Unorm planeIndex:0];
     }
     return _destinationYTexture;
 }
@@ -97,13 +139,7 @@ static NSInteger const kSCFocusRectSize = 4;
 - (id<MTLTexture>)destinationUVTexture
 {
     if (!_destinationUVTexture) {
-        MTLTextureDescriptor *textureDescriptor =
-            [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRG8Unorm
-                                                               width:CVPixelBufferGetWidthOfPlane(_imageBuffer, 1)
-                                                              height:CVPixelBufferGetHeightOfPlane(_imageBuffer, 1)
-                                                           mipmapped:NO];
-        textureDescriptor.usage |= MTLTextureUsageShaderWrite;
-        _destinationUVTexture = [_device newTextureWithDescriptor:textureDescriptor];
+        _destinationUVTexture = [self _intermediateTextureWithPixelFormat:MTLPixelFormatRG8Unorm planeIndex:1];
     }
     return _destinationUVTexture;
 }
@@ -111,13 +147,7 @@ static NSInteger const kSCFocusRectSize = 4;
 - (id<MTLTexture>)sourceBlurredYTexture
 {
     if (!_sourceBlurredYTexture) {
-        MTLTextureDescriptor *textureDescriptor =
-            [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
-                                                               width:CVPixelBufferGetWidthOfPlane(_imageBuffer, 0)
-                                                              height:CVPixelBufferGetHeightOfPlane(_imageBuffer, 0)
-                                                           mipmapped:NO];
-        textureDescriptor.usage |= MTLTextureUsageShaderWrite;
-        _sourceBlurredYTexture = [_device newTextureWithDescriptor:textureDescriptor];
+        _sourceBlurredYTexture = [self _intermediateTextureWithPixelFormat:MTLPixelFormatR8Unorm planeIndex:0];
     }
     return _sourceBlurredYTexture;
 }
@@ -135,72 +165,49 @@ static NSInteger const kSCFocusRectSize = 4;
 
 - (float)depthRange
 {
-    if (_depthRange == 0) {
-        //  Get min/max values of depth image to normalize
-        size_t bufferWidth = CVPixelBufferGetWidth(_renderData.depthDataMap);
-        size_t bufferHeight = CVPixelBufferGetHeight(_renderData.depthDataMap);
-        size_t bufferBytesPerRow = CVPixelBufferGetBytesPerRow(_renderData.depthDataMap);
-
-        CVPixelBufferLockBaseAddress(_renderData.depthDataMap, kCVPixelBufferLock_ReadOnly);
-        unsigned char *pixelBufferPointer = CVPixelBufferGetBaseAddress(_renderData.depthDataMap);
-        __fp16 *bufferPtr = (__fp16 *)pixelBufferPointer;
-        uint32_t ptrInc = (int)bufferBytesPerRow / sizeof(__fp16);
-
-        float depthMin = MAXFLOAT;
-        float depthMax = -MAXFLOAT;
-        for (int j = 0; j < bufferHeight; j++) {
-            for (int i = 0; i < bufferWidth; i++) {
-                float value = bufferPtr[i];
-                if (!isnan(value)) {
-                    depthMax = MAX(depthMax, value);
-                    depthMin = MIN(depthMin, value);
-                }
-            }
-            bufferPtr += ptrInc;
-        }
-        CVPixelBufferUnlockBaseAddress(_renderData.depthDataMap, kCVPixelBufferLock_ReadOnly);
-        _depthRange = depthMax - depthMin;
-        _depthOffset = depthMin;
-    }
-    return _depthRange;
+    SCDepthRange range = [self _depthNormalizingRange];
+    return range.maximum - range.minimum;
 }
 
 - (float)depthOffset
 {
-    if (_depthRange == 0) {
-        [self depthRange];
-    }
-    return _depthOffset;
+    return [self _depthNormalizingRange].minimum;
 }
 
 - (CGFloat)depthBlurForegroundThreshold
 {
-    if (_renderData.depthBlurPointOfInterest) {
-        CGPoint point = *_renderData.depthBlurPointOfInterest;
-        CIImage *disparityImage = [CIImage imageWithCVPixelBuffer:_renderData.depthDataMap];
-        CIVector *vector =
-            [CIVector vectorWithX:point.x * CVPixelBufferGetWidth(_renderData.depthDataMap) - kSCFocusRectSize / 2
-                                Y:point.y * CVPixelBufferGetHeight(_renderData.depthDataMap) - kSCFocusRectSize / 2
-                                Z:kSCFocusRectSize
-                                W:kSCFocusRectSize];
-        CIImage *minMaxImage =
-            [[disparityImage imageByClampingToExtent] imageByApplyingFilter:@"CIAreaMinMaxRed"
-                                                        withInputParameters:@{kCIInputExtentKey : vector}];
-        UInt8 pixel[4] = {0, 0, 0, 0};
-        [_context render:minMaxImage
-                toBitmap:&pixel
-                rowBytes:4
-                  bounds:CGRectMake(0, 0, 1, 1)
-                  format:kCIFormatRGBA8
-              colorSpace:nil];
-        CGFloat disparity = pixel[1] / 255.0;
-        CGFloat normalizedDisparity = (disparity - self.depthOffset) / self.depthRange;
-        return normalizedDisparity;
+    float focusDepthMax;
+    if ([self _getFocusDepthMax:&focusDepthMax]) {
+        // Clamped like the shader does
+        return (MIN(MAX(focusDepthMax, 0), 1) - self.depthOffset) / self.depthRange;
     } else {
         return SCCameraTweaksDepthBlurForegroundThreshold();
     }
 }
 
+- (id<MTLBuffer>)depthStatisticsBufferForCommandBuffer:(id<MTLCommandBuffer>)commandBuffer offset:(NSUInteger *)offset
+{
+    if (!_depthStatisticsBuffer) {
+        _depthStatisticsBuffer =
+            [SCMetalTextureResourceDepthStatisticsKernel() encodeToCommandBuffer:commandBuffer
+                                                                    depthTexture:self.sourceDepthTexture
+                                                                      focusPoint:_renderData.depthBlurPointOfInterest
+                                                                          offset:&_depthStatisticsBufferOffset];
+    }
+    if (!_depthStatisticsBuffer) {
+        float focusDepthMax;
+        BOOL hasFocusDepth = [self _getFocusDepthMax:&focusDepthMax];
+        SCDepthStatistics statistics =
+            SCDepthStatisticsMake([self _depthNormalizingRange], hasFocusDepth ? &focusDepthMax : NULL);
+        _depthStatisticsBuffer = [_device newBufferWithBytes:&statistics
+                                                      length:sizeof(SCDepthStatistics)
+                                                     options:MTLResourceOptionCPUCacheModeDefault];
+        _depthStatisticsBufferOffset = 0;
+    }
+    *offset = _depthStatisticsBufferOffset;
+    return _depthStatisticsBuffer;
+}
+
 - (SampleBufferMetadata)sampleBufferMetadata
 {
     SampleBufferMetadata sampleMetadata = {
@@ -210,6 +217,59 @@ static NSInteger const kSCFocusRectSize = 4;
     return sampleMetadata;
 }
 
+#pragma mark - Private methods
+
+- (SCDepthRange)_depthNormalizingRange
+{
+    if (!_hasDepthNormalizingRange) {
+        CVPixelBufferRef depthDataMap = _renderData.depthDataMap;
+        CVPixelBufferLockBaseAddress(depthDataMap, kCVPixelBufferLock_ReadOnly);
+        _depthNormalizingRange = SCDepthNormalizingRangeOfHalfFloatPlane(
+            CVPixelBufferGetBaseAddress(depthDataMap), CVPixelBufferGetWidth(depthDataMap),
+            CVPixelBufferGetHeight(depthDataMap), CVPixelBufferGetBytesPerRow(depthDataMap));
+        CVPixelBufferUnlockBaseAddress(depthDataMap, kCVPixelBufferLock_ReadOnly);
+        _hasDepthNormalizingRange = YES;
+    }
+    return _depthNormalizingRange;
+}
+
+// Max depth around the point of interest, the same kernel_depth_statistics computes on the GPU
+- (BOOL)_getFocusDepthMax:(float *)focusDepthMax
+{
+    SC_GUARD_ELSE_RETURN_VALUE(_renderData.depthBlurPointOfInterest, NO);
+    CVPixelBufferRef depthDataMap = _renderData.depthDataMap;
+    CGPoint point = *_renderData.depthBlurPointOfInterest;
+    SCDepthRect focusRect;
+    BOOL hasFocusRect = SCDepthFocusRectMake(point.x, point.y, CVPixelBufferGetWidth(depthDataMap),
+                                             CVPixelBufferGetHeight(depthDataMap), &focusRect);
+    SC_GUARD_ELSE_RETURN_VALUE(hasFocusRect, NO);
+
+    CVPixelBufferLockBaseAddress(depthDataMap, kCVPixelBufferLock_ReadOnly);
+    BOOL hasFocusDepth = SCDepthMaximumOfHalfFloatPlaneRect(
+        CVPixelBufferGetBaseAddress(depthDataMap), CVPixelBufferGetBytesPerRow(depthDataMap), focusRect, focusDepthMax);
+    CVPixelBufferUnlockBaseAddress(depthDataMap, kCVPixelBufferLock_ReadOnly);
+    return hasFocusDepth;
+}
+
+- (id<MTLTexture>)_intermediateTextureWithPixelFormat:(MTLPixelFormat)pixelFormat planeIndex:(size_t)planeIndex
+{
+    NSUInteger width = CVPixelBufferGetWidthOfPlane(_imageBuffer, planeIndex);
+    NSUInteger height = CVPixelBufferGetHeightOfPlane(_imageBuffer, planeIndex);
+    if (!_texturePool) {
+        MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:pixelFormat
+                                                                                                     width:width
+                                                                                                    height:height
+                                                                                                 mipmapped:NO];
+        textureDescriptor.usage |= MTLTextureUsageShaderWrite;
+        return [_device newTextureWithDescriptor:textureDescriptor];
+    }
+    id<MTLTexture> texture = [_texturePool dequeueTextureWithPixelFormat:pixelFormat width:width height:height];
+    if (texture) {
+        [_pooledTextures addObject:texture];
+    }
+    return texture;
+}
+
 #endif
 
 @end
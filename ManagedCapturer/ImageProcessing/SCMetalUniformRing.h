@@ -0,0 +1,28 @@
+//
+//  SCMetalUniformRing.h
+//  Snapchat
+//
+
+#import <Foundation/Foundation.h>
+#if !TARGET_IPHONE_SIMULATOR
+#import <Metal/Metal.h>
+#endif
+
+/*
+ @class SCMetalUniformRing
+    Triple buffered storage for the small per frame parameters of the metal shaders: one buffer split in slots, a slot
+        being reused once the command buffer it was written for completed. Frames beyond the slot count get a buffer
+        of their own rather than waiting for the GPU. Thread safe.
+ */
+@interface SCMetalUniformRing : NSObject
+
+#if !TARGET_IPHONE_SIMULATOR
+- (instancetype)initWithDevice:(id<MTLDevice>)device length:(NSUInteger)length;
+
+// Copies length bytes for commandBuffer, which must not be committed yet. Bind the returned buffer at *offset.
+- (id<MTLBuffer>)bufferWithBytes:(const void *)bytes
+                   commandBuffer:(id<MTLCommandBuffer>)commandBuffer
+                          offset:(NSUInteger *)offset;
+#endif
+
+@end
@@ -0,0 +1,89 @@
+//
+//  SCMetalUniformRing.m
+//  Snapchat
+//
+
+#import "SCMetalUniformRing.h"
+
+#import <SCBase/SCMacros.h>
+
+#if !TARGET_IPHONE_SIMULATOR
+static NSUInteger const kSCMetalUniformRingSlotCount = 3;
+// Buffer offsets of constant arguments must be aligned, 256 covers every GPU family
+static NSUInteger const kSCMetalUniformRingSlotAlignment = 256;
+#endif
+
+@implementation SCMetalUniformRing {
+#if !TARGET_IPHONE_SIMULATOR
+    id<MTLDevice> _device;
+    id<MTLBuffer> _buffer;
+    NSUInteger _length;
+    NSUInteger _slotStride;
+    // Guarded by @synchronized(self)
+    BOOL _slotInFlight[kSCMetalUniformRingSlotCount];
+    NSUInteger _nextSlot;
+#endif
+}
+
+#if !TARGET_IPHONE_SIMULATOR
+- (instancetype)initWithDevice:(id<MTLDevice>)device length:(NSUInteger)length
+{
+    self = [super init];
+    if (self) {
+        _device = device;
+        _length = length;
+        _slotStride = (length + kSCMetalUniformRingSlotAlignment - 1) / kSCMetalUniformRingSlotAlignment *
+                      kSCMetalUniformRingSlotAlignment;
+        _buffer = [device newBufferWithLength:_slotStride * kSCMetalUniformRingSlotCount
+                                      options:MTLResourceOptionCPUCacheModeDefault];
+    }
+    return self;
+}
+
+- (id<MTLBuffer>)bufferWithBytes:(const void *)bytes
+                   commandBuffer:(id<MTLCommandBuffer>)commandBuffer
+                          offset:(NSUInteger *)offset
+{
+    NSUInteger slot = [self _acquireSlot];
+    if (slot == NSNotFound) {
+        *offset = 0;
+        return [_device newBufferWithBytes:bytes length:_length options:MTLResourceOptionCPUCacheModeDefault];
+    }
+    *offset = slot * _slotStride;
+    memcpy((uint8_t *)_buffer.contents + *offset, bytes, _length);
+    [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> completedCommandBuffer) {
+        [self _releaseSlot:slot];
+    }];
+    return _buffer;
+}
+
+#pragma mark - Private methods
+
+// Completion order isn't guaranteed across command queues, so free slots are looked up rather than assumed in order
+- (NSUInteger)_acquireSlot
+{
+    SC_GUARD_ELSE_RETURN_VALUE(_buffer, NSNotFound);
+    @synchronized(self)
+    {
+        for (NSUInteger attempt = 0; attempt < kSCMetalUniformRingSlotCount; ++attempt) {
+            NSUInteger slot = (_nextSlot + attempt) % kSCMetalUniformRingSlotCount;
+            if (!_slotInFlight[slot]) {
+                _slotInFlight[slot] = YES;
+                _nextSlot = (slot + 1) % kSCMetalUniformRingSlotCount;
+                return slot;
+            }
+        }
+    }
+    return NSNotFound;
+}
+
+- (void)_releaseSlot:(NSUInteger)slot
+{
+    @synchronized(self)
+    {
+        _slotInFlight[slot] = NO;
+    }
+}
+#endif
+
+@end
@@ -8,13 +8,18 @@
 #import "SCNightModeEnhancementMetalRenderCommand.h"
 
 #import "SCCameraTweaks.h"
+#import "SCMetalUniformRing.h"
 #import "SCMetalUtils.h"
 
 #import <SCFoundation/NSString+SCFormat.h>
 
 @import Metal;
 
-@implementation SCNightModeEnhancementMetalRenderCommand
+@implementation SCNightModeEnhancementMetalRenderCommand {
+#if !TARGET_IPHONE_SIMULATOR
+    SCMetalUniformRing *_metadataRing;
+#endif
+}
 
 #pragma mark - SCMetalRenderCommand
 
@@ -30,14 +35,18 @@
         .exposureTime = textureResource.sampleBufferMetadata.exposureTime,
         .brightness = textureResource.sampleBufferMetadata.brightness,
     };
-    id<MTLBuffer> metadataBuffer = [textureResource.device newBufferWithLength:sizeof(SampleBufferMetadata)
-                                                                       options:MTLResourceOptionCPUCacheModeDefault];
-    memcpy(metadataBuffer.contents, &sampleBufferMetadata, sizeof(SampleBufferMetadata));
+    if (!_metadataRing) {
+        _metadataRing =
+            [[SCMetalUniformRing alloc] initWithDevice:textureResource.device length:sizeof(SampleBufferMetadata)];
+    }
+    NSUInteger metadataOffset = 0;
+    id<MTLBuffer> metadataBuffer =
+        [_metadataRing bufferWithBytes:&sampleBufferMetadata commandBuffer:commandBuffer offset:&metadataOffset];
     [commandEncoder setTexture:textureResource.sourceYTexture atIndex:0];
     [commandEncoder setTexture:textureResource.sourceUVTexture atIndex:1];
     [commandEncoder setTexture:textureResource.destinationYTexture atIndex:2];
     [commandEncoder setTexture:textureResource.destinationUVTexture atIndex:3];
-    [commandEncoder setBuffer:metadataBuffer offset:0 atIndex:0];
+    [commandEncoder setBuffer:metadataBuffer offset:metadataOffset atIndex:0];
 #endif
 
     return commandEncoder;
@@ -7,6 +7,8 @@
 
 #import "SCProcessingModuleUtils.h"
 
+#import "SCSampleBufferFactory.h"
+
 #import <SCFoundation/SCLog.h>
 
 @import CoreImage;
@@ -57,22 +59,13 @@
         return oldSampleBuffer;
     }
 
-    CMSampleBufferRef newSampleBuffer = NULL;
     CMSampleTimingInfo timimgInfo = kCMTimingInfoInvalid;
     CMSampleBufferGetSampleTimingInfo(oldSampleBuffer, 0, &timimgInfo);
 
-    CMVideoFormatDescriptionRef videoInfo = NULL;
-    OSStatus status = CMVideoFormatDescriptionCreateForImageBuffer(NULL, pixelBuffer, &videoInfo);
-    if (status != noErr) {
-        SCLogGeneralError(@"[Processing Pipeline] Error creating video format description %i", (int)status);
-        CVPixelBufferRelease(pixelBuffer);
-        return oldSampleBuffer;
-    }
-
-    status = CMSampleBufferCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, true, NULL, NULL, videoInfo,
-                                                &timimgInfo, &newSampleBuffer);
-    if (status != noErr) {
-        SCLogGeneralError(@"[Processing Pipeline] Error creating CMSampleBuffer %i", (int)status);
+    CMSampleBufferRef newSampleBuffer =
+        [[SCSampleBufferFactory sharedFactory] createSampleBufferWithPixelBuffer:pixelBuffer timingInfo:&timimgInfo];
+    if (!newSampleBuffer) {
+        SCLogGeneralError(@"[Processing Pipeline] Error creating CMSampleBuffer");
         CVPixelBufferRelease(pixelBuffer);
         return oldSampleBuffer;
     }
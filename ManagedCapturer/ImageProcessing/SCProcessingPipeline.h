@@ -10,14 +10,37 @@
 
 #import <Foundation/Foundation.h>
 
+@class SCQueuePerformer;
+
 /*
  @class SCProcessingPipeline
     The SCProcessingPipeline chains together a series of SCProcessingModules and passes the frame through
         each of them in a pre-determined order. This is done through a chain of command, where the resulting
         frame from the the first module is passed to the second, then to the third, etc.
+    When fusesMetalModules is set, consecutive SCMetalModules are encoded into a single command buffer that
+        ping-pongs between intermediate textures, so the CPU waits for the GPU and copies back into the pixel
+        buffer once per run of metal modules instead of once per module.
  */
 @interface SCProcessingPipeline : NSObject <SCProcessingModule>
 
 @property (nonatomic, strong) NSMutableArray<id<SCProcessingModule>> *processingModules;
 
+@property (nonatomic) BOOL fusesMetalModules;
+
+// Commits one command buffer per fused metal module (still with a single wait and copy back) so that GPU time can be
+// reported per module. Only meaningful together with fusesMetalModules.
+@property (nonatomic) BOOL profilesMetalModules;
+
+/*
+ Asynchronous variant of render:, used for pipelined frame processing. The trailing run of fused metal modules is
+    committed without waiting for the GPU, so the next frame can be encoded while this one is still in flight. The
+    result is copied back into the pixel buffer on the GPU completion thread, then completionHandler is called on
+    performer. Modules that must run on the CPU (and any metal modules before them) are rendered synchronously first.
+    Completion handlers are called in submission order. The caller must keep renderData.sampleBuffer and
+    renderData.depthDataMap alive until completionHandler is called.
+ */
+- (void)render:(RenderData)renderData
+            performer:(SCQueuePerformer *)performer
+    completionHandler:(void (^)(CMSampleBufferRef sampleBuffer))completionHandler;
+
 @end
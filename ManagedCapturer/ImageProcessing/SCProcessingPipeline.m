@@ -8,23 +8,132 @@
 
 #import "SCProcessingPipeline.h"
 
+#import "SCMetalModule.h"
+#import "SCMetalUtils.h"
+
 #import <SCFoundation/NSString+Helpers.h>
+#import <SCFoundation/SCAssertWrapper.h>
+#import <SCFoundation/SCLog.h>
+#import <SCFoundation/SCQueuePerformer.h>
 
 @import CoreMedia;
+@import QuartzCore;
 
-@implementation SCProcessingPipeline
+static NSTimeInterval const kSCProcessingPipelineReportInterval = 10;
+static NSUInteger const kSCProcessingPipelineMaxProfiledModules = 8;
 
-- (CMSampleBufferRef)render:(RenderData)renderData
+#if !TARGET_IPHONE_SIMULATOR
+// The encoded-but-not-yet-committed result of a run of fused metal modules.
+@interface SCProcessingPipelineMetalPass : NSObject
+
+@property (nonatomic, strong) SCMetalTextureResource *textureResource;
+@property (nonatomic, strong) id<MTLCommandBuffer> commandBuffer;
+// Committed per-module command buffers when profiling, along with the index of the module each one ran.
+@property (nonatomic, strong) NSMutableArray<id<MTLCommandBuffer>> *profiledCommandBuffers;
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *profiledModuleIndexes;
+
+@end
+
+@implementation SCProcessingPipelineMetalPass
+@end
+#endif
+
+@interface SCProcessingPipeline ()
+#if !TARGET_IPHONE_SIMULATOR
+@property (nonatomic, readonly) id<MTLCommandQueue> commandQueue;
+@property (nonatomic, readonly) CVMetalTextureCacheRef textureCache;
+@property (nonatomic, readonly) SCMetalTexturePool *texturePool;
+#endif
+@end
+
+@implementation SCProcessingPipeline {
+    NSTimeInterval _lastReportTime;
+    NSUInteger _renderedFrames;
+    CFTimeInterval _renderTime;
+    CFTimeInterval _moduleGPUTime[kSCProcessingPipelineMaxProfiledModules];
+    NSUInteger _moduleGPUSamples[kSCProcessingPipelineMaxProfiledModules];
+}
+
+#if !TARGET_IPHONE_SIMULATOR
+@synthesize commandQueue = _commandQueue;
+@synthesize textureCache = _textureCache;
+@synthesize texturePool = _texturePool;
+#endif
+
+- (void)dealloc
 {
-    for (id<SCProcessingModule> module in self.processingModules) {
-        if (![module requiresDepthData] || ([module requiresDepthData] && renderData.depthDataMap)) {
-            renderData.sampleBuffer = [module render:renderData];
-        }
+#if !TARGET_IPHONE_SIMULATOR
+    if (_textureCache) {
+        CFRelease(_textureCache);
     }
+#endif
+}
 
+- (CMSampleBufferRef)render:(RenderData)renderData
+{
+    CFTimeInterval startTime = CACurrentMediaTime();
+    renderData.sampleBuffer =
+        [self _renderModulesInRange:NSMakeRange(0, self.processingModules.count) renderData:renderData];
+    [self _recordRenderTime:CACurrentMediaTime() - startTime];
     return renderData.sampleBuffer;
 }
 
+- (void)render:(RenderData)renderData
+            performer:(SCQueuePerformer *)performer
+    completionHandler:(void (^)(CMSampleBufferRef sampleBuffer))completionHandler
+{
+    SCAssert(performer, @"performer must be provided");
+    SCAssert(completionHandler, @"completion handler must be provided");
+    CFTimeInterval startTime = CACurrentMediaTime();
+    NSArray<id<SCProcessingModule>> *modules = self.processingModules;
+    // Find the trailing run of metal modules, only those can finish on the GPU without blocking.
+    NSUInteger asyncRangeStart = modules.count;
+    while (_fusesMetalModules && asyncRangeStart > 0 &&
+           ([modules[asyncRangeStart - 1] isKindOfClass:[SCMetalModule class]] ||
+            ![self _shouldRenderModule:modules[asyncRangeStart - 1] renderData:renderData])) {
+        --asyncRangeStart;
+    }
+    renderData.sampleBuffer = [self _renderModulesInRange:NSMakeRange(0, asyncRangeStart) renderData:renderData];
+
+#if !TARGET_IPHONE_SIMULATOR
+    SCProcessingPipelineMetalPass *metalPass =
+        [self _encodeMetalModulesInRange:NSMakeRange(asyncRangeStart, modules.count - asyncRangeStart)
+                              renderData:renderData];
+    if (metalPass) {
+        CMSampleBufferRef sampleBuffer = renderData.sampleBuffer;
+        [metalPass.commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
+            // Copy back on the GPU completion thread, keeping that work off the performer as well.
+            [self _copyBackMetalPass:metalPass sampleBuffer:sampleBuffer];
+            [performer perform:^{
+                [self _recordGPUTimeOfMetalPass:metalPass];
+                completionHandler(sampleBuffer);
+            }];
+        }];
+        [metalPass.commandBuffer commit];
+        [self _recordRenderTime:CACurrentMediaTime() - startTime];
+        return;
+    }
+    // Nothing left for the GPU, but still complete behind the frames already in flight to keep delivery in order.
+    CMSampleBufferRef sampleBuffer = renderData.sampleBuffer;
+    id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
+    if (commandBuffer) {
+        [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> completedCommandBuffer) {
+            [performer perform:^{
+                completionHandler(sampleBuffer);
+            }];
+        }];
+        [commandBuffer commit];
+        [self _recordRenderTime:CACurrentMediaTime() - startTime];
+        return;
+    }
+#endif
+    [self _recordRenderTime:CACurrentMediaTime() - startTime];
+    CMSampleBufferRef processedSampleBuffer = renderData.sampleBuffer;
+    [performer perform:^{
+        completionHandler(processedSampleBuffer);
+    }];
+}
+
 - (NSString *)description
 {
     NSMutableString *desc = [NSMutableString new];
@@ -43,4 +152,208 @@
     return NO;
 }
 
+#pragma mark - Private methods
+
+- (BOOL)_shouldRenderModule:(id<SCProcessingModule>)module renderData:(RenderData)renderData
+{
+    return ![module requiresDepthData] || renderData.depthDataMap;
+}
+
+- (CMSampleBufferRef)_renderModulesInRange:(NSRange)range renderData:(RenderData)renderData
+{
+    NSArray<id<SCProcessingModule>> *modules = self.processingModules;
+    NSUInteger fusedRangeStart = NSNotFound;
+    for (NSUInteger i = range.location; i < NSMaxRange(range); ++i) {
+        id<SCProcessingModule> module = modules[i];
+        if (![self _shouldRenderModule:module renderData:renderData]) {
+            continue;
+        }
+        if (_fusesMetalModules && [module isKindOfClass:[SCMetalModule class]]) {
+            if (fusedRangeStart == NSNotFound) {
+                fusedRangeStart = i;
+            }
+            continue;
+        }
+        if (fusedRangeStart != NSNotFound) {
+            renderData.sampleBuffer =
+                [self _renderMetalModulesInRange:NSMakeRange(fusedRangeStart, i - fusedRangeStart)
+                                      renderData:renderData];
+            fusedRangeStart = NSNotFound;
+        }
+        renderData.sampleBuffer = [module render:renderData];
+    }
+    if (fusedRangeStart != NSNotFound) {
+        renderData.sampleBuffer =
+            [self _renderMetalModulesInRange:NSMakeRange(fusedRangeStart, NSMaxRange(range) - fusedRangeStart)
+                                  renderData:renderData];
+    }
+    return renderData.sampleBuffer;
+}
+
+// Encodes all metal modules in range into one command buffer, waits for it once and copies the final textures back
+// into the pixel buffer once.
+- (CMSampleBufferRef)_renderMetalModulesInRange:(NSRange)range renderData:(RenderData)renderData
+{
+#if !TARGET_IPHONE_SIMULATOR
+    SCProcessingPipelineMetalPass *metalPass = [self _encodeMetalModulesInRange:range renderData:renderData];
+    SC_GUARD_ELSE_RETURN_VALUE(metalPass, renderData.sampleBuffer);
+
+    [metalPass.commandBuffer commit];
+    [metalPass.commandBuffer waitUntilCompleted];
+    [self _copyBackMetalPass:metalPass sampleBuffer:renderData.sampleBuffer];
+    [self _recordGPUTimeOfMetalPass:metalPass];
+#endif
+    return renderData.sampleBuffer;
+}
+
+#if !TARGET_IPHONE_SIMULATOR
+// Encodes the metal modules in range, chaining their texture resources. The returned pass' command buffer is not
+// committed yet. Returns nil if nothing was encoded.
+- (SCProcessingPipelineMetalPass *)_encodeMetalModulesInRange:(NSRange)range renderData:(RenderData)renderData
+{
+    SC_GUARD_ELSE_RETURN_VALUE(range.length > 0, nil);
+
+    CVMetalTextureCacheRef textureCache = self.textureCache;
+    SC_GUARD_ELSE_RETURN_VALUE(textureCache, nil);
+
+    id<MTLCommandQueue> commandQueue = self.commandQueue;
+    SC_GUARD_ELSE_RETURN_VALUE(commandQueue, nil);
+
+    id<MTLDevice> device = SCGetManagedCaptureMetalDevice();
+    SCProcessingPipelineMetalPass *metalPass = [[SCProcessingPipelineMetalPass alloc] init];
+    if (_profilesMetalModules) {
+        metalPass.profiledCommandBuffers = [NSMutableArray array];
+        metalPass.profiledModuleIndexes = [NSMutableArray array];
+    }
+    metalPass.commandBuffer = [commandQueue commandBuffer];
+    for (NSUInteger i = range.location; i < NSMaxRange(range); ++i) {
+        SCMetalModule *module = (SCMetalModule *)self.processingModules[i];
+        if (![self _shouldRenderModule:module renderData:renderData]) {
+            continue;
+        }
+        SCMetalTextureResource *previousTextureResource = metalPass.textureResource;
+        SCMetalTextureResource *textureResource =
+            previousTextureResource ? [[SCMetalTextureResource alloc] initWithRenderData:renderData
+                                                                            textureCache:textureCache
+                                                                                  device:device
+                                                                 previousTextureResource:previousTextureResource]
+                                    : [[SCMetalTextureResource alloc] initWithRenderData:renderData
+                                                                            textureCache:textureCache
+                                                                                  device:device
+                                                                             texturePool:self.texturePool];
+        if (![module encodeToCommandBuffer:metalPass.commandBuffer textureResource:textureResource]) {
+            // Nothing was encoded with its textures, those of a chained resource are returned along with the chain
+            if (!previousTextureResource) {
+                [textureResource returnTexturesToPool];
+            }
+            continue;
+        }
+        metalPass.textureResource = textureResource;
+        if (metalPass.profiledCommandBuffers && i < kSCProcessingPipelineMaxProfiledModules) {
+            // Command buffers on the same queue execute in commit order, so splitting here keeps the chaining intact
+            // while giving each module its own GPU start / end time.
+            [metalPass.profiledCommandBuffers addObject:metalPass.commandBuffer];
+            [metalPass.profiledModuleIndexes addObject:@(i)];
+            [metalPass.commandBuffer commit];
+            metalPass.commandBuffer = [commandQueue commandBuffer];
+        }
+    }
+    return metalPass.textureResource ? metalPass : nil;
+}
+
+- (void)_copyBackMetalPass:(SCProcessingPipelineMetalPass *)metalPass sampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+    CVImageBufferRef imageBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
+    SCMetalCopyTexture(metalPass.textureResource.destinationYTexture, imageBuffer, 0);
+    SCMetalCopyTexture(metalPass.textureResource.destinationUVTexture, imageBuffer, 1);
+    // The pass completed on the GPU, its intermediate textures can be used by the next frames
+    [metalPass.textureResource returnTexturesToPool];
+}
+
+// Must be called after the pass' last command buffer completed, all earlier ones completed before it did.
+- (void)_recordGPUTimeOfMetalPass:(SCProcessingPipelineMetalPass *)metalPass
+{
+    if (@available(iOS 10.3, *)) {
+        for (NSUInteger i = 0; i < metalPass.profiledCommandBuffers.count; ++i) {
+            id<MTLCommandBuffer> profiledCommandBuffer = metalPass.profiledCommandBuffers[i];
+            NSUInteger moduleIndex = metalPass.profiledModuleIndexes[i].unsignedIntegerValue;
+            _moduleGPUTime[moduleIndex] += profiledCommandBuffer.GPUEndTime - profiledCommandBuffer.GPUStartTime;
+            ++_moduleGPUSamples[moduleIndex];
+        }
+    }
+}
+#endif
+
+- (void)_recordRenderTime:(CFTimeInterval)renderTime
+{
+    _renderTime += renderTime;
+    ++_renderedFrames;
+    [self _reportIfNeeded];
+}
+
+- (void)_reportIfNeeded
+{
+    CFTimeInterval currentTime = CACurrentMediaTime();
+    if (_lastReportTime == 0) {
+        _lastReportTime = currentTime;
+        return;
+    }
+    SC_GUARD_ELSE_RETURN(currentTime - _lastReportTime > kSCProcessingPipelineReportInterval);
+
+    NSMutableString *moduleGPUTimes = [NSMutableString string];
+    for (NSUInteger i = 0; i < MIN(self.processingModules.count, kSCProcessingPipelineMaxProfiledModules); ++i) {
+        if (_moduleGPUSamples[i] > 0) {
+            [moduleGPUTimes appendFormat:@"%@: %.2fms, ", self.processingModules[i],
+                                         _moduleGPUTime[i] * 1000 / _moduleGPUSamples[i]];
+        }
+        _moduleGPUTime[i] = 0;
+        _moduleGPUSamples[i] = 0;
+    }
+    NSUInteger texturePoolHits = 0;
+    NSUInteger texturePoolRequests = 0;
+    NSUInteger texturePoolBytes = 0;
+#if !TARGET_IPHONE_SIMULATOR
+    texturePoolHits = _texturePool.hitCount;
+    texturePoolRequests = _texturePool.requestCount;
+    texturePoolBytes = _texturePool.residentBytes;
+#endif
+    SCLogGeneralInfo(@"[Processing Pipeline] Time: (%.3f - %.3f], rendered %tu frames, %.2fms per frame, fused:%d, "
+                     @"GPU time per module: [%@], texture pool hits: %tu/%tu, resident: %tu bytes",
+                     _lastReportTime, currentTime, _renderedFrames, _renderTime * 1000 / MAX(_renderedFrames, 1),
+                     _fusesMetalModules, moduleGPUTimes, texturePoolHits, texturePoolRequests, texturePoolBytes);
+    _renderedFrames = 0;
+    _renderTime = 0;
+    _lastReportTime = currentTime;
+}
+
+#pragma mark - Lazy properties
+
+#if !TARGET_IPHONE_SIMULATOR
+
+- (id<MTLCommandQueue>)commandQueue
+{
+    if (!_commandQueue) {
+        _commandQueue = [SCGetManagedCaptureMetalDevice() newCommandQueue];
+    }
+    return _commandQueue;
+}
+
+- (CVMetalTextureCacheRef)textureCache
+{
+    if (!_textureCache) {
+        CVMetalTextureCacheCreate(kCFAllocatorDefault, nil, SCGetManagedCaptureMetalDevice(), nil, &_textureCache);
+    }
+    return _textureCache;
+}
+
+- (SCMetalTexturePool *)texturePool
+{
+    if (!_texturePool) {
+        _texturePool = [[SCMetalTexturePool alloc] initWithDevice:SCGetManagedCaptureMetalDevice()];
+    }
+    return _texturePool;
+}
+
+#endif
+
 @end
@@ -51,6 +51,8 @@
     }
 
     processingPipeline.processingModules = processingModules;
+    processingPipeline.fusesMetalModules = SCCameraTweaksEnableFusedMetalProcessing();
+    processingPipeline.profilesMetalModules = SCCameraTweaksProfileMetalProcessingModules();
     return processingPipeline;
 }
 
@@ -1,5 +1,5 @@
 //
-//  SCAudioCaptureSession.m
+//  SCAudioCaptureSession.mm
 //  Snapchat
 //
 //  Created by Liu Liu on 3/5/15.
@@ -8,6 +8,8 @@
 
 #import "SCAudioCaptureSession.h"
 
+#import "SCPooledBlockBuffer.h"
+
 #import <SCAudio/SCAudioSession.h>
 #import <SCFoundation/SCLog.h>
 #import <SCFoundation/SCQueuePerformer.h>
@@ -32,6 +34,8 @@ static char *const kSCAudioCaptureSessionQueueLabel = "com.snapchat.audio-captur
     AudioQueueRef _audioQueue;
     AudioQueueBufferRef _audioQueueBuffers[kNumberOfAudioBuffersInQueue];
     CMAudioFormatDescriptionRef _audioFormatDescription;
+    // Recycles the blocks the audio queue buffers are copied to
+    SC::BlockPool *_blockPool;
 }
 
 @synthesize delegate = _delegate;
@@ -106,11 +110,13 @@ static int computeRecordBufferSize(const AudioStreamBasicDescription *format, co
 static NSTimeInterval machHostTimeToSeconds(UInt64 mHostTime)
 {
     static dispatch_once_t onceToken;
-    static mach_timebase_info_data_t timebase_info;
+    static double secondsPerHostTimeUnit;
     dispatch_once(&onceToken, ^{
+        mach_timebase_info_data_t timebase_info;
         (void)mach_timebase_info(&timebase_info);
+        secondsPerHostTimeUnit = (double)timebase_info.numer / timebase_info.denom / NSEC_PER_SEC;
     });
-    return (double)mHostTime * timebase_info.numer / timebase_info.denom / NSEC_PER_SEC;
+    return mHostTime * secondsPerHostTimeUnit;
 }
 
 static void audioQueueBufferHandler(void *inUserData, AudioQueueRef inAQ, AudioQueueBufferRef inBuffer,
@@ -137,11 +143,23 @@ static void audioQueueBufferHandler(void *inUserData, AudioQueueRef inAQ, AudioQ
 {
     SCTraceStart();
     CMBlockBufferRef dataBuffer = NULL;
-    CMBlockBufferCreateWithMemoryBlock(NULL, NULL, audioQueueBuffer->mAudioDataByteSize, NULL, NULL, 0,
-                                       audioQueueBuffer->mAudioDataByteSize, 0, &dataBuffer);
+    UInt32 byteSize = audioQueueBuffer->mAudioDataByteSize;
+    // The audio queue buffer is enqueued again right after, so the bytes are copied to a pooled block. Only the data
+    // block is recycled, the CMBlockBuffer wrapping it and the sample buffer are still created for every callback.
+    void *block = (_blockPool && byteSize <= _blockPool->blockSize()) ? _blockPool->acquireBlock() : NULL;
+    if (block) {
+        memcpy(block, audioQueueBuffer->mAudioData, byteSize);
+        if (SCPooledBlockBufferCreate(_blockPool, block, byteSize, &dataBuffer) != kCMBlockBufferNoErr) {
+            _blockPool->releaseBlock(block);
+            dataBuffer = NULL;
+        }
+    } else {
+        CMBlockBufferCreateWithMemoryBlock(NULL, NULL, byteSize, NULL, NULL, 0, byteSize, 0, &dataBuffer);
+        if (dataBuffer) {
+            CMBlockBufferReplaceDataBytes(audioQueueBuffer->mAudioData, dataBuffer, 0, byteSize);
+        }
+    }
     if (dataBuffer) {
-        CMBlockBufferReplaceDataBytes(audioQueueBuffer->mAudioData, dataBuffer, 0,
-                                      audioQueueBuffer->mAudioDataByteSize);
         CMSampleBufferRef sampleBuffer = NULL;
         CMAudioSampleBufferCreateWithPacketDescriptions(NULL, dataBuffer, true, NULL, NULL, _audioFormatDescription,
                                                         numPackets, PTS, packetDescriptions, &sampleBuffer);
@@ -199,6 +217,9 @@ static void audioQueueBufferHandler(void *inUserData, AudioQueueRef inAQ, AudioQ
         SCTraceSignal(@"Initialize audio queue with new input");
         UInt32 bufferByteSize = computeRecordBufferSize(
             &recordFormat, _audioQueue, kAudioBufferDurationInSeconds); // Enough bytes for half a second
+        // As many blocks as audio queue buffers, so that the pool doesn't grow unless consumers hold on to the
+        // sample buffers for longer than the queue takes to cycle through its buffers
+        _blockPool = SC::BlockPool::create(bufferByteSize, kNumberOfAudioBuffersInQueue);
         for (int i = 0; i < kNumberOfAudioBuffersInQueue; i++) {
             AudioQueueAllocateBuffer(_audioQueue, bufferByteSize, &_audioQueueBuffers[i]);
             AudioQueueEnqueueBuffer(_audioQueue, _audioQueueBuffers[i], 0, NULL);
@@ -256,6 +277,11 @@ static void audioQueueBufferHandler(void *inUserData, AudioQueueRef inAQ, AudioQ
         CFRelease(_audioFormatDescription);
         _audioFormatDescription = NULL;
     }
+    if (_blockPool) {
+        // Blocks still held by consumers keep the pool alive
+        _blockPool->release();
+        _blockPool = NULL;
+    }
 }
 
 #pragma mark - Public methods
@@ -0,0 +1,94 @@
+//
+//  SCBlockPool.cpp
+//  Snapchat
+//
+
+#include "SCBlockPool.h"
+
+#include <cstdlib>
+
+namespace SC {
+
+BlockPool *BlockPool::create(size_t blockSize, size_t blockCount)
+{
+    return new BlockPool(blockSize, blockCount);
+}
+
+BlockPool::BlockPool(size_t blockSize, size_t blockCount)
+    : _blockSize(blockSize > 0 ? blockSize : 1)
+    , _allocatedBlockCount(0)
+    , _references(1)
+{
+    _freeBlocks.reserve(blockCount);
+    for (size_t index = 0; index < blockCount; ++index) {
+        void *block = malloc(_blockSize);
+        if (!block) {
+            break;
+        }
+        _freeBlocks.push_back(block);
+        ++_allocatedBlockCount;
+    }
+}
+
+BlockPool::~BlockPool()
+{
+    for (void *block : _freeBlocks) {
+        free(block);
+    }
+}
+
+void *BlockPool::acquireBlock()
+{
+    void *block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_freeBlocks.empty()) {
+            block = _freeBlocks.back();
+            _freeBlocks.pop_back();
+        }
+    }
+    if (!block) {
+        block = malloc(_blockSize);
+        if (!block) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_allocatedBlockCount;
+        // Makes sure giving the block back never allocates
+        _freeBlocks.reserve(_allocatedBlockCount);
+    }
+    retain();
+    return block;
+}
+
+void BlockPool::releaseBlock(void *block)
+{
+    if (!block) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _freeBlocks.push_back(block);
+    }
+    release();
+}
+
+void BlockPool::retain()
+{
+    _references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BlockPool::release()
+{
+    if (_references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+size_t BlockPool::allocatedBlockCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _allocatedBlockCount;
+}
+
+} // namespace SC
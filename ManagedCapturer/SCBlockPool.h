@@ -0,0 +1,55 @@
+//
+//  SCBlockPool.h
+//  Snapchat
+//
+//  Thread safe pool of fixed size memory blocks, to recycle the blocks backing the audio sample buffers rather than
+//  allocating one per buffer. Blocks can be given back from any thread, and keep the pool alive until they are, so
+//  the owner can let go of the pool while consumers still hold some of them.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace SC {
+
+class BlockPool {
+public:
+    // Preallocates blockCount blocks. The pool starts with one reference, owned by the caller.
+    static BlockPool *create(size_t blockSize, size_t blockCount);
+
+    size_t blockSize() const
+    {
+        return _blockSize;
+    }
+
+    // Reuses a free block, or allocates a new one once they are all in use. Each block retains the pool.
+    void *acquireBlock();
+
+    // Gives back a block acquired from this pool, and the reference it held
+    void releaseBlock(void *block);
+
+    void retain();
+    void release();
+
+    // Blocks allocated so far, either free or in use
+    size_t allocatedBlockCount();
+
+private:
+    BlockPool(size_t blockSize, size_t blockCount);
+    ~BlockPool();
+
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    const size_t _blockSize;
+    std::mutex _mutex;
+    std::vector<void *> _freeBlocks;
+    size_t _allocatedBlockCount;
+    std::atomic<size_t> _references;
+};
+
+} // namespace SC
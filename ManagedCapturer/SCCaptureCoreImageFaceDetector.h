@@ -7,6 +7,10 @@
 //
 //  This class is intended to detect faces in Camera. It receives CMSampleBuffer, process the face detection using
 //  CIDetector, and announce the bounds and faceIDs.
+//
+//  Detection runs on a downscaled luma image of the newest frame only, frames which are replaced while waiting or are
+//  already too late are dropped before detection. With the adaptive frequency tweak on, detection runs more often
+//  while faces move, and less often when nothing moves or results come late.
 
 #import "SCCaptureFaceDetector.h"
 
@@ -19,4 +23,14 @@
 
 SC_INIT_AND_NEW_UNAVAILABLE;
 
+// Detection statistics since the detection started, can be read on any queue
+@property (nonatomic, assign, readonly) NSUInteger detectionCount;
+// Frames dropped before detection, because a newer frame replaced them or they were already too late
+@property (nonatomic, assign, readonly) NSUInteger droppedFrameCount;
+// Detections which ran, but whose result came too late to be announced
+@property (nonatomic, assign, readonly) NSUInteger wastedDetectionCount;
+
+// Percentile (0-100) of the time from frame capture to detection result
+- (NSTimeInterval)detectionLatencyAtPercentile:(double)percentile;
+
 @end
@@ -0,0 +1,413 @@
+//
+//  SCCaptureCoreImageFaceDetector.mm
+//  Snapchat
+//
+//  Created by Jiyang Zhu on 3/27/18.
+//  Copyright © 2018 Snapchat, Inc. All rights reserved.
+//
+
+#import "SCCaptureCoreImageFaceDetector.h"
+
+#import "SCCameraTweaks.h"
+#import "SCCaptureFaceDetectionParser.h"
+#import "SCCaptureFaceDetectorTrigger.h"
+#import "SCCaptureResource.h"
+#import "SCHotPathTrace.h"
+#import "SCLatencyHistogram.h"
+#import "SCManagedCapturer.h"
+
+#import <SCFoundation/NSArray+Helpers.h>
+#import <SCFoundation/SCAssertWrapper.h>
+#import <SCFoundation/SCLog.h>
+#import <SCFoundation/SCQueuePerformer.h>
+#import <SCFoundation/SCTrace.h>
+#import <SCFoundation/SCTraceODPCompatible.h>
+#import <SCFoundation/SCZeroDependencyExperiments.h>
+#import <SCFoundation/UIImage+CVPixelBufferRef.h>
+
+#include <atomic>
+
+@import ImageIO;
+
+static const NSTimeInterval kSCCaptureCoreImageFaceDetectorMaxAllowedLatency =
+    1; // Drop the face detection result if it is 1 second late.
+static const NSInteger kDefaultNumberOfSequentialOutputSampleBuffer = -1; // -1 means no sequential sample buffers.
+
+// Longer side of the image the detection runs on. CIDetectorMinFeatureSize is relative to the image size, so this
+// only trades precision of the bounds.
+static const size_t kSCCaptureCoreImageFaceDetectorMaxImageDimension = 640;
+// With adaptive frequency, the detection interval ranges from half to 4 times the experiment one
+static const NSUInteger kSCCaptureCoreImageFaceDetectorMaxIntervalMultiplier = 4;
+// Faces whose center moved by more than this fraction of the frame since the last detection are moving
+static const CGFloat kSCCaptureCoreImageFaceDetectorMovementThreshold = 0.02;
+
+static char *const kSCCaptureCoreImageFaceDetectorProcessQueue =
+    "com.snapchat.capture-core-image-face-detector-process";
+
+@implementation SCCaptureCoreImageFaceDetector {
+    CIDetector *_detector;
+    SCCaptureResource *_captureResource;
+
+    BOOL _isDetecting;
+    BOOL _hasDetectedFaces;
+    NSInteger _numberOfSequentialOutputSampleBuffer;
+    NSUInteger _detectionFrequency;
+    NSDictionary *_detectorOptions;
+    SCManagedCaptureDevicePosition _devicePosition;
+    CIContext *_context;
+
+    SCQueuePerformer *_callbackPerformer;
+    SCQueuePerformer *_processPerformer;
+
+    SCCaptureFaceDetectionParser *_parser;
+    SCCaptureFaceDetectorTrigger *_trigger;
+
+    // Written on the process queue, read on the capture queue
+    std::atomic<NSUInteger> _detectionInterval;
+    BOOL _adaptiveDetectionFrequency;
+    SCFaceBoundsList _lastFaces;
+
+    // Newest frame waiting for detection, guarded by @synchronized(self) along with the statistics
+    CMSampleBufferRef _pendingSampleBuffer;
+    SCManagedCaptureDevicePosition _pendingDevicePosition;
+    BOOL _pendingShouldResetDetection;
+    NSUInteger _detectionCount;
+    NSUInteger _droppedFrameCount;
+    NSUInteger _wastedDetectionCount;
+    SC::LatencyHistogram _detectionLatencies;
+}
+
+@synthesize trigger = _trigger;
+@synthesize parser = _parser;
+
+- (instancetype)initWithCaptureResource:(SCCaptureResource *)captureResource
+{
+    SCTraceODPCompatibleStart(2);
+    self = [super init];
+    if (self) {
+        SCAssert(captureResource, @"SCCaptureResource should not be nil");
+        SCAssert(captureResource.queuePerformer, @"SCQueuePerformer should not be nil");
+        _callbackPerformer = captureResource.queuePerformer;
+        _captureResource = captureResource;
+        _parser = [[SCCaptureFaceDetectionParser alloc]
+            initWithFaceBoundsAreaThreshold:pow(SCCameraFaceFocusMinFaceSize(), 2)];
+        _processPerformer = [[SCQueuePerformer alloc] initWithLabel:kSCCaptureCoreImageFaceDetectorProcessQueue
+                                                   qualityOfService:QOS_CLASS_USER_INITIATED
+                                                          queueType:DISPATCH_QUEUE_SERIAL
+                                                            context:SCQueuePerformerContextCamera];
+        _detectionFrequency = MAX(SCExperimentWithFaceDetectionFrequency(), 1);
+        _detectionInterval = _detectionFrequency;
+        _adaptiveDetectionFrequency = SCCameraTweaksFaceFocusAdaptiveDetectionFrequency();
+        _devicePosition = captureResource.device.position;
+        _trigger = [[SCCaptureFaceDetectorTrigger alloc] initWithDetector:self];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_pendingSampleBuffer) {
+        CFRelease(_pendingSampleBuffer);
+    }
+}
+
+- (void)_setupDetectionIfNeeded
+{
+    SCTraceODPCompatibleStart(2);
+    SC_GUARD_ELSE_RETURN(!_detector);
+    if (!_context) {
+        _context = [CIContext context];
+    }
+    // For CIDetectorMinFeatureSize, the valid range is [0.0100, 0.5000], otherwise, it will cause a crash.
+    if (!_detectorOptions) {
+        _detectorOptions = @{
+            CIDetectorAccuracy : CIDetectorAccuracyLow,
+            CIDetectorTracking : @(YES),
+            CIDetectorMaxFeatureCount : @(2),
+            CIDetectorMinFeatureSize : @(SCCameraFaceFocusMinFaceSize()),
+            CIDetectorNumberOfAngles : @(3)
+        };
+    }
+    @try {
+        _detector = [CIDetector detectorOfType:CIDetectorTypeFace context:_context options:_detectorOptions];
+    } @catch (NSException *exception) {
+        SCLogCoreCameraError(@"Failed to create CIDetector with exception:%@", exception);
+    }
+}
+
+- (void)_resetDetection
+{
+    SCTraceODPCompatibleStart(2);
+    _detector = nil;
+    _lastFaces.count = 0;
+    [self _setupDetectionIfNeeded];
+}
+
+- (SCQueuePerformer *)detectionPerformer
+{
+    return _processPerformer;
+}
+
+- (void)startDetection
+{
+    SCTraceODPCompatibleStart(2);
+    SCAssert([[self detectionPerformer] isCurrentPerformer], @"Calling -startDetection in an invalid queue.");
+    [self _setupDetectionIfNeeded];
+    _isDetecting = YES;
+    _hasDetectedFaces = NO;
+    _numberOfSequentialOutputSampleBuffer = kDefaultNumberOfSequentialOutputSampleBuffer;
+    _detectionInterval = _detectionFrequency;
+    _lastFaces.count = 0;
+    @synchronized(self)
+    {
+        _detectionCount = 0;
+        _droppedFrameCount = 0;
+        _wastedDetectionCount = 0;
+        _detectionLatencies.reset();
+    }
+}
+
+- (void)stopDetection
+{
+    SCTraceODPCompatibleStart(2);
+    SCAssert([[self detectionPerformer] isCurrentPerformer], @"Calling -stopDetection in an invalid queue.");
+    _isDetecting = NO;
+    @synchronized(self)
+    {
+        SCLogCoreCameraInfo(@"Face detection stopped, detections:%lu dropped frames:%lu wasted detections:%lu "
+                            @"p50 latency:%.1fms p99 latency:%.1fms",
+                            (unsigned long)_detectionCount, (unsigned long)_droppedFrameCount,
+                            (unsigned long)_wastedDetectionCount, _detectionLatencies.valueAtPercentile(50) / 1000.0,
+                            _detectionLatencies.valueAtPercentile(99) / 1000.0);
+    }
+}
+
+- (NSUInteger)detectionCount
+{
+    @synchronized(self)
+    {
+        return _detectionCount;
+    }
+}
+
+- (NSUInteger)droppedFrameCount
+{
+    @synchronized(self)
+    {
+        return _droppedFrameCount;
+    }
+}
+
+- (NSUInteger)wastedDetectionCount
+{
+    @synchronized(self)
+    {
+        return _wastedDetectionCount;
+    }
+}
+
+- (NSTimeInterval)detectionLatencyAtPercentile:(double)percentile
+{
+    @synchronized(self)
+    {
+        return (NSTimeInterval)_detectionLatencies.valueAtPercentile(percentile) / USEC_PER_SEC;
+    }
+}
+
+- (SCFaceBoundsList)_detectFaceFeaturesInImage:(CIImage *)image withOrientation:(CGImagePropertyOrientation)orientation
+{
+    SCTraceODPCompatibleStart(2);
+    NSDictionary *opts =
+        @{ CIDetectorImageOrientation : @(orientation),
+           CIDetectorEyeBlink : @(NO),
+           CIDetectorSmile : @(NO) };
+    NSArray<CIFeature *> *features = [_detector featuresInImage:image options:opts];
+    return [_parser parseFaceBoundsFromCIFeatures:features
+                                    withImageSize:image.extent.size
+                                 imageOrientation:orientation];
+}
+
+#pragma mark - SCManagedVideoDataSourceListener
+
+- (void)managedVideoDataSource:(id<SCManagedVideoDataSource>)managedVideoDataSource
+         didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer
+                devicePosition:(SCManagedCaptureDevicePosition)devicePosition
+{
+    SC_GUARD_ELSE_RETURN(_isDetecting);
+
+    // Reset detection if the device position changes. Resetting detection should execute in _processPerformer, so we
+    // just set a flag here, and then do it later in the perform block.
+    BOOL shouldForceResetDetection = NO;
+    if (devicePosition != _devicePosition) {
+        _devicePosition = devicePosition;
+        shouldForceResetDetection = YES;
+        _numberOfSequentialOutputSampleBuffer = kDefaultNumberOfSequentialOutputSampleBuffer;
+    }
+
+    _numberOfSequentialOutputSampleBuffer++;
+    NSUInteger detectionInterval = _detectionInterval.load();
+    SC_GUARD_ELSE_RETURN(_numberOfSequentialOutputSampleBuffer % detectionInterval == 0);
+    SCHotPathTrace2(SCHotPathTraceEventFaceDetectorFrame, SCHotPathTracePointer(sampleBuffer), detectionInterval);
+
+    // Only the newest frame waits for detection, a frame still waiting is replaced rather than detected late
+    CFRetain(sampleBuffer);
+    BOOL needsPerform;
+    @synchronized(self)
+    {
+        needsPerform = !_pendingSampleBuffer;
+        if (_pendingSampleBuffer) {
+            CFRelease(_pendingSampleBuffer);
+            ++_droppedFrameCount;
+        }
+        _pendingSampleBuffer = sampleBuffer;
+        _pendingDevicePosition = devicePosition;
+        _pendingShouldResetDetection = _pendingShouldResetDetection || shouldForceResetDetection;
+    }
+    SC_GUARD_ELSE_RETURN(needsPerform);
+    @weakify(self);
+    [_processPerformer perform:^{
+        @strongify(self);
+        SC_GUARD_ELSE_RETURN(self);
+        [self _detectPendingSampleBuffer];
+    }];
+}
+
+#pragma mark - Private methods
+
+- (void)_detectPendingSampleBuffer
+{
+    SCTraceODPCompatibleStart(2);
+    CMSampleBufferRef sampleBuffer;
+    SCManagedCaptureDevicePosition devicePosition;
+    BOOL shouldForceResetDetection;
+    @synchronized(self)
+    {
+        sampleBuffer = _pendingSampleBuffer;
+        devicePosition = _pendingDevicePosition;
+        shouldForceResetDetection = _pendingShouldResetDetection;
+        _pendingSampleBuffer = NULL;
+        _pendingShouldResetDetection = NO;
+    }
+    SC_GUARD_ELSE_RETURN(sampleBuffer);
+
+    if (shouldForceResetDetection) {
+        // Resetting detection usually costs no more than 1ms.
+        [self _resetDetection];
+    }
+
+    CFTimeInterval presentationTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
+    NSTimeInterval queueLatency = CACurrentMediaTime() - presentationTime;
+    if (queueLatency >= kSCCaptureCoreImageFaceDetectorMaxAllowedLatency) {
+        // The result would be discarded anyway
+        CFRelease(sampleBuffer);
+        @synchronized(self)
+        {
+            ++_droppedFrameCount;
+        }
+        [self _updateDetectionIntervalWithFaces:_lastFaces latency:queueLatency];
+        return;
+    }
+
+    CGImagePropertyOrientation orientation =
+        (devicePosition == SCManagedCaptureDevicePositionBack ? kCGImagePropertyOrientationRight
+                                                              : kCGImagePropertyOrientationLeftMirrored);
+    SCFaceBoundsList faceBounds =
+        [self _detectFaceFeaturesInPixelBuffer:CMSampleBufferGetImageBuffer(sampleBuffer) withOrientation:orientation];
+    CFRelease(sampleBuffer);
+
+    // Calculate the latency for face detection, if it is too long, discard the face detection results.
+    NSTimeInterval latency = CACurrentMediaTime() - presentationTime;
+    BOOL late = latency >= kSCCaptureCoreImageFaceDetectorMaxAllowedLatency;
+    @synchronized(self)
+    {
+        ++_detectionCount;
+        if (late) {
+            ++_wastedDetectionCount;
+        }
+        _detectionLatencies.record((uint32_t)(MAX(latency, 0) * USEC_PER_SEC));
+    }
+    [self _updateDetectionIntervalWithFaces:faceBounds latency:latency];
+    if (late) {
+        faceBounds.count = 0;
+    }
+
+    // Only announce face detection result if faceBounds is not empty, or faceBounds was not empty last time.
+    if (faceBounds.count > 0 || _hasDetectedFaces) {
+        _hasDetectedFaces = faceBounds.count > 0;
+        [_callbackPerformer perform:^{
+            [_captureResource.announcer managedCapturer:[SCManagedCapturer sharedInstance]
+                                    didDetectFaceBounds:&faceBounds];
+        }];
+    }
+}
+
+- (SCFaceBoundsList)_detectFaceFeaturesInPixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                     withOrientation:(CGImagePropertyOrientation)orientation
+{
+    SCFaceBoundsList faceBounds = {};
+    SC_GUARD_ELSE_RETURN_VALUE(pixelBuffer, faceBounds);
+    OSType pixelFormat = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    BOOL biPlanar = pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange ||
+                    pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
+    CVPixelBufferRef lumaBuffer = NULL;
+    if (biPlanar && CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly) == kCVReturnSuccess) {
+        // Wrap the luma plane without copying, CIDetector only looks at the intensity
+        CVPixelBufferCreateWithBytes(kCFAllocatorDefault, CVPixelBufferGetWidthOfPlane(pixelBuffer, 0),
+                                     CVPixelBufferGetHeightOfPlane(pixelBuffer, 0), kCVPixelFormatType_OneComponent8,
+                                     CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0),
+                                     CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0), NULL, NULL, NULL, &lumaBuffer);
+        if (!lumaBuffer) {
+            CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+        }
+    }
+
+    CIImage *image = [CIImage imageWithCVPixelBuffer:(lumaBuffer ?: pixelBuffer)];
+    CGFloat scale = (CGFloat)kSCCaptureCoreImageFaceDetectorMaxImageDimension /
+                    MAX(CGRectGetWidth(image.extent), CGRectGetHeight(image.extent));
+    if (scale < 1) {
+        image = [image imageByApplyingTransform:CGAffineTransformMakeScale(scale, scale)];
+    }
+    faceBounds = [self _detectFaceFeaturesInImage:image withOrientation:orientation];
+
+    if (lumaBuffer) {
+        CVPixelBufferRelease(lumaBuffer);
+        CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    }
+    return faceBounds;
+}
+
+- (void)_updateDetectionIntervalWithFaces:(const SCFaceBoundsList &)faces latency:(NSTimeInterval)latency
+{
+    BOOL moving = [self _facesMoved:faces];
+    _lastFaces = faces;
+    SC_GUARD_ELSE_RETURN(_adaptiveDetectionFrequency);
+    NSUInteger minInterval = MAX(_detectionFrequency / 2, 1);
+    NSUInteger maxInterval = _detectionFrequency * kSCCaptureCoreImageFaceDetectorMaxIntervalMultiplier;
+    NSUInteger interval = _detectionInterval;
+    // Back off first when results come late, detecting more often would only make it worse
+    if (latency >= kSCCaptureCoreImageFaceDetectorMaxAllowedLatency / 2) {
+        interval = MIN(interval * 2, maxInterval);
+    } else if (moving) {
+        interval = MAX(interval / 2, minInterval);
+    } else {
+        interval = MIN(interval + 1, maxInterval);
+    }
+    _detectionInterval = interval;
+}
+
+- (BOOL)_facesMoved:(const SCFaceBoundsList &)faces
+{
+    SC_GUARD_ELSE_RETURN_VALUE(faces.count == _lastFaces.count, YES);
+    for (const SCFaceBounds &face : faces) {
+        const SCFaceBounds *lastFace = SC::FindFace(_lastFaces, face.faceID);
+        SC_GUARD_ELSE_RETURN_VALUE(lastFace, YES);
+        double movement = MAX(fabs(SC::FaceRectMidX(face.rect) - SC::FaceRectMidX(lastFace->rect)),
+                              fabs(SC::FaceRectMidY(face.rect) - SC::FaceRectMidY(lastFace->rect)));
+        if (movement > kSCCaptureCoreImageFaceDetectorMovementThreshold) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+@end
@@ -0,0 +1,21 @@
+//
+//  SCCaptureFaceBounds.h
+//  Snapchat
+//
+//  Conversions between the face rects of SCFaceBounds.h and CGRect.
+//
+
+#import "SCFaceBounds.h"
+
+#import <CoreGraphics/CoreGraphics.h>
+
+static inline SCFaceRect SCFaceRectFromCGRect(CGRect rect)
+{
+    SCFaceRect faceRect = {CGRectGetMinX(rect), CGRectGetMinY(rect), CGRectGetWidth(rect), CGRectGetHeight(rect)};
+    return faceRect;
+}
+
+static inline CGRect SCCGRectFromFaceRect(SCFaceRect rect)
+{
+    return CGRectMake(rect.x, rect.y, rect.width, rect.height);
+}
@@ -7,6 +7,8 @@
 //
 //  This class offers methods to parse face bounds from raw data, e.g., AVMetadataObject, CIFeature.
 
+#import "SCFaceBounds.h"
+
 #import <SCBase/SCMacros.h>
 
 #import <AVFoundation/AVFoundation.h>
@@ -22,10 +24,9 @@ SC_INIT_AND_NEW_UNAVAILABLE;
  Parse face bounds from AVMetadataObject.
 
  @param metadataObjects An array of AVMetadataObject.
- @return A dictionary, value is faceBounds: CGRect, key is faceID: NSString.
+ @return The faces at least as large as the area threshold, empty if there is none.
  */
-- (NSDictionary<NSNumber *, NSValue *> *)parseFaceBoundsByFaceIDFromMetadataObjects:
-    (NSArray<__kindof AVMetadataObject *> *)metadataObjects;
+- (SCFaceBoundsList)parseFaceBoundsFromMetadataObjects:(NSArray<__kindof AVMetadataObject *> *)metadataObjects;
 
 /**
  Parse face bounds from CIFeature.
@@ -33,11 +34,10 @@ SC_INIT_AND_NEW_UNAVAILABLE;
  @param features An array of CIFeature.
  @param imageSize Size of the image, where the feature are detected from.
  @param imageOrientation Orientation of the image.
- @return A dictionary, value is faceBounds: CGRect, key is faceID: NSString.
+ @return The faces at least as large as the area threshold, with bounds normalized to the image, empty if there is none.
  */
-- (NSDictionary<NSNumber *, NSValue *> *)parseFaceBoundsByFaceIDFromCIFeatures:(NSArray<__kindof CIFeature *> *)features
-                                                                 withImageSize:(CGSize)imageSize
-                                                              imageOrientation:
-                                                                  (CGImagePropertyOrientation)imageOrientation;
+- (SCFaceBoundsList)parseFaceBoundsFromCIFeatures:(NSArray<__kindof CIFeature *> *)features
+                                    withImageSize:(CGSize)imageSize
+                                 imageOrientation:(CGImagePropertyOrientation)imageOrientation;
 
 @end
@@ -0,0 +1,61 @@
+//
+//  SCCaptureFaceDetectionParser.mm
+//  Snapchat
+//
+//  Created by Jiyang Zhu on 3/13/18.
+//  Copyright © 2018 Snapchat, Inc. All rights reserved.
+//
+
+#import "SCCaptureFaceDetectionParser.h"
+
+#import "SCCaptureFaceBounds.h"
+
+#import <SCBase/SCMacros.h>
+
+@implementation SCCaptureFaceDetectionParser {
+    CGFloat _minimumArea;
+}
+
+- (instancetype)initWithFaceBoundsAreaThreshold:(CGFloat)minimumArea
+{
+    self = [super init];
+    if (self) {
+        _minimumArea = minimumArea;
+    }
+    return self;
+}
+
+- (SCFaceBoundsList)parseFaceBoundsFromMetadataObjects:(NSArray<__kindof AVMetadataObject *> *)metadataObjects
+{
+    SCFaceBoundsList faces = {};
+    for (AVMetadataObject *metadataObject in metadataObjects) {
+        if ([metadataObject isKindOfClass:[AVMetadataFaceObject class]]) {
+            AVMetadataFaceObject *faceObject = (AVMetadataFaceObject *)metadataObject;
+            SC::AddFace(faces, faceObject.faceID, SCFaceRectFromCGRect(faceObject.bounds), _minimumArea);
+        }
+    }
+    return faces;
+}
+
+- (SCFaceBoundsList)parseFaceBoundsFromCIFeatures:(NSArray<__kindof CIFeature *> *)features
+                                    withImageSize:(CGSize)imageSize
+                                 imageOrientation:(CGImagePropertyOrientation)imageOrientation
+{
+    SCFaceBoundsList faces = {};
+    // Somehow the detected bounds for back camera is mirrored.
+    BOOL flipVertically = imageOrientation == kCGImagePropertyOrientationRight;
+    for (CIFeature *feature in features) {
+        if (![feature isKindOfClass:[CIFaceFeature class]]) {
+            continue;
+        }
+        CIFaceFeature *faceFeature = (CIFaceFeature *)feature;
+        if (faceFeature.hasTrackingID) {
+            SCFaceRect bounds = SCFaceRectFromCGRect(faceFeature.bounds);
+            SCFaceRect rect = SC::NormalizedFaceRect(bounds, imageSize.width, imageSize.height, flipVertically);
+            SC::AddFace(faces, faceFeature.trackingID, rect, _minimumArea);
+        }
+    }
+    return faces;
+}
+
+@end
@@ -12,6 +12,7 @@
 #import "SCCaptureFaceDetectionParser.h"
 #import "SCCaptureFaceDetectorTrigger.h"
 #import "SCCaptureResource.h"
+#import "SCHotPathTrace.h"
 #import "SCManagedCaptureSession.h"
 #import "SCManagedCapturer.h"
 
@@ -147,7 +148,7 @@ static const NSInteger kDefaultNumberOfSequentialFramesWithFaces = -1; // -1 mea
     didOutputMetadataObjects:(NSArray<__kindof AVMetadataObject *> *)metadataObjects
               fromConnection:(AVCaptureConnection *)connection
 {
-    SCTraceODPCompatibleStart(2);
+    SCHotPathTrace1(SCHotPathTraceEventMetadataFaces, metadataObjects.count);
 
     BOOL shouldNotify = NO;
     if (metadataObjects.count == 0 &&
@@ -163,12 +164,11 @@ static const NSInteger kDefaultNumberOfSequentialFramesWithFaces = -1; // -1 mea
 
     SC_GUARD_ELSE_RETURN(shouldNotify);
 
-    NSDictionary<NSNumber *, NSValue *> *faceBoundsByFaceID =
-        [_parser parseFaceBoundsByFaceIDFromMetadataObjects:metadataObjects];
+    SCFaceBoundsList faceBounds = [_parser parseFaceBoundsFromMetadataObjects:metadataObjects];
 
     [_callbackPerformer perform:^{
         [_captureResource.announcer managedCapturer:[SCManagedCapturer sharedInstance]
-                                didDetectFaceBounds:faceBoundsByFaceID];
+                                didDetectFaceBounds:&faceBounds];
     }];
 }
 
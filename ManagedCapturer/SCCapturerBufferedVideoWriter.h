@@ -39,6 +39,10 @@
 
 - (void)appendAudioSampleBuffer:(CMSampleBufferRef)sampleBuffer;
 
+/* High water marks, drops, reserve use and blocked time of the samples staged while the writer inputs weren't ready,
+ * nil if nothing was staged since the last cleanUp. */
+- (NSDictionary *)stagingStatistics;
+
 - (void)cleanUp;
 
 @end
@@ -1,5 +1,5 @@
 //
-//  SCCapturerBufferedVideoWriter.m
+//  SCCapturerBufferedVideoWriter.mm
 //  Snapchat
 //
 //  Created by Chao Pang on 12/5/17.
@@ -9,7 +9,10 @@
 
 #import "SCAudioCaptureSession.h"
 #import "SCCaptureCommon.h"
+#import "SCCameraTweaks.h"
 #import "SCManagedCapturerUtils.h"
+#import "SCPlaneCopy.h"
+#import "SCStagingQueue.h"
 
 #import <SCBase/SCMacros.h>
 #import <SCFoundation/SCAssertWrapper.h>
@@ -19,6 +22,64 @@
 
 #import <FBKVOController/FBKVOController.h>
 
+#include <memory>
+
+// Video sample buffers hold on to the capture pixel buffer pool, stage at most a few frames worth of them
+static const size_t kSCCapturerBufferedVideoWriterVideoStagingCapacity = 8;
+// With the block on overflow tweak, how long a new video frame waits for the writer input before the oldest is dropped
+static const double kSCCapturerBufferedVideoWriterVideoStagingBlockTimeout = 0.010;
+// Audio sample buffers are small, this is a few seconds worth of them before using the reserve
+static const size_t kSCCapturerBufferedVideoWriterAudioStagingCapacity = 128;
+// Audio is never dropped, the reserve keeps another ~10 seconds of it. A writer stalled for longer fails the recording.
+static const size_t kSCCapturerBufferedVideoWriterAudioStagingReserve = 384;
+static const double kSCCapturerBufferedVideoWriterAudioStagingBlockTimeout = 0.010;
+
+static NSString *const kSCCapturerBufferedVideoWriterErrorDomain = @"kSCCapturerBufferedVideoWriterErrorDomain";
+static NSInteger const kSCCapturerBufferedVideoWriterAudioStagingOverflow = 1001;
+
+typedef struct {
+    size_t inputWidth;
+    size_t inputHeight;
+    size_t croppedWidth;
+    size_t croppedHeight;
+    size_t offsetX;
+    size_t offsetY;
+} SCCapturerVideoCropGeometry;
+
+static BOOL SCCapturerVideoCropGeometryMake(CVPixelBufferRef inputPixelBuffer, SCCapturerVideoCropGeometry *geometry)
+{
+    const size_t inputBufferWidth = CVPixelBufferGetWidth(inputPixelBuffer);
+    const size_t inputBufferHeight = CVPixelBufferGetHeight(inputPixelBuffer);
+    const size_t croppedBufferWidth = (size_t)(inputBufferWidth * kSCIPhoneXCapturedImageVideoCropRatio) / 2 * 2;
+    const size_t croppedBufferHeight =
+        (size_t)(croppedBufferWidth * SCManagedCapturedImageAndVideoAspectRatio()) / 2 * 2;
+    const size_t offsetPointX = inputBufferWidth - croppedBufferWidth;
+    const size_t offsetPointY = (inputBufferHeight - croppedBufferHeight) / 4 * 2;
+
+    SC_GUARD_ELSE_RUN_AND_RETURN_VALUE((inputBufferWidth >= croppedBufferWidth) &&
+                                           (inputBufferHeight >= croppedBufferHeight) && (offsetPointX % 2 == 0) &&
+                                           (offsetPointY % 2 == 0) &&
+                                           (inputBufferWidth >= croppedBufferWidth + offsetPointX) &&
+                                           (inputBufferHeight >= croppedBufferHeight + offsetPointY),
+                                       SCLogGeneralError(@"Invalid cropping configuration"), NO);
+    geometry->inputWidth = inputBufferWidth;
+    geometry->inputHeight = inputBufferHeight;
+    geometry->croppedWidth = croppedBufferWidth;
+    geometry->croppedHeight = croppedBufferHeight;
+    geometry->offsetX = offsetPointX;
+    geometry->offsetY = offsetPointY;
+    return YES;
+}
+
+struct SCSampleBufferRelease {
+    void operator()(CMSampleBufferRef sampleBuffer) const
+    {
+        CFRelease(sampleBuffer);
+    }
+};
+
+typedef SC::StagingQueue<CMSampleBufferRef, SCSampleBufferRelease> SCSampleBufferStagingQueue;
+
 @implementation SCCapturerBufferedVideoWriter {
     SCQueuePerformer *_performer;
     __weak id<SCCapturerBufferedVideoWriterDelegate> _delegate;
@@ -31,8 +92,11 @@
     CVPixelBufferPoolRef _defaultPixelBufferPool;
     CVPixelBufferPoolRef _nightPixelBufferPool;
     CVPixelBufferPoolRef _lensesPixelBufferPool;
-    CMBufferQueueRef _videoBufferQueue;
-    CMBufferQueueRef _audioBufferQueue;
+    // Samples waiting for the writer inputs to be readyForMoreMediaData, pushed and popped on the performer. The
+    // writer inputs notify them when they become ready, from any thread.
+    std::unique_ptr<SCSampleBufferStagingQueue> _videoStagingQueue;
+    std::unique_ptr<SCSampleBufferStagingQueue> _audioStagingQueue;
+    BOOL _audioStagingOverflowed;
 }
 
 - (instancetype)initWithPerformer:(id<SCPerforming>)performer
@@ -45,10 +109,16 @@
         _performer = performer;
         _delegate = delegate;
         _observeController = [[FBKVOController alloc] initWithObserver:self];
-        CMBufferQueueCreate(kCFAllocatorDefault, 0, CMBufferQueueGetCallbacksForUnsortedSampleBuffers(),
-                            &_videoBufferQueue);
-        CMBufferQueueCreate(kCFAllocatorDefault, 0, CMBufferQueueGetCallbacksForUnsortedSampleBuffers(),
-                            &_audioBufferQueue);
+        // Late video frames are dropped rather than exhausting the capture pool, but audio is never dropped
+        SC::StagingOverflowPolicy videoPolicy = SCCameraTweaksBlockOnVideoWriterStagingOverflow()
+                                                    ? SC::StagingOverflowPolicy::BlockWithTimeout
+                                                    : SC::StagingOverflowPolicy::DropOldest;
+        _videoStagingQueue.reset(new SCSampleBufferStagingQueue(
+            kSCCapturerBufferedVideoWriterVideoStagingCapacity, videoPolicy,
+            kSCCapturerBufferedVideoWriterVideoStagingBlockTimeout));
+        _audioStagingQueue.reset(new SCSampleBufferStagingQueue(
+            kSCCapturerBufferedVideoWriterAudioStagingCapacity, SC::StagingOverflowPolicy::NeverDrop,
+            kSCCapturerBufferedVideoWriterAudioStagingBlockTimeout, kSCCapturerBufferedVideoWriterAudioStagingReserve));
         _assetWriter = [[AVAssetWriter alloc] initWithURL:outputURL fileType:AVFileTypeMPEG4 error:error];
         if (*error) {
             self = nil;
@@ -106,6 +176,16 @@
             kCVPixelBufferHeightKey : @(outputHeight)
         }];
 
+    // Wakes up the staging queues waiting for room
+    [_observeController observe:_videoWriterInput
+                        keyPath:@keypath(_videoWriterInput, readyForMoreMediaData)
+                        options:NSKeyValueObservingOptionNew
+                         action:@selector(videoWriterInputReadinessChanged:)];
+    [_observeController observe:_audioWriterInput
+                        keyPath:@keypath(_audioWriterInput, readyForMoreMediaData)
+                        options:NSKeyValueObservingOptionNew
+                         action:@selector(audioWriterInputReadinessChanged:)];
+
     SCTraceSignal(@"Setup video writer input");
     if ([_assetWriter canAddInput:_videoWriterInput]) {
         [_assetWriter addInput:_videoWriterInput];
@@ -127,24 +207,15 @@
 {
     SCAssert([_performer isCurrentPerformer], @"");
     SC_GUARD_ELSE_RETURN(sampleBuffer);
-    if (!CMBufferQueueIsEmpty(_videoBufferQueue)) {
-        // We need to drain the buffer queue in this case
-        while (_videoWriterInput.readyForMoreMediaData) { // TODO: also need to break out in case of errors
-            CMSampleBufferRef dequeuedSampleBuffer =
-                (CMSampleBufferRef)CMBufferQueueDequeueAndRetain(_videoBufferQueue);
-            if (dequeuedSampleBuffer == NULL) {
-                break;
-            }
-            [self _appendVideoSampleBuffer:dequeuedSampleBuffer];
-            CFRelease(dequeuedSampleBuffer);
-        }
-    }
+    // We need to drain the staging queue first to keep the samples in order
+    [self _drainVideoStagingQueue];
     // Fast path, just append this sample buffer if ready
-    if (_videoWriterInput.readyForMoreMediaData) {
+    if (_videoStagingQueue->empty() && _videoWriterInput.readyForMoreMediaData) {
         [self _appendVideoSampleBuffer:sampleBuffer];
     } else {
-        // It is not ready, queuing the sample buffer
-        CMBufferQueueEnqueue(_videoBufferQueue, sampleBuffer);
+        // It is not ready, staging the sample buffer
+        _videoStagingQueue->push((CMSampleBufferRef)CFRetain(sampleBuffer),
+                                 [self]() { return [self _drainVideoStagingQueue] > 0; });
     }
 }
 
@@ -152,27 +223,45 @@
 {
     SCAssert([_performer isCurrentPerformer], @"");
     SC_GUARD_ELSE_RETURN(sampleBuffer);
-    if (!CMBufferQueueIsEmpty(_audioBufferQueue)) {
-        // We need to drain the buffer queue in this case
-        while (_audioWriterInput.readyForMoreMediaData) {
-            CMSampleBufferRef dequeuedSampleBuffer =
-                (CMSampleBufferRef)CMBufferQueueDequeueAndRetain(_audioBufferQueue);
-            if (dequeuedSampleBuffer == NULL) {
-                break;
-            }
-            [_audioWriterInput appendSampleBuffer:sampleBuffer];
-            CFRelease(dequeuedSampleBuffer);
-        }
-    }
+    // We need to drain the staging queue first to keep the samples in order
+    [self _drainAudioStagingQueue];
     // fast path, just append this sample buffer if ready
-    if ((_audioWriterInput.readyForMoreMediaData)) {
+    if (_audioStagingQueue->empty() && _audioWriterInput.readyForMoreMediaData) {
         [_audioWriterInput appendSampleBuffer:sampleBuffer];
     } else {
-        // it is not ready, queuing the sample buffer
-        CMBufferQueueEnqueue(_audioBufferQueue, sampleBuffer);
+        // it is not ready, staging the sample buffer
+        BOOL staged = _audioStagingQueue->push((CMSampleBufferRef)CFRetain(sampleBuffer),
+                                               [self]() { return [self _drainAudioStagingQueue] > 0; });
+        if (!staged && !_audioStagingOverflowed) {
+            // Rather than a recording with a hole in its audio
+            _audioStagingOverflowed = YES;
+            SCLogGeneralError(@"[SCCapturerBufferedVideoWriter] Audio staging overflowed, the writer input is stalled");
+            NSError *error = [NSError errorWithDomain:kSCCapturerBufferedVideoWriterErrorDomain
+                                                 code:kSCCapturerBufferedVideoWriterAudioStagingOverflow
+                                             userInfo:nil];
+            [_delegate videoWriterDidFailWritingWithError:error];
+        }
     }
 }
 
+- (NSDictionary *)stagingStatistics
+{
+    SCAssert([_performer isCurrentPerformer], @"");
+    const SC::StagingStatistics &videoStatistics = _videoStagingQueue->statistics();
+    const SC::StagingStatistics &audioStatistics = _audioStagingQueue->statistics();
+    // Nothing to report if the writer inputs kept up
+    SC_GUARD_ELSE_RETURN_VALUE(videoStatistics.highWaterMark > 0 || audioStatistics.highWaterMark > 0, nil);
+    return @{
+        @"video_staging_high_water_mark" : @(videoStatistics.highWaterMark),
+        @"video_staging_dropped" : @(videoStatistics.droppedCount),
+        @"video_staging_blocked_time" : @(videoStatistics.blockedSeconds),
+        @"audio_staging_high_water_mark" : @(audioStatistics.highWaterMark),
+        @"audio_staging_reserved" : @(audioStatistics.reservedCount),
+        @"audio_staging_overflowed" : @(audioStatistics.overflowCount),
+        @"audio_staging_blocked_time" : @(audioStatistics.blockedSeconds),
+    };
+}
+
 - (void)startWritingAtSourceTime:(CMTime)sourceTime
 {
     SCTraceStart();
@@ -191,8 +280,8 @@
 {
     SCTraceStart();
     SCAssert([_performer isCurrentPerformer], @"");
-    CMBufferQueueReset(_videoBufferQueue);
-    CMBufferQueueReset(_audioBufferQueue);
+    _videoStagingQueue->clear();
+    _audioStagingQueue->clear();
     [_assetWriter cancelWriting];
 }
 
@@ -201,22 +290,8 @@
     SCTraceStart();
     SCAssert([_performer isCurrentPerformer], @"");
 
-    while (_audioWriterInput.readyForMoreMediaData && !CMBufferQueueIsEmpty(_audioBufferQueue)) {
-        CMSampleBufferRef audioSampleBuffer = (CMSampleBufferRef)CMBufferQueueDequeueAndRetain(_audioBufferQueue);
-        if (audioSampleBuffer == NULL) {
-            break;
-        }
-        [_audioWriterInput appendSampleBuffer:audioSampleBuffer];
-        CFRelease(audioSampleBuffer);
-    }
-    while (_videoWriterInput.readyForMoreMediaData && !CMBufferQueueIsEmpty(_videoBufferQueue)) {
-        CMSampleBufferRef videoSampleBuffer = (CMSampleBufferRef)CMBufferQueueDequeueAndRetain(_videoBufferQueue);
-        if (videoSampleBuffer == NULL) {
-            break;
-        }
-        [_videoWriterInput appendSampleBuffer:videoSampleBuffer];
-        CFRelease(videoSampleBuffer);
-    }
+    [self _drainAudioStagingQueue];
+    [self _drainVideoStagingQueue];
 
     dispatch_block_t finishWritingBlock = ^() {
         [_assetWriter endSessionAtSourceTime:sourceTime];
@@ -229,7 +304,7 @@
         }];
     };
 
-    if (CMBufferQueueIsEmpty(_audioBufferQueue) && CMBufferQueueIsEmpty(_videoBufferQueue)) {
+    if (_audioStagingQueue->empty() && _videoStagingQueue->empty()) {
         finishWritingBlock();
     } else {
         // We need to drain the samples from the queues before finish writing
@@ -239,14 +314,11 @@
         [_audioWriterInput
             requestMediaDataWhenReadyOnQueue:_performer.queue
                                   usingBlock:^{
-                                      if (!CMBufferQueueIsEmpty(_audioBufferQueue) &&
-                                          _assetWriter.status == AVAssetWriterStatusWriting) {
-                                          CMSampleBufferRef audioSampleBuffer =
-                                              (CMSampleBufferRef)CMBufferQueueDequeueAndRetain(_audioBufferQueue);
-                                          if (audioSampleBuffer) {
-                                              [_audioWriterInput appendSampleBuffer:audioSampleBuffer];
-                                              CFRelease(audioSampleBuffer);
-                                          }
+                                      CMSampleBufferRef audioSampleBuffer = NULL;
+                                      if (_assetWriter.status == AVAssetWriterStatusWriting &&
+                                          _audioStagingQueue->pop(audioSampleBuffer)) {
+                                          [_audioWriterInput appendSampleBuffer:audioSampleBuffer];
+                                          CFRelease(audioSampleBuffer);
                                       } else if (!isAudioDone) {
                                           isAudioDone = YES;
                                       }
@@ -259,14 +331,11 @@
         [_videoWriterInput
             requestMediaDataWhenReadyOnQueue:_performer.queue
                                   usingBlock:^{
-                                      if (!CMBufferQueueIsEmpty(_videoBufferQueue) &&
-                                          _assetWriter.status == AVAssetWriterStatusWriting) {
-                                          CMSampleBufferRef videoSampleBuffer =
-                                              (CMSampleBufferRef)CMBufferQueueDequeueAndRetain(_videoBufferQueue);
-                                          if (videoSampleBuffer) {
-                                              [_videoWriterInput appendSampleBuffer:videoSampleBuffer];
-                                              CFRelease(videoSampleBuffer);
-                                          }
+                                      CMSampleBufferRef videoSampleBuffer = NULL;
+                                      if (_assetWriter.status == AVAssetWriterStatusWriting &&
+                                          _videoStagingQueue->pop(videoSampleBuffer)) {
+                                          [self _appendVideoSampleBuffer:videoSampleBuffer];
+                                          CFRelease(videoSampleBuffer);
                                       } else if (!isVideoDone) {
                                           isVideoDone = YES;
                                       }
@@ -279,6 +348,17 @@
 
 - (void)cleanUp
 {
+    _videoStagingQueue->clear();
+    _audioStagingQueue->clear();
+    _videoStagingQueue->resetStatistics();
+    _audioStagingQueue->resetStatistics();
+    _audioStagingOverflowed = NO;
+    if (_videoWriterInput) {
+        [_observeController unobserve:_videoWriterInput];
+    }
+    if (_audioWriterInput) {
+        [_observeController unobserve:_audioWriterInput];
+    }
     _assetWriter = nil;
     _videoWriterInput = nil;
     _audioWriterInput = nil;
@@ -287,8 +367,6 @@
 
 - (void)dealloc
 {
-    CFRelease(_videoBufferQueue);
-    CFRelease(_audioBufferQueue);
     CVPixelBufferPoolRelease(_defaultPixelBufferPool);
     CVPixelBufferPoolRelease(_nightPixelBufferPool);
     CVPixelBufferPoolRelease(_lensesPixelBufferPool);
@@ -304,30 +382,29 @@
     }
 }
 
+// Called on an arbitrary thread
+- (void)videoWriterInputReadinessChanged:(NSDictionary *)change
+{
+    _videoStagingQueue->notify();
+}
+
+- (void)audioWriterInputReadinessChanged:(NSDictionary *)change
+{
+    _audioStagingQueue->notify();
+}
+
 #pragma - Private methods
 
 - (CVImageBufferRef)_croppedPixelBufferWithInputPixelBuffer:(CVImageBufferRef)inputPixelBuffer
 {
     SCAssertTrue([SCDeviceName isIphoneX]);
-    const size_t inputBufferWidth = CVPixelBufferGetWidth(inputPixelBuffer);
-    const size_t inputBufferHeight = CVPixelBufferGetHeight(inputPixelBuffer);
-    const size_t croppedBufferWidth = (size_t)(inputBufferWidth * kSCIPhoneXCapturedImageVideoCropRatio) / 2 * 2;
-    const size_t croppedBufferHeight =
-        (size_t)(croppedBufferWidth * SCManagedCapturedImageAndVideoAspectRatio()) / 2 * 2;
-    const size_t offsetPointX = inputBufferWidth - croppedBufferWidth;
-    const size_t offsetPointY = (inputBufferHeight - croppedBufferHeight) / 4 * 2;
-
-    SC_GUARD_ELSE_RUN_AND_RETURN_VALUE((inputBufferWidth >= croppedBufferWidth) &&
-                                           (inputBufferHeight >= croppedBufferHeight) && (offsetPointX % 2 == 0) &&
-                                           (offsetPointY % 2 == 0) &&
-                                           (inputBufferWidth >= croppedBufferWidth + offsetPointX) &&
-                                           (inputBufferHeight >= croppedBufferHeight + offsetPointY),
-                                       SCLogGeneralError(@"Invalid cropping configuration"), NULL);
+    SCCapturerVideoCropGeometry geometry;
+    SC_GUARD_ELSE_RETURN_VALUE(SCCapturerVideoCropGeometryMake(inputPixelBuffer, &geometry), NULL);
 
     CVPixelBufferRef croppedPixelBuffer = NULL;
     CVPixelBufferPoolRef pixelBufferPool =
-        [self _pixelBufferPoolWithInputSize:CGSizeMake(inputBufferWidth, inputBufferHeight)
-                                croppedSize:CGSizeMake(croppedBufferWidth, croppedBufferHeight)];
+        [self _pixelBufferPoolWithInputSize:CGSizeMake(geometry.inputWidth, geometry.inputHeight)
+                                croppedSize:CGSizeMake(geometry.croppedWidth, geometry.croppedHeight)];
 
     if (pixelBufferPool) {
         CVReturn result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, pixelBufferPool, &croppedPixelBuffer);
@@ -338,7 +415,8 @@
     } else {
         SCAssertFail(@"[SCCapturerVideoWriterInput] PixelBufferPool is NULL with inputBufferWidth:%@, "
                      @"inputBufferHeight:%@, croppedBufferWidth:%@, croppedBufferHeight:%@",
-                     @(inputBufferWidth), @(inputBufferHeight), @(croppedBufferWidth), @(croppedBufferHeight));
+                     @(geometry.inputWidth), @(geometry.inputHeight), @(geometry.croppedWidth),
+                     @(geometry.croppedHeight));
         return NULL;
     }
     CVPixelBufferLockBaseAddress(inputPixelBuffer, kCVPixelBufferLock_ReadOnly);
@@ -356,16 +434,17 @@
 
         // Note that inPlaneBytesPerRow is not strictly 2x of inPlaneWidth for some devices (e.g. iPhone X).
         // However, since UV are packed together in memory, we can use offsetPointX for all planes
-        size_t offsetPlaneBytesX = offsetPointX;
-        size_t offsetPlaneBytesY = offsetPointY * inPlaneHeight / inputBufferHeight;
-
-        inPlaneAdress = inPlaneAdress + offsetPlaneBytesY * inPlaneBytesPerRow + offsetPlaneBytesX;
-        size_t bytesToCopyPerRow = MIN(inPlaneBytesPerRow - offsetPlaneBytesX, croppedPlaneBytesPerRow);
-        for (int i = 0; i < croppedPlaneHeight; i++) {
-            memcpy(croppedPlaneAdress, inPlaneAdress, bytesToCopyPerRow);
-            inPlaneAdress += inPlaneBytesPerRow;
-            croppedPlaneAdress += croppedPlaneBytesPerRow;
-        }
+        size_t offsetPlaneBytesX = geometry.offsetX;
+        size_t offsetPlaneBytesY = geometry.offsetY * inPlaneHeight / geometry.inputHeight;
+
+        SC::PlaneRegion region;
+        region.source = inPlaneAdress + offsetPlaneBytesY * inPlaneBytesPerRow + offsetPlaneBytesX;
+        region.sourceBytesPerRow = inPlaneBytesPerRow;
+        region.destination = croppedPlaneAdress;
+        region.destinationBytesPerRow = croppedPlaneBytesPerRow;
+        region.bytesPerRow = MIN(inPlaneBytesPerRow - offsetPlaneBytesX, croppedPlaneBytesPerRow);
+        region.rows = croppedPlaneHeight;
+        SC::PlaneRegionCopy(region);
     }
     CVPixelBufferUnlockBaseAddress(inputPixelBuffer, kCVPixelBufferLock_ReadOnly);
     CVPixelBufferUnlockBaseAddress(croppedPixelBuffer, 0);
@@ -411,6 +490,33 @@
     return pixelBufferPool;
 }
 
+- (NSUInteger)_drainVideoStagingQueue
+{
+    SCAssert([_performer isCurrentPerformer], @"");
+    NSUInteger drainedCount = 0;
+    CMSampleBufferRef sampleBuffer = NULL;
+    // TODO: also need to break out in case of errors
+    while (_videoWriterInput.readyForMoreMediaData && _videoStagingQueue->pop(sampleBuffer)) {
+        [self _appendVideoSampleBuffer:sampleBuffer];
+        CFRelease(sampleBuffer);
+        drainedCount++;
+    }
+    return drainedCount;
+}
+
+- (NSUInteger)_drainAudioStagingQueue
+{
+    SCAssert([_performer isCurrentPerformer], @"");
+    NSUInteger drainedCount = 0;
+    CMSampleBufferRef sampleBuffer = NULL;
+    while (_audioWriterInput.readyForMoreMediaData && _audioStagingQueue->pop(sampleBuffer)) {
+        [_audioWriterInput appendSampleBuffer:sampleBuffer];
+        CFRelease(sampleBuffer);
+        drainedCount++;
+    }
+    return drainedCount;
+}
+
 - (void)_appendVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer
 {
     SCAssert([_performer isCurrentPerformer], @"");
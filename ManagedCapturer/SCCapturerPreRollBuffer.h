@@ -0,0 +1,44 @@
+//
+//  SCCapturerPreRollBuffer.h
+//  Snapchat
+//
+
+#import <CoreMedia/CoreMedia.h>
+#import <Foundation/Foundation.h>
+
+typedef void (^sc_capturer_pre_roll_sample_buffer_block_t)(CMSampleBufferRef sampleBuffer);
+
+/*
+ Memory bounded pre-roll of the latest video frames and audio buffers, so that a recording can be written from the
+ moment it was requested rather than from the first frame after the writer got set up. Held video frames keep their
+ IOSurface out of the capture pool, so the oldest ones are let go as soon as either the frame count or the byte budget
+ is exceeded. Not thread safe, it is confined to the queue of its owner.
+ */
+@interface SCCapturerPreRollBuffer : NSObject
+
+- (instancetype)initWithMaxVideoFrameCount:(NSUInteger)maxVideoFrameCount
+                       maxAudioBufferCount:(NSUInteger)maxAudioBufferCount
+                          maxRetainedBytes:(size_t)maxRetainedBytes;
+
+@property (nonatomic, assign, readonly) NSUInteger videoFrameCount;
+@property (nonatomic, assign, readonly) NSUInteger audioBufferCount;
+
+// Bytes of the held IOSurfaces and audio data
+@property (nonatomic, assign, readonly) size_t retainedBytes;
+
+- (void)appendVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer;
+- (void)appendAudioSampleBuffer:(CMSampleBufferRef)sampleBuffer;
+
+/* Hands out the held buffers presented at or after time, oldest first, and lets go of all of them. An invalid time
+ * hands out every buffer. */
+- (void)drainVideoSampleBuffersFromTime:(CMTime)time handler:(sc_capturer_pre_roll_sample_buffer_block_t)handler;
+
+// Same as the video one, except that audio buffers spanning time are handed out as well, they end after it
+- (void)drainAudioSampleBuffersFromTime:(CMTime)time handler:(sc_capturer_pre_roll_sample_buffer_block_t)handler;
+
+- (void)clear;
+
+// Peak memory use and evictions since the last call, nil if nothing was held
+- (NSDictionary *)statistics;
+
+@end
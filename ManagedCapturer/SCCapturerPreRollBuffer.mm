@@ -0,0 +1,189 @@
+//
+//  SCCapturerPreRollBuffer.mm
+//  Snapchat
+//
+
+#import "SCCapturerPreRollBuffer.h"
+
+#import "SCRingBuffer.h"
+
+#import <SCBase/SCMacros.h>
+
+#import <IOSurface/IOSurfaceRef.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+struct SCPreRollSample {
+    CMSampleBufferRef sampleBuffer;
+    size_t byteSize;
+};
+
+size_t SCPreRollVideoByteSize(CMSampleBufferRef sampleBuffer)
+{
+    CVImageBufferRef imageBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
+    SC_GUARD_ELSE_RETURN_VALUE(imageBuffer, 0);
+    // The IOSurface is what the capture pool runs out of, it can be larger than the pixel data
+    IOSurfaceRef surface = CVPixelBufferGetIOSurface(imageBuffer);
+    return surface ? IOSurfaceGetAllocSize(surface) : CVPixelBufferGetDataSize(imageBuffer);
+}
+
+} // namespace
+
+@implementation SCCapturerPreRollBuffer {
+    std::unique_ptr<SC::RingBuffer<SCPreRollSample>> _videoSamples;
+    std::unique_ptr<SC::RingBuffer<SCPreRollSample>> _audioSamples;
+    NSUInteger _maxAudioBufferCount;
+    size_t _maxRetainedBytes;
+    size_t _retainedBytes;
+    size_t _peakRetainedBytes;
+    NSUInteger _peakVideoFrameCount;
+    NSUInteger _evictedVideoFrameCount;
+    NSUInteger _evictedAudioBufferCount;
+}
+
+- (instancetype)initWithMaxVideoFrameCount:(NSUInteger)maxVideoFrameCount
+                       maxAudioBufferCount:(NSUInteger)maxAudioBufferCount
+                          maxRetainedBytes:(size_t)maxRetainedBytes
+{
+    self = [super init];
+    if (self) {
+        _videoSamples.reset(new SC::RingBuffer<SCPreRollSample>(maxVideoFrameCount));
+        // A ring of no capacity still holds one sample, appending audio is turned off instead
+        _audioSamples.reset(new SC::RingBuffer<SCPreRollSample>(maxAudioBufferCount));
+        _maxAudioBufferCount = maxAudioBufferCount;
+        _maxRetainedBytes = maxRetainedBytes;
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self clear];
+}
+
+- (NSUInteger)videoFrameCount
+{
+    return _videoSamples->size();
+}
+
+- (NSUInteger)audioBufferCount
+{
+    return _audioSamples->size();
+}
+
+- (size_t)retainedBytes
+{
+    return _retainedBytes;
+}
+
+- (void)appendVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+    SC_GUARD_ELSE_RETURN(sampleBuffer);
+    size_t byteSize = SCPreRollVideoByteSize(sampleBuffer);
+    while (_videoSamples->full() || (!_videoSamples->empty() && _retainedBytes + byteSize > _maxRetainedBytes)) {
+        [self _popSampleFrom:*_videoSamples];
+        ++_evictedVideoFrameCount;
+    }
+    [self _pushSampleBuffer:sampleBuffer byteSize:byteSize to:*_videoSamples];
+    _peakVideoFrameCount = std::max(_peakVideoFrameCount, (NSUInteger)_videoSamples->size());
+}
+
+- (void)appendAudioSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+    SC_GUARD_ELSE_RETURN(sampleBuffer && _maxAudioBufferCount > 0);
+    size_t byteSize = CMSampleBufferGetTotalSampleSize(sampleBuffer);
+    while (_audioSamples->full() || (!_audioSamples->empty() && _retainedBytes + byteSize > _maxRetainedBytes)) {
+        [self _popSampleFrom:*_audioSamples];
+        ++_evictedAudioBufferCount;
+    }
+    [self _pushSampleBuffer:sampleBuffer byteSize:byteSize to:*_audioSamples];
+}
+
+- (void)drainVideoSampleBuffersFromTime:(CMTime)time handler:(sc_capturer_pre_roll_sample_buffer_block_t)handler
+{
+    [self _drainSamples:*_videoSamples fromTime:time includingSpanning:NO handler:handler];
+}
+
+- (void)drainAudioSampleBuffersFromTime:(CMTime)time handler:(sc_capturer_pre_roll_sample_buffer_block_t)handler
+{
+    [self _drainSamples:*_audioSamples fromTime:time includingSpanning:YES handler:handler];
+}
+
+- (void)clear
+{
+    while (!_videoSamples->empty()) {
+        [self _popSampleFrom:*_videoSamples];
+    }
+    while (!_audioSamples->empty()) {
+        [self _popSampleFrom:*_audioSamples];
+    }
+}
+
+- (NSDictionary *)statistics
+{
+    NSDictionary *statistics = nil;
+    if (_peakRetainedBytes > 0) {
+        statistics = @{
+            @"pre_roll_peak_bytes" : @(_peakRetainedBytes),
+            @"pre_roll_peak_video_frames" : @(_peakVideoFrameCount),
+            @"pre_roll_evicted_video_frames" : @(_evictedVideoFrameCount),
+            @"pre_roll_evicted_audio_buffers" : @(_evictedAudioBufferCount),
+        };
+    }
+    _peakRetainedBytes = _retainedBytes;
+    _peakVideoFrameCount = _videoSamples->size();
+    _evictedVideoFrameCount = 0;
+    _evictedAudioBufferCount = 0;
+    return statistics;
+}
+
+#pragma mark - Private methods
+
+- (void)_pushSampleBuffer:(CMSampleBufferRef)sampleBuffer
+                 byteSize:(size_t)byteSize
+                       to:(SC::RingBuffer<SCPreRollSample> &)samples
+{
+    CFRetain(sampleBuffer);
+    samples.push({sampleBuffer, byteSize});
+    _retainedBytes += byteSize;
+    _peakRetainedBytes = std::max(_peakRetainedBytes, _retainedBytes);
+}
+
+- (void)_popSampleFrom:(SC::RingBuffer<SCPreRollSample> &)samples
+{
+    SCPreRollSample sample;
+    if (samples.pop(sample)) {
+        _retainedBytes -= sample.byteSize;
+        CFRelease(sample.sampleBuffer);
+    }
+}
+
+- (void)_drainSamples:(SC::RingBuffer<SCPreRollSample> &)samples
+             fromTime:(CMTime)time
+    includingSpanning:(BOOL)includingSpanning
+              handler:(sc_capturer_pre_roll_sample_buffer_block_t)handler
+{
+    SCPreRollSample sample;
+    while (samples.pop(sample)) {
+        _retainedBytes -= sample.byteSize;
+        BOOL handedOut = CMTIME_IS_INVALID(time);
+        if (!handedOut) {
+            CMTime presentationTime = CMSampleBufferGetPresentationTimeStamp(sample.sampleBuffer);
+            CMTime duration = CMSampleBufferGetDuration(sample.sampleBuffer);
+            if (includingSpanning && CMTIME_IS_NUMERIC(duration)) {
+                handedOut = CMTimeCompare(CMTimeAdd(presentationTime, duration), time) > 0;
+            } else {
+                handedOut = CMTimeCompare(presentationTime, time) >= 0;
+            }
+        }
+        if (handler && handedOut) {
+            handler(sample.sampleBuffer);
+        }
+        CFRelease(sample.sampleBuffer);
+    }
+}
+
+@end
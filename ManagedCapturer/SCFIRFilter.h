@@ -0,0 +1,192 @@
+//
+//  SCFIRFilter.h
+//  Snapchat
+//
+//  Platform independent FIR filter over a fixed size ring of the latest samples, with compile time generated
+//  Savitzky-Golay smoothing coefficients (https://en.wikipedia.org/wiki/Savitzky%E2%80%93Golay_filter).
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace SC {
+
+template <size_t Taps>
+struct FIRCoefficients {
+    double values[Taps];
+
+    constexpr size_t size() const
+    {
+        return Taps;
+    }
+
+    constexpr double operator[](size_t index) const
+    {
+        return values[index];
+    }
+};
+
+namespace detail {
+
+constexpr double IntegerPower(double base, size_t exponent)
+{
+    double result = 1;
+    for (size_t i = 0; i < exponent; ++i) {
+        result *= base;
+    }
+    return result;
+}
+
+constexpr double Absolute(double value)
+{
+    return value < 0 ? -value : value;
+}
+
+} // namespace detail
+
+/*
+ Coefficients smoothing the center sample of a window of Window samples, oldest first, with a least squares fit of a
+    polynomial of degree Order. Computed from the normal equations of the fit, solved with Gauss-Jordan elimination:
+    only the constant term of the polynomial is needed, so only the first row of the inverse Gram matrix is.
+ */
+template <size_t Window, size_t Order>
+constexpr FIRCoefficients<Window> SavitzkyGolayCoefficients()
+{
+    static_assert(Window % 2 == 1, "Savitzky-Golay window must be odd");
+    static_assert(Order < Window, "Savitzky-Golay order must be lower than the window");
+    const size_t n = Order + 1;
+    const double half = (double)(Window / 2);
+    // Gram matrix augmented with the identity, gram[j][k] = sum over the window of x^(j + k)
+    double gram[Order + 1][2 * (Order + 1)] = {};
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t k = 0; k < n; ++k) {
+            for (size_t i = 0; i < Window; ++i) {
+                gram[j][k] += detail::IntegerPower((double)i - half, j + k);
+            }
+        }
+        gram[j][n + j] = 1;
+    }
+    for (size_t column = 0; column < n; ++column) {
+        size_t pivot = column;
+        for (size_t row = column + 1; row < n; ++row) {
+            if (detail::Absolute(gram[row][column]) > detail::Absolute(gram[pivot][column])) {
+                pivot = row;
+            }
+        }
+        for (size_t k = 0; k < 2 * n; ++k) {
+            double swapped = gram[column][k];
+            gram[column][k] = gram[pivot][k];
+            gram[pivot][k] = swapped;
+        }
+        double divisor = gram[column][column];
+        for (size_t k = 0; k < 2 * n; ++k) {
+            gram[column][k] /= divisor;
+        }
+        for (size_t row = 0; row < n; ++row) {
+            if (row != column) {
+                double factor = gram[row][column];
+                for (size_t k = 0; k < 2 * n; ++k) {
+                    gram[row][k] -= factor * gram[column][k];
+                }
+            }
+        }
+    }
+    FIRCoefficients<Window> coefficients = {};
+    for (size_t i = 0; i < Window; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            coefficients.values[i] += gram[0][n + j] * detail::IntegerPower((double)i - half, j);
+        }
+    }
+    return coefficients;
+}
+
+/*
+ FIR filter whose number of taps can be picked at runtime, up to MaxTaps. The samples are kept in place, so pushing a
+    sample never allocates.
+ */
+template <typename T, size_t MaxTaps>
+class FIRFilter {
+public:
+    FIRFilter()
+        : _coefficients()
+        , _samples()
+        , _taps(0)
+        , _head(0)
+        , _count(0)
+    {
+    }
+
+    // Also drops the samples pushed so far
+    template <size_t Taps>
+    void setCoefficients(const FIRCoefficients<Taps> &coefficients)
+    {
+        static_assert(Taps > 0 && Taps <= MaxTaps, "FIR filter taps out of range");
+        for (size_t i = 0; i < Taps; ++i) {
+            _coefficients[i] = coefficients[i];
+        }
+        _taps = Taps;
+        reset();
+    }
+
+    size_t taps() const
+    {
+        return _taps;
+    }
+
+    size_t size() const
+    {
+        return _count;
+    }
+
+    bool full() const
+    {
+        return _taps > 0 && _count == _taps;
+    }
+
+    void reset()
+    {
+        _head = 0;
+        _count = 0;
+    }
+
+    // Overwrites the oldest sample once the filter is full
+    void push(const T &sample)
+    {
+        if (_taps == 0) {
+            return;
+        }
+        if (_count < _taps) {
+            _samples[(_head + _count) % _taps] = sample;
+            ++_count;
+        } else {
+            _samples[_head] = sample;
+            _head = (_head + 1) % _taps;
+        }
+    }
+
+    // Only meaningful when the filter is not empty
+    const T &latest() const
+    {
+        return _samples[(_head + _count - 1) % _taps];
+    }
+
+    // The first coefficient applies to the oldest sample, only meaningful when the filter is full
+    T value() const
+    {
+        T result = T();
+        for (size_t i = 0; i < _taps; ++i) {
+            result += (T)_coefficients[i] * _samples[(_head + i) % _taps];
+        }
+        return result;
+    }
+
+private:
+    double _coefficients[MaxTaps];
+    T _samples[MaxTaps];
+    size_t _taps;
+    size_t _head;
+    size_t _count;
+};
+
+} // namespace SC
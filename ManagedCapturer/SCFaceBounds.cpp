@@ -0,0 +1,95 @@
+//
+//  SCFaceBounds.cpp
+//  Snapchat
+//
+
+#include "SCFaceBounds.h"
+
+namespace SC {
+
+bool AddFace(SCFaceBoundsList &faces, int64_t faceID, const SCFaceRect &rect, double minimumArea)
+{
+    double area = FaceRectArea(rect);
+    if (area < minimumArea) {
+        return false;
+    }
+    SCFaceBounds *smallestFace = nullptr;
+    for (size_t index = 0; index < faces.count; ++index) {
+        SCFaceBounds &face = faces.faces[index];
+        if (face.faceID == faceID) {
+            face.rect = rect;
+            return true;
+        }
+        if (!smallestFace || FaceRectArea(face.rect) < FaceRectArea(smallestFace->rect)) {
+            smallestFace = &face;
+        }
+    }
+    if (faces.count < kSCFaceBoundsMaxCount) {
+        faces.faces[faces.count++] = {faceID, rect};
+        return true;
+    }
+    if (area <= FaceRectArea(smallestFace->rect)) {
+        return false;
+    }
+    *smallestFace = {faceID, rect};
+    return true;
+}
+
+const SCFaceBounds *FindFace(const SCFaceBoundsList &faces, int64_t faceID)
+{
+    for (const SCFaceBounds &face : faces) {
+        if (face.faceID == faceID) {
+            return &face;
+        }
+    }
+    return nullptr;
+}
+
+SCFaceRect NormalizedFaceRect(const SCFaceRect &rect, double imageWidth, double imageHeight, bool flipVertically)
+{
+    SCFaceRect normalized = {rect.x / imageWidth, rect.y / imageHeight, rect.width / imageWidth,
+                             rect.height / imageHeight};
+    if (flipVertically) {
+        normalized.y = 1 - (rect.y + rect.height) / imageHeight;
+    }
+    return normalized;
+}
+
+const SCFaceBounds *PreferredFace(const SCFaceBoundsList &faces)
+{
+    const SCFaceBounds *preferredFace = nullptr;
+    double maxArea = 0;
+    for (const SCFaceBounds &face : faces) {
+        if (FaceRectArea(face.rect) > maxArea) {
+            preferredFace = &face;
+            maxArea = FaceRectArea(face.rect);
+        }
+    }
+    return preferredFace;
+}
+
+const SCFaceBounds *FaceContainingPoint(const SCFaceBoundsList &faces, double x, double y)
+{
+    for (const SCFaceBounds &face : faces) {
+        if (FaceRectContainsPoint(face.rect, x, y)) {
+            return &face;
+        }
+    }
+    return nullptr;
+}
+
+bool ShouldRetargetFace(const SCFaceBounds *targetedFace, const SCFaceBounds &face)
+{
+    if (!targetedFace || targetedFace->faceID != face.faceID) {
+        return true;
+    }
+    if (FaceRectIsEmpty(targetedFace->rect) ||
+        !FaceRectContainsPoint(targetedFace->rect, FaceRectMidX(face.rect), FaceRectMidY(face.rect))) {
+        return true;
+    }
+    double currentArea = FaceRectArea(targetedFace->rect);
+    double newArea = FaceRectArea(face.rect);
+    return newArea >= currentArea * 1.2 || newArea <= currentArea * 0.8;
+}
+
+} // namespace SC
@@ -0,0 +1,108 @@
+//
+//  SCFaceBounds.h
+//  Snapchat
+//
+//  Platform independent face bounds used along the face detection pipeline: normalizing and filtering the detected
+//  faces, and picking the face the point of interest should target. Faces are kept in a fixed capacity list, so none of
+//  it allocates. The types are plain C so that they can go through the SCManagedCapturerListener API, the helpers only
+//  depend on the C++ standard library so that they can be built and exercised off device.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CIDetector is capped at 2 faces and AVCaptureMetadataOutput reports a handful at most
+enum { kSCFaceBoundsMaxCount = 16 };
+
+typedef struct SCFaceRect {
+    double x;
+    double y;
+    double width;
+    double height;
+} SCFaceRect;
+
+typedef struct SCFaceBounds {
+    int64_t faceID;
+    SCFaceRect rect;
+} SCFaceBounds;
+
+// Copied by value, faces past count are garbage
+typedef struct SCFaceBoundsList {
+    size_t count;
+    SCFaceBounds faces[kSCFaceBoundsMaxCount];
+} SCFaceBoundsList;
+
+#ifdef __cplusplus
+
+// Range-based for over the faces in the list, found by argument dependent lookup
+inline const SCFaceBounds *begin(const SCFaceBoundsList &faces)
+{
+    return faces.faces;
+}
+
+inline const SCFaceBounds *end(const SCFaceBoundsList &faces)
+{
+    return faces.faces + faces.count;
+}
+
+namespace SC {
+
+inline double FaceRectArea(const SCFaceRect &rect)
+{
+    return rect.width * rect.height;
+}
+
+inline double FaceRectMidX(const SCFaceRect &rect)
+{
+    return rect.x + rect.width / 2;
+}
+
+inline double FaceRectMidY(const SCFaceRect &rect)
+{
+    return rect.y + rect.height / 2;
+}
+
+inline bool FaceRectIsEmpty(const SCFaceRect &rect)
+{
+    return rect.x == 0 && rect.y == 0 && rect.width == 0 && rect.height == 0;
+}
+
+// Same as CGRectContainsPoint, the max edges are excluded
+inline bool FaceRectContainsPoint(const SCFaceRect &rect, double x, double y)
+{
+    return x >= rect.x && x < rect.x + rect.width && y >= rect.y && y < rect.y + rect.height;
+}
+
+/*
+ Adds the face unless its area is below minimumArea. Like in a dictionary keyed by face id, it replaces the face with
+ the same id if there is one. Once the list is full, it replaces the smallest face if it is larger than that one.
+ Returns false when the face is dropped.
+ */
+bool AddFace(SCFaceBoundsList &faces, int64_t faceID, const SCFaceRect &rect, double minimumArea = 0);
+
+// nullptr when there is no face with this id
+const SCFaceBounds *FindFace(const SCFaceBoundsList &faces, int64_t faceID);
+
+/*
+ Normalizes the bounds of a face detected in an image of the given size to [0, 1]. Faces detected by CIDetector in the
+ back camera are upside down, flipVertically mirrors them back.
+ */
+SCFaceRect NormalizedFaceRect(const SCFaceRect &rect, double imageWidth, double imageHeight, bool flipVertically);
+
+// Face with the largest area, nullptr when there is no face with a positive area
+const SCFaceBounds *PreferredFace(const SCFaceBoundsList &faces);
+
+// First face containing the point, nullptr if none does
+const SCFaceBounds *FaceContainingPoint(const SCFaceBoundsList &faces, double x, double y);
+
+/*
+ Moving the point of interest is costly, it is only worth it when the face is a different one than the targeted one,
+ its center is out of the targeted bounds, or its area changed by more than 20%.
+ */
+bool ShouldRetargetFace(const SCFaceBounds *targetedFace, const SCFaceBounds &face);
+
+} // namespace SC
+
+#endif
@@ -1,5 +1,5 @@
 //
-//  SCFileAudioCaptureSession.m
+//  SCFileAudioCaptureSession.mm
 //  Snapchat
 //
 //  Created by Xiaomu Wu on 2/2/17.
@@ -8,6 +8,8 @@
 
 #import "SCFileAudioCaptureSession.h"
 
+#import "SCPooledBlockBuffer.h"
+
 #import <SCFoundation/SCAssertWrapper.h>
 #import <SCFoundation/SCLog.h>
 #import <SCFoundation/SCQueuePerformer.h>
@@ -16,6 +18,7 @@
 @import AudioToolbox;
 
 static float const kAudioBufferDurationInSeconds = 0.2; // same as SCAudioCaptureSession
+static size_t const kNumberOfAudioBuffersInPool = 15;   // same as SCAudioCaptureSession
 
 static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-audio-capture-session";
 
@@ -31,7 +34,7 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
     SInt64 _readCurPacket;                          // current packet index to read
     UInt32 _readNumPackets;                         // number of packets to read every time
     UInt32 _readNumBytes;                           // number of bytes to read every time
-    void *_readBuffer;                              // data buffer to hold read packets
+    SC::BlockPool *_readBlockPool;                  // blocks the packets are read into
 }
 
 @synthesize delegate = _delegate;
@@ -59,8 +62,8 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
     if (_formatDescription) {
         CFRelease(_formatDescription);
     }
-    if (_readBuffer) {
-        free(_readBuffer);
+    if (_readBlockPool) {
+        _readBlockPool->release();
     }
 }
 
@@ -140,7 +143,7 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
     AudioChannelLayout *acl = NULL;
     status = AudioFileGetPropertyInfo(_audioFile, kAudioFilePropertyChannelLayout, &aclSize, NULL);
     if (noErr == status) {
-        acl = malloc(aclSize);
+        acl = (AudioChannelLayout *)malloc(aclSize);
         status = AudioFileGetProperty(_audioFile, kAudioFilePropertyChannelLayout, &aclSize, acl);
         if (noErr != status) {
             aclSize = 0;
@@ -165,7 +168,7 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
     _readCurPacket = 0;
     _readNumPackets = ceil(_asbd.mSampleRate * kAudioBufferDurationInSeconds);
     _readNumBytes = _asbd.mBytesPerPacket * _readNumPackets;
-    _readBuffer = malloc(_readNumBytes);
+    _readBlockPool = SC::BlockPool::create(_readNumBytes, kNumberOfAudioBuffersInPool);
 
     return YES;
 }
@@ -176,14 +179,22 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
 
     OSStatus status = noErr;
 
+    // Read the packets straight into the block backing the sample buffer
+    void *block = _readBlockPool->acquireBlock();
+    if (!block) {
+        SCLogGeneralError(@"Cannot allocate audio data block");
+        return;
+    }
     UInt32 numBytes = _readNumBytes;
     UInt32 numPackets = _readNumPackets;
-    status = AudioFileReadPacketData(_audioFile, NO, &numBytes, NULL, _readCurPacket, &numPackets, _readBuffer);
+    status = AudioFileReadPacketData(_audioFile, NO, &numBytes, NULL, _readCurPacket, &numPackets, block);
     if (noErr != status) {
         SCLogGeneralError(@"Cannot read audio data, error code %d", (int)status);
+        _readBlockPool->releaseBlock(block);
         return;
     }
     if (0 == numPackets) {
+        _readBlockPool->releaseBlock(block);
         return;
     }
     CMTime PTS = CMTimeMakeWithSeconds(_readCurPacket / _asbd.mSampleRate, 600);
@@ -191,10 +202,9 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
     _readCurPacket += numPackets;
 
     CMBlockBufferRef dataBuffer = NULL;
-    status = CMBlockBufferCreateWithMemoryBlock(NULL, NULL, numBytes, NULL, NULL, 0, numBytes, 0, &dataBuffer);
+    status = SCPooledBlockBufferCreate(_readBlockPool, block, numBytes, &dataBuffer);
     if (kCMBlockBufferNoErr == status) {
         if (dataBuffer) {
-            CMBlockBufferReplaceDataBytes(_readBuffer, dataBuffer, 0, numBytes);
             CMSampleBufferRef sampleBuffer = NULL;
             CMAudioSampleBufferCreateWithPacketDescriptions(NULL, dataBuffer, true, NULL, NULL, _formatDescription,
                                                             numPackets, PTS, NULL, &sampleBuffer);
@@ -206,6 +216,7 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
         }
     } else {
         SCLogGeneralError(@"Cannot create data buffer, error code %d", (int)status);
+        _readBlockPool->releaseBlock(block);
     }
 
     int32_t sentinelValue = [_sentinel value];
@@ -234,9 +245,10 @@ static char *const kSCFileAudioCaptureSessionQueueLabel = "com.snapchat.file-aud
     _readCurPacket = 0;
     _readNumPackets = 0;
     _readNumBytes = 0;
-    if (_readBuffer) {
-        free(_readBuffer);
-        _readBuffer = NULL;
+    if (_readBlockPool) {
+        // Blocks still held by consumers keep the pool alive
+        _readBlockPool->release();
+        _readBlockPool = NULL;
     }
 }
 
@@ -0,0 +1,246 @@
+//
+//  SCFrameHealthSampler.cpp
+//  Snapchat
+//
+
+#include "SCFrameHealthSampler.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SC_FRAME_HEALTH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SC_FRAME_HEALTH_SSE2 1
+#endif
+
+namespace SC {
+
+namespace {
+
+// Samples are taken in runs of contiguous bytes filling one vector register
+static const size_t kSampleRunBytes = 16;
+// A 16-bit accumulator lane takes at most 2 * 255 per run, it is widened to 32 bits before it can overflow
+static const size_t kSampleRunsPerWidening = 128;
+static const uint8_t kVideoRangeLumaBlack = 16;
+static const uint8_t kVideoRangeLumaWhite = 235;
+
+// Walks cells idx = k * stride of a columns x height grid without a division per cell. A cell is either a single pixel
+// or a run of contiguous pixels, cellBytes long.
+class SampleCursor {
+public:
+    SampleCursor(const FrameHealthImage &image, size_t columns, size_t cellBytes, size_t stride)
+        : _image(image)
+        , _columns(columns)
+        , _cellBytes(cellBytes)
+        , _strideRows(stride / columns)
+        , _strideColumns(stride % columns)
+        , _row(0)
+        , _column(0)
+    {
+    }
+
+    const uint8_t *next()
+    {
+        const uint8_t *cell = _image.data + _row * _image.bytesPerRow + _column * _cellBytes;
+        _row += _strideRows;
+        _column += _strideColumns;
+        if (_column >= _columns) {
+            _column -= _columns;
+            ++_row;
+        }
+        return cell;
+    }
+
+private:
+    const FrameHealthImage &_image;
+    const size_t _columns;
+    const size_t _cellBytes;
+    const size_t _strideRows;
+    const size_t _strideColumns;
+    size_t _row;
+    size_t _column;
+};
+
+// Sums the four interleaved 8-bit channels of runCount runs of 4 pixels, sums[i] being the sum of byte i of each pixel
+void SumInterleavedChannelRuns(SampleCursor &cursor, size_t runCount, uint32_t sums[4])
+{
+#if SC_FRAME_HEALTH_NEON
+    uint32x4_t sums32 = vdupq_n_u32(0);
+    for (size_t run = 0; run < runCount;) {
+        size_t widening = std::min(runCount, run + kSampleRunsPerWidening);
+        // Lanes i and i + 4 both hold channel i
+        uint16x8_t sums16 = vdupq_n_u16(0);
+        for (; run < widening; ++run) {
+            uint8x16_t bytes = vld1q_u8(cursor.next());
+            sums16 = vaddw_u8(sums16, vget_low_u8(bytes));
+            sums16 = vaddw_u8(sums16, vget_high_u8(bytes));
+        }
+        sums32 = vaddw_u16(sums32, vget_low_u16(sums16));
+        sums32 = vaddw_u16(sums32, vget_high_u16(sums16));
+    }
+    vst1q_u32(sums, sums32);
+#elif SC_FRAME_HEALTH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums32 = zero;
+    for (size_t run = 0; run < runCount;) {
+        size_t widening = std::min(runCount, run + kSampleRunsPerWidening);
+        // Lanes i and i + 4 both hold channel i
+        __m128i sums16 = zero;
+        for (; run < widening; ++run) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cursor.next()));
+            sums16 = _mm_add_epi16(sums16, _mm_unpacklo_epi8(bytes, zero));
+            sums16 = _mm_add_epi16(sums16, _mm_unpackhi_epi8(bytes, zero));
+        }
+        sums32 = _mm_add_epi32(sums32, _mm_unpacklo_epi16(sums16, zero));
+        sums32 = _mm_add_epi32(sums32, _mm_unpackhi_epi16(sums16, zero));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), sums32);
+#else
+    sums[0] = sums[1] = sums[2] = sums[3] = 0;
+    for (size_t run = 0; run < runCount; ++run) {
+        const uint8_t *bytes = cursor.next();
+        for (size_t i = 0; i < kSampleRunBytes; ++i) {
+            sums[i % 4] += bytes[i];
+        }
+    }
+#endif
+}
+
+// Sums the luma of runCount runs of 16 pixels, clamped to the black level
+uint32_t SumLumaRuns(SampleCursor &cursor, size_t runCount, uint8_t blackLevel)
+{
+#if SC_FRAME_HEALTH_NEON
+    const uint8x16_t black = vdupq_n_u8(blackLevel);
+    uint32x4_t sums32 = vdupq_n_u32(0);
+    for (size_t run = 0; run < runCount;) {
+        size_t widening = std::min(runCount, run + kSampleRunsPerWidening);
+        uint16x8_t sums16 = vdupq_n_u16(0);
+        for (; run < widening; ++run) {
+            sums16 = vpadalq_u8(sums16, vqsubq_u8(vld1q_u8(cursor.next()), black));
+        }
+        sums32 = vpadalq_u16(sums32, sums16);
+    }
+    uint32x2_t pairs = vadd_u32(vget_low_u32(sums32), vget_high_u32(sums32));
+    return vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+#elif SC_FRAME_HEALTH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i black = _mm_set1_epi8((char)blackLevel);
+    // Sums of absolute differences against zero add up each half of the run into a 64-bit lane
+    __m128i sums64 = zero;
+    for (size_t run = 0; run < runCount; ++run) {
+        __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cursor.next()));
+        sums64 = _mm_add_epi64(sums64, _mm_sad_epu8(_mm_subs_epu8(luma, black), zero));
+    }
+    return (uint32_t)_mm_cvtsi128_si32(sums64) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sums64, 8));
+#else
+    uint32_t sum = 0;
+    for (size_t run = 0; run < runCount; ++run) {
+        const uint8_t *luma = cursor.next();
+        for (size_t i = 0; i < kSampleRunBytes; ++i) {
+            sum += luma[i] > blackLevel ? luma[i] - blackLevel : 0;
+        }
+    }
+    return sum;
+#endif
+}
+
+// Single pixel versions of the above for images too narrow for a run
+void SumInterleavedChannels(SampleCursor &cursor, size_t count, uint32_t sums[4])
+{
+    sums[0] = sums[1] = sums[2] = sums[3] = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *pixel = cursor.next();
+        sums[0] += pixel[0];
+        sums[1] += pixel[1];
+        sums[2] += pixel[2];
+        sums[3] += pixel[3];
+    }
+}
+
+uint32_t SumLuma(SampleCursor &cursor, size_t count, uint8_t blackLevel)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t luma = *cursor.next();
+        sum += luma > blackLevel ? luma - blackLevel : 0;
+    }
+    return sum;
+}
+
+} // namespace
+
+FrameHealthStatistics FrameHealthSample(const FrameHealthImage &image, size_t maxSamples)
+{
+    FrameHealthStatistics statistics = {0, false, 0, 0, 0, 0};
+    size_t pixels = image.width * image.height;
+    if (!image.data || pixels == 0 || maxSamples == 0) {
+        return statistics;
+    }
+    bool luma = image.format == FrameHealthPixelFormat::Luma;
+    uint8_t blackLevel = luma && image.lumaVideoRange ? kVideoRangeLumaBlack : 0;
+    size_t bytesPerPixel = luma ? 1 : 4;
+    // Limit the max sampled pixels
+    size_t count = std::min(pixels, maxSamples);
+
+    size_t pixelsPerRun = kSampleRunBytes / bytesPerPixel;
+    size_t runsPerRow = image.width / pixelsPerRun;
+    size_t runCount = std::min(count / pixelsPerRun, runsPerRow * image.height);
+    uint32_t sums[4] = {0, 0, 0, 0};
+    if (runCount > 0) {
+        SampleCursor cursor(image, runsPerRow, kSampleRunBytes, runsPerRow * image.height / runCount);
+        count = runCount * pixelsPerRun;
+        if (luma) {
+            sums[0] = SumLumaRuns(cursor, runCount, blackLevel);
+        } else {
+            SumInterleavedChannelRuns(cursor, runCount, sums);
+        }
+    } else {
+        SampleCursor cursor(image, image.width, bytesPerPixel, pixels / count);
+        if (luma) {
+            sums[0] = SumLuma(cursor, count, blackLevel);
+        } else {
+            SumInterleavedChannels(cursor, count, sums);
+        }
+    }
+    statistics.sampleCount = count;
+
+    if (luma) {
+        float averageLuma = (float)sums[0] / count;
+        if (image.lumaVideoRange) {
+            averageLuma = std::min(averageLuma * 255 / (kVideoRangeLumaWhite - kVideoRangeLumaBlack), 255.0f);
+        }
+        statistics.sampledLuma = true;
+        statistics.averageR = statistics.averageG = statistics.averageB = averageLuma;
+        statistics.averageA = 255;
+    } else if (image.format == FrameHealthPixelFormat::BGRA) {
+        statistics.averageB = (float)sums[0] / count;
+        statistics.averageG = (float)sums[1] / count;
+        statistics.averageR = (float)sums[2] / count;
+        statistics.averageA = (float)sums[3] / count;
+    } else {
+        statistics.averageR = (float)sums[0] / count;
+        statistics.averageG = (float)sums[1] / count;
+        statistics.averageB = (float)sums[2] / count;
+        statistics.averageA = (float)sums[3] / count;
+    }
+    return statistics;
+}
+
+FrameHealthClassification FrameHealthClassify(const FrameHealthStatistics &statistics, float possibleBlackThreshold)
+{
+    if (statistics.sampleCount == 0) {
+        return FrameHealthClassification::Healthy;
+    }
+    if (statistics.averageA > kFrameHealthOpaqueAlphaThreshold && statistics.averageR < possibleBlackThreshold &&
+        statistics.averageG < possibleBlackThreshold && statistics.averageB < possibleBlackThreshold) {
+        if (statistics.averageR == 0 && statistics.averageG == 0 && statistics.averageB == 0) {
+            return FrameHealthClassification::TotallyBlack;
+        }
+        return FrameHealthClassification::PossiblyBlack;
+    }
+    return FrameHealthClassification::Healthy;
+}
+
+} // namespace SC
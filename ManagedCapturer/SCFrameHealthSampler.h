@@ -0,0 +1,69 @@
+//
+//  SCFrameHealthSampler.h
+//  Snapchat
+//
+//  Platform independent sampling and black-frame classification used by SCManagedFrameHealthChecker. Only depends on
+//  the C++ standard library so that it can be built and exercised off device.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SC {
+
+enum class FrameHealthPixelFormat {
+    RGBA,
+    BGRA,
+    // 8-bit luma plane, e.g. plane 0 of a 420YpCbCr8BiPlanar (NV12) pixel buffer
+    Luma,
+};
+
+enum class FrameHealthClassification {
+    Healthy,
+    PossiblyBlack,
+    TotallyBlack,
+};
+
+static const size_t kFrameHealthMaxSamples = 2304;
+static const float kFrameHealthPossibleBlackThreshold = 20.0;
+// Averaged alpha is very near 255 for camera frames but very small for video overlay images, only frames above this
+// are considered for possible black.
+static const float kFrameHealthOpaqueAlphaThreshold = 250.0;
+
+struct FrameHealthImage {
+    const uint8_t *data;
+    size_t width;
+    size_t height;
+    size_t bytesPerRow;
+    FrameHealthPixelFormat format;
+    // Luma in [16, 235] instead of [0, 255], as in 420YpCbCr8BiPlanarVideoRange. Ignored for RGBA / BGRA.
+    bool lumaVideoRange;
+};
+
+struct FrameHealthStatistics {
+    size_t sampleCount;
+    bool sampledLuma;
+    /*
+     Averages of the sampled channels in [0, 255]. For luma images R, G and B are the average luma expanded to full
+     range, which is what the channels of a gray RGB frame converted from it would average to, and A is 255. That
+     keeps the RGB thresholds of FrameHealthClassify valid for them.
+     */
+    float averageR;
+    float averageG;
+    float averageB;
+    float averageA;
+};
+
+/*
+ Samples at most maxSamples pixels evenly spread over the image, in a single pass with integer accumulation. The
+ pixels are sampled in runs of 16 contiguous bytes, summed with NEON or SSE2 where available. The image is sampled in
+ place, honoring bytesPerRow, so there is no need to copy or rescale it first.
+ */
+FrameHealthStatistics FrameHealthSample(const FrameHealthImage &image, size_t maxSamples = kFrameHealthMaxSamples);
+
+FrameHealthClassification FrameHealthClassify(const FrameHealthStatistics &statistics,
+                                              float possibleBlackThreshold = kFrameHealthPossibleBlackThreshold);
+
+} // namespace SC
@@ -0,0 +1,329 @@
+//
+//  SCHotPathTrace.cpp
+//  Snapchat
+//
+
+#include "SCHotPathTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace {
+
+const uint32_t kHotPathTraceMagic = 0x54485053; // "SPHT"
+const uint32_t kHotPathTraceVersion = 1;
+
+struct HotPathTraceRecord {
+    uint64_t timestamp;
+    uint32_t threadIndex;
+    uint32_t event;
+    uint64_t args[4];
+};
+
+struct HotPathTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t recordCount;
+};
+
+// Decoding uses the formats of the build that took the snapshot. Integer conversions are printed as 64 bits, %f and
+// %lf arguments are doubles.
+const char *const kHotPathTraceEventFormats[SCHotPathTraceEventCount] = {
+    "[SCManagedVideoCapturer] Obtained video data source at time %lld",
+    "[SCManagedVideoCapturer] Obtained video data source with an invalid time",
+    "[SCManagedVideoStreamer] didOutputSampleBuffer:%p latency:%f",
+    "[SCManagedVideoStreamer] rendered sampleBuffer:%p pipelined:%d",
+    "[SCManagedVideoStreamer] displayed sampleBuffer:%p",
+    "[SCManagedVideoStreamer] begin annoucing sampleBuffer:%p of devicePosition:%lu",
+    "[SCManagedVideoStreamer] end annoucing sampleBuffer:%p",
+    "[SCManagedVideoStreamer] didDropSampleBuffer:%p timestamp:%f latency:%f",
+    "[SCManagedDeviceCapacityAnalyzer] ExposureTime: %f, ISO: %ld, Brightness: %f, Luma: %f",
+    "[SCCaptureCoreImageFaceDetector] sampleBuffer:%p detection interval:%lu",
+    "[SCCaptureMetadataOutputDetector] metadata objects:%lu",
+};
+
+#if SC_HOT_PATH_TRACE_ENABLED
+
+// Per thread, about 17 seconds of the streamer at 60fps in 48KB
+const size_t kHotPathTraceRecordCount = 1024;
+
+// Only its own thread writes to a ring, the count is published after the record is written
+struct HotPathTraceRing {
+    uint32_t threadIndex;
+    std::atomic<uint64_t> writeCount;
+    HotPathTraceRecord records[kHotPathTraceRecordCount];
+};
+
+struct HotPathTraceRegistry {
+    std::mutex mutex;
+    std::vector<HotPathTraceRing *> rings;
+    // Rings of the threads which exited, taken by the next threads which trace
+    std::vector<HotPathTraceRing *> freeRings;
+    uint32_t threadCount;
+};
+
+std::atomic<bool> sHotPathTraceEnabled(false);
+
+// Never destroyed, so that threads still tracing while the process exits are fine
+HotPathTraceRegistry &SharedRegistry()
+{
+    static HotPathTraceRegistry *registry = new HotPathTraceRegistry();
+    return *registry;
+}
+
+/*
+ Gives the ring of a thread back when the thread exits, so that there are only as many rings as threads which traced
+ at the same time, GCD threads come and go. The records stay in the snapshots until another thread takes the ring.
+ */
+struct HotPathTraceThreadRing {
+    HotPathTraceRing *ring = nullptr;
+
+    ~HotPathTraceThreadRing()
+    {
+        if (ring) {
+            HotPathTraceRegistry &registry = SharedRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.freeRings.push_back(ring);
+        }
+    }
+};
+
+HotPathTraceRing *CurrentRing()
+{
+    static thread_local HotPathTraceThreadRing threadRing;
+    if (!threadRing.ring) {
+        HotPathTraceRegistry &registry = SharedRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        HotPathTraceRing *ring;
+        if (!registry.freeRings.empty()) {
+            ring = registry.freeRings.back();
+            registry.freeRings.pop_back();
+        } else {
+            ring = new HotPathTraceRing();
+            ring->writeCount.store(0, std::memory_order_relaxed);
+            registry.rings.push_back(ring);
+        }
+        ring->threadIndex = registry.threadCount++;
+        threadRing.ring = ring;
+    }
+    return threadRing.ring;
+}
+
+uint64_t TimestampNanoseconds()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void AppendRingRecords(const HotPathTraceRing &ring, std::vector<HotPathTraceRecord> &records)
+{
+    uint64_t end = ring.writeCount.load(std::memory_order_acquire);
+    uint64_t begin = end > kHotPathTraceRecordCount ? end - kHotPathTraceRecordCount : 0;
+    size_t firstRecord = records.size();
+    for (uint64_t index = begin; index < end; ++index) {
+        records.push_back(ring.records[index % kHotPathTraceRecordCount]);
+    }
+    // The writer may have overwritten the oldest records while they were copied, those are dropped
+    uint64_t endAfterCopy = ring.writeCount.load(std::memory_order_acquire);
+    uint64_t firstIntact = endAfterCopy >= kHotPathTraceRecordCount ? endAfterCopy - kHotPathTraceRecordCount + 1 : 0;
+    if (firstIntact > begin) {
+        size_t overwritten = (size_t)std::min(firstIntact - begin, end - begin);
+        records.erase(records.begin() + firstRecord, records.begin() + firstRecord + overwritten);
+    }
+}
+
+#endif
+
+// Formats a single conversion specification, spec being the text from the % to the conversion character
+void AppendFormattedArgument(std::string &output, const std::string &spec, uint64_t arg)
+{
+    char conversion = spec.back();
+    // Keeps the flags, width and precision, the length modifiers are replaced by the ones of the argument
+    std::string prefix;
+    for (size_t index = 0; index + 1 < spec.size(); ++index) {
+        if (!strchr("hlqLjzt", spec[index])) {
+            prefix += spec[index];
+        }
+    }
+    char buffer[64];
+    switch (conversion) {
+    case 'd':
+    case 'i':
+        snprintf(buffer, sizeof(buffer), (prefix + "lld").c_str(), (long long)arg);
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        snprintf(buffer, sizeof(buffer), (prefix + "ll" + conversion).c_str(), (unsigned long long)arg);
+        break;
+    case 'p':
+        snprintf(buffer, sizeof(buffer), "0x%llx", (unsigned long long)arg);
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G': {
+        double value;
+        memcpy(&value, &arg, sizeof(value));
+        snprintf(buffer, sizeof(buffer), (prefix + conversion).c_str(), value);
+        break;
+    }
+    default:
+        snprintf(buffer, sizeof(buffer), "%s", spec.c_str());
+        break;
+    }
+    output += buffer;
+}
+
+std::string FormatRecord(const HotPathTraceRecord &record)
+{
+    char header[64];
+    snprintf(header, sizeof(header), "%llu thread:%u ", (unsigned long long)record.timestamp, record.threadIndex);
+    std::string output = header;
+    if (record.event >= SCHotPathTraceEventCount) {
+        snprintf(header, sizeof(header), "unknown event %u", record.event);
+        return output + header;
+    }
+    const char *format = kHotPathTraceEventFormats[record.event];
+    size_t argIndex = 0;
+    for (const char *cursor = format; *cursor; ++cursor) {
+        if (*cursor != '%') {
+            output += *cursor;
+            continue;
+        }
+        if (cursor[1] == '%') {
+            output += '%';
+            ++cursor;
+            continue;
+        }
+        const char *end = cursor + 1;
+        while (*end && !strchr("diuxXofFeEgGps", *end)) {
+            ++end;
+        }
+        if (!*end) {
+            break;
+        }
+        std::string spec(cursor, end + 1);
+        AppendFormattedArgument(output, spec, argIndex < 4 ? record.args[argIndex] : 0);
+        ++argIndex;
+        cursor = end;
+    }
+    return output;
+}
+
+} // namespace
+
+#if SC_HOT_PATH_TRACE_ENABLED
+
+void SCHotPathTraceSetEnabled(int enabled)
+{
+    sHotPathTraceEnabled.store(enabled != 0, std::memory_order_relaxed);
+}
+
+void SCHotPathTraceRecord(SCHotPathTraceEvent event, uint64_t arg0, uint64_t arg1, uint64_t arg2, uint64_t arg3)
+{
+    if (!sHotPathTraceEnabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    HotPathTraceRing *ring = CurrentRing();
+    uint64_t index = ring->writeCount.load(std::memory_order_relaxed);
+    HotPathTraceRecord &record = ring->records[index % kHotPathTraceRecordCount];
+    record.timestamp = TimestampNanoseconds();
+    record.threadIndex = ring->threadIndex;
+    record.event = event;
+    record.args[0] = arg0;
+    record.args[1] = arg1;
+    record.args[2] = arg2;
+    record.args[3] = arg3;
+    ring->writeCount.store(index + 1, std::memory_order_release);
+}
+
+int SCHotPathTraceWriteSnapshot(const char *path)
+{
+    std::vector<uint8_t> snapshot = SC::HotPathTraceSnapshot();
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return 0;
+    }
+    size_t written = fwrite(snapshot.data(), 1, snapshot.size(), file);
+    return fclose(file) == 0 && written == snapshot.size();
+}
+
+int SCHotPathTraceWriteDecodedSnapshot(const char *path)
+{
+    std::vector<uint8_t> snapshot = SC::HotPathTraceSnapshot();
+    std::string decoded = SC::DecodeHotPathTrace(snapshot.data(), snapshot.size());
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return 0;
+    }
+    size_t written = fwrite(decoded.data(), 1, decoded.size(), file);
+    return fclose(file) == 0 && written == decoded.size();
+}
+
+#endif
+
+namespace SC {
+
+#if SC_HOT_PATH_TRACE_ENABLED
+
+size_t HotPathTraceRingCount()
+{
+    HotPathTraceRegistry &registry = SharedRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return registry.rings.size();
+}
+
+std::vector<uint8_t> HotPathTraceSnapshot()
+{
+    std::vector<HotPathTraceRecord> records;
+    {
+        HotPathTraceRegistry &registry = SharedRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const HotPathTraceRing *ring : registry.rings) {
+            AppendRingRecords(*ring, records);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(), [](const HotPathTraceRecord &lhs, const HotPathTraceRecord &rhs) {
+        return lhs.timestamp < rhs.timestamp;
+    });
+    HotPathTraceHeader header = {kHotPathTraceMagic, kHotPathTraceVersion, records.size()};
+    std::vector<uint8_t> snapshot(sizeof(header) + records.size() * sizeof(HotPathTraceRecord));
+    memcpy(snapshot.data(), &header, sizeof(header));
+    if (!records.empty()) {
+        memcpy(snapshot.data() + sizeof(header), records.data(), records.size() * sizeof(HotPathTraceRecord));
+    }
+    return snapshot;
+}
+
+#endif
+
+std::string DecodeHotPathTrace(const uint8_t *data, size_t size)
+{
+    HotPathTraceHeader header;
+    if (!data || size < sizeof(header)) {
+        return std::string();
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != kHotPathTraceMagic || header.version != kHotPathTraceVersion) {
+        return std::string();
+    }
+    size_t recordCount = std::min((size_t)header.recordCount, (size - sizeof(header)) / sizeof(HotPathTraceRecord));
+    std::string output;
+    for (size_t index = 0; index < recordCount; ++index) {
+        HotPathTraceRecord record;
+        memcpy(&record, data + sizeof(header) + index * sizeof(record), sizeof(record));
+        output += FormatRecord(record);
+        output += '\n';
+    }
+    return output;
+}
+
+} // namespace SC
@@ -0,0 +1,114 @@
+//
+//  SCHotPathTrace.h
+//  Snapchat
+//
+//  Binary trace of the per-frame paths of the capture pipeline, which can't afford a formatted log on every frame:
+//  each thread appends the event id, its raw arguments and a timestamp to its own ring of records, without locks nor
+//  string formatting. Snapshots of the rings are decoded with the format strings of the events. The trace is compiled
+//  out unless SC_HOT_PATH_TRACE_ENABLED is set, and where it is compiled in, recording is off until it is enabled at
+//  runtime. The implementation only depends on the C++ standard library, the interface is plain C so that it can be
+//  called from Objective-C as well.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Internal configurations set it in their build settings, release builds don't have the trace at all
+#ifndef SC_HOT_PATH_TRACE_ENABLED
+#if defined(DEBUG) && DEBUG
+#define SC_HOT_PATH_TRACE_ENABLED 1
+#else
+#define SC_HOT_PATH_TRACE_ENABLED 0
+#endif
+#endif
+
+// Events are identified by their position, new ones go last so that older snapshots still decode
+typedef enum SCHotPathTraceEvent {
+    SCHotPathTraceEventVideoCapturerFrame,
+    SCHotPathTraceEventVideoCapturerFrameWithInvalidTime,
+    SCHotPathTraceEventVideoStreamerFrame,
+    SCHotPathTraceEventVideoStreamerRendered,
+    SCHotPathTraceEventVideoStreamerDisplayed,
+    SCHotPathTraceEventVideoStreamerBeginAnnouncing,
+    SCHotPathTraceEventVideoStreamerEndAnnouncing,
+    SCHotPathTraceEventVideoStreamerDropped,
+    SCHotPathTraceEventCapacityAnalyzerFrame,
+    SCHotPathTraceEventFaceDetectorFrame,
+    SCHotPathTraceEventMetadataFaces,
+    SCHotPathTraceEventCount,
+} SCHotPathTraceEvent;
+
+static inline uint64_t SCHotPathTraceDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+#define SCHotPathTracePointer(pointer) ((uint64_t)(uintptr_t)(pointer))
+
+#if SC_HOT_PATH_TRACE_ENABLED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Off by default, records made while it is off are dropped without touching the rings
+void SCHotPathTraceSetEnabled(int enabled);
+
+// Records are at most 4 arguments, integers and pointers as is, doubles through SCHotPathTraceDouble
+void SCHotPathTraceRecord(SCHotPathTraceEvent event, uint64_t arg0, uint64_t arg1, uint64_t arg2, uint64_t arg3);
+
+// Writes a snapshot of the records of every thread to path, returns 0 on failure
+int SCHotPathTraceWriteSnapshot(const char *path);
+
+// Same as SCHotPathTraceWriteSnapshot, decoded to text
+int SCHotPathTraceWriteDecodedSnapshot(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define SCHotPathTrace(event, arg0, arg1, arg2, arg3)                                                                  \
+    SCHotPathTraceRecord(event, (uint64_t)(arg0), (uint64_t)(arg1), (uint64_t)(arg2), (uint64_t)(arg3))
+
+#else
+
+// The arguments aren't evaluated
+#define SCHotPathTrace(event, arg0, arg1, arg2, arg3)                                                                  \
+    do {                                                                                                               \
+    } while (0)
+
+#endif
+
+#define SCHotPathTrace1(event, arg0) SCHotPathTrace(event, arg0, 0, 0, 0)
+#define SCHotPathTrace2(event, arg0, arg1) SCHotPathTrace(event, arg0, arg1, 0, 0)
+#define SCHotPathTrace3(event, arg0, arg1, arg2) SCHotPathTrace(event, arg0, arg1, arg2, 0)
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+namespace SC {
+
+#if SC_HOT_PATH_TRACE_ENABLED
+// Records of every thread, oldest first, in the format SCHotPathTraceWriteSnapshot writes
+std::vector<uint8_t> HotPathTraceSnapshot();
+
+// Rings allocated so far, one per thread tracing at the same time as the others
+size_t HotPathTraceRingCount();
+#endif
+
+/*
+ One line per record: timestamp in nanoseconds, thread index and the formatted event. It is there even without the
+ trace, so that tools can decode snapshots taken by internal builds.
+ */
+std::string DecodeHotPathTrace(const uint8_t *data, size_t size);
+
+} // namespace SC
+
+#endif
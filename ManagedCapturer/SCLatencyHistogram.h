@@ -0,0 +1,124 @@
+//
+//  SCLatencyHistogram.h
+//  Snapchat
+//
+//  Log-linear latency histogram in the spirit of HdrHistogram. Every power of two is split in 8 linear sub buckets, so
+//  percentiles are within 12.5% of the recorded values from 1us up to ~71 minutes. Recording is a few integer
+//  operations into a fixed array, it never allocates and takes no locks.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace SC {
+
+class LatencyHistogram {
+public:
+    // Values below this are recorded exactly, each power of two above is split in kSubBucketCount / 2 buckets
+    static const uint32_t kSubBucketCount = 16;
+    static const uint32_t kBucketCount = kSubBucketCount + (32 - 4) * (kSubBucketCount / 2);
+
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    void record(uint32_t microseconds)
+    {
+        ++_counts[bucketIndex(microseconds)];
+        ++_count;
+        _sum += microseconds;
+        _min = std::min(_min, microseconds);
+        _max = std::max(_max, microseconds);
+    }
+
+    uint64_t count() const
+    {
+        return _count;
+    }
+
+    uint32_t min() const
+    {
+        return _count > 0 ? _min : 0;
+    }
+
+    uint32_t max() const
+    {
+        return _max;
+    }
+
+    double mean() const
+    {
+        return _count > 0 ? (double)_sum / _count : 0;
+    }
+
+    // Highest value equivalent to the one at the given percentile (0-100), clamped to the recorded range
+    uint32_t valueAtPercentile(double percentile) const
+    {
+        if (_count == 0) {
+            return 0;
+        }
+        percentile = std::max(0.0, std::min(percentile, 100.0));
+        uint64_t rank = std::max<uint64_t>((uint64_t)(percentile / 100 * _count + 0.5), 1);
+        uint64_t seen = 0;
+        for (uint32_t index = 0; index < kBucketCount; ++index) {
+            seen += _counts[index];
+            if (seen >= rank) {
+                return std::max(_min, std::min(highestEquivalentValue(index), _max));
+            }
+        }
+        return _max;
+    }
+
+    void add(const LatencyHistogram &other)
+    {
+        for (uint32_t index = 0; index < kBucketCount; ++index) {
+            _counts[index] += other._counts[index];
+        }
+        _count += other._count;
+        _sum += other._sum;
+        _min = std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }
+
+    void reset()
+    {
+        _counts.fill(0);
+        _count = 0;
+        _sum = 0;
+        _min = UINT32_MAX;
+        _max = 0;
+    }
+
+    static uint32_t bucketIndex(uint32_t value)
+    {
+        if (value < kSubBucketCount) {
+            return value;
+        }
+        uint32_t shift = 31 - __builtin_clz(value) - 3;
+        return kSubBucketCount + (shift - 1) * (kSubBucketCount / 2) + ((value >> shift) - kSubBucketCount / 2);
+    }
+
+    static uint32_t highestEquivalentValue(uint32_t index)
+    {
+        if (index < kSubBucketCount) {
+            return index;
+        }
+        uint32_t shift = (index - kSubBucketCount) / (kSubBucketCount / 2) + 1;
+        uint64_t subBucket = (index - kSubBucketCount) % (kSubBucketCount / 2) + kSubBucketCount / 2;
+        return (uint32_t)std::min<uint64_t>(((subBucket + 1) << shift) - 1, UINT32_MAX);
+    }
+
+private:
+    std::array<uint32_t, kBucketCount> _counts;
+    uint64_t _count;
+    uint64_t _sum;
+    uint32_t _min;
+    uint32_t _max;
+};
+
+} // namespace SC
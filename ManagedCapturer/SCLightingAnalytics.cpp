@@ -0,0 +1,213 @@
+//
+//  SCLightingAnalytics.cpp
+//  Snapchat
+//
+
+#include "SCLightingAnalytics.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SC_LIGHTING_ANALYTICS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SC_LIGHTING_ANALYTICS_SSE2 1
+#endif
+
+namespace SC {
+
+namespace {
+
+const int kLumaClippingTolerance = 4;
+const size_t kLumaHistogramColumnStep = 4;
+
+struct LumaRowAccumulator {
+    uint64_t sum;
+    uint64_t darkClipped;
+    uint64_t brightClipped;
+};
+
+void AccumulateLumaRow(const uint8_t *row, size_t width, uint8_t darkLevel, uint8_t brightLevel,
+                       LumaRowAccumulator &accumulator)
+{
+    size_t column = 0;
+#if SC_LIGHTING_ANALYTICS_NEON
+    uint32x4_t sum = vdupq_n_u32(0);
+    // Each chunk adds at most 2 to a lane, which is safe for rows far wider than any camera frame
+    uint16x8_t darkClipped = vdupq_n_u16(0);
+    uint16x8_t brightClipped = vdupq_n_u16(0);
+    const uint8x16_t dark = vdupq_n_u8(darkLevel);
+    const uint8x16_t bright = vdupq_n_u8(brightLevel);
+    for (; column + 16 <= width; column += 16) {
+        uint8x16_t luma = vld1q_u8(row + column);
+        sum = vpadalq_u16(sum, vpaddlq_u8(luma));
+        darkClipped = vpadalq_u8(darkClipped, vshrq_n_u8(vcleq_u8(luma, dark), 7));
+        brightClipped = vpadalq_u8(brightClipped, vshrq_n_u8(vcgeq_u8(luma, bright), 7));
+    }
+    uint32_t lanes[4];
+    vst1q_u32(lanes, sum);
+    accumulator.sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    vst1q_u32(lanes, vpaddlq_u16(darkClipped));
+    accumulator.darkClipped += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    vst1q_u32(lanes, vpaddlq_u16(brightClipped));
+    accumulator.brightClipped += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif SC_LIGHTING_ANALYTICS_SSE2
+    __m128i sum = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i dark = _mm_set1_epi8((char)darkLevel);
+    const __m128i bright = _mm_set1_epi8((char)brightLevel);
+    for (; column + 16 <= width; column += 16) {
+        __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + column));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(luma, zero));
+        // luma <= dark exactly when min(luma, dark) == luma, and the other way around for bright
+        int darkMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(luma, dark), luma));
+        int brightMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(luma, bright), luma));
+        accumulator.darkClipped += __builtin_popcount(darkMask);
+        accumulator.brightClipped += __builtin_popcount(brightMask);
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sum);
+    accumulator.sum += lanes[0] + lanes[1];
+#endif
+    for (; column < width; ++column) {
+        uint8_t luma = row[column];
+        accumulator.sum += luma;
+        accumulator.darkClipped += luma <= darkLevel;
+        accumulator.brightClipped += luma >= brightLevel;
+    }
+}
+
+uint8_t HistogramPercentile(const uint32_t *histogram, uint64_t count, double percentile)
+{
+    uint64_t target = (uint64_t)(count * percentile);
+    uint64_t cumulated = 0;
+    for (int luma = 0; luma < 256; ++luma) {
+        cumulated += histogram[luma];
+        if (cumulated > target) {
+            return (uint8_t)luma;
+        }
+    }
+    return 255;
+}
+
+} // namespace
+
+LumaStatistics LumaPlaneStatistics(const LumaPlane &plane, size_t rowStep)
+{
+    LumaStatistics statistics = {};
+    if (!plane.data || plane.width == 0 || plane.height == 0 || plane.whiteLevel <= plane.blackLevel) {
+        return statistics;
+    }
+    rowStep = std::max<size_t>(rowStep, 1);
+    uint8_t darkLevel = (uint8_t)std::min(plane.blackLevel + kLumaClippingTolerance, 255);
+    uint8_t brightLevel = (uint8_t)std::max(plane.whiteLevel - kLumaClippingTolerance, 0);
+    LumaRowAccumulator accumulator = {};
+    uint32_t histogram[256] = {};
+    uint64_t histogramCount = 0;
+    for (size_t y = 0; y < plane.height; y += rowStep) {
+        const uint8_t *row = plane.data + y * plane.bytesPerRow;
+        AccumulateLumaRow(row, plane.width, darkLevel, brightLevel, accumulator);
+        for (size_t x = 0; x < plane.width; x += kLumaHistogramColumnStep) {
+            ++histogram[row[x]];
+            ++histogramCount;
+        }
+        statistics.sampleCount += plane.width;
+    }
+
+    float range = plane.whiteLevel - plane.blackLevel;
+    float mean = (float)accumulator.sum / statistics.sampleCount;
+    statistics.mean = std::min(std::max((mean - plane.blackLevel) / range, 0.f), 1.f);
+    statistics.darkClippedFraction = (float)accumulator.darkClipped / statistics.sampleCount;
+    statistics.brightClippedFraction = (float)accumulator.brightClipped / statistics.sampleCount;
+    int low = HistogramPercentile(histogram, histogramCount, 0.01);
+    int high = HistogramPercentile(histogram, histogramCount, 0.99);
+    statistics.dynamicRange = std::min(std::max((high - low) / range, 0.f), 1.f);
+    return statistics;
+}
+
+LightingHysteresis::LightingHysteresis(const LightingHysteresisTable &table, int initialState)
+    : _table(table)
+    , _level(0)
+    , _pendingLevel(0)
+    , _pendingFrames(0)
+{
+    reset(initialState);
+}
+
+int LightingHysteresis::state() const
+{
+    return _table.levels[_level].state;
+}
+
+void LightingHysteresis::reset(int state)
+{
+    _level = 0;
+    for (size_t i = 0; i < _table.levelCount; ++i) {
+        if (_table.levels[i].state == state) {
+            _level = i;
+            break;
+        }
+    }
+    _pendingLevel = _level;
+    _pendingFrames = 0;
+}
+
+bool LightingHysteresis::update(const LightingSample &sample)
+{
+    bool ambiguous = false;
+    size_t level = _levelForBrightness(sample.brightness, &ambiguous);
+    if (ambiguous) {
+        return false;
+    }
+    if (level == _level) {
+        _pendingLevel = _level;
+        _pendingFrames = 0;
+        return false;
+    }
+    if (level != _pendingLevel) {
+        _pendingLevel = level;
+        _pendingFrames = 0;
+    }
+    ++_pendingFrames;
+    const LightingLevel &pending = _table.levels[level];
+    uint32_t framesToEnter = _isConfirmed(sample, level) ? pending.confirmedFramesToEnter : pending.framesToEnter;
+    if (_pendingFrames < framesToEnter) {
+        return false;
+    }
+    _level = level;
+    _pendingFrames = 0;
+    return true;
+}
+
+size_t LightingHysteresis::_levelForBrightness(float brightness, bool *ambiguous) const
+{
+    size_t last = _table.levelCount - 1;
+    for (size_t i = 0; i < last; ++i) {
+        float bound = _table.levels[i].brightnessLowerBound;
+        if (brightness >= bound - _table.brightnessMargin && brightness < bound + _table.brightnessMargin) {
+            *ambiguous = true;
+        }
+    }
+    for (size_t i = 0; i < last; ++i) {
+        if (brightness >= _table.levels[i].brightnessLowerBound) {
+            return i;
+        }
+    }
+    return last;
+}
+
+bool LightingHysteresis::_isConfirmed(const LightingSample &sample, size_t level) const
+{
+    if (!sample.hasLumaStatistics ||
+        sample.lumaStatistics.brightClippedFraction > _table.maxConfirmingBrightClippedFraction) {
+        return false;
+    }
+    float mean = sample.lumaStatistics.mean;
+    size_t last = _table.levelCount - 1;
+    bool belowUpperBound = level == 0 || mean < _table.levels[level - 1].lumaLowerBound;
+    bool aboveLowerBound = level == last || mean >= _table.levels[level].lumaLowerBound;
+    return belowUpperBound && aboveLowerBound;
+}
+
+} // namespace SC
@@ -0,0 +1,94 @@
+//
+//  SCLightingAnalytics.h
+//  Snapchat
+//
+//  Platform independent lighting analytics for SCManagedDeviceCapacityAnalyzer: frame level luma statistics, and the
+//  table driven hysteresis the lighting decisions are made with. Nothing here reads a clock, so a decision sequence
+//  can be replayed from recorded samples.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SC {
+
+struct LumaPlane {
+    const uint8_t *data;
+    size_t width;
+    size_t height;
+    size_t bytesPerRow;
+    // 16 and 235 for video range, 0 and 255 for full range
+    uint8_t blackLevel;
+    uint8_t whiteLevel;
+};
+
+struct LumaStatistics {
+    size_t sampleCount;
+    // Normalized between the black and white levels of the plane
+    float mean;
+    // Share of the samples at most a few steps from the black / white level
+    float darkClippedFraction;
+    float brightClippedFraction;
+    // Spread between the 1st and 99th percentiles, normalized like the mean
+    float dynamicRange;
+};
+
+/*
+ Looks at every rowStep-th row of the plane. Mean and clipping are computed over the whole rows with SIMD, the
+    percentiles from a histogram of every 4th sample of those rows.
+ */
+LumaStatistics LumaPlaneStatistics(const LumaPlane &plane, size_t rowStep);
+
+struct LightingLevel {
+    int state;
+    // Lower bounds of the level, the levels of a table are ordered from the brightest to the darkest, the bounds of
+    // the darkest one are ignored
+    float brightnessLowerBound;
+    float lumaLowerBound;
+    // Consecutive frames in the level needed to switch to it, and the fewer needed when the luma statistics of the
+    // frame agree with the brightness
+    uint32_t framesToEnter;
+    uint32_t confirmedFramesToEnter;
+};
+
+struct LightingHysteresisTable {
+    const LightingLevel *levels;
+    size_t levelCount;
+    // Brightness within the margin of a level bound is ambiguous, it neither advances nor resets the pending switch
+    float brightnessMargin;
+    // Luma statistics with more bright clipping than this, i.e. a light source in frame, never confirm a level
+    float maxConfirmingBrightClippedFraction;
+};
+
+struct LightingSample {
+    float brightness;
+    bool hasLumaStatistics;
+    LumaStatistics lumaStatistics;
+};
+
+/*
+ Switches to a level once enough consecutive samples fall in it. The table is not copied and has to outlive the
+    hysteresis.
+ */
+class LightingHysteresis {
+public:
+    LightingHysteresis(const LightingHysteresisTable &table, int initialState);
+
+    int state() const;
+    // Returns true when the state changed
+    bool update(const LightingSample &sample);
+    void reset(int state);
+
+private:
+    size_t _levelForBrightness(float brightness, bool *ambiguous) const;
+    bool _isConfirmed(const LightingSample &sample, size_t level) const;
+
+    const LightingHysteresisTable &_table;
+    size_t _level;
+    size_t _pendingLevel;
+    uint32_t _pendingFrames;
+};
+
+} // namespace SC
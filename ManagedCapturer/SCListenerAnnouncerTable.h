@@ -0,0 +1,98 @@
+//
+//  SCListenerAnnouncerTable.h
+//  Snapchat
+//
+//  Listener storage shared by the listener announcers.
+//
+
+#pragma once
+
+#import <Foundation/Foundation.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace SC {
+
+/*
+ Copy on write listener list, which also keeps for each selector of the listener protocol the listeners responding to
+    it, computed once when a listener is added, so announcing doesn't have to ask every listener respondsToSelector:.
+
+ Readers never take the lock nor touch a reference count, they only bump an in-flight counter. The counter is striped
+    across threads, each on its own cache line, so announcing from the camera threads doesn't contend on it. Replaced
+    snapshots are retired, and freed by a later add / remove once no reader is in flight on any stripe, so adding or
+    removing a listener from a listener callback is fine.
+ */
+class ListenerAnnouncerTable {
+public:
+    struct Snapshot {
+        std::vector<__weak id> listeners;
+        // Indexed like the selectors passed to addListener
+        std::vector<std::vector<__weak id>> listenersBySelector;
+    };
+
+    class Reader {
+    public:
+        explicit Reader(ListenerAnnouncerTable &table)
+            : _readers(table._readerStripes[ReaderStripeIndex()].readers)
+        {
+            _readers.fetch_add(1);
+            _snapshot = table._current.load();
+        }
+
+        ~Reader()
+        {
+            _readers.fetch_sub(1);
+        }
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        const std::vector<__weak id> &listeners() const
+        {
+            return _snapshot ? _snapshot->listeners : EmptyListeners();
+        }
+
+        const std::vector<__weak id> &listenersForSelector(size_t selectorIndex) const
+        {
+            return _snapshot ? _snapshot->listenersBySelector[selectorIndex] : EmptyListeners();
+        }
+
+    private:
+        std::atomic<size_t> &_readers;
+        const Snapshot *_snapshot;
+    };
+
+    ListenerAnnouncerTable();
+    ~ListenerAnnouncerTable();
+
+    ListenerAnnouncerTable(const ListenerAnnouncerTable &) = delete;
+    ListenerAnnouncerTable &operator=(const ListenerAnnouncerTable &) = delete;
+
+    // Returns false if the listener was already added
+    bool addListener(id listener, const SEL *selectors, size_t selectorCount);
+    void removeListener(id listener);
+
+private:
+    static const size_t kReaderStripeCount = 16;
+
+    // Padded so that neighbouring stripes never share a cache line
+    struct ReaderStripe {
+        std::atomic<size_t> readers;
+        char padding[64 - sizeof(std::atomic<size_t>)];
+    };
+
+    static const std::vector<__weak id> &EmptyListeners();
+    // Stable for the lifetime of the calling thread, threads are spread round robin over the stripes
+    static size_t ReaderStripeIndex();
+    void _publish(Snapshot *snapshot);
+
+    std::mutex _mutex;
+    std::atomic<Snapshot *> _current;
+    ReaderStripe _readerStripes[kReaderStripeCount];
+    // Replaced snapshots that readers in flight may still be iterating, only accessed with the lock held
+    std::vector<Snapshot *> _retired;
+};
+
+} // namespace SC
@@ -0,0 +1,128 @@
+//
+//  SCListenerAnnouncerTable.mm
+//  Snapchat
+//
+
+#import "SCListenerAnnouncerTable.h"
+
+#include <algorithm>
+
+namespace SC {
+
+ListenerAnnouncerTable::ListenerAnnouncerTable()
+    : _current(nullptr)
+{
+    for (ReaderStripe &stripe : _readerStripes) {
+        stripe.readers.store(0);
+    }
+}
+
+ListenerAnnouncerTable::~ListenerAnnouncerTable()
+{
+    delete _current.load();
+    for (Snapshot *snapshot : _retired) {
+        delete snapshot;
+    }
+}
+
+const std::vector<__weak id> &ListenerAnnouncerTable::EmptyListeners()
+{
+    static const std::vector<__weak id> emptyListeners;
+    return emptyListeners;
+}
+
+size_t ListenerAnnouncerTable::ReaderStripeIndex()
+{
+    static std::atomic<size_t> nextStripeIndex(0);
+    static thread_local size_t stripeIndex = nextStripeIndex.fetch_add(1) % kReaderStripeCount;
+    return stripeIndex;
+}
+
+bool ListenerAnnouncerTable::addListener(id listener, const SEL *selectors, size_t selectorCount)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Snapshot *current = _current.load();
+    Snapshot *snapshot = new Snapshot();
+    snapshot->listenersBySelector.resize(selectorCount);
+    if (current) {
+        // The listener we want to add already exists
+        if (std::find(current->listeners.begin(), current->listeners.end(), listener) != current->listeners.end()) {
+            delete snapshot;
+            return false;
+        }
+        for (auto &one : current->listeners) {
+            if (one != nil) {
+                snapshot->listeners.push_back(one);
+            }
+        }
+        for (size_t i = 0; i < selectorCount; ++i) {
+            for (auto &one : current->listenersBySelector[i]) {
+                if (one != nil) {
+                    snapshot->listenersBySelector[i].push_back(one);
+                }
+            }
+        }
+    }
+    snapshot->listeners.push_back(listener);
+    for (size_t i = 0; i < selectorCount; ++i) {
+        if ([listener respondsToSelector:selectors[i]]) {
+            snapshot->listenersBySelector[i].push_back(listener);
+        }
+    }
+    _publish(snapshot);
+    return true;
+}
+
+void ListenerAnnouncerTable::removeListener(id listener)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Snapshot *current = _current.load();
+    if (!current) {
+        return;
+    }
+    // If the only item in the listener list is the one we want to remove, store it back to nil again
+    if (current->listeners.size() == 1 && current->listeners[0] == listener) {
+        _publish(nullptr);
+        return;
+    }
+    Snapshot *snapshot = new Snapshot();
+    for (auto &one : current->listeners) {
+        if (one != nil && one != listener) {
+            snapshot->listeners.push_back(one);
+        }
+    }
+    snapshot->listenersBySelector.resize(current->listenersBySelector.size());
+    for (size_t i = 0; i < current->listenersBySelector.size(); ++i) {
+        for (auto &one : current->listenersBySelector[i]) {
+            if (one != nil && one != listener) {
+                snapshot->listenersBySelector[i].push_back(one);
+            }
+        }
+    }
+    _publish(snapshot);
+}
+
+void ListenerAnnouncerTable::_publish(Snapshot *snapshot)
+{
+    Snapshot *previous = _current.exchange(snapshot);
+    if (previous) {
+        _retired.push_back(previous);
+    }
+    // A reader that starts from now on loads the new snapshot, so once no reader is in flight on any stripe nothing can
+    // still be iterating the retired ones.
+    bool hasReadersInFlight = false;
+    for (const ReaderStripe &stripe : _readerStripes) {
+        if (stripe.readers.load() != 0) {
+            hasReadersInFlight = true;
+            break;
+        }
+    }
+    if (!hasReadersInFlight) {
+        for (Snapshot *retired : _retired) {
+            delete retired;
+        }
+        _retired.clear();
+    }
+}
+
+} // namespace SC
@@ -28,7 +28,6 @@
 @property (nonatomic, assign) CGPoint exposurePointOfInterest;
 @property (nonatomic, assign) BOOL isVisible;
 
-@property (nonatomic, copy) NSDictionary<NSNumber *, NSValue *> *faceBoundsByFaceID;
 @property (nonatomic, strong) SCManagedCaptureFaceDetectionAdjustingPOIResource *resource;
 
 @end
@@ -109,12 +108,11 @@
 }
 
 #pragma mark - SCManagedCapturerListener
-- (void)managedCapturer:(id<SCCapturer>)managedCapturer
-    didDetectFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID
+- (void)managedCapturer:(id<SCCapturer>)managedCapturer didDetectFaceBounds:(const SCFaceBoundsList *)faceBounds
 {
     SCTraceODPCompatibleStart(2);
     SC_GUARD_ELSE_RETURN(self.isVisible);
-    CGPoint pointOfInterest = [self.resource updateWithNewDetectedFaceBounds:faceBoundsByFaceID];
+    CGPoint pointOfInterest = [self.resource updateWithNewDetectedFaceBounds:faceBounds];
     [self _actuallySetExposurePointOfInterestIfNeeded:pointOfInterest];
 }
 
@@ -28,7 +28,6 @@
 @property (nonatomic, assign) BOOL isContinuousAutofocus;
 @property (nonatomic, assign) BOOL focusLock;
 
-@property (nonatomic, copy) NSDictionary<NSNumber *, NSValue *> *faceBoundsByFaceID;
 @property (nonatomic, strong) SCManagedCaptureFaceDetectionAdjustingPOIResource *resource;
 
 @end
@@ -132,12 +131,11 @@
 }
 
 #pragma mark - SCManagedCapturerListener
-- (void)managedCapturer:(id<SCCapturer>)managedCapturer
-    didDetectFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID
+- (void)managedCapturer:(id<SCCapturer>)managedCapturer didDetectFaceBounds:(const SCFaceBoundsList *)faceBounds
 {
     SCTraceODPCompatibleStart(2);
     SC_GUARD_ELSE_RETURN(self.isVisible);
-    CGPoint pointOfInterest = [self.resource updateWithNewDetectedFaceBounds:faceBoundsByFaceID];
+    CGPoint pointOfInterest = [self.resource updateWithNewDetectedFaceBounds:faceBounds];
     // If pointOfInterest is equal to CGPointMake(0.5, 0.5), it means no valid face is found, so that we should reset to
     // AVCaptureFocusModeContinuousAutoFocus. Otherwise, focus on the point and set the mode as
     // AVCaptureFocusModeAutoFocus.
@@ -0,0 +1,110 @@
+//
+//  SCManagedCaptureDeviceSavitzkyGolayZoomHandler.mm
+//  Snapchat
+//
+//  Created by Yu-Kuan Lai on 4/12/17.
+//  Copyright © 2017 Snapchat, Inc. All rights reserved.
+//  https://en.wikipedia.org/wiki/Savitzky%E2%80%93Golay_filter
+//
+
+#import "SCManagedCaptureDeviceSavitzkyGolayZoomHandler.h"
+
+#import "SCCameraTweaks.h"
+#import "SCFIRFilter.h"
+#import "SCManagedCaptureDevice.h"
+#import "SCManagedCaptureDeviceDefaultZoomHandler_Private.h"
+
+#import <SCFoundation/SCQueuePerformer.h>
+#import <SCFoundation/SCTraceODPCompatible.h>
+
+static size_t const kSCSavitzkyGolayMaxWindowSize = 11;
+static size_t const kSCSavitzkyGolayPolynomialOrder = 2;
+static CGFloat const kSCUpperSharpZoomThreshold = 1.15;
+
+typedef SC::FIRFilter<CGFloat, kSCSavitzkyGolayMaxWindowSize> SCSavitzkyGolayZoomFilter;
+
+// The 9 samples window is the one the handler always used, (-21, 14, 39, 54, 59, 54, 39, 14, -21) / 231
+static_assert(SC::SavitzkyGolayCoefficients<9, kSCSavitzkyGolayPolynomialOrder>()[4] * 231 > 58.999 &&
+                  SC::SavitzkyGolayCoefficients<9, kSCSavitzkyGolayPolynomialOrder>()[4] * 231 < 59.001,
+              "Unexpected Savitzky-Golay coefficients");
+
+static void SCSavitzkyGolayZoomFilterSetWindowSize(SCSavitzkyGolayZoomFilter &filter, NSInteger windowSize)
+{
+    switch (windowSize) {
+    case 5:
+        filter.setCoefficients(SC::SavitzkyGolayCoefficients<5, kSCSavitzkyGolayPolynomialOrder>());
+        break;
+    case 7:
+        filter.setCoefficients(SC::SavitzkyGolayCoefficients<7, kSCSavitzkyGolayPolynomialOrder>());
+        break;
+    case 11:
+        filter.setCoefficients(SC::SavitzkyGolayCoefficients<11, kSCSavitzkyGolayPolynomialOrder>());
+        break;
+    default:
+        filter.setCoefficients(SC::SavitzkyGolayCoefficients<9, kSCSavitzkyGolayPolynomialOrder>());
+        break;
+    }
+}
+
+@implementation SCManagedCaptureDeviceSavitzkyGolayZoomHandler {
+    // Zoom factor history, only touched from setZoomFactor:forDevice:immediately:
+    SCSavitzkyGolayZoomFilter _zoomFactorFilter;
+}
+
+- (instancetype)initWithCaptureResource:(SCCaptureResource *)captureResource
+{
+    self = [super initWithCaptureResource:captureResource];
+    if (self) {
+        SCSavitzkyGolayZoomFilterSetWindowSize(_zoomFactorFilter, SCCameraTweaksSavitzkyGolayZoomWindowSize());
+    }
+
+    return self;
+}
+
+- (void)setZoomFactor:(CGFloat)zoomFactor forDevice:(SCManagedCaptureDevice *)device immediately:(BOOL)immediately
+{
+    if (self.currentDevice != device) {
+        // reset if device changed
+        self.currentDevice = device;
+        [self _resetZoomFactor:zoomFactor forDevice:self.currentDevice];
+        return;
+    }
+
+    if (immediately || zoomFactor == 1 || _zoomFactorFilter.size() == 0) {
+        // reset if zoomFactor is 1 or this is the first data point
+        [self _resetZoomFactor:zoomFactor forDevice:device];
+        return;
+    }
+
+    CGFloat lastVal = _zoomFactorFilter.latest();
+    CGFloat upperThreshold = lastVal * kSCUpperSharpZoomThreshold;
+    if (zoomFactor > upperThreshold) {
+        // sharp change in zoomFactor, reset
+        [self _resetZoomFactor:zoomFactor forDevice:device];
+        return;
+    }
+
+    _zoomFactorFilter.push(zoomFactor);
+
+    float filteredZoomFactor =
+        SC_CLAMP([self _savitzkyGolayFilteredZoomFactor], kSCMinVideoZoomFactor, kSCMaxVideoZoomFactor);
+    [self _setZoomFactor:filteredZoomFactor forManagedCaptureDevice:device];
+}
+
+- (CGFloat)_savitzkyGolayFilteredZoomFactor
+{
+    if (_zoomFactorFilter.full()) {
+        return _zoomFactorFilter.value();
+    } else {
+        return _zoomFactorFilter.latest(); // use zoomFactor directly until the window is filled
+    }
+}
+
+- (void)_resetZoomFactor:(CGFloat)zoomFactor forDevice:(SCManagedCaptureDevice *)device
+{
+    _zoomFactorFilter.reset();
+    _zoomFactorFilter.push(zoomFactor);
+    [self _setZoomFactor:zoomFactor forManagedCaptureDevice:device];
+}
+
+@end
@@ -10,6 +10,8 @@
 //  from user taps, subject area changes, and face detection, by updating itself and return the actual point of
 //  interest.
 
+#import "SCFaceBounds.h"
+
 #import <CoreGraphics/CoreGraphics.h>
 #import <Foundation/Foundation.h>
 
@@ -23,7 +25,8 @@ typedef NS_ENUM(NSInteger, SCManagedCaptureFaceDetectionAdjustingPOIMode) {
 
 @property (nonatomic, assign) CGPoint pointOfInterest;
 
-@property (nonatomic, strong) NSDictionary<NSNumber *, NSValue *> *faceBoundsByFaceID;
+// The faces of the latest detection
+@property (nonatomic, assign, readonly) SCFaceBoundsList faceBounds;
 @property (nonatomic, assign) SCManagedCaptureFaceDetectionAdjustingPOIMode adjustingPOIMode;
 @property (nonatomic, assign) BOOL shouldTargetOnFaceAutomatically;
 @property (nonatomic, strong) NSNumber *targetingFaceID;
@@ -51,11 +54,11 @@ typedef NS_ENUM(NSInteger, SCManagedCaptureFaceDetectionAdjustingPOIMode) {
 /**
  Update SCManagedCaptureFaceDetectionAdjustingPOIResource when new detected face bounds comes.
 
- @param faceBoundsByFaceID
- A dictionary. Key: FaceID as NSNumber. Value: FaceBounds as CGRect.
+ @param faceBounds
+ The detected faces, copied by the resource.
  @return
  The actual point of interest that should be applied.
  */
-- (CGPoint)updateWithNewDetectedFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID;
+- (CGPoint)updateWithNewDetectedFaceBounds:(const SCFaceBoundsList *)faceBounds;
 
 @end
@@ -0,0 +1,164 @@
+//
+//  SCManagedCaptureFaceDetectionAdjustingPOIResource.mm
+//  Snapchat
+//
+//  Created by Jiyang Zhu on 3/7/18.
+//  Copyright © 2018 Snapchat, Inc. All rights reserved.
+//
+
+#import "SCManagedCaptureFaceDetectionAdjustingPOIResource.h"
+
+#import "SCCaptureFaceBounds.h"
+
+#import <SCFoundation/SCLog.h>
+#import <SCFoundation/SCTrace.h>
+#import <SCFoundation/SCTraceODPCompatible.h>
+
+@implementation SCManagedCaptureFaceDetectionAdjustingPOIResource {
+    CGPoint _defaultPointOfInterest;
+}
+
+#pragma mark - Public Methods
+
+- (instancetype)initWithDefaultPointOfInterest:(CGPoint)pointOfInterest
+               shouldTargetOnFaceAutomatically:(BOOL)shouldTargetOnFaceAutomatically
+{
+    if (self = [super init]) {
+        _pointOfInterest = pointOfInterest;
+        _defaultPointOfInterest = pointOfInterest;
+        _shouldTargetOnFaceAutomatically = shouldTargetOnFaceAutomatically;
+    }
+    return self;
+}
+
+- (void)reset
+{
+    SCTraceODPCompatibleStart(2);
+    self.adjustingPOIMode = SCManagedCaptureFaceDetectionAdjustingPOIModeNone;
+    self.targetingFaceID = nil;
+    self.targetingFaceBounds = CGRectZero;
+    _faceBounds.count = 0;
+    self.pointOfInterest = _defaultPointOfInterest;
+}
+
+- (CGPoint)updateWithNewProposedPointOfInterest:(CGPoint)proposedPoint fromUser:(BOOL)fromUser
+{
+    SCTraceODPCompatibleStart(2);
+    if (fromUser) {
+        const SCFaceBounds *face = SC::FaceContainingPoint(_faceBounds, proposedPoint.x, proposedPoint.y);
+        if (face && face->faceID >= 0) {
+            CGPoint point = CGPointMake(SC::FaceRectMidX(face->rect), SC::FaceRectMidY(face->rect));
+            if ([self _isPointOfInterestValid:point]) {
+                [self _setPointOfInterest:point
+                            targetingFace:face
+                         adjustingPOIMode:SCManagedCaptureFaceDetectionAdjustingPOIModeFixedOnPointWithFace];
+            } else {
+                [self _setPointOfInterest:proposedPoint
+                            targetingFace:nullptr
+                         adjustingPOIMode:SCManagedCaptureFaceDetectionAdjustingPOIModeFixedOnPointWithoutFace];
+            }
+        } else {
+            [self _setPointOfInterest:proposedPoint
+                        targetingFace:nullptr
+                     adjustingPOIMode:SCManagedCaptureFaceDetectionAdjustingPOIModeFixedOnPointWithoutFace];
+        }
+    } else {
+        [self _setPointOfInterest:proposedPoint
+                    targetingFace:nullptr
+                 adjustingPOIMode:SCManagedCaptureFaceDetectionAdjustingPOIModeNone];
+    }
+    return self.pointOfInterest;
+}
+
+- (CGPoint)updateWithNewDetectedFaceBounds:(const SCFaceBoundsList *)faceBounds
+{
+    SCTraceODPCompatibleStart(2);
+    _faceBounds = *faceBounds;
+    switch (self.adjustingPOIMode) {
+    case SCManagedCaptureFaceDetectionAdjustingPOIModeNone: {
+        if (self.shouldTargetOnFaceAutomatically) {
+            [self _focusOnPreferredFace];
+        }
+    } break;
+    case SCManagedCaptureFaceDetectionAdjustingPOIModeFixedOnPointWithFace: {
+        BOOL isFocusingOnCurrentTargetingFaceSuccess = [self _focusOnTargetingFace];
+        if (!isFocusingOnCurrentTargetingFaceSuccess && self.shouldTargetOnFaceAutomatically) {
+            // If the targeted face has disappeared, and shouldTargetOnFaceAutomatically is YES, automatically target on
+            // the next preferred face.
+            [self _focusOnPreferredFace];
+        }
+    } break;
+    case SCManagedCaptureFaceDetectionAdjustingPOIModeFixedOnPointWithoutFace:
+        // The point of interest should be fixed at a non-face point where user tapped before.
+        break;
+    }
+    return self.pointOfInterest;
+}
+
+#pragma mark - Internal Methods
+
+- (BOOL)_focusOnPreferredFace
+{
+    SCTraceODPCompatibleStart(2);
+    // The preferred face is the one with the max area.
+    const SCFaceBounds *preferredFace = SC::PreferredFace(_faceBounds);
+    SC_GUARD_ELSE_RETURN_VALUE(preferredFace, NO);
+    return [self _focusOnFaceWithFaceID:preferredFace->faceID];
+}
+
+- (BOOL)_focusOnTargetingFace
+{
+    SCTraceODPCompatibleStart(2);
+    SC_GUARD_ELSE_RETURN_VALUE(self.targetingFaceID, NO);
+    return [self _focusOnFaceWithFaceID:[self.targetingFaceID longLongValue]];
+}
+
+- (BOOL)_focusOnFaceWithFaceID:(int64_t)faceID
+{
+    SCTraceODPCompatibleStart(2);
+    const SCFaceBounds *face = SC::FindFace(_faceBounds, faceID);
+    if (face) {
+        CGPoint proposedPoint = CGPointMake(SC::FaceRectMidX(face->rect), SC::FaceRectMidY(face->rect));
+        if ([self _isPointOfInterestValid:proposedPoint]) {
+            if ([self _shouldChangeToFace:*face]) {
+                [self _setPointOfInterest:proposedPoint
+                            targetingFace:face
+                         adjustingPOIMode:SCManagedCaptureFaceDetectionAdjustingPOIModeFixedOnPointWithFace];
+            }
+            return YES;
+        }
+    }
+    [self reset];
+    return NO;
+}
+
+- (void)_setPointOfInterest:(CGPoint)pointOfInterest
+              targetingFace:(const SCFaceBounds *)targetingFace
+           adjustingPOIMode:(SCManagedCaptureFaceDetectionAdjustingPOIMode)adjustingPOIMode
+{
+    SCTraceODPCompatibleStart(2);
+    self.pointOfInterest = pointOfInterest;
+    // If there is a targeting face, record its current bounds, otherwise reset targetingFaceBounds to zero.
+    self.targetingFaceID = targetingFace ? @(targetingFace->faceID) : nil;
+    self.targetingFaceBounds = targetingFace ? SCCGRectFromFaceRect(targetingFace->rect) : CGRectZero;
+    self.adjustingPOIMode = adjustingPOIMode;
+}
+
+- (BOOL)_isPointOfInterestValid:(CGPoint)pointOfInterest
+{
+    return (pointOfInterest.x >= 0 && pointOfInterest.x <= 1 && pointOfInterest.y >= 0 && pointOfInterest.y <= 1);
+}
+
+/**
+ Setting a new focus/exposure point needs high CPU usage, so we only set a new POI when we have to. This method is to
+ return whether setting this new point if necessary.
+ If not, there is no need to change the POI.
+ */
+- (BOOL)_shouldChangeToFace:(const SCFaceBounds &)face
+{
+    SCTraceODPCompatibleStart(2);
+    SCFaceBounds targetingFace = {[self.targetingFaceID longLongValue], SCFaceRectFromCGRect(self.targetingFaceBounds)};
+    return SC::ShouldRetargetFace(self.targetingFaceID ? &targetingFace : nullptr, face);
+}
+
+@end
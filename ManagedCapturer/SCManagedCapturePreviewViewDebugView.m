@@ -8,6 +8,7 @@
 
 #import "SCManagedCapturePreviewViewDebugView.h"
 
+#import "SCCaptureFaceBounds.h"
 #import "SCManagedCapturer.h"
 #import "SCManagedCapturerListener.h"
 
@@ -24,11 +25,13 @@ static CGFloat const kSCManagedCapturePreviewViewDebugViewCrossHairWidth = 20.0;
 
 @property (assign, nonatomic) CGPoint focusPoint;
 @property (assign, nonatomic) CGPoint exposurePoint;
-@property (strong, nonatomic) NSDictionary<NSNumber *, NSValue *> *faceBoundsByFaceID;
 
 @end
 
-@implementation SCManagedCapturePreviewViewDebugView
+@implementation SCManagedCapturePreviewViewDebugView {
+    // In the coordinates of the view, only touched on the main thread
+    SCFaceBoundsList _faceBounds;
+}
 
 - (instancetype)initWithFrame:(CGRect)frame
 {
@@ -55,19 +58,16 @@ static CGFloat const kSCManagedCapturePreviewViewDebugViewCrossHairWidth = 20.0;
         [self _drawCrossHairAtPoint:self.exposurePoint inContext:context withColor:[UIColor yellowColor] isXShaped:NO];
     }
 
-    if (self.faceBoundsByFaceID.count > 0) {
-        [self.faceBoundsByFaceID
-            enumerateKeysAndObjectsUsingBlock:^(NSNumber *_Nonnull key, NSValue *_Nonnull obj, BOOL *_Nonnull stop) {
-                CGRect faceRect = [obj CGRectValue];
-                NSInteger faceID = [key integerValue];
-                [self _drawRectangle:faceRect
-                                text:[NSString sc_stringWithFormat:@"ID: %@", key]
-                           inContext:context
-                           withColor:[UIColor colorWithRed:((faceID % 3) == 0)
-                                                     green:((faceID % 3) == 1)
-                                                      blue:((faceID % 3) == 2)
-                                                     alpha:1.0]];
-            }];
+    for (size_t index = 0; index < _faceBounds.count; ++index) {
+        const SCFaceBounds *face = &_faceBounds.faces[index];
+        NSInteger faceID = (NSInteger)face->faceID;
+        [self _drawRectangle:SCCGRectFromFaceRect(face->rect)
+                        text:[NSString sc_stringWithFormat:@"ID: %lld", face->faceID]
+                   inContext:context
+                   withColor:[UIColor colorWithRed:((faceID % 3) == 0)
+                                             green:((faceID % 3) == 1)
+                                              blue:((faceID % 3) == 2)
+                                             alpha:1.0]];
     }
 }
 
@@ -146,13 +146,11 @@ static CGFloat const kSCManagedCapturePreviewViewDebugViewCrossHairWidth = 20.0;
     return convertedPoint;
 }
 
-- (NSDictionary<NSNumber *, NSValue *> *)_convertFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID
+- (SCFaceBoundsList)_convertFaceBounds:(SCFaceBoundsList)faceBoundsList
 {
     SCAssertMainThread();
-    NSMutableDictionary<NSNumber *, NSValue *> *convertedFaceBoundsByFaceID =
-        [NSMutableDictionary dictionaryWithCapacity:faceBoundsByFaceID.count];
-    for (NSNumber *key in faceBoundsByFaceID.allKeys) {
-        CGRect faceBounds = [[faceBoundsByFaceID objectForKey:key] CGRectValue];
+    for (size_t index = 0; index < faceBoundsList.count; ++index) {
+        CGRect faceBounds = SCCGRectFromFaceRect(faceBoundsList.faces[index].rect);
         CGRect convertedBounds = CGRectMake(CGRectGetMinY(faceBounds) * CGRectGetWidth(self.bounds),
                                             CGRectGetMinX(faceBounds) * CGRectGetHeight(self.bounds),
                                             CGRectGetHeight(faceBounds) * CGRectGetWidth(self.bounds),
@@ -160,9 +158,9 @@ static CGFloat const kSCManagedCapturePreviewViewDebugViewCrossHairWidth = 20.0;
         if (![[SCManagedCapturer sharedInstance] isVideoMirrored]) {
             convertedBounds.origin.x = CGRectGetWidth(self.bounds) - CGRectGetMaxX(convertedBounds);
         }
-        [convertedFaceBoundsByFaceID setObject:[NSValue valueWithCGRect:convertedBounds] forKey:key];
+        faceBoundsList.faces[index].rect = SCFaceRectFromCGRect(convertedBounds);
     }
-    return convertedFaceBoundsByFaceID;
+    return faceBoundsList;
 }
 
 #pragma mark - SCManagedCapturerListener
@@ -182,11 +180,12 @@ static CGFloat const kSCManagedCapturePreviewViewDebugViewCrossHairWidth = 20.0;
     });
 }
 
-- (void)managedCapturer:(id<SCCapturer>)managedCapturer
-    didDetectFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID
+- (void)managedCapturer:(id<SCCapturer>)managedCapturer didDetectFaceBounds:(const SCFaceBoundsList *)faceBounds
 {
+    // The block keeps its own copy of the list
+    SCFaceBoundsList faceBoundsList = *faceBounds;
     runOnMainThreadAsynchronouslyIfNecessary(^{
-        self.faceBoundsByFaceID = [self _convertFaceBounds:faceBoundsByFaceID];
+        self->_faceBounds = [self _convertFaceBounds:faceBoundsList];
         [self setNeedsDisplay];
     });
 }
@@ -194,7 +193,7 @@ static CGFloat const kSCManagedCapturePreviewViewDebugViewCrossHairWidth = 20.0;
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeCaptureDevicePosition:(SCManagedCapturerState *)state
 {
     runOnMainThreadAsynchronouslyIfNecessary(^{
-        self.faceBoundsByFaceID = nil;
+        self->_faceBounds.count = 0;
         self.focusPoint = [self _convertPointOfInterest:CGPointMake(0.5, 0.5)];
         self.exposurePoint = [self _convertPointOfInterest:CGPointMake(0.5, 0.5)];
         [self setNeedsDisplay];
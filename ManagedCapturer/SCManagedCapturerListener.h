@@ -8,6 +8,7 @@
 //
 
 #import "SCCapturer.h"
+#import "SCFaceBounds.h"
 #import "SCManagedCaptureDevice.h"
 #import "SCManagedRecordedVideo.h"
 #import "SCVideoCaptureSessionInfo.h"
@@ -127,9 +128,8 @@
 
 - (BOOL)managedCapturer:(id<SCCapturer>)managedCapturer shouldProcessFileInput:(SCManagedCapturerState *)state;
 
-// Face detection
-- (void)managedCapturer:(id<SCCapturer>)managedCapturer
-    didDetectFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID;
+// Face detection, faceBounds is only valid during the call, copy it to keep it
+- (void)managedCapturer:(id<SCCapturer>)managedCapturer didDetectFaceBounds:(const SCFaceBoundsList *)faceBounds;
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeExposurePoint:(CGPoint)exposurePoint;
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeFocusPoint:(CGPoint)focusPoint;
 @end
@@ -1,29 +1,101 @@
-// Generated by the announcer.rb  DO NOT EDIT!!
+//
+//  SCManagedCapturerListenerAnnouncer.mm
+//  Snapchat
+//
+//  Originally generated by announcer.rb, now maintained by hand on top of SC::ListenerAnnouncerTable.
+//  Don't regenerate it, edit this file directly.
+//
 
 #import "SCManagedCapturerListenerAnnouncer.h"
 
-#include <mutex>
-using std::lock_guard;
-using std::mutex;
-#include <vector>
-using std::find;
-using std::make_shared;
-using std::shared_ptr;
-using std::vector;
+#import "SCListenerAnnouncerTable.h"
+
+typedef NS_ENUM(NSUInteger, SCManagedCapturerListenerSelector) {
+    SCManagedCapturerListenerSelectorDidStartRunning = 0,
+    SCManagedCapturerListenerSelectorDidStopRunning,
+    SCManagedCapturerListenerSelectorDidResetFromRuntimeError,
+    SCManagedCapturerListenerSelectorDidChangeState,
+    SCManagedCapturerListenerSelectorDidChangeNightModeActive,
+    SCManagedCapturerListenerSelectorDidChangePortraitModeActive,
+    SCManagedCapturerListenerSelectorDidChangeFlashActive,
+    SCManagedCapturerListenerSelectorDidChangeLensesActive,
+    SCManagedCapturerListenerSelectorDidChangeARSessionActive,
+    SCManagedCapturerListenerSelectorDidChangeFlashSupportedAndTorchSupported,
+    SCManagedCapturerListenerSelectorDidChangeZoomFactor,
+    SCManagedCapturerListenerSelectorDidChangeLowLightCondition,
+    SCManagedCapturerListenerSelectorDidChangeAdjustingExposure,
+    SCManagedCapturerListenerSelectorDidChangeCaptureDevicePosition,
+    SCManagedCapturerListenerSelectorDidChangeVideoPreviewLayer,
+    SCManagedCapturerListenerSelectorDidChangeVideoPreviewGLView,
+    SCManagedCapturerListenerSelectorDidBeginVideoRecordingSession,
+    SCManagedCapturerListenerSelectorDidBeginAudioRecordingSession,
+    SCManagedCapturerListenerSelectorWillFinishRecordingSessionRecordedVideoFutureVideoSizePlaceholderImage,
+    SCManagedCapturerListenerSelectorDidFinishRecordingSessionRecordedVideo,
+    SCManagedCapturerListenerSelectorDidFailRecordingSessionError,
+    SCManagedCapturerListenerSelectorDidCancelRecordingSession,
+    SCManagedCapturerListenerSelectorDidGetErrorForTypeSession,
+    SCManagedCapturerListenerSelectorDidCallLenseResumeSession,
+    SCManagedCapturerListenerSelectorDidAppendVideoSampleBufferSampleMetadata,
+    SCManagedCapturerListenerSelectorWillCapturePhotoSampleMetadata,
+    SCManagedCapturerListenerSelectorDidCapturePhoto,
+    SCManagedCapturerListenerSelectorIsUnderDeviceMotion,
+    SCManagedCapturerListenerSelectorShouldProcessFileInput,
+    SCManagedCapturerListenerSelectorDidDetectFaceBounds,
+    SCManagedCapturerListenerSelectorDidChangeExposurePoint,
+    SCManagedCapturerListenerSelectorDidChangeFocusPoint,
+    SCManagedCapturerListenerSelectorCount,
+};
+
+static SEL const SCManagedCapturerListenerSelectors[] = {
+    @selector(managedCapturer:didStartRunning:),
+    @selector(managedCapturer:didStopRunning:),
+    @selector(managedCapturer:didResetFromRuntimeError:),
+    @selector(managedCapturer:didChangeState:),
+    @selector(managedCapturer:didChangeNightModeActive:),
+    @selector(managedCapturer:didChangePortraitModeActive:),
+    @selector(managedCapturer:didChangeFlashActive:),
+    @selector(managedCapturer:didChangeLensesActive:),
+    @selector(managedCapturer:didChangeARSessionActive:),
+    @selector(managedCapturer:didChangeFlashSupportedAndTorchSupported:),
+    @selector(managedCapturer:didChangeZoomFactor:),
+    @selector(managedCapturer:didChangeLowLightCondition:),
+    @selector(managedCapturer:didChangeAdjustingExposure:),
+    @selector(managedCapturer:didChangeCaptureDevicePosition:),
+    @selector(managedCapturer:didChangeVideoPreviewLayer:),
+    @selector(managedCapturer:didChangeVideoPreviewGLView:),
+    @selector(managedCapturer:didBeginVideoRecording:session:),
+    @selector(managedCapturer:didBeginAudioRecording:session:),
+    @selector(managedCapturer:willFinishRecording:session:recordedVideoFuture:videoSize:placeholderImage:),
+    @selector(managedCapturer:didFinishRecording:session:recordedVideo:),
+    @selector(managedCapturer:didFailRecording:session:error:),
+    @selector(managedCapturer:didCancelRecording:session:),
+    @selector(managedCapturer:didGetError:forType:session:),
+    @selector(managedCapturerDidCallLenseResume:session:),
+    @selector(managedCapturer:didAppendVideoSampleBuffer:sampleMetadata:),
+    @selector(managedCapturer:willCapturePhoto:sampleMetadata:),
+    @selector(managedCapturer:didCapturePhoto:),
+    @selector(managedCapturer:isUnderDeviceMotion:),
+    @selector(managedCapturer:shouldProcessFileInput:),
+    @selector(managedCapturer:didDetectFaceBounds:),
+    @selector(managedCapturer:didChangeExposurePoint:),
+    @selector(managedCapturer:didChangeFocusPoint:),
+};
+static_assert(sizeof(SCManagedCapturerListenerSelectors) / sizeof(SEL) == SCManagedCapturerListenerSelectorCount,
+              "Every listener selector needs an entry, in the order of the enum");
 
 @implementation SCManagedCapturerListenerAnnouncer {
-    mutex _mutex;
-    shared_ptr<vector<__weak id<SCManagedCapturerListener>>> _listeners;
+    SC::ListenerAnnouncerTable _table;
 }
 
 - (NSString *)description
 {
-    auto listeners = atomic_load(&self->_listeners);
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    auto &listeners = reader.listeners();
     NSMutableString *desc = [NSMutableString string];
     [desc appendFormat:@"<SCManagedCapturerListenerAnnouncer %p>: [", self];
-    for (int i = 0; i < listeners->size(); ++i) {
-        [desc appendFormat:@"%@", (*listeners)[i]];
-        if (i != listeners->size() - 1) {
+    for (int i = 0; i < listeners.size(); ++i) {
+        [desc appendFormat:@"%@", listeners[i]];
+        if (i != listeners.size() - 1) {
             [desc appendString:@", "];
         }
     }
@@ -33,238 +105,157 @@ using std::vector;
 
 - (BOOL)addListener:(id<SCManagedCapturerListener>)listener
 {
-    lock_guard<mutex> lock(_mutex);
-    auto listeners = make_shared<vector<__weak id<SCManagedCapturerListener>>>();
-    if (_listeners != nil) {
-        // The listener we want to add already exists
-        if (find(_listeners->begin(), _listeners->end(), listener) != _listeners->end()) {
-            return NO;
-        }
-        for (auto &one : *_listeners) {
-            if (one != nil) {
-                listeners->push_back(one);
-            }
-        }
-        listeners->push_back(listener);
-        atomic_store(&self->_listeners, listeners);
-    } else {
-        listeners->push_back(listener);
-        atomic_store(&self->_listeners, listeners);
-    }
-    return YES;
+    return _table.addListener(listener, SCManagedCapturerListenerSelectors, SCManagedCapturerListenerSelectorCount);
 }
 
 - (void)removeListener:(id<SCManagedCapturerListener>)listener
 {
-    lock_guard<mutex> lock(_mutex);
-    if (_listeners == nil) {
-        return;
-    }
-    // If the only item in the listener list is the one we want to remove, store it back to nil again
-    if (_listeners->size() == 1 && (*_listeners)[0] == listener) {
-        atomic_store(&self->_listeners, shared_ptr<vector<__weak id<SCManagedCapturerListener>>>());
-        return;
-    }
-    auto listeners = make_shared<vector<__weak id<SCManagedCapturerListener>>>();
-    for (auto &one : *_listeners) {
-        if (one != nil && one != listener) {
-            listeners->push_back(one);
-        }
-    }
-    atomic_store(&self->_listeners, listeners);
+    _table.removeListener(listener);
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didStartRunning:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didStartRunning:)]) {
-                [listener managedCapturer:managedCapturer didStartRunning:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidStartRunning)) {
+        [listener managedCapturer:managedCapturer didStartRunning:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didStopRunning:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didStopRunning:)]) {
-                [listener managedCapturer:managedCapturer didStopRunning:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidStopRunning)) {
+        [listener managedCapturer:managedCapturer didStopRunning:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didResetFromRuntimeError:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didResetFromRuntimeError:)]) {
-                [listener managedCapturer:managedCapturer didResetFromRuntimeError:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidResetFromRuntimeError)) {
+        [listener managedCapturer:managedCapturer didResetFromRuntimeError:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeState:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeState:)]) {
-                [listener managedCapturer:managedCapturer didChangeState:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeState)) {
+        [listener managedCapturer:managedCapturer didChangeState:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeNightModeActive:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeNightModeActive:)]) {
-                [listener managedCapturer:managedCapturer didChangeNightModeActive:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeNightModeActive)) {
+        [listener managedCapturer:managedCapturer didChangeNightModeActive:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangePortraitModeActive:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangePortraitModeActive:)]) {
-                [listener managedCapturer:managedCapturer didChangePortraitModeActive:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangePortraitModeActive)) {
+        [listener managedCapturer:managedCapturer didChangePortraitModeActive:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeFlashActive:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeFlashActive:)]) {
-                [listener managedCapturer:managedCapturer didChangeFlashActive:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeFlashActive)) {
+        [listener managedCapturer:managedCapturer didChangeFlashActive:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeLensesActive:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeLensesActive:)]) {
-                [listener managedCapturer:managedCapturer didChangeLensesActive:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeLensesActive)) {
+        [listener managedCapturer:managedCapturer didChangeLensesActive:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeARSessionActive:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeARSessionActive:)]) {
-                [listener managedCapturer:managedCapturer didChangeARSessionActive:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeARSessionActive)) {
+        [listener managedCapturer:managedCapturer didChangeARSessionActive:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer
     didChangeFlashSupportedAndTorchSupported:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeFlashSupportedAndTorchSupported:)]) {
-                [listener managedCapturer:managedCapturer didChangeFlashSupportedAndTorchSupported:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeFlashSupportedAndTorchSupported)) {
+        [listener managedCapturer:managedCapturer didChangeFlashSupportedAndTorchSupported:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeZoomFactor:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeZoomFactor:)]) {
-                [listener managedCapturer:managedCapturer didChangeZoomFactor:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeZoomFactor)) {
+        [listener managedCapturer:managedCapturer didChangeZoomFactor:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeLowLightCondition:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeLowLightCondition:)]) {
-                [listener managedCapturer:managedCapturer didChangeLowLightCondition:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeLowLightCondition)) {
+        [listener managedCapturer:managedCapturer didChangeLowLightCondition:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeAdjustingExposure:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeAdjustingExposure:)]) {
-                [listener managedCapturer:managedCapturer didChangeAdjustingExposure:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeAdjustingExposure)) {
+        [listener managedCapturer:managedCapturer didChangeAdjustingExposure:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeCaptureDevicePosition:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeCaptureDevicePosition:)]) {
-                [listener managedCapturer:managedCapturer didChangeCaptureDevicePosition:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeCaptureDevicePosition)) {
+        [listener managedCapturer:managedCapturer didChangeCaptureDevicePosition:state];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer
     didChangeVideoPreviewLayer:(AVCaptureVideoPreviewLayer *)videoPreviewLayer
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeVideoPreviewLayer:)]) {
-                [listener managedCapturer:managedCapturer didChangeVideoPreviewLayer:videoPreviewLayer];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeVideoPreviewLayer)) {
+        [listener managedCapturer:managedCapturer didChangeVideoPreviewLayer:videoPreviewLayer];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeVideoPreviewGLView:(LSAGLView *)videoPreviewGLView
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeVideoPreviewGLView:)]) {
-                [listener managedCapturer:managedCapturer didChangeVideoPreviewGLView:videoPreviewGLView];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeVideoPreviewGLView)) {
+        [listener managedCapturer:managedCapturer didChangeVideoPreviewGLView:videoPreviewGLView];
     }
 }
 
@@ -272,13 +263,10 @@ using std::vector;
  didBeginVideoRecording:(SCManagedCapturerState *)state
                 session:(SCVideoCaptureSessionInfo)session
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didBeginVideoRecording:session:)]) {
-                [listener managedCapturer:managedCapturer didBeginVideoRecording:state session:session];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidBeginVideoRecordingSession)) {
+        [listener managedCapturer:managedCapturer didBeginVideoRecording:state session:session];
     }
 }
 
@@ -286,13 +274,10 @@ using std::vector;
  didBeginAudioRecording:(SCManagedCapturerState *)state
                 session:(SCVideoCaptureSessionInfo)session
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didBeginAudioRecording:session:)]) {
-                [listener managedCapturer:managedCapturer didBeginAudioRecording:state session:session];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidBeginAudioRecordingSession)) {
+        [listener managedCapturer:managedCapturer didBeginAudioRecording:state session:session];
     }
 }
 
@@ -303,23 +288,16 @@ using std::vector;
               videoSize:(CGSize)videoSize
        placeholderImage:(UIImage *)placeholderImage
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:
-                                                   willFinishRecording:
-                                                               session:
-                                                   recordedVideoFuture:
-                                                             videoSize:
-                                                      placeholderImage:)]) {
-                [listener managedCapturer:managedCapturer
-                      willFinishRecording:state
-                                  session:session
-                      recordedVideoFuture:recordedVideoFuture
-                                videoSize:videoSize
-                         placeholderImage:placeholderImage];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(
+             SCManagedCapturerListenerSelectorWillFinishRecordingSessionRecordedVideoFutureVideoSizePlaceholderImage)) {
+        [listener managedCapturer:managedCapturer
+              willFinishRecording:state
+                          session:session
+              recordedVideoFuture:recordedVideoFuture
+                        videoSize:videoSize
+                 placeholderImage:placeholderImage];
     }
 }
 
@@ -328,16 +306,13 @@ using std::vector;
                 session:(SCVideoCaptureSessionInfo)session
           recordedVideo:(SCManagedRecordedVideo *)recordedVideo
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didFinishRecording:session:recordedVideo:)]) {
-                [listener managedCapturer:managedCapturer
-                       didFinishRecording:state
-                                  session:session
-                            recordedVideo:recordedVideo];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidFinishRecordingSessionRecordedVideo)) {
+        [listener managedCapturer:managedCapturer
+               didFinishRecording:state
+                          session:session
+                    recordedVideo:recordedVideo];
     }
 }
 
@@ -346,13 +321,10 @@ using std::vector;
                 session:(SCVideoCaptureSessionInfo)session
                   error:(NSError *)error
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didFailRecording:session:error:)]) {
-                [listener managedCapturer:managedCapturer didFailRecording:state session:session error:error];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidFailRecordingSessionError)) {
+        [listener managedCapturer:managedCapturer didFailRecording:state session:session error:error];
     }
 }
 
@@ -360,13 +332,10 @@ using std::vector;
      didCancelRecording:(SCManagedCapturerState *)state
                 session:(SCVideoCaptureSessionInfo)session
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didCancelRecording:session:)]) {
-                [listener managedCapturer:managedCapturer didCancelRecording:state session:session];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidCancelRecordingSession)) {
+        [listener managedCapturer:managedCapturer didCancelRecording:state session:session];
     }
 }
 
@@ -375,25 +344,19 @@ using std::vector;
                 forType:(SCManagedVideoCapturerInfoType)type
                 session:(SCVideoCaptureSessionInfo)session
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didGetError:forType:session:)]) {
-                [listener managedCapturer:managedCapturer didGetError:error forType:type session:session];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidGetErrorForTypeSession)) {
+        [listener managedCapturer:managedCapturer didGetError:error forType:type session:session];
     }
 }
 
 - (void)managedCapturerDidCallLenseResume:(id<SCCapturer>)managedCapturer session:(SCVideoCaptureSessionInfo)session
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturerDidCallLenseResume:session:)]) {
-                [listener managedCapturerDidCallLenseResume:managedCapturer session:session];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidCallLenseResumeSession)) {
+        [listener managedCapturerDidCallLenseResume:managedCapturer session:session];
     }
 }
 
@@ -401,15 +364,12 @@ using std::vector;
     didAppendVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer
                 sampleMetadata:(SCManagedCapturerSampleMetadata *)sampleMetadata
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didAppendVideoSampleBuffer:sampleMetadata:)]) {
-                [listener managedCapturer:managedCapturer
-                    didAppendVideoSampleBuffer:sampleBuffer
-                                sampleMetadata:sampleMetadata];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidAppendVideoSampleBufferSampleMetadata)) {
+        [listener managedCapturer:managedCapturer
+            didAppendVideoSampleBuffer:sampleBuffer
+                        sampleMetadata:sampleMetadata];
     }
 }
 
@@ -417,36 +377,29 @@ using std::vector;
        willCapturePhoto:(SCManagedCapturerState *)state
          sampleMetadata:(SCManagedCapturerSampleMetadata *)sampleMetadata
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:willCapturePhoto:sampleMetadata:)]) {
-                [listener managedCapturer:managedCapturer willCapturePhoto:state sampleMetadata:sampleMetadata];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorWillCapturePhotoSampleMetadata)) {
+        [listener managedCapturer:managedCapturer willCapturePhoto:state sampleMetadata:sampleMetadata];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didCapturePhoto:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didCapturePhoto:)]) {
-                [listener managedCapturer:managedCapturer didCapturePhoto:state];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidCapturePhoto)) {
+        [listener managedCapturer:managedCapturer didCapturePhoto:state];
     }
 }
 
 - (BOOL)managedCapturer:(id<SCCapturer>)managedCapturer isUnderDeviceMotion:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didCapturePhoto:)]) {
-                return [listener managedCapturer:managedCapturer isUnderDeviceMotion:state];
-            }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorIsUnderDeviceMotion)) {
+        if (listener) {
+            return [listener managedCapturer:managedCapturer isUnderDeviceMotion:state];
         }
     }
     return NO;
@@ -454,51 +407,40 @@ using std::vector;
 
 - (BOOL)managedCapturer:(id<SCCapturer>)managedCapturer shouldProcessFileInput:(SCManagedCapturerState *)state
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didCapturePhoto:)]) {
-                return [listener managedCapturer:managedCapturer isUnderDeviceMotion:state];
-            }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorShouldProcessFileInput)) {
+        if (listener) {
+            return [listener managedCapturer:managedCapturer shouldProcessFileInput:state];
         }
     }
     return NO;
 }
 
-- (void)managedCapturer:(id<SCCapturer>)managedCapturer
-    didDetectFaceBounds:(NSDictionary<NSNumber *, NSValue *> *)faceBoundsByFaceID
-{
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didDetectFaceBounds:)]) {
-                [listener managedCapturer:managedCapturer didDetectFaceBounds:faceBoundsByFaceID];
-            }
-        }
+- (void)managedCapturer:(id<SCCapturer>)managedCapturer didDetectFaceBounds:(const SCFaceBoundsList *)faceBounds
+{
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidDetectFaceBounds)) {
+        [listener managedCapturer:managedCapturer didDetectFaceBounds:faceBounds];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeExposurePoint:(CGPoint)exposurePoint
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeExposurePoint:)]) {
-                [listener managedCapturer:managedCapturer didChangeExposurePoint:exposurePoint];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeExposurePoint)) {
+        [listener managedCapturer:managedCapturer didChangeExposurePoint:exposurePoint];
     }
 }
 
 - (void)managedCapturer:(id<SCCapturer>)managedCapturer didChangeFocusPoint:(CGPoint)focusPoint
 {
-    auto listeners = atomic_load(&self->_listeners);
-    if (listeners) {
-        for (id<SCManagedCapturerListener> listener : *listeners) {
-            if ([listener respondsToSelector:@selector(managedCapturer:didChangeFocusPoint:)]) {
-                [listener managedCapturer:managedCapturer didChangeFocusPoint:focusPoint];
-            }
-        }
+    SC::ListenerAnnouncerTable::Reader reader(_table);
+    for (id<SCManagedCapturerListener> listener :
+         reader.listenersForSelector(SCManagedCapturerListenerSelectorDidChangeFocusPoint)) {
+        [listener managedCapturer:managedCapturer didChangeFocusPoint:focusPoint];
     }
 }
 
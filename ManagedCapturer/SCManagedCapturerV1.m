@@ -19,6 +19,7 @@
 #import "SCCaptureUninitializedState.h"
 #import "SCCaptureWorker.h"
 #import "SCCapturerToken.h"
+#import "SCHotPathTrace.h"
 #import "SCManagedAudioStreamer.h"
 #import "SCManagedCaptureDevice+SCManagedCapturer.h"
 #import "SCManagedCaptureDeviceDefaultZoomHandler.h"
@@ -44,10 +45,12 @@
 #import "SCManagedVideoARDataSource.h"
 #import "SCManagedVideoCapturer.h"
 #import "SCManagedVideoFileStreamer.h"
+#import "SCManagedVideoFrameDeliveryLane.h"
 #import "SCManagedVideoFrameSampler.h"
 #import "SCManagedVideoScanner.h"
 #import "SCManagedVideoStreamReporter.h"
 #import "SCManagedVideoStreamer.h"
+#import "SCMetalPipelineStateCache.h"
 #import "SCMetalUtils.h"
 #import "SCProcessingPipeline.h"
 #import "SCProcessingPipelineBuilder.h"
@@ -75,6 +78,7 @@
 #import <SCLogger/SCCameraMetrics.h>
 #import <SCLogger/SCLogger+Performance.h>
 #import <SCUserTraceLogger/SCUserTraceLogger.h>
+#import <Tweaks/FBTweakInline.h>
 
 #import <Looksery/Looksery.h>
 
@@ -132,6 +136,15 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
         _captureResource.deviceSubjectAreaHandler =
             [[SCManagedCaptureDeviceSubjectAreaHandler alloc] initWithCaptureResource:_captureResource];
         _captureResource.snapCreationTriggers = [SCSnapCreationTriggers new];
+        // Compile the metal kernels now rather than on the first processed frame
+        [[SCMetalPipelineStateCache sharedCache] precompileCameraKernels];
+#if SC_HOT_PATH_TRACE_ENABLED
+        // The per-frame trace is only recorded in internal builds, the tweak dumps it to the temporary directory
+        SCHotPathTraceSetEnabled(SCIsDebugBuild() || SCIsMasterBuild());
+        FBTweakAction(@"Camera", @"Core Camera", @"Dump hot path trace", ^{
+            [SCManagedCapturerV1 _dumpHotPathTrace];
+        });
+#endif
         if (SCIsMasterBuild()) {
             // We call _sessionRuntimeError to reset _captureResource.videoDataSource if input changes
             [[NSNotificationCenter defaultCenter] addObserver:self
@@ -538,7 +551,9 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
             }
         }
         [_captureResource.queuePerformer perform:^{
-            [_captureResource.videoDataSource addListener:_captureResource.frameCap];
+            // Converting the frame to an image takes a while, it is done off the streamer queue
+            SCManagedVideoDataSourceAddListener(_captureResource.videoDataSource, _captureResource.frameCap,
+                                                SCManagedVideoFrameDeliveryPolicyLatestOnly, QOS_CLASS_USER_INITIATED);
             [SCCaptureWorker startStreaming:_captureResource];
         }
                                            after:(waitForTorch ? 0.5 : 0)];
@@ -552,6 +567,7 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
     SCTraceODPCompatibleStart(2);
     [_captureResource.queuePerformer perform:^{
         SCLogCapturerInfo(@"prepare for recording");
+        [SCCaptureWorker runDeferredSetupWithCaptureResource:_captureResource];
         [_captureResource.videoCapturer prepareForRecordingWithAudioConfiguration:configuration];
     }];
 }
@@ -632,6 +648,7 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
     SCTraceODPCompatibleStart(2);
     SCLogCapturerInfo(@"Adding timed task:%@", task);
     [_captureResource.queuePerformer perform:^{
+        [SCCaptureWorker runDeferredSetupWithCaptureResource:_captureResource];
         [_captureResource.videoCapturer addTimedTask:task];
     }];
 }
@@ -640,6 +657,7 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
 {
     SCTraceODPCompatibleStart(2);
     [_captureResource.queuePerformer perform:^{
+        [SCCaptureWorker runDeferredSetupWithCaptureResource:_captureResource];
         [_captureResource.videoCapturer clearTimedTasks];
     }];
 }
@@ -1490,6 +1508,22 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
     return info.copy;
 }
 
+#if SC_HOT_PATH_TRACE_ENABLED
++ (void)_dumpHotPathTrace
+{
+    // The binary snapshot for tooling, and the same records decoded for reading on the device
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"hot_path_trace"];
+    NSString *binaryPath = [path stringByAppendingPathExtension:@"bin"];
+    NSString *decodedPath = [path stringByAppendingPathExtension:@"txt"];
+    if (SCHotPathTraceWriteSnapshot(binaryPath.fileSystemRepresentation) &&
+        SCHotPathTraceWriteDecodedSnapshot(decodedPath.fileSystemRepresentation)) {
+        SCLogCapturerInfo(@"Dumped hot path trace to %@ and %@", binaryPath, decodedPath);
+    } else {
+        SCLogCapturerError(@"Failed to dump hot path trace to %@", path);
+    }
+}
+#endif
+
 - (NSString *)description
 {
     return [self debugDescription];
@@ -1867,6 +1901,8 @@ NSString *const kSCLensesTweaksDidChangeFileInput = @"kSCLensesTweaksDidChangeFi
     SCLogCapturerInfo(@"Start running with new capture session. isRecording:%d isStreaming:%d status:%lu",
                       _captureResource.videoRecording, _captureResource.videoDataSource.isStreaming,
                       (unsigned long)_captureResource.status);
+    // The listeners are swapped below, so the deferred ones have to be in place first
+    [SCCaptureWorker runDeferredSetupWithCaptureResource:_captureResource];
 
     // Mark the start of recreating session
     [_captureResource.blackCameraDetector sessionWillRecreate];
@@ -1,5 +1,5 @@
 //
-//  SCManagedDeviceCapacityAnalyzer.m
+//  SCManagedDeviceCapacityAnalyzer.mm
 //  Snapchat
 //
 //  Created by Liu Liu on 5/1/15.
@@ -10,6 +10,8 @@
 
 #import "SCCameraSettingUtils.h"
 #import "SCCameraTweaks.h"
+#import "SCHotPathTrace.h"
+#import "SCLightingAnalytics.h"
 #import "SCManagedCaptureDevice+SCManagedDeviceCapacityAnalyzer.h"
 #import "SCManagedCaptureDevice.h"
 #import "SCManagedDeviceCapacityAnalyzerListenerAnnouncer.h"
@@ -18,13 +20,20 @@
 #import <SCFoundation/SCDeviceName.h>
 #import <SCFoundation/SCLog.h>
 #import <SCFoundation/SCPerforming.h>
+#import <SCFoundation/SCQueuePerformer.h>
 #import <SCFoundation/SCTrace.h>
 
 #import <FBKVOController/FBKVOController.h>
 
+@import CoreVideo;
 @import ImageIO;
 @import QuartzCore;
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 NSInteger const kSCManagedDeviceCapacityAnalyzerMaxISOPresetHighFor6WithHRSI = 500;
 
 NSInteger const kSCManagedDeviceCapacityAnalyzerMaxISOPresetHighFor6S = 800;
@@ -59,21 +68,85 @@ static NSInteger const kSCLightingConditionDecisionWatermark = 15; // For 30 fps
 static float const kSCLightingConditionNormalThreshold = 0;
 static float const kSCLightingConditionDarkThreshold = -3;
 
+// Mean luma, between the black and white levels, expected in each lighting condition. When the luma statistics of a
+// frame agree with its brightness, the decision is taken in fewer frames.
+static float const kSCLightingConditionNormalLumaThreshold = 0.3;
+static float const kSCLightingConditionDarkLumaThreshold = 0.12;
+static float const kSCLowLightEnoughLightLumaThreshold = 0.2;
+// A light source in frame makes the mean luma meaningless
+static float const kSCLumaMaxConfirmingBrightClippedFraction = 0.05;
+
+static char *const kSCManagedDeviceCapacityAnalyzerLumaQueueLabel =
+    "com.snapchat.managed-device-capacity-analyzer.luma";
+// Rows of the luma plane looked at per analyzed frame, which bounds the cost of the analytics
+static size_t const kSCLumaAnalyticsSampledRows = 64;
+
+// The watermarks are compared with the frame counts before they are incremented, the low light one has to be reached
+// and the lighting condition one exceeded, hence the extra frames
+static SC::LightingLevel const kSCLowLightLevels[] = {
+    {NO, kBrightnessValueThreshold, kSCLowLightEnoughLightLumaThreshold, kLowLightBoostUnchangedLowWatermark + 1,
+     kLowLightBoostUnchangedLowWatermark / 2 + 1},
+    {YES, 0, 0, kLowLightBoostUnchangedHighWatermark + 1, kLowLightBoostUnchangedHighWatermark / 2 + 1},
+};
+
+static SC::LightingHysteresisTable const kSCLowLightTable = {
+    kSCLowLightLevels, sizeof(kSCLowLightLevels) / sizeof(kSCLowLightLevels[0]),
+    kBrightnessValueThresholdConfidenceInterval, kSCLumaMaxConfirmingBrightClippedFraction,
+};
+
+static SC::LightingLevel const kSCLightingConditionLevels[] = {
+    {SCCapturerLightingConditionTypeNormal, kSCLightingConditionNormalThreshold,
+     kSCLightingConditionNormalLumaThreshold, kSCLightingConditionDecisionWatermark + 2,
+     kSCLightingConditionDecisionWatermark / 2 + 2},
+    {SCCapturerLightingConditionTypeDark, kSCLightingConditionDarkThreshold, kSCLightingConditionDarkLumaThreshold,
+     kSCLightingConditionDecisionWatermark + 2, kSCLightingConditionDecisionWatermark / 2 + 2},
+    {SCCapturerLightingConditionTypeExtremeDark, 0, 0, kSCLightingConditionDecisionWatermark + 2,
+     kSCLightingConditionDecisionWatermark / 2 + 2},
+};
+
+static SC::LightingHysteresisTable const kSCLightingConditionTable = {
+    kSCLightingConditionLevels, sizeof(kSCLightingConditionLevels) / sizeof(kSCLightingConditionLevels[0]), 0,
+    kSCLumaMaxConfirmingBrightClippedFraction,
+};
+
+static BOOL SCLumaPlaneFromLockedPixelBuffer(CVPixelBufferRef pixelBuffer, SC::LumaPlane *plane)
+{
+    OSType pixelFormat = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    SC_GUARD_ELSE_RETURN_VALUE(pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange ||
+                                   pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange,
+                               NO);
+    BOOL videoRange = pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
+    plane->data = (const uint8_t *)CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+    plane->width = CVPixelBufferGetWidthOfPlane(pixelBuffer, 0);
+    plane->height = CVPixelBufferGetHeightOfPlane(pixelBuffer, 0);
+    plane->bytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+    plane->blackLevel = videoRange ? 16 : 0;
+    plane->whiteLevel = videoRange ? 235 : 255;
+    return plane->data != NULL;
+}
+
 @implementation SCManagedDeviceCapacityAnalyzer {
     float _lastExposureTime;
     int _lastISOSpeedRating;
     NSTimeInterval _lastAdjustingExposureStartTime;
 
-    NSInteger _lowLightBoostLowLightCount;
-    NSInteger _lowLightBoostEnoughLightCount;
     NSInteger _exposureUnchangedCount;
     NSInteger _maxISOPresetHigh;
 
-    NSInteger _normalLightingConditionCount;
-    NSInteger _darkLightingConditionCount;
-    NSInteger _extremeDarkLightingConditionCount;
+    std::unique_ptr<SC::LightingHysteresis> _lowLightHysteresis;
+    std::unique_ptr<SC::LightingHysteresis> _lightingConditionHysteresis;
     SCCapturerLightingConditionType _lightingCondition;
 
+    // Optional luma analytics, run every _lumaAnalyticsFrameInterval frames off the video data queue
+    SCQueuePerformer *_lumaAnalyticsPerformer;
+    NSUInteger _lumaAnalyticsFrameInterval;
+    NSUInteger _frameIndex;
+    std::atomic<bool> _lumaAnalysisInFlight;
+    std::mutex _lumaStatisticsMutex;
+    SC::LumaStatistics _lumaStatistics;
+    NSUInteger _lumaStatisticsFrameIndex;
+    BOOL _hasLumaStatistics;
+
     BOOL _lowLightCondition;
     BOOL _adjustingExposure;
 
@@ -102,6 +175,17 @@ static float const kSCLightingConditionDarkThreshold = -3;
         }
         _announcer = [[SCManagedDeviceCapacityAnalyzerListenerAnnouncer alloc] init];
         _observeController = [[FBKVOController alloc] initWithObserver:self];
+        _lowLightHysteresis.reset(new SC::LightingHysteresis(kSCLowLightTable, NO));
+        _lightingConditionHysteresis.reset(
+            new SC::LightingHysteresis(kSCLightingConditionTable, SCCapturerLightingConditionTypeNormal));
+        if (SCCameraTweaksEnableLumaAnalytics()) {
+            _lumaAnalyticsPerformer =
+                [[SCQueuePerformer alloc] initWithLabel:kSCManagedDeviceCapacityAnalyzerLumaQueueLabel
+                                       qualityOfService:QOS_CLASS_UTILITY
+                                              queueType:DISPATCH_QUEUE_SERIAL
+                                                context:SCQueuePerformerContextCamera];
+            _lumaAnalyticsFrameInterval = MAX(SCCameraTweaksLumaAnalyticsFrameInterval(), 1);
+        }
     }
     return self;
 }
@@ -124,8 +208,7 @@ static float const kSCLightingConditionDarkThreshold = -3;
     if (_lowLightConditionEnabled != lowLightConditionEnabled) {
         _lowLightConditionEnabled = lowLightConditionEnabled;
         if (!lowLightConditionEnabled) {
-            _lowLightBoostLowLightCount = 0;
-            _lowLightBoostEnoughLightCount = 0;
+            _lowLightHysteresis->reset(NO);
             _lowLightCondition = NO;
             [_announcer managedDeviceCapacityAnalyzer:self didChangeLowLightCondition:_lowLightCondition];
         }
@@ -136,27 +219,37 @@ static float const kSCLightingConditionDarkThreshold = -3;
          didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer
                 devicePosition:(SCManagedCaptureDevicePosition)devicePosition
 {
-    SCTraceStart();
     SampleBufferMetadata metadata = {
-        .isoSpeedRating = _lastISOSpeedRating, .brightness = 0, .exposureTime = _lastExposureTime,
+        .isoSpeedRating = _lastISOSpeedRating, .exposureTime = _lastExposureTime, .brightness = 0,
     };
     retrieveSampleBufferMetadata(sampleBuffer, &metadata);
+    SC::LightingSample sample = {metadata.brightness, false, {}};
+    if (_lumaAnalyticsPerformer) {
+        [self _analyzeLumaIfNeeded:sampleBuffer];
+        [self _getLumaStatistics:&sample];
+    }
+    SCHotPathTrace(SCHotPathTraceEventCapacityAnalyzerFrame, SCHotPathTraceDouble(metadata.exposureTime),
+                   metadata.isoSpeedRating, SCHotPathTraceDouble(metadata.brightness),
+                   SCHotPathTraceDouble(sample.lumaStatistics.mean));
     if ((SCIsDebugBuild() || SCIsMasterBuild())
         // Enable this on internal build only (excluding alpha)
         && fabs(metadata.brightness - _lastBrightnessToLog) > 0.5f) {
         // Log only when brightness change is greater than 0.5
         _lastBrightnessToLog = metadata.brightness;
-        SCLogCoreCameraInfo(@"ExposureTime: %f, ISO: %ld, Brightness: %f", metadata.exposureTime,
-                            (long)metadata.isoSpeedRating, metadata.brightness);
+        SCLogCoreCameraInfo(@"ExposureTime: %f, ISO: %ld, Brightness: %f, Luma: %f, Dark clipped: %f, Bright "
+                            @"clipped: %f, Dynamic range: %f",
+                            metadata.exposureTime, (long)metadata.isoSpeedRating, metadata.brightness,
+                            sample.lumaStatistics.mean, sample.lumaStatistics.darkClippedFraction,
+                            sample.lumaStatistics.brightClippedFraction, sample.lumaStatistics.dynamicRange);
     }
     [self _automaticallyDetectAdjustingExposure:metadata.exposureTime ISOSpeedRating:metadata.isoSpeedRating];
     _lastExposureTime = metadata.exposureTime;
     _lastISOSpeedRating = metadata.isoSpeedRating;
     if (!_adjustingExposure && _lastISOSpeedRating <= _maxISOPresetHigh &&
         _lowLightConditionEnabled) { // If we are not recording, we are not at ISO higher than we needed
-        [self _automaticallyDetectLowLightCondition:metadata.brightness];
+        [self _automaticallyDetectLowLightCondition:sample];
     }
-    [self _automaticallyDetectLightingConditionWithBrightness:metadata.brightness];
+    [self _automaticallyDetectLightingCondition:sample];
     [_announcer managedDeviceCapacityAnalyzer:self didChangeBrightness:metadata.brightness];
 }
 
@@ -207,37 +300,14 @@ static float const kSCLightingConditionDarkThreshold = -3;
     }
 }
 
-- (void)_automaticallyDetectLowLightCondition:(float)brightness
+- (void)_automaticallyDetectLowLightCondition:(const SC::LightingSample &)sample
 {
     SCTraceStart();
-    if (!_lowLightCondition && _lastISOSpeedRating == _maxISOPresetHigh) {
-        // If we are at the stage that we need to use higher ISO (because current ISO is maxed out)
-        // and the brightness is lower than the threshold
-        if (brightness < kBrightnessValueThreshold - kBrightnessValueThresholdConfidenceInterval) {
-            // Either count how many frames like this continuously we encountered
-            // Or if reached the watermark, change the low light boost mode
-            if (_lowLightBoostLowLightCount >= kLowLightBoostUnchangedHighWatermark) {
-                _lowLightCondition = YES;
-                [_announcer managedDeviceCapacityAnalyzer:self didChangeLowLightCondition:_lowLightCondition];
-            } else {
-                ++_lowLightBoostLowLightCount;
-            }
-        } else if (brightness >= kBrightnessValueThreshold + kBrightnessValueThresholdConfidenceInterval) {
-            // If the brightness is consistently better, reset the low light boost unchanged count to 0
-            _lowLightBoostLowLightCount = 0;
-        }
-    } else if (_lowLightCondition) {
-        // Check the current ISO to see if we can disable low light boost
-        if (_lastISOSpeedRating <= _maxISOPresetHigh &&
-            brightness >= kBrightnessValueThreshold + kBrightnessValueThresholdConfidenceInterval) {
-            if (_lowLightBoostEnoughLightCount >= kLowLightBoostUnchangedLowWatermark) {
-                _lowLightCondition = NO;
-                [_announcer managedDeviceCapacityAnalyzer:self didChangeLowLightCondition:_lowLightCondition];
-                _lowLightBoostEnoughLightCount = 0;
-            } else {
-                ++_lowLightBoostEnoughLightCount;
-            }
-        }
+    // Only consider going into low light once we need to use higher ISO (because current ISO is maxed out)
+    SC_GUARD_ELSE_RETURN(_lowLightCondition || _lastISOSpeedRating == _maxISOPresetHigh);
+    if (_lowLightHysteresis->update(sample)) {
+        _lowLightCondition = _lowLightHysteresis->state();
+        [_announcer managedDeviceCapacityAnalyzer:self didChangeLowLightCondition:_lowLightCondition];
     }
 }
 
@@ -250,44 +320,57 @@ static float const kSCLightingConditionDarkThreshold = -3;
     }];
 }
 
-- (void)_automaticallyDetectLightingConditionWithBrightness:(float)brightness
+- (void)_automaticallyDetectLightingCondition:(const SC::LightingSample &)sample
 {
-    if (brightness >= kSCLightingConditionNormalThreshold) {
-        if (_normalLightingConditionCount > kSCLightingConditionDecisionWatermark) {
-            if (_lightingCondition != SCCapturerLightingConditionTypeNormal) {
-                _lightingCondition = SCCapturerLightingConditionTypeNormal;
-                [_announcer managedDeviceCapacityAnalyzer:self
-                               didChangeLightingCondition:SCCapturerLightingConditionTypeNormal];
-            }
-        } else {
-            _normalLightingConditionCount++;
-        }
-        _darkLightingConditionCount = 0;
-        _extremeDarkLightingConditionCount = 0;
-    } else if (brightness >= kSCLightingConditionDarkThreshold) {
-        if (_darkLightingConditionCount > kSCLightingConditionDecisionWatermark) {
-            if (_lightingCondition != SCCapturerLightingConditionTypeDark) {
-                _lightingCondition = SCCapturerLightingConditionTypeDark;
-                [_announcer managedDeviceCapacityAnalyzer:self
-                               didChangeLightingCondition:SCCapturerLightingConditionTypeDark];
-            }
-        } else {
-            _darkLightingConditionCount++;
+    if (_lightingConditionHysteresis->update(sample)) {
+        _lightingCondition = (SCCapturerLightingConditionType)_lightingConditionHysteresis->state();
+        [_announcer managedDeviceCapacityAnalyzer:self didChangeLightingCondition:_lightingCondition];
+    }
+}
+
+#pragma mark - Luma analytics
+
+- (void)_analyzeLumaIfNeeded:(CMSampleBufferRef)sampleBuffer
+{
+    NSUInteger frameIndex = _frameIndex++;
+    SC_GUARD_ELSE_RETURN(frameIndex % _lumaAnalyticsFrameInterval == 0);
+    // Only one frame is held at a time, skip this one if the previous is still being analyzed
+    SC_GUARD_ELSE_RETURN(!_lumaAnalysisInFlight.exchange(true));
+    CVPixelBufferRef pixelBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
+    if (!pixelBuffer) {
+        _lumaAnalysisInFlight = false;
+        return;
+    }
+    CVPixelBufferRetain(pixelBuffer);
+    [_lumaAnalyticsPerformer perform:^{
+        SC::LumaPlane plane = {};
+        SC::LumaStatistics statistics = {};
+        CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+        BOOL analyzed = SCLumaPlaneFromLockedPixelBuffer(pixelBuffer, &plane);
+        if (analyzed) {
+            size_t rowStep = std::max<size_t>(plane.height / kSCLumaAnalyticsSampledRows, 1);
+            statistics = SC::LumaPlaneStatistics(plane, rowStep);
         }
-        _normalLightingConditionCount = 0;
-        _extremeDarkLightingConditionCount = 0;
-    } else {
-        if (_extremeDarkLightingConditionCount > kSCLightingConditionDecisionWatermark) {
-            if (_lightingCondition != SCCapturerLightingConditionTypeExtremeDark) {
-                _lightingCondition = SCCapturerLightingConditionTypeExtremeDark;
-                [_announcer managedDeviceCapacityAnalyzer:self
-                               didChangeLightingCondition:SCCapturerLightingConditionTypeExtremeDark];
-            }
-        } else {
-            _extremeDarkLightingConditionCount++;
+        CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+        CVPixelBufferRelease(pixelBuffer);
+        if (analyzed) {
+            std::lock_guard<std::mutex> lock(_lumaStatisticsMutex);
+            _lumaStatistics = statistics;
+            _lumaStatisticsFrameIndex = frameIndex;
+            _hasLumaStatistics = YES;
         }
-        _normalLightingConditionCount = 0;
-        _darkLightingConditionCount = 0;
+        _lumaAnalysisInFlight = false;
+    }];
+}
+
+- (void)_getLumaStatistics:(SC::LightingSample *)sample
+{
+    std::lock_guard<std::mutex> lock(_lumaStatisticsMutex);
+    // Statistics older than the analysis after them was due are stale
+    sample->hasLumaStatistics =
+        _hasLumaStatistics && _frameIndex - _lumaStatisticsFrameIndex <= 2 * _lumaAnalyticsFrameInterval;
+    if (sample->hasLumaStatistics) {
+        sample->lumaStatistics = _lumaStatistics;
     }
 }
 
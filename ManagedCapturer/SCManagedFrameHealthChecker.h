@@ -44,6 +44,10 @@ SC_INIT_AND_NEW_UNAVAILABLE;
 - (void)checkVideoHealthForCaptureFrameImage:(UIImage *)image
                                     metedata:(NSDictionary *)metadata
                             captureSessionID:(NSString *)captureSessionID;
+/* Samples the luma plane of 420YpCbCr8BiPlanar (or BGRA) pixel buffers in place, without converting to an image. */
+- (void)checkVideoHealthForCaptureFramePixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                          metedata:(NSDictionary *)metadata
+                                  captureSessionID:(NSString *)captureSessionID;
 - (void)checkVideoHealthForOverlayImage:(UIImage *)image
                                metedata:(NSDictionary *)metadata
                        captureSessionID:(NSString *)captureSessionID;
@@ -1,5 +1,5 @@
 //
-//  SCManagedFrameHealthChecker.m
+//  SCManagedFrameHealthChecker.mm
 //  Snapchat
 //
 //  Created by Pinlin Chen on 30/08/2017.
@@ -9,8 +9,10 @@
 
 #import "SCCameraSettingUtils.h"
 #import "SCCameraTweaks.h"
+#import "SCFrameHealthSampler.h"
 
 #import <SCFoundation/AVAsset+Helpers.h>
+#import <SCFoundation/SCAssertWrapper.h>
 #import <SCFoundation/SCLog.h>
 #import <SCFoundation/SCLogHelper.h>
 #import <SCFoundation/SCQueuePerformer.h>
@@ -21,15 +23,21 @@
 #import <SCWebP/UIImage+WebP.h>
 
 #import <ImageIO/CGImageProperties.h>
-@import Accelerate;
+#import <objc/runtime.h>
 
 static const char *kSCManagedFrameHealthCheckerQueueLabel = "com.snapchat.frame_health_checker";
-static const int kSCManagedFrameHealthCheckerMaxSamples = 2304;
-static const float kSCManagedFrameHealthCheckerPossibleBlackThreshold = 20.0;
+static const size_t kSCManagedFrameHealthCheckerMaxSamples = SC::kFrameHealthMaxSamples;
+static const float kSCManagedFrameHealthCheckerPossibleBlackThreshold = SC::kFrameHealthPossibleBlackThreshold;
 static const float kSCManagedFrameHealthCheckerScaledImageMaxEdgeLength = 300.0;
 static const float kSCManagedFrameHealthCheckerScaledImageScale = 1.0;
 // assume we could process at most of 2 RGBA images which are 2304*4096 RGBA image
 static const double kSCManagedFrameHealthCheckerMinFreeMemMB = 72.0;
+// Pending tasks only keep sampled statistics and metadata, this is enough for a few dozens of capture sessions
+static const NSUInteger kSCManagedFrameHealthCheckerTaskStoreBudgetBytes = 64 * 1024;
+// Sessions that are never reported, e.g. cancelled captures, are dropped after this long
+static const NSTimeInterval kSCManagedFrameHealthCheckerTaskTimeToLive = 120;
+// Rough cost of a metadata or video property entry, keys and boxed values included
+static const NSUInteger kSCManagedFrameHealthCheckerEstimatedEntryBytes = 64;
 
 typedef NS_ENUM(NSUInteger, SCManagedFrameHealthCheckType) {
     SCManagedFrameHealthCheck_ImageCapture = 0,
@@ -48,25 +56,34 @@ typedef NS_ENUM(NSUInteger, SCManagedFrameHealthCheckErrorType) {
     SCManagedFrameHealthCheckError_Execution_Error,
 };
 
-typedef struct {
-    float R;
-    float G;
-    float B;
-    float A;
-} FloatRGBA;
-
 @class SCManagedFrameHealthCheckerTask;
 typedef NSMutableDictionary * (^sc_managed_frame_checker_block)(SCManagedFrameHealthCheckerTask *task);
 
-float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger bufferLength)
+// Describes the luma plane of a 420YpCbCr8BiPlanar pixel buffer, or a BGRA pixel buffer, whose base address is locked.
+static BOOL SCFrameHealthImageFromLockedPixelBuffer(CVPixelBufferRef pixelBuffer, SC::FrameHealthImage *image)
 {
-    float sum = 0;
-    float colorArray[bufferLength];
-    // Convert to float for DSP registerator
-    vDSP_vfltu8(data, stripLength, colorArray, 1, bufferLength);
-    // Calculate sum of color element
-    vDSP_sve(colorArray, 1, &sum, bufferLength);
-    return sum;
+    OSType pixelFormat = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    switch (pixelFormat) {
+    case kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange:
+    case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
+        image->data = (const uint8_t *)CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+        image->width = CVPixelBufferGetWidthOfPlane(pixelBuffer, 0);
+        image->height = CVPixelBufferGetHeightOfPlane(pixelBuffer, 0);
+        image->bytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+        image->format = SC::FrameHealthPixelFormat::Luma;
+        image->lumaVideoRange = pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
+        return image->data != NULL;
+    case kCVPixelFormatType_32BGRA:
+        image->data = (const uint8_t *)CVPixelBufferGetBaseAddress(pixelBuffer);
+        image->width = CVPixelBufferGetWidth(pixelBuffer);
+        image->height = CVPixelBufferGetHeight(pixelBuffer);
+        image->bytesPerRow = CVPixelBufferGetBytesPerRow(pixelBuffer);
+        image->format = SC::FrameHealthPixelFormat::BGRA;
+        image->lumaVideoRange = false;
+        return image->data != NULL;
+    default:
+        return NO;
+    }
 }
 
 @interface SCManagedFrameHealthCheckerTask : NSObject
@@ -74,10 +91,14 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
 @property (nonatomic, assign) SCManagedFrameHealthCheckType type;
 @property (nonatomic, strong) id targetObject;
 @property (nonatomic, assign) CGSize sourceImageSize;
-@property (nonatomic, strong) UIImage *unifiedImage;
+// Tasks are sampled as soon as they are added, only the statistics are kept until the report
+@property (nonatomic, assign) BOOL hasSampledStatistics;
+@property (nonatomic, assign) SC::FrameHealthStatistics sampledStatistics;
 @property (nonatomic, strong) NSDictionary *metadata;
 @property (nonatomic, strong) NSDictionary *videoProperties;
 @property (nonatomic, assign) SCManagedFrameHealthCheckErrorType errorType;
+// Bytes accounted for this task by the task store
+@property (nonatomic, assign) NSUInteger storedBytes;
 
 + (SCManagedFrameHealthCheckerTask *)taskWithType:(SCManagedFrameHealthCheckType)type
                                      targetObject:(id)targetObject
@@ -88,6 +109,8 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
                                      targetObject:(id)targetObject
                                          metadata:(NSDictionary *)metadata;
 
+- (NSUInteger)estimatedBytes;
+
 @end
 
 @implementation SCManagedFrameHealthCheckerTask
@@ -112,6 +135,12 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
     return task;
 }
 
+- (NSUInteger)estimatedBytes
+{
+    return class_getInstanceSize([self class]) +
+           kSCManagedFrameHealthCheckerEstimatedEntryBytes * (self.metadata.count + self.videoProperties.count);
+}
+
 - (NSString *)textForSnapType
 {
     switch (self.type) {
@@ -162,12 +191,138 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
 
 @end
 
+@interface SCManagedFrameHealthCheckerSession : NSObject
+
+@property (nonatomic, strong, readonly) NSMutableArray<SCManagedFrameHealthCheckerTask *> *tasks;
+@property (nonatomic, assign) NSUInteger bytes;
+@property (nonatomic, assign) CFTimeInterval lastUpdateTime;
+
+@end
+
+@implementation SCManagedFrameHealthCheckerSession
+
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _tasks = [NSMutableArray array];
+    }
+    return self;
+}
+
+@end
+
+/*
+ Pending tasks grouped by capture session, with a hard byte budget. When the budget is exceeded, the least recently
+    updated sessions are evicted, and sessions that haven't been updated for the time to live are expired. Not thread
+    safe, only accessed on the checker queue.
+ */
+@interface SCManagedFrameHealthCheckerTaskStore : NSObject
+
+@property (nonatomic, assign, readonly) NSUInteger bytes;
+@property (nonatomic, assign, readonly) NSUInteger peakBytes;
+@property (nonatomic, assign, readonly) NSUInteger evictedSessionsCount;
+@property (nonatomic, assign, readonly) NSUInteger expiredSessionsCount;
+
+- (instancetype)initWithBudgetBytes:(NSUInteger)budgetBytes timeToLive:(NSTimeInterval)timeToLive;
+
+- (void)addTask:(SCManagedFrameHealthCheckerTask *)task forCaptureSessionID:(NSString *)captureSessionID;
+- (NSArray<SCManagedFrameHealthCheckerTask *> *)removeTasksForCaptureSessionID:(NSString *)captureSessionID;
+// Returns the time until the oldest remaining session expires, negative if no session remains
+- (NSTimeInterval)removeExpiredSessions;
+
+@end
+
+@implementation SCManagedFrameHealthCheckerTaskStore {
+    NSUInteger _budgetBytes;
+    NSTimeInterval _timeToLive;
+    NSMutableDictionary<NSString *, SCManagedFrameHealthCheckerSession *> *_sessions;
+    // Least recently updated first
+    NSMutableArray<NSString *> *_captureSessionIDs;
+}
+
+- (instancetype)initWithBudgetBytes:(NSUInteger)budgetBytes timeToLive:(NSTimeInterval)timeToLive
+{
+    if (self = [super init]) {
+        _budgetBytes = budgetBytes;
+        _timeToLive = timeToLive;
+        _sessions = [NSMutableDictionary dictionary];
+        _captureSessionIDs = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)addTask:(SCManagedFrameHealthCheckerTask *)newTask forCaptureSessionID:(NSString *)captureSessionID
+{
+    SCManagedFrameHealthCheckerSession *session = _sessions[captureSessionID];
+    if (session) {
+        [_captureSessionIDs removeObject:captureSessionID];
+    } else {
+        session = [[SCManagedFrameHealthCheckerSession alloc] init];
+        _sessions[captureSessionID] = session;
+    }
+    [_captureSessionIDs addObject:captureSessionID];
+    session.lastUpdateTime = CACurrentMediaTime();
+
+    // Remove previous same type task, avoid meaningless task,
+    // for example repeat click "Send Button" and then "Back button"
+    // will produce a lot of PRE_TRANSCODING and POST_TRANSCODING
+    for (SCManagedFrameHealthCheckerTask *task in session.tasks) {
+        if (task.type == newTask.type) {
+            session.bytes -= task.storedBytes;
+            _bytes -= task.storedBytes;
+            [session.tasks removeObject:task];
+            break;
+        }
+    }
+    newTask.storedBytes = [newTask estimatedBytes];
+    [session.tasks addObject:newTask];
+    session.bytes += newTask.storedBytes;
+    _bytes += newTask.storedBytes;
+    _peakBytes = MAX(_peakBytes, _bytes);
+
+    // Never evict the session being updated, it is the most likely one to be reported next
+    while (_bytes > _budgetBytes && _captureSessionIDs.count > 1) {
+        NSString *evictedCaptureSessionID = _captureSessionIDs.firstObject;
+        SCLogCoreCameraWarning(@"[FrameHealthChecker] task store is over budget:%lu, evicted captureSessionID:%@",
+                               (unsigned long)_bytes, evictedCaptureSessionID);
+        [self removeTasksForCaptureSessionID:evictedCaptureSessionID];
+        _evictedSessionsCount++;
+    }
+}
+
+- (NSArray<SCManagedFrameHealthCheckerTask *> *)removeTasksForCaptureSessionID:(NSString *)captureSessionID
+{
+    SCManagedFrameHealthCheckerSession *session = _sessions[captureSessionID];
+    SC_GUARD_ELSE_RETURN_VALUE(session, nil);
+    _bytes -= session.bytes;
+    [_sessions removeObjectForKey:captureSessionID];
+    [_captureSessionIDs removeObject:captureSessionID];
+    return session.tasks;
+}
+
+- (NSTimeInterval)removeExpiredSessions
+{
+    CFTimeInterval now = CACurrentMediaTime();
+    while (_captureSessionIDs.count > 0) {
+        NSString *captureSessionID = _captureSessionIDs.firstObject;
+        NSTimeInterval timeToExpiration = _sessions[captureSessionID].lastUpdateTime + _timeToLive - now;
+        if (timeToExpiration > 0) {
+            return timeToExpiration;
+        }
+        SCLogCoreCameraInfo(@"[FrameHealthChecker] expired captureSessionID:%@", captureSessionID);
+        [self removeTasksForCaptureSessionID:captureSessionID];
+        _expiredSessionsCount++;
+    }
+    return -1;
+}
+
+@end
+
 @interface SCManagedFrameHealthChecker () {
-    id<SCPerforming> _performer;
-    // Dictionary structure
-    // Key   - NSString, captureSessionID
-    // Value - NSMutableArray<SCManagedFrameHealthCheckerTask>
-    NSMutableDictionary *_frameCheckTasks;
+    SCQueuePerformer *_performer;
+    SCManagedFrameHealthCheckerTaskStore *_taskStore;
+    // Only accessed on _performer
+    BOOL _expirationSweepScheduled;
 }
 
 @end
@@ -194,7 +349,9 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
                                             qualityOfService:QOS_CLASS_UTILITY
                                                    queueType:DISPATCH_QUEUE_SERIAL
                                                      context:SCQueuePerformerContextCamera];
-        _frameCheckTasks = [NSMutableDictionary dictionary];
+        _taskStore = [[SCManagedFrameHealthCheckerTaskStore alloc]
+            initWithBudgetBytes:kSCManagedFrameHealthCheckerTaskStoreBudgetBytes
+                     timeToLive:kSCManagedFrameHealthCheckerTaskTimeToLive];
     }
     return self;
 }
@@ -388,6 +545,24 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
     [self _addTask:task withCaptureSessionID:captureSessionID];
 }
 
+- (void)checkVideoHealthForCaptureFramePixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                          metedata:(NSDictionary *)metadata
+                                  captureSessionID:(NSString *)captureSessionID
+{
+    SCTraceODPCompatibleStart(2);
+    if (captureSessionID.length == 0) {
+        SCLogCoreCameraError(@"[FrameHealthChecker] #VIDEO:CAPTURE - captureSessionID shouldn't be empty");
+        return;
+    }
+    SC_GUARD_ELSE_RETURN(pixelBuffer);
+    // The pixel buffer is retained by the task until it is sampled on the checker queue
+    SCManagedFrameHealthCheckerTask *task =
+        [SCManagedFrameHealthCheckerTask taskWithType:SCManagedFrameHealthCheck_VideoCapture
+                                         targetObject:(__bridge id)pixelBuffer
+                                             metadata:metadata];
+    [self _addTask:task withCaptureSessionID:captureSessionID];
+}
+
 - (void)checkVideoHealthForOverlayImage:(UIImage *)image
                                metedata:(NSDictionary *)metadata
                        captureSessionID:(NSString *)captureSessionID
@@ -478,83 +653,61 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
     }
     [_performer perform:^{
         SCTraceODPCompatibleStart(2);
-
-        CFTimeInterval beforeScaling = CACurrentMediaTime();
-        if (newTask.targetObject) {
-            if ([newTask.targetObject isKindOfClass:[UIImage class]]) {
-                UIImage *sourceImage = (UIImage *)newTask.targetObject;
-                newTask.unifiedImage = [self _unifyImage:sourceImage];
-                newTask.sourceImageSize = sourceImage.size;
-            } else if ([newTask.targetObject isKindOfClass:[NSData class]]) {
-                UIImage *sourceImage = [UIImage sc_imageWithData:newTask.targetObject];
-                CFTimeInterval betweenDecodingAndScaling = CACurrentMediaTime();
-                SCLogCoreCameraInfo(@"[FrameHealthChecker] #Image decoding delay: %f",
-                                    betweenDecodingAndScaling - beforeScaling);
-                beforeScaling = betweenDecodingAndScaling;
-                newTask.unifiedImage = [self _unifyImage:sourceImage];
-                newTask.sourceImageSize = sourceImage.size;
-            } else {
-                SCLogCoreCameraError(@"[FrameHealthChecker] Invalid targetObject class:%@",
-                                     NSStringFromClass([newTask.targetObject class]));
-            }
-            newTask.targetObject = nil;
+        // Check the free memory before decoding or scaling anything, if it is too low, drop this task
+        double memFree = [SCLogger memoryFreeMB];
+        if (memFree < kSCManagedFrameHealthCheckerMinFreeMemMB) {
+            SCLogCoreCameraWarning(
+                @"[FrameHealthChecker] mem_free:%f is too low, dropped #%@:%@ task for captureSessionID:%@", memFree,
+                [newTask textForSnapType], [newTask textForSource], captureSessionID);
+            return;
         }
-        SCLogCoreCameraInfo(@"[FrameHealthChecker] #Scale image delay: %f", CACurrentMediaTime() - beforeScaling);
 
-        NSMutableArray *taskQueue = _frameCheckTasks[captureSessionID];
-        if (!taskQueue) {
-            taskQueue = [NSMutableArray array];
-            _frameCheckTasks[captureSessionID] = taskQueue;
-        }
-        // Remove previous same type task, avoid meaningless task,
-        // for example repeat click "Send Button" and then "Back button"
-        // will produce a lot of PRE_TRANSCODING and POST_TRANSCODING
-        for (SCManagedFrameHealthCheckerTask *task in taskQueue) {
-            if (task.type == newTask.type) {
-                [taskQueue removeObject:task];
-                break;
-            }
-        }
+        [self _sampleTask:newTask];
 
-        [taskQueue addObject:newTask];
+        [_taskStore addTask:newTask forCaptureSessionID:captureSessionID];
+        // Orphaned sessions which are never reported are expired by the time to live
+        [self _scheduleExpirationSweepAfter:kSCManagedFrameHealthCheckerTaskTimeToLive];
     }];
 }
 
+- (void)_scheduleExpirationSweepAfter:(NSTimeInterval)delay
+{
+    SCAssertPerformer(_performer);
+    SC_GUARD_ELSE_RETURN(!_expirationSweepScheduled);
+    _expirationSweepScheduled = YES;
+    [_performer perform:^{
+        _expirationSweepScheduled = NO;
+        // Sessions updated since the sweep was scheduled are still alive, sweep again when the oldest one expires
+        NSTimeInterval timeToNextExpiration = [_taskStore removeExpiredSessions];
+        if (timeToNextExpiration >= 0) {
+            [self _scheduleExpirationSweepAfter:timeToNextExpiration];
+        }
+    }
+                  after:delay];
+}
+
 - (void)_asynchronouslyCheckForCaptureSessionID:(NSString *)captureSessionID
 {
     SCTraceODPCompatibleStart(2);
     [_performer perform:^{
         SCTraceODPCompatibleStart(2);
-        NSMutableArray *tasksQueue = _frameCheckTasks[captureSessionID];
-        if (!tasksQueue) {
+        NSArray<SCManagedFrameHealthCheckerTask *> *tasks =
+            [_taskStore removeTasksForCaptureSessionID:captureSessionID];
+        if (!tasks) {
             return;
         }
 
-        // Check the free memory, if it is too low, drop these tasks
-        double memFree = [SCLogger memoryFreeMB];
-        if (memFree < kSCManagedFrameHealthCheckerMinFreeMemMB) {
-            SCLogCoreCameraWarning(
-                @"[FrameHealthChecker] mem_free:%f is too low, dropped checking tasks for captureSessionID:%@", memFree,
-                captureSessionID);
-            [_frameCheckTasks removeObjectForKey:captureSessionID];
-            return;
-        }
-
-        __block NSMutableArray *frameHealthInfoArray = [NSMutableArray array];
-        // Execute all tasks and wait for complete
-        [tasksQueue enumerateObjectsUsingBlock:^(id _Nonnull obj, NSUInteger idx, BOOL *_Nonnull stop) {
-            SCManagedFrameHealthCheckerTask *task = (SCManagedFrameHealthCheckerTask *)obj;
-            NSMutableDictionary *frameHealthInfo;
-            UIImage *image = task.unifiedImage;
-
-            if (image) {
+        NSMutableArray *frameHealthInfoArray = [NSMutableArray array];
+        for (SCManagedFrameHealthCheckerTask *task in tasks) {
+            NSMutableDictionary *frameHealthInfo = [NSMutableDictionary dictionary];
+            if (task.hasSampledStatistics) {
                 // Get frame health info
-                frameHealthInfo = [self _getFrameHealthInfoForImage:image
-                                                             source:[task textForSource]
-                                                           snapType:[task textForSnapType]
-                                                           metadata:task.metadata
-                                                    sourceImageSize:task.sourceImageSize
-                                                   captureSessionID:captureSessionID];
+                [self _addStatistics:task.sampledStatistics
+                         toParameters:frameHealthInfo
+                               source:[task textForSource]
+                             snapType:[task textForSnapType]
+                      sourceImageSize:task.sourceImageSize
+                     captureSessionID:captureSessionID];
                 NSNumber *isPossibleBlackNum = frameHealthInfo[@"is_possible_black"];
                 NSNumber *isTotallyBlackNum = frameHealthInfo[@"is_total_black"];
                 NSNumber *hasExecutionError = frameHealthInfo[@"execution_error"];
@@ -565,26 +718,26 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
                 } else if ([hasExecutionError boolValue]) {
                     task.errorType = SCManagedFrameHealthCheckError_Execution_Error;
                 }
-            } else {
-                frameHealthInfo = [NSMutableDictionary dictionary];
-                task.errorType = SCManagedFrameHealthCheckError_Invalid_Bitmap;
+            } else if (task.errorType == SCManagedFrameHealthCheckError_Execution_Error) {
+                frameHealthInfo[@"execution_error"] = @(YES);
+                frameHealthInfo[@"sample_size"] = @(0);
             }
 
-            if (frameHealthInfo) {
-                frameHealthInfo[@"frame_source"] = [task textForSource];
-                frameHealthInfo[@"snap_type"] = [task textForSnapType];
-                frameHealthInfo[@"error_type"] = [task textForErrorType];
-                frameHealthInfo[@"capture_session_id"] = captureSessionID;
-                frameHealthInfo[@"metadata"] = task.metadata;
-                if (task.videoProperties.count > 0) {
-                    [frameHealthInfo addEntriesFromDictionary:task.videoProperties];
-                }
-                [frameHealthInfoArray addObject:frameHealthInfo];
+            frameHealthInfo[@"frame_source"] = [task textForSource];
+            frameHealthInfo[@"snap_type"] = [task textForSnapType];
+            frameHealthInfo[@"error_type"] = [task textForErrorType];
+            frameHealthInfo[@"capture_session_id"] = captureSessionID;
+            frameHealthInfo[@"metadata"] = task.metadata;
+            if (task.videoProperties.count > 0) {
+                [frameHealthInfo addEntriesFromDictionary:task.videoProperties];
             }
-
-            // Release the image as soon as possible to mitigate the memory pressure
-            task.unifiedImage = nil;
-        }];
+            // Footprint of the pending tasks, to keep an eye on the store budget
+            frameHealthInfo[@"task_store_bytes"] = @(_taskStore.bytes);
+            frameHealthInfo[@"task_store_peak_bytes"] = @(_taskStore.peakBytes);
+            frameHealthInfo[@"task_store_evicted_sessions"] = @(_taskStore.evictedSessionsCount);
+            frameHealthInfo[@"task_store_expired_sessions"] = @(_taskStore.expiredSessionsCount);
+            [frameHealthInfoArray addObject:frameHealthInfo];
+        }
 
         for (NSDictionary *frameHealthInfo in frameHealthInfoArray) {
             if ([frameHealthInfo[@"is_total_black"] boolValue] || [frameHealthInfo[@"is_possible_black"] boolValue]) {
@@ -600,110 +753,145 @@ float vDspColorElementSum(const Byte *data, NSInteger stripLength, NSInteger buf
                                                      secretParameters:nil
                                                               metrics:nil];
         }
-
-        [_frameCheckTasks removeObjectForKey:captureSessionID];
     }];
 }
 
-- (NSMutableDictionary *)_getFrameHealthInfoForImage:(UIImage *)image
-                                              source:(NSString *)source
-                                            snapType:(NSString *)snapType
-                                            metadata:(NSDictionary *)metadata
-                                     sourceImageSize:(CGSize)sourceImageSize
-                                    captureSessionID:(NSString *)captureSessionID
+/// Samples the target object of the task and releases it, so that only the statistics are kept until the report.
+- (void)_sampleTask:(SCManagedFrameHealthCheckerTask *)task
+{
+    SCTraceODPCompatibleStart(2);
+    id targetObject = task.targetObject;
+    task.targetObject = nil;
+    if (!targetObject) {
+        task.errorType = SCManagedFrameHealthCheckError_Invalid_Bitmap;
+        return;
+    }
+
+    CFTimeInterval beforeScaling = CACurrentMediaTime();
+    UIImage *unifiedImage = nil;
+    if ([targetObject isKindOfClass:[UIImage class]]) {
+        UIImage *sourceImage = (UIImage *)targetObject;
+        unifiedImage = [self _unifyImage:sourceImage];
+        task.sourceImageSize = sourceImage.size;
+    } else if ([targetObject isKindOfClass:[NSData class]]) {
+        UIImage *sourceImage = [UIImage sc_imageWithData:targetObject];
+        CFTimeInterval betweenDecodingAndScaling = CACurrentMediaTime();
+        SCLogCoreCameraInfo(@"[FrameHealthChecker] #Image decoding delay: %f",
+                            betweenDecodingAndScaling - beforeScaling);
+        beforeScaling = betweenDecodingAndScaling;
+        unifiedImage = [self _unifyImage:sourceImage];
+        task.sourceImageSize = sourceImage.size;
+    } else if (CFGetTypeID((__bridge CFTypeRef)targetObject) == CVPixelBufferGetTypeID()) {
+        // Sample the pixel buffer in place, so it goes back to its pool without being converted and rescaled to an
+        // image first.
+        CVPixelBufferRef pixelBuffer = (__bridge CVPixelBufferRef)targetObject;
+        task.sourceImageSize = CGSizeMake(CVPixelBufferGetWidth(pixelBuffer), CVPixelBufferGetHeight(pixelBuffer));
+        [self _sampleTask:task pixelBuffer:pixelBuffer];
+        return;
+    } else {
+        SCLogCoreCameraError(@"[FrameHealthChecker] Invalid targetObject class:%@",
+                             NSStringFromClass([targetObject class]));
+    }
+    SCLogCoreCameraInfo(@"[FrameHealthChecker] #Scale image delay: %f", CACurrentMediaTime() - beforeScaling);
+
+    if (unifiedImage) {
+        [self _sampleTask:task image:unifiedImage];
+    } else {
+        task.errorType = SCManagedFrameHealthCheckError_Invalid_Bitmap;
+    }
+}
+
+- (void)_sampleTask:(SCManagedFrameHealthCheckerTask *)task pixelBuffer:(CVPixelBufferRef)pixelBuffer
+{
+    SCTraceODPCompatibleStart(2);
+    CFTimeInterval start = CACurrentMediaTime();
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    SC::FrameHealthImage image;
+    if (SCFrameHealthImageFromLockedPixelBuffer(pixelBuffer, &image)) {
+        task.sampledStatistics = SC::FrameHealthSample(image, kSCManagedFrameHealthCheckerMaxSamples);
+        task.hasSampledStatistics = YES;
+    } else {
+        SCLogCoreCameraError(@"[FrameHealthChecker] #%@:%@ - unsupported pixel format:%u", [task textForSnapType],
+                             [task textForSource], (unsigned)CVPixelBufferGetPixelFormatType(pixelBuffer));
+        task.errorType = SCManagedFrameHealthCheckError_Invalid_Bitmap;
+    }
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    SCLogCoreCameraInfo(@"[FrameHealthChecker] #%@:%@ - SAMPLE_DATA_TIME:%f", [task textForSnapType],
+                        [task textForSource], CACurrentMediaTime() - start);
+}
+
+- (void)_sampleTask:(SCManagedFrameHealthCheckerTask *)task image:(UIImage *)image
 {
     SCTraceODPCompatibleStart(2);
-    NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
-    size_t samplesCount = 0;
     CFTimeInterval start = CACurrentMediaTime();
     CGImageRef imageRef = image.CGImage;
-    size_t imageWidth = CGImageGetWidth(imageRef);
-    size_t imageHeight = CGImageGetHeight(imageRef);
     CFDataRef pixelData = CGDataProviderCopyData(CGImageGetDataProvider(imageRef));
     CFTimeInterval getImageDataTime = CACurrentMediaTime();
+    if (pixelData && CGImageGetBitsPerPixel(imageRef) == 32) {
+        CGBitmapInfo bitmapInfo = CGImageGetBitmapInfo(imageRef);
+        SC::FrameHealthImage sampledImage;
+        sampledImage.data = CFDataGetBytePtr(pixelData);
+        sampledImage.width = CGImageGetWidth(imageRef);
+        sampledImage.height = CGImageGetHeight(imageRef);
+        sampledImage.bytesPerRow = CGImageGetBytesPerRow(imageRef);
+        // TODO. support other types beside RGBA
+        sampledImage.format = (bitmapInfo & kCGImageAlphaPremultipliedFirst) && (bitmapInfo & kCGImageByteOrder32Little)
+                                  ? SC::FrameHealthPixelFormat::BGRA
+                                  : SC::FrameHealthPixelFormat::RGBA;
+        sampledImage.lumaVideoRange = false;
+        task.sampledStatistics = SC::FrameHealthSample(sampledImage, kSCManagedFrameHealthCheckerMaxSamples);
+        task.hasSampledStatistics = YES;
+    } else {
+        SCLogCoreCameraError(@"[FrameHealthChecker] #%@:%@ - pixelData is nil or not 32 bits per pixel!",
+                             [task textForSnapType], [task textForSource]);
+        task.errorType = SCManagedFrameHealthCheckError_Execution_Error;
+    }
     if (pixelData) {
-        const Byte *imageData = CFDataGetBytePtr(pixelData);
-        NSInteger stripLength = 0;
-        NSInteger bufferLength = 0;
-        NSInteger imagePixels = imageWidth * imageHeight;
-        // Limit the max sampled frames
-        if (imagePixels > kSCManagedFrameHealthCheckerMaxSamples) {
-            stripLength = imagePixels / kSCManagedFrameHealthCheckerMaxSamples * 4;
-            bufferLength = kSCManagedFrameHealthCheckerMaxSamples;
-        } else {
-            stripLength = 4;
-            bufferLength = imagePixels;
-        }
-        samplesCount = bufferLength;
-
-        // Avoid dividing by zero
-        if (samplesCount != 0) {
-            FloatRGBA sumRGBA = [self _getSumRGBAFromData:imageData
-                                              stripLength:stripLength
-                                             bufferLength:bufferLength
-                                               bitmapInfo:CGImageGetBitmapInfo(imageRef)];
-            float averageR = sumRGBA.R / samplesCount;
-            float averageG = sumRGBA.G / samplesCount;
-            float averageB = sumRGBA.B / samplesCount;
-            float averageA = sumRGBA.A / samplesCount;
-            parameters[@"average_sampled_rgba_r"] = @(averageR);
-            parameters[@"average_sampled_rgba_g"] = @(averageG);
-            parameters[@"average_sampled_rgba_b"] = @(averageB);
-            parameters[@"average_sampled_rgba_a"] = @(averageA);
-            parameters[@"origin_frame_width"] = @(sourceImageSize.width);
-            parameters[@"origin_frame_height"] = @(sourceImageSize.height);
-            // Also report possible black to identify the intentional black snap by covering camera.
-            // Normally, the averageA very near 255, but for video overlay image, it is very small.
-            // So we use averageA > 250 to avoid considing video overlay image as possible black.
-            if (averageA > 250 && averageR < kSCManagedFrameHealthCheckerPossibleBlackThreshold &&
-                averageG < kSCManagedFrameHealthCheckerPossibleBlackThreshold &&
-                averageB < kSCManagedFrameHealthCheckerPossibleBlackThreshold) {
-                parameters[@"is_possible_black"] = @(YES);
-                // Use this parameters for BigQuery conditions in Grafana
-                if (averageR == 0 && averageG == 0 && averageB == 0) {
-                    parameters[@"is_total_black"] = @(YES);
-                }
-            }
-        } else {
-            SCLogCoreCameraError(@"[FrameHealthChecker] #%@:%@ - samplesCount is zero! captureSessionID:%@", snapType,
-                                 source, captureSessionID);
-            parameters[@"execution_error"] = @(YES);
-        }
         CFRelease(pixelData);
-    } else {
-        SCLogCoreCameraError(@"[FrameHealthChecker] #%@:%@ - pixelData is nil! captureSessionID:%@", snapType, source,
-                             captureSessionID);
-        parameters[@"execution_error"] = @(YES);
     }
-    parameters[@"sample_size"] = @(samplesCount);
 
     CFTimeInterval end = CACurrentMediaTime();
     SCLogCoreCameraInfo(@"[FrameHealthChecker] #%@:%@ - GET_IMAGE_DATA_TIME:%f SAMPLE_DATA_TIME:%f TOTAL_TIME:%f",
-                        snapType, source, getImageDataTime - start, end - getImageDataTime, end - start);
-    return parameters;
+                        [task textForSnapType], [task textForSource], getImageDataTime - start, end - getImageDataTime,
+                        end - start);
 }
 
-- (FloatRGBA)_getSumRGBAFromData:(const Byte *)imageData
-                     stripLength:(NSInteger)stripLength
-                    bufferLength:(NSInteger)bufferLength
-                      bitmapInfo:(CGBitmapInfo)bitmapInfo
+- (void)_addStatistics:(const SC::FrameHealthStatistics &)statistics
+          toParameters:(NSMutableDictionary *)parameters
+                source:(NSString *)source
+              snapType:(NSString *)snapType
+       sourceImageSize:(CGSize)sourceImageSize
+      captureSessionID:(NSString *)captureSessionID
 {
     SCTraceODPCompatibleStart(2);
-    FloatRGBA sumRGBA;
-    if ((bitmapInfo & kCGImageAlphaPremultipliedFirst) && (bitmapInfo & kCGImageByteOrder32Little)) {
-        // BGRA
-        sumRGBA.B = vDspColorElementSum(imageData, stripLength, bufferLength);
-        sumRGBA.G = vDspColorElementSum(imageData + 1, stripLength, bufferLength);
-        sumRGBA.R = vDspColorElementSum(imageData + 2, stripLength, bufferLength);
-        sumRGBA.A = vDspColorElementSum(imageData + 3, stripLength, bufferLength);
-    } else {
-        // TODO. support other types beside RGBA
-        sumRGBA.R = vDspColorElementSum(imageData, stripLength, bufferLength);
-        sumRGBA.G = vDspColorElementSum(imageData + 1, stripLength, bufferLength);
-        sumRGBA.B = vDspColorElementSum(imageData + 2, stripLength, bufferLength);
-        sumRGBA.A = vDspColorElementSum(imageData + 3, stripLength, bufferLength);
+    parameters[@"sample_size"] = @(statistics.sampleCount);
+    // Avoid dividing by zero
+    if (statistics.sampleCount == 0) {
+        SCLogCoreCameraError(@"[FrameHealthChecker] #%@:%@ - samplesCount is zero! captureSessionID:%@", snapType,
+                             source, captureSessionID);
+        parameters[@"execution_error"] = @(YES);
+        return;
+    }
+    // Luma samples report their full range luma as an opaque gray, to keep the fields the dashboards are built on
+    parameters[@"average_sampled_rgba_r"] = @(statistics.averageR);
+    parameters[@"average_sampled_rgba_g"] = @(statistics.averageG);
+    parameters[@"average_sampled_rgba_b"] = @(statistics.averageB);
+    parameters[@"average_sampled_rgba_a"] = @(statistics.averageA);
+    parameters[@"origin_frame_width"] = @(sourceImageSize.width);
+    parameters[@"origin_frame_height"] = @(sourceImageSize.height);
+    // Also report possible black to identify the intentional black snap by covering camera.
+    switch (SC::FrameHealthClassify(statistics, kSCManagedFrameHealthCheckerPossibleBlackThreshold)) {
+    case SC::FrameHealthClassification::TotallyBlack:
+        // Use this parameters for BigQuery conditions in Grafana
+        parameters[@"is_total_black"] = @(YES);
+        parameters[@"is_possible_black"] = @(YES);
+        break;
+    case SC::FrameHealthClassification::PossiblyBlack:
+        parameters[@"is_possible_black"] = @(YES);
+        break;
+    case SC::FrameHealthClassification::Healthy:
+        break;
     }
-    return sumRGBA;
 }
 
 @end
@@ -12,17 +12,21 @@
 #import "SCAudioCaptureSession.h"
 #import "SCCameraTweaks.h"
 #import "SCCapturerBufferedVideoWriter.h"
+#import "SCCapturerPreRollBuffer.h"
 #import "SCCoreCameraLogger.h"
+#import "SCHotPathTrace.h"
 #import "SCLogger+Camera.h"
 #import "SCManagedCapturer.h"
 #import "SCManagedFrameHealthChecker.h"
 #import "SCManagedVideoCapturerLogger.h"
+#import "SCManagedVideoCapturerPreparation.h"
 #import "SCManagedVideoCapturerTimeObserver.h"
 
 #import <SCAudio/SCAudioSession.h>
 #import <SCAudio/SCMutableAudioSession.h>
 #import <SCBase/SCMacros.h>
 #import <SCCameraFoundation/SCManagedAudioDataSourceListenerAnnouncer.h>
+#import <SCFoundation/SCAppEnvironment.h>
 #import <SCFoundation/SCAssertWrapper.h>
 #import <SCFoundation/SCCoreGraphicsUtils.h>
 #import <SCFoundation/SCDeviceName.h>
@@ -81,6 +85,7 @@ static NSInteger const kSCManagedVideoCapturerCannotAddAudioVideoInput = 1001;
 static NSInteger const kSCManagedVideoCapturerEmptyFrame = 1002;
 static NSInteger const kSCManagedVideoCapturerStopBeforeStart = 1003;
 static NSInteger const kSCManagedVideoCapturerStopWithoutStart = 1004;
+static NSInteger const kSCManagedVideoCapturerPreparationTimedOut = 1005;
 static NSInteger const kSCManagedVideoCapturerZeroVideoSize = -111;
 
 static NSUInteger const kSCVideoContentComplexitySamplingRate = 90;
@@ -90,6 +95,20 @@ static NSUInteger const kSCVideoContentComplexitySamplingRate = 90;
 // @30 fps this is 0.66 seconds
 static NSTimeInterval const kSCManagedVideoCapturerStopRecordingDeadline = 1.0;
 
+// Recording goes ahead once the audio session preparation takes longer than this, starting the audio queue retries
+// the audio session on its own if it is still not ready by then
+static NSTimeInterval const kSCManagedVideoCapturerPreparationDeadline = 2.0;
+
+// Frames received while recording waits on its preparation are held and written first, at 30fps this is 0.1 seconds.
+// Kept short since every held frame is a capture pool buffer the camera can't reuse.
+static NSUInteger const kSCManagedVideoCapturerMaxPendingVideoFrames = 3;
+
+// With the pre-roll on, frames are held from the record press on, and the recording is written from the press.
+// A few frames more than without it, and a second of audio buffers, within a budget of about ten 1080p frames.
+static NSUInteger const kSCManagedVideoCapturerMaxPreRollVideoFrames = 5;
+static NSUInteger const kSCManagedVideoCapturerMaxPreRollAudioBuffers = 5;
+static size_t const kSCManagedVideoCapturerMaxPreRollBytes = 32 * 1024 * 1024;
+
 static const char *SCPlaceholderImageGenerationQueueLabel = "com.snapchat.video-capturer-placeholder-queue";
 
 static const char *SCVideoRecordingPreparationQueueLabel = "com.snapchat.video-recording-preparation-queue";
@@ -132,7 +151,11 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
     SCAudioConfigurationToken *_preparedAudioConfiguration;
     SCAudioConfigurationToken *_audioConfiguration;
 
-    dispatch_semaphore_t _startRecordingSemaphore;
+    SCManagedVideoCapturerPreparation *_preparation;
+    // Sample buffers received while recording waits on its preparation and its first video frame
+    SCCapturerPreRollBuffer *_preRollBuffer;
+    BOOL _preRollEnabled;
+    CMTime _recordRequestTime;
 
     // For store the raw frame datas
     NSInteger _rawDataFrameNum;
@@ -179,7 +202,17 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
         _announcer = [SCManagedAudioDataSourceListenerAnnouncer new];
         self.status = SCManagedVideoCapturerStatusIdle;
         _capturerLogger = [[SCManagedVideoCapturerLogger alloc] init];
-        _startRecordingSemaphore = dispatch_semaphore_create(0);
+        _preRollEnabled = SCCameraTweaksEnableVideoRecordingPreRoll();
+        _preRollBuffer = _preRollEnabled
+                             ? [[SCCapturerPreRollBuffer alloc]
+                                   initWithMaxVideoFrameCount:kSCManagedVideoCapturerMaxPreRollVideoFrames
+                                          maxAudioBufferCount:kSCManagedVideoCapturerMaxPreRollAudioBuffers
+                                             maxRetainedBytes:kSCManagedVideoCapturerMaxPreRollBytes]
+                             : [[SCCapturerPreRollBuffer alloc]
+                                   initWithMaxVideoFrameCount:kSCManagedVideoCapturerMaxPendingVideoFrames
+                                          maxAudioBufferCount:0
+                                             maxRetainedBytes:kSCManagedVideoCapturerMaxPreRollBytes];
+        _recordRequestTime = kCMTimeInvalid;
     }
     return self;
 }
@@ -288,23 +321,33 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
         if (_audioConfiguration) {
             [SCAudioSessionExperimentAdapter relinquishConfiguration:_audioConfiguration performer:nil completion:nil];
         }
-        __block NSError *audioSessionError = nil;
+        // Rather than waiting for the audio session here, which used to hold every other capturer operation,
+        // starting the recording chains on the preparation
+        SCManagedVideoCapturerPreparation *preparation =
+            [[SCManagedVideoCapturerPreparation alloc] initWithPerformer:_performer
+                                                                deadline:kSCManagedVideoCapturerPreparationDeadline];
+        _preparation = preparation;
         _preparedAudioConfiguration = _audioConfiguration =
             [SCAudioSessionExperimentAdapter configureWith:configuration
                                                  performer:[self _getVideoPreparationPerformer]
                                                 completion:^(NSError *error) {
-                                                    audioSessionError = error;
-                                                    if (self.status == SCManagedVideoCapturerStatusPrepareToRecord) {
-                                                        dispatch_semaphore_signal(_startRecordingSemaphore);
-                                                    }
+                                                    [_performer performImmediatelyIfCurrentPerformer:^{
+                                                        [preparation completeWithError:error];
+                                                    }];
                                                 }];
-
-        // Wait until preparation for recording is done
-        dispatch_semaphore_wait(_startRecordingSemaphore, DISPATCH_TIME_FOREVER);
-        [_delegate managedVideoCapturer:self
-                            didGetError:audioSessionError
-                                forType:SCManagedVideoCapturerInfoAudioSessionError
-                                session:self.activeSession];
+        [preparation onComplete:^(NSError *error, BOOL timedOut) {
+            SCLogVideoCapturerInfo(@"Recording preparation completed in %lf seconds, timed out: %d",
+                                   preparation.duration, timedOut);
+            if (timedOut) {
+                error = [NSError errorWithDomain:kSCManagedVideoCapturerErrorDomain
+                                            code:kSCManagedVideoCapturerPreparationTimedOut
+                                        userInfo:nil];
+            }
+            [_delegate managedVideoCapturer:self
+                                didGetError:error
+                                    forType:SCManagedVideoCapturerInfoAudioSessionError
+                                    session:self.activeSession];
+        }];
     }];
 }
 
@@ -326,6 +369,7 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                                     isUniqueEvent:NO];
 
     NSTimeInterval startTime = CACurrentMediaTime();
+    CMTime recordRequestTime = CMTimeMakeWithSeconds(startTime, NSEC_PER_SEC);
     [[SCLogger sharedInstance] logPreCaptureOperationRequestedAt:startTime];
     [[SCCoreCameraLogger sharedInstance] logCameraCreationDelaySplitPointPreCaptureOperationRequested];
     _sessionId = arc4random();
@@ -342,6 +386,7 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
     SCVideoCaptureSessionInfo sessionInfo = self.activeSession;
     [_performer performImmediatelyIfCurrentPerformer:^{
         _maxDuration = maxDuration;
+        _recordRequestTime = recordRequestTime;
         dispatch_block_t startRecordingBlock = ^{
             _rawDataFrameNum = 0;
             // Begin audio recording asynchronously, first, need to have correct audio session.
@@ -350,6 +395,7 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                                    CACurrentMediaTime() - startTime);
             if (self.status != SCManagedVideoCapturerStatusReadyForRecording) {
                 SCLogVideoCapturerInfo(@"SCManagedVideoCapturer status: %lu", (unsigned long)self.status);
+                [_preRollBuffer clear];
                 // We may already released, but this should be OK.
                 [SCAudioSessionExperimentAdapter relinquishConfiguration:_preparedAudioConfiguration
                                                                performer:nil
@@ -360,6 +406,7 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                 SCLogVideoCapturerInfo(
                     @"SCManagedVideoCapturer has mismatched audio session token, prepared: %@, have: %@",
                     _preparedAudioConfiguration.token, _audioConfiguration.token);
+                [_preRollBuffer clear];
                 // We are on a different audio session token already.
                 [SCAudioSessionExperimentAdapter relinquishConfiguration:_preparedAudioConfiguration
                                                                performer:nil
@@ -451,6 +498,7 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                 self.status = SCManagedVideoCapturerStatusError;
                 _lastError = error;
                 _placeholderImage = nil;
+                [_preRollBuffer clear];
                 [_delegate managedVideoCapturer:self
                                     didGetError:error
                                         forType:SCManagedVideoCapturerInfoAssetWriterError
@@ -465,6 +513,7 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                                                  code:kSCManagedVideoCapturerCannotAddAudioVideoInput
                                              userInfo:nil];
                 _placeholderImage = nil;
+                [_preRollBuffer clear];
                 [_delegate managedVideoCapturer:self didFailWithError:_lastError session:sessionInfo];
                 return;
             }
@@ -486,9 +535,16 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                                          uniqueId:_captureSessionID
                                          stepName:@"audio_session_start_begin"];
 
-        if (self.status == SCManagedVideoCapturerStatusPrepareToRecord) {
+        if (self.status == SCManagedVideoCapturerStatusPrepareToRecord && _preparation) {
             self.status = SCManagedVideoCapturerStatusReadyForRecording;
-            startRecordingBlock();
+            // Frames keep flowing, the latest of them are held until recording starts
+            SCManagedVideoCapturerPreparation *preparation = _preparation;
+            [preparation onComplete:^(NSError *error, BOOL timedOut) {
+                [_capturerLogger logStartingStep:kSCCapturerStartingStepRecordingPreparation];
+                // A newer preparation took over, its own start request will begin recording
+                SC_GUARD_ELSE_RETURN(preparation == _preparation);
+                startRecordingBlock();
+            }];
         } else {
             self.status = SCManagedVideoCapturerStatusReadyForRecording;
             if (_audioConfiguration) {
@@ -859,6 +915,13 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
 
 - (void)_cleanup
 {
+    [_preRollBuffer clear];
+    if (_preRollEnabled) {
+        [_capturerLogger logPreRollStatistics:[_preRollBuffer statistics]];
+    }
+    _preparation = nil;
+    _recordRequestTime = kCMTimeInvalid;
+    [_capturerLogger logWriterStagingStatistics:[_videoWriter stagingStatistics]];
     [_videoWriter cleanUp];
     _timeObserver = nil;
 
@@ -929,15 +992,26 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
     [_performer performImmediatelyIfCurrentPerformer:^{
         if (self.status == SCManagedVideoCapturerStatusRecording) {
             // Audio always follows video, there is no other way around this :)
-            if (_hasWritten && CACurrentMediaTime() - _recordStartTime <= _maxDuration) {
-                [self _processAudioSampleBuffer:sampleBuffer];
-                [_videoWriter appendAudioSampleBuffer:sampleBuffer];
+            if (_hasWritten) {
+                [self _writeAudioSampleBuffer:sampleBuffer];
+            } else {
+                // Written after the first video frame, no-op unless the pre-roll is on
+                [_preRollBuffer appendAudioSampleBuffer:sampleBuffer];
             }
         }
         CFRelease(sampleBuffer);
     }];
 }
 
+- (void)_writeAudioSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+    SCAssert([_performer isCurrentPerformer], @"Needs to be on the performing queue");
+    if (CACurrentMediaTime() - _recordStartTime <= _maxDuration) {
+        [self _processAudioSampleBuffer:sampleBuffer];
+        [_videoWriter appendAudioSampleBuffer:sampleBuffer];
+    }
+}
+
 #pragma mark - SCManagedVideoDataSourceListener
 
 - (void)managedVideoDataSource:(id<SCManagedVideoDataSource>)managedVideoDataSource
@@ -945,53 +1019,34 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                 devicePosition:(SCManagedCaptureDevicePosition)devicePosition
 {
     SCTraceStart();
-    if (self.status != SCManagedVideoCapturerStatusRecording) {
-        return;
-    }
+    SC_GUARD_ELSE_RETURN([self _shouldReceiveVideoSampleBufferInStatus:self.status]);
     CFRetain(sampleBuffer);
     [_performer performImmediatelyIfCurrentPerformer:^{
-        // the following check will allow the capture pipeline to drain
-        if (CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer)) > _stopTime) {
+        if (self.status != SCManagedVideoCapturerStatusRecording) {
+            // Frames presented before the record press would only be dropped when the pre-roll is drained
+            if ([self _shouldReceiveVideoSampleBufferInStatus:self.status] &&
+                (!_preRollEnabled ||
+                 CMTimeCompare(CMSampleBufferGetPresentationTimeStamp(sampleBuffer), _recordRequestTime) >= 0)) {
+                [_preRollBuffer appendVideoSampleBuffer:sampleBuffer];
+            }
+        } else if (CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer)) > _stopTime) {
+            // the following check will allow the capture pipeline to drain
             [self _stopRecording];
         } else {
             if (self.status == SCManagedVideoCapturerStatusRecording) {
                 _isFrontFacingCamera = (devicePosition == SCManagedCaptureDevicePositionFront);
-                CMTime presentationTime = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
-                if (CMTIME_IS_VALID(presentationTime)) {
-                    SCLogVideoCapturerInfo(@"Obtained video data source at time %lld", presentationTime.value);
-                } else {
-                    SCLogVideoCapturerInfo(@"Obtained video data source with an invalid time");
-                }
-                if (!_hasWritten) {
-                    // Start writing!
-                    [_videoWriter startWritingAtSourceTime:presentationTime];
-                    [_capturerLogger endLoggingForStarting];
-                    _startSessionTime = presentationTime;
-                    _startSessionRealTime = CACurrentMediaTime();
-                    SCLogVideoCapturerInfo(@"First frame processed %f seconds after presentation Time",
-                                           _startSessionRealTime - CMTimeGetSeconds(presentationTime));
-                    _hasWritten = YES;
-                    [[SCLogger sharedInstance] logPreCaptureOperationFinishedAt:CMTimeGetSeconds(presentationTime)];
-                    [[SCCoreCameraLogger sharedInstance]
-                        logCameraCreationDelaySplitPointPreCaptureOperationFinishedAt:CMTimeGetSeconds(
-                                                                                          presentationTime)];
-                    SCLogVideoCapturerInfo(@"SCVideoCaptureSessionInfo after first frame: %@",
-                                           SCVideoCaptureSessionInfoGetDebugDescription(self.activeSession));
-                }
-                // Only respect video end session time, audio can be cut off, not video,
-                // not video
-                if (CMTIME_IS_INVALID(_endSessionTime)) {
-                    _endSessionTime = presentationTime;
-                } else {
-                    _endSessionTime = CMTimeMaximum(_endSessionTime, presentationTime);
-                }
-                if (CACurrentMediaTime() - _recordStartTime <= _maxDuration) {
-                    [_videoWriter appendVideoSampleBuffer:sampleBuffer];
-                    [self _processVideoSampleBuffer:sampleBuffer];
-                }
-                if (_timeObserver) {
-                    [_timeObserver processTime:CMTimeSubtract(presentationTime, _startSessionTime)
-                        sessionStartTimeDelayInSecond:_startSessionRealTime - CMTimeGetSeconds(_startSessionTime)];
+                BOOL hadWritten = _hasWritten;
+                // With the pre-roll on, the recording is written from the record press
+                [_preRollBuffer drainVideoSampleBuffersFromTime:_preRollEnabled ? _recordRequestTime : kCMTimeInvalid
+                                                        handler:^(CMSampleBufferRef pendingSampleBuffer) {
+                                                            [self _writeVideoSampleBuffer:pendingSampleBuffer];
+                                                        }];
+                [self _writeVideoSampleBuffer:sampleBuffer];
+                if (!hadWritten) {
+                    [_preRollBuffer drainAudioSampleBuffersFromTime:_startSessionTime
+                                                            handler:^(CMSampleBufferRef audioSampleBuffer) {
+                                                                [self _writeAudioSampleBuffer:audioSampleBuffer];
+                                                            }];
                 }
             }
         }
@@ -999,7 +1054,62 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
     }];
 }
 
-- (void)_generatePlaceholderImageWithPixelBuffer:(CVImageBufferRef)pixelBuffer metaData:(NSDictionary *)metadata
+- (BOOL)_shouldReceiveVideoSampleBufferInStatus:(SCManagedVideoCapturerStatus)status
+{
+    // Frames are held from the record press, while recording waits on its preparation
+    return status == SCManagedVideoCapturerStatusRecording || status == SCManagedVideoCapturerStatusReadyForRecording;
+}
+
+- (void)_writeVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+    SCAssert([_performer isCurrentPerformer], @"Needs to be on the performing queue");
+    CMTime presentationTime = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
+    // Every frame is traced, formatting a log per frame is left to debug builds
+    BOOL shouldLog = SCIsDebugBuild();
+    if (CMTIME_IS_VALID(presentationTime)) {
+        SCHotPathTrace1(SCHotPathTraceEventVideoCapturerFrame, presentationTime.value);
+        if (shouldLog) {
+            SCLogVideoCapturerInfo(@"Obtained video data source at time %lld", presentationTime.value);
+        }
+    } else {
+        SCHotPathTrace1(SCHotPathTraceEventVideoCapturerFrameWithInvalidTime, 0);
+        if (shouldLog) {
+            SCLogVideoCapturerInfo(@"Obtained video data source with an invalid time");
+        }
+    }
+    if (!_hasWritten) {
+        // Start writing!
+        [_videoWriter startWritingAtSourceTime:presentationTime];
+        [_capturerLogger endLoggingForStarting];
+        _startSessionTime = presentationTime;
+        _startSessionRealTime = CACurrentMediaTime();
+        SCLogVideoCapturerInfo(@"First frame processed %f seconds after presentation Time",
+                               _startSessionRealTime - CMTimeGetSeconds(presentationTime));
+        _hasWritten = YES;
+        [[SCLogger sharedInstance] logPreCaptureOperationFinishedAt:CMTimeGetSeconds(presentationTime)];
+        [[SCCoreCameraLogger sharedInstance]
+            logCameraCreationDelaySplitPointPreCaptureOperationFinishedAt:CMTimeGetSeconds(presentationTime)];
+        SCLogVideoCapturerInfo(@"SCVideoCaptureSessionInfo after first frame: %@",
+                               SCVideoCaptureSessionInfoGetDebugDescription(self.activeSession));
+    }
+    // Only respect video end session time, audio can be cut off, not video,
+    // not video
+    if (CMTIME_IS_INVALID(_endSessionTime)) {
+        _endSessionTime = presentationTime;
+    } else {
+        _endSessionTime = CMTimeMaximum(_endSessionTime, presentationTime);
+    }
+    if (CACurrentMediaTime() - _recordStartTime <= _maxDuration) {
+        [_videoWriter appendVideoSampleBuffer:sampleBuffer];
+        [self _processVideoSampleBuffer:sampleBuffer];
+    }
+    if (_timeObserver) {
+        [_timeObserver processTime:CMTimeSubtract(presentationTime, _startSessionTime)
+            sessionStartTimeDelayInSecond:_startSessionRealTime - CMTimeGetSeconds(_startSessionTime)];
+    }
+}
+
+- (void)_generatePlaceholderImageWithPixelBuffer:(CVImageBufferRef)pixelBuffer
 {
     SCTraceStart();
     CVImageBufferRef imageBuffer = CVPixelBufferRetain(pixelBuffer);
@@ -1015,11 +1125,6 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
                 // After processing, assign it back.
                 if (self.status == SCManagedVideoCapturerStatusRecording) {
                     _placeholderImage = placeholderImage;
-                    // Check video frame health by placeholder image
-                    [[SCManagedFrameHealthChecker sharedInstance]
-                        checkVideoHealthForCaptureFrameImage:placeholderImage
-                                                    metedata:metadata
-                                            captureSessionID:_captureSessionID];
                 }
                 CVPixelBufferRelease(imageBuffer);
             }];
@@ -1043,7 +1148,11 @@ static dispatch_queue_t SCPlaceholderImageGenerationQueue(void)
             NSDictionary *metadata =
                 [[[SCManagedFrameHealthChecker sharedInstance] metadataForSampleBuffer:sampleBuffer extraInfo:extraInfo]
                     copy];
-            [self _generatePlaceholderImageWithPixelBuffer:outputPixelBuffer metaData:metadata];
+            [self _generatePlaceholderImageWithPixelBuffer:outputPixelBuffer];
+            // Check video frame health on the first frame's pixel buffer directly
+            [[SCManagedFrameHealthChecker sharedInstance] checkVideoHealthForCaptureFramePixelBuffer:outputPixelBuffer
+                                                                                           metedata:metadata
+                                                                                   captureSessionID:_captureSessionID];
         }
     }
 
@@ -8,6 +8,7 @@
 
 #import <Foundation/Foundation.h>
 
+static NSString *const kSCCapturerStartingStepRecordingPreparation = @"recording_preparation";
 static NSString *const kSCCapturerStartingStepAudioSession = @"audio_session";
 static NSString *const kSCCapturerStartingStepTranscodeingVideoBitrate = @"transcoding_video_bitrate";
 static NSString *const kSCCapturerStartingStepOutputSettings = @"output_settings";
@@ -17,11 +18,16 @@ static NSString *const kSCCapturerStartingStepAssetWriterConfiguration = @"asset
 static NSString *const kSCCapturerStartingStepStartingWriting = @"start_writing";
 static NSString *const kCapturerStartingTotalDelay = @"total_delay";
 
+static NSString *const kSCCapturerWriterStagingEvent = @"VIDEO_CAPTURER_WRITER_STAGING";
+static NSString *const kSCCapturerPreRollEvent = @"VIDEO_CAPTURER_PRE_ROLL";
+
 @interface SCManagedVideoCapturerLogger : NSObject
 
 - (void)prepareForStartingLog;
 - (void)logStartingStep:(NSString *)stepName;
 - (void)endLoggingForStarting;
 - (void)logEventIfStartingTooSlow;
+- (void)logWriterStagingStatistics:(NSDictionary *)statistics;
+- (void)logPreRollStatistics:(NSDictionary *)statistics;
 
 @end
@@ -74,4 +74,22 @@
     }
 }
 
+- (void)logWriterStagingStatistics:(NSDictionary *)statistics
+{
+    if (statistics.count == 0) {
+        return;
+    }
+    SCLogGeneralWarning(@"Capturer writer staged samples while not ready:%@", statistics);
+    [[SCLogger sharedInstance] logEvent:kSCCapturerWriterStagingEvent parameters:statistics];
+}
+
+- (void)logPreRollStatistics:(NSDictionary *)statistics
+{
+    if (statistics.count == 0) {
+        return;
+    }
+    SCLogGeneralInfo(@"Capturer pre-roll held samples:%@", statistics);
+    [[SCLogger sharedInstance] logEvent:kSCCapturerPreRollEvent parameters:statistics];
+}
+
 @end
@@ -0,0 +1,33 @@
+//
+//  SCManagedVideoCapturerPreparation.h
+//  Snapchat
+//
+
+#import <Foundation/Foundation.h>
+
+@class SCQueuePerformer;
+
+typedef void (^sc_managed_video_capturer_preparation_block_t)(NSError *error, BOOL timedOut);
+
+/*
+ Promise for the audio session preparation of a recording, so that the capturer queue never waits on the audio
+ session. It completes once, either with the outcome of the audio session configuration or when its deadline passes,
+ whichever comes first. Must be used on the performer, blocks chained on it run there in order, right away when it
+ already completed.
+ */
+@interface SCManagedVideoCapturerPreparation : NSObject
+
+// The deadline is counted from now
+- (instancetype)initWithPerformer:(SCQueuePerformer *)performer deadline:(NSTimeInterval)deadline;
+
+@property (nonatomic, assign, readonly) BOOL completed;
+
+// Time from the creation of the preparation to its completion, 0 until then
+@property (nonatomic, assign, readonly) NSTimeInterval duration;
+
+// No-op once completed
+- (void)completeWithError:(NSError *)error;
+
+- (void)onComplete:(sc_managed_video_capturer_preparation_block_t)block;
+
+@end
@@ -0,0 +1,73 @@
+//
+//  SCManagedVideoCapturerPreparation.m
+//  Snapchat
+//
+
+#import "SCManagedVideoCapturerPreparation.h"
+
+#import <SCBase/SCMacros.h>
+#import <SCFoundation/SCAssertWrapper.h>
+#import <SCFoundation/SCQueuePerformer.h>
+
+@import QuartzCore;
+
+@implementation SCManagedVideoCapturerPreparation {
+    SCQueuePerformer *_performer;
+    CFTimeInterval _creationTime;
+    NSError *_error;
+    BOOL _timedOut;
+    NSMutableArray<sc_managed_video_capturer_preparation_block_t> *_blocks;
+}
+
+- (instancetype)initWithPerformer:(SCQueuePerformer *)performer deadline:(NSTimeInterval)deadline
+{
+    SCAssert([performer isCurrentPerformer], @"must run on performer");
+    self = [super init];
+    if (self) {
+        _performer = performer;
+        _creationTime = CACurrentMediaTime();
+        _blocks = [NSMutableArray array];
+        @weakify(self);
+        [_performer perform:^{
+            @strongify(self);
+            [self _completeWithError:nil timedOut:YES];
+        }
+                      after:deadline];
+    }
+    return self;
+}
+
+- (void)completeWithError:(NSError *)error
+{
+    [self _completeWithError:error timedOut:NO];
+}
+
+- (void)onComplete:(sc_managed_video_capturer_preparation_block_t)block
+{
+    SCAssert([_performer isCurrentPerformer], @"must run on performer");
+    SC_GUARD_ELSE_RETURN(block);
+    if (_completed) {
+        block(_error, _timedOut);
+    } else {
+        [_blocks addObject:block];
+    }
+}
+
+#pragma mark - Private methods
+
+- (void)_completeWithError:(NSError *)error timedOut:(BOOL)timedOut
+{
+    SCAssert([_performer isCurrentPerformer], @"must run on performer");
+    SC_GUARD_ELSE_RETURN(!_completed);
+    _completed = YES;
+    _error = error;
+    _timedOut = timedOut;
+    _duration = CACurrentMediaTime() - _creationTime;
+    NSArray<sc_managed_video_capturer_preparation_block_t> *blocks = [_blocks copy];
+    [_blocks removeAllObjects];
+    for (sc_managed_video_capturer_preparation_block_t block in blocks) {
+        block(error, timedOut);
+    }
+}
+
+@end
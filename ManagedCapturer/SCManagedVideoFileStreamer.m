@@ -9,6 +9,7 @@
 #import "SCManagedVideoFileStreamer.h"
 
 #import "SCManagedCapturePreviewLayerController.h"
+#import "SCSampleBufferFactory.h"
 
 #import <SCCameraFoundation/SCManagedVideoDataSourceListenerAnnouncer.h>
 #import <SCFoundation/SCLog.h>
@@ -229,21 +230,7 @@ static char *const kSCManagedVideoFileStreamerQueueLabel = "com.snapchat.managed
 
 - (CMSampleBufferRef)createSampleBufferFromPixelBuffer:(CVPixelBufferRef)pixelBuffer presentationTime:(CMTime)time
 {
-    CMSampleBufferRef sampleBuffer = NULL;
-    CMVideoFormatDescriptionRef formatDesc = NULL;
-
-    OSStatus err = CMVideoFormatDescriptionCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, &formatDesc);
-    if (err != noErr) {
-        return NULL;
-    }
-
-    CMSampleTimingInfo sampleTimingInfo = {kCMTimeInvalid, time, kCMTimeInvalid};
-    CMSampleBufferCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, true, NULL, NULL, formatDesc,
-                                       &sampleTimingInfo, &sampleBuffer);
-
-    CFRelease(formatDesc);
-
-    return sampleBuffer;
+    return [[SCSampleBufferFactory sharedFactory] createSampleBufferWithPixelBuffer:pixelBuffer presentationTime:time];
 }
 
 - (void)configureOutput
@@ -0,0 +1,65 @@
+//
+//  SCManagedVideoFrameDeliveryLane.h
+//  Snapchat
+//
+//  A video data source announces every frame synchronously on its own queue, so one slow listener delays the preview
+//  and every other listener. A delivery lane sits between the data source and a listener which doesn't need that:
+//  the lane is announced to synchronously, and only hands the frame over to the listener on a queue of its own.
+//
+
+#import <SCBase/SCMacros.h>
+#import <SCCameraFoundation/SCManagedVideoDataSource.h>
+#import <SCCameraFoundation/SCManagedVideoDataSourceListener.h>
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSUInteger, SCManagedVideoFrameDeliveryPolicy) {
+    // Called on the data source queue, like a listener added with -addListener:
+    SCManagedVideoFrameDeliveryPolicySynchronous = 0,
+    // Every frame, in order, on the lane queue. Frames beyond the few in flight are dropped, not queued.
+    SCManagedVideoFrameDeliveryPolicyEveryFrame,
+    // Only the newest frame on the lane queue, a frame still waiting is replaced by the next one
+    SCManagedVideoFrameDeliveryPolicyLatestOnly,
+};
+
+@protocol SCManagedVideoFrameDeliveryDataSource <NSObject>
+
+// Listeners are removed with -removeListener: whatever their delivery policy
+- (void)addListener:(id<SCManagedVideoDataSourceListener>)listener
+      deliveryPolicy:(SCManagedVideoFrameDeliveryPolicy)deliveryPolicy
+    qualityOfService:(qos_class_t)qualityOfService;
+
+@end
+
+// Adds the listener synchronously if the data source doesn't support delivery lanes
+extern void SCManagedVideoDataSourceAddListener(id<SCManagedVideoDataSource> videoDataSource,
+                                                id<SCManagedVideoDataSourceListener> listener,
+                                                SCManagedVideoFrameDeliveryPolicy deliveryPolicy,
+                                                qos_class_t qualityOfService);
+
+/*
+ @class SCManagedVideoFrameDeliveryLane
+    Listener of a video data source which forwards the frames to another listener on its own serial queue, following
+        an asynchronous delivery policy. Announcing to the lane never blocks: the frames the listener can't keep up with
+        are dropped and counted. The listener is held weakly.
+ */
+@interface SCManagedVideoFrameDeliveryLane : NSObject <SCManagedVideoDataSourceListener>
+
+SC_INIT_AND_NEW_UNAVAILABLE;
+
+- (instancetype)initWithListener:(id<SCManagedVideoDataSourceListener>)listener
+                  deliveryPolicy:(SCManagedVideoFrameDeliveryPolicy)deliveryPolicy
+                qualityOfService:(qos_class_t)qualityOfService;
+
+@property (nonatomic, weak, readonly) id<SCManagedVideoDataSourceListener> listener;
+@property (nonatomic, assign, readonly) SCManagedVideoFrameDeliveryPolicy deliveryPolicy;
+
+// Delivery statistics since the lane was created, can be read on any queue
+@property (nonatomic, assign, readonly) NSUInteger deliveredFrameCount;
+// Frames the lane dropped because the listener was still busy, not the ones the data source dropped
+@property (nonatomic, assign, readonly) NSUInteger droppedFrameCount;
+
+// Percentile (0-100) of the time from the announcement to the lane to the listener returning
+- (NSTimeInterval)deliveryLatencyAtPercentile:(double)percentile;
+
+@end
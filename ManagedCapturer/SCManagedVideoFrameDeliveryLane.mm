@@ -0,0 +1,217 @@
+//
+//  SCManagedVideoFrameDeliveryLane.mm
+//  Snapchat
+//
+
+#import "SCManagedVideoFrameDeliveryLane.h"
+
+#import "SCLatencyHistogram.h"
+
+#import <SCFoundation/SCAssertWrapper.h>
+#import <SCFoundation/SCQueuePerformer.h>
+
+@import CoreMedia;
+@import QuartzCore;
+
+static char *const kSCManagedVideoFrameDeliveryLaneQueueLabel = "com.snapchat.managed-video-frame-delivery-lane";
+// Sample buffers come from the small capture pool, an every frame lane only holds on to a few of them
+static NSUInteger const kSCManagedVideoFrameDeliveryLaneMaxFramesInFlight = 3;
+
+void SCManagedVideoDataSourceAddListener(id<SCManagedVideoDataSource> videoDataSource,
+                                         id<SCManagedVideoDataSourceListener> listener,
+                                         SCManagedVideoFrameDeliveryPolicy deliveryPolicy,
+                                         qos_class_t qualityOfService)
+{
+    if (deliveryPolicy != SCManagedVideoFrameDeliveryPolicySynchronous &&
+        [videoDataSource conformsToProtocol:@protocol(SCManagedVideoFrameDeliveryDataSource)]) {
+        [(id<SCManagedVideoFrameDeliveryDataSource>)videoDataSource addListener:listener
+                                                                  deliveryPolicy:deliveryPolicy
+                                                                qualityOfService:qualityOfService];
+    } else {
+        [videoDataSource addListener:listener];
+    }
+}
+
+@implementation SCManagedVideoFrameDeliveryLane {
+    SCQueuePerformer *_performer;
+    BOOL _listenerHandlesDroppedFrames;
+
+    // Guarded by @synchronized(self) along with the statistics
+    CMSampleBufferRef _pendingSampleBuffer;
+    SCManagedCaptureDevicePosition _pendingDevicePosition;
+    CFTimeInterval _pendingAnnouncementTime;
+    NSUInteger _framesInFlight;
+    NSUInteger _deliveredFrameCount;
+    NSUInteger _droppedFrameCount;
+    SC::LatencyHistogram _deliveryLatencies;
+}
+
+- (instancetype)initWithListener:(id<SCManagedVideoDataSourceListener>)listener
+                  deliveryPolicy:(SCManagedVideoFrameDeliveryPolicy)deliveryPolicy
+                qualityOfService:(qos_class_t)qualityOfService
+{
+    SCAssert(deliveryPolicy != SCManagedVideoFrameDeliveryPolicySynchronous,
+             @"Synchronous listeners don't need a delivery lane");
+    self = [super init];
+    if (self) {
+        _listener = listener;
+        _deliveryPolicy = deliveryPolicy;
+        _listenerHandlesDroppedFrames =
+            [listener respondsToSelector:@selector(managedVideoDataSource:didDropSampleBuffer:devicePosition:)];
+        _performer = [[SCQueuePerformer alloc] initWithLabel:kSCManagedVideoFrameDeliveryLaneQueueLabel
+                                            qualityOfService:qualityOfService
+                                                   queueType:DISPATCH_QUEUE_SERIAL
+                                                     context:SCQueuePerformerContextCamera];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_pendingSampleBuffer) {
+        CFRelease(_pendingSampleBuffer);
+    }
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<SCManagedVideoFrameDeliveryLane %p> listener:%@ policy:%lu delivered:%lu "
+                                      @"dropped:%lu p50 latency:%.1fms p99 latency:%.1fms",
+                                      self, _listener, (unsigned long)_deliveryPolicy,
+                                      (unsigned long)self.deliveredFrameCount, (unsigned long)self.droppedFrameCount,
+                                      [self deliveryLatencyAtPercentile:50] * 1000,
+                                      [self deliveryLatencyAtPercentile:99] * 1000];
+}
+
+- (NSUInteger)deliveredFrameCount
+{
+    @synchronized(self)
+    {
+        return _deliveredFrameCount;
+    }
+}
+
+- (NSUInteger)droppedFrameCount
+{
+    @synchronized(self)
+    {
+        return _droppedFrameCount;
+    }
+}
+
+- (NSTimeInterval)deliveryLatencyAtPercentile:(double)percentile
+{
+    @synchronized(self)
+    {
+        return (NSTimeInterval)_deliveryLatencies.valueAtPercentile(percentile) / USEC_PER_SEC;
+    }
+}
+
+#pragma mark - SCManagedVideoDataSourceListener
+
+- (void)managedVideoDataSource:(id<SCManagedVideoDataSource>)managedVideoDataSource
+         didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer
+                devicePosition:(SCManagedCaptureDevicePosition)devicePosition
+{
+    SC_GUARD_ELSE_RETURN(sampleBuffer && _listener);
+    CFTimeInterval announcementTime = CACurrentMediaTime();
+    if (_deliveryPolicy == SCManagedVideoFrameDeliveryPolicyLatestOnly) {
+        CFRetain(sampleBuffer);
+        BOOL needsPerform;
+        @synchronized(self)
+        {
+            needsPerform = !_pendingSampleBuffer;
+            if (_pendingSampleBuffer) {
+                CFRelease(_pendingSampleBuffer);
+                ++_droppedFrameCount;
+            }
+            _pendingSampleBuffer = sampleBuffer;
+            _pendingDevicePosition = devicePosition;
+            _pendingAnnouncementTime = announcementTime;
+        }
+        SC_GUARD_ELSE_RETURN(needsPerform);
+        [_performer perform:^{
+            [self _deliverPendingSampleBufferFromDataSource:managedVideoDataSource];
+        }];
+        return;
+    }
+
+    @synchronized(self)
+    {
+        if (_framesInFlight >= kSCManagedVideoFrameDeliveryLaneMaxFramesInFlight) {
+            ++_droppedFrameCount;
+            return;
+        }
+        ++_framesInFlight;
+    }
+    CFRetain(sampleBuffer);
+    [_performer perform:^{
+        [self _deliverSampleBuffer:sampleBuffer
+                    devicePosition:devicePosition
+                  announcementTime:announcementTime
+                        dataSource:managedVideoDataSource];
+        CFRelease(sampleBuffer);
+        @synchronized(self)
+        {
+            --_framesInFlight;
+        }
+    }];
+}
+
+- (void)managedVideoDataSource:(id<SCManagedVideoDataSource>)managedVideoDataSource
+           didDropSampleBuffer:(CMSampleBufferRef)sampleBuffer
+                devicePosition:(SCManagedCaptureDevicePosition)devicePosition
+{
+    SC_GUARD_ELSE_RETURN(sampleBuffer && _listenerHandlesDroppedFrames);
+    // Dropped sample buffers carry no image data, holding on to them doesn't starve the capture pool
+    CFRetain(sampleBuffer);
+    [_performer perform:^{
+        [_listener managedVideoDataSource:managedVideoDataSource
+                      didDropSampleBuffer:sampleBuffer
+                           devicePosition:devicePosition];
+        CFRelease(sampleBuffer);
+    }];
+}
+
+#pragma mark - Private methods
+
+- (void)_deliverPendingSampleBufferFromDataSource:(id<SCManagedVideoDataSource>)managedVideoDataSource
+{
+    CMSampleBufferRef sampleBuffer;
+    SCManagedCaptureDevicePosition devicePosition;
+    CFTimeInterval announcementTime;
+    @synchronized(self)
+    {
+        sampleBuffer = _pendingSampleBuffer;
+        devicePosition = _pendingDevicePosition;
+        announcementTime = _pendingAnnouncementTime;
+        _pendingSampleBuffer = NULL;
+    }
+    SC_GUARD_ELSE_RETURN(sampleBuffer);
+    [self _deliverSampleBuffer:sampleBuffer
+                devicePosition:devicePosition
+              announcementTime:announcementTime
+                    dataSource:managedVideoDataSource];
+    CFRelease(sampleBuffer);
+}
+
+- (void)_deliverSampleBuffer:(CMSampleBufferRef)sampleBuffer
+              devicePosition:(SCManagedCaptureDevicePosition)devicePosition
+            announcementTime:(CFTimeInterval)announcementTime
+                  dataSource:(id<SCManagedVideoDataSource>)managedVideoDataSource
+{
+    SCAssertPerformer(_performer);
+    id<SCManagedVideoDataSourceListener> listener = _listener;
+    SC_GUARD_ELSE_RETURN(listener);
+    [listener managedVideoDataSource:managedVideoDataSource
+               didOutputSampleBuffer:sampleBuffer
+                      devicePosition:devicePosition];
+    CFTimeInterval latency = CACurrentMediaTime() - announcementTime;
+    @synchronized(self)
+    {
+        ++_deliveredFrameCount;
+        _deliveryLatencies.record((uint32_t)MIN(MAX(latency, 0) * USEC_PER_SEC, UINT32_MAX));
+    }
+}
+
+@end
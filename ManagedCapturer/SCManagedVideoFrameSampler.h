@@ -14,9 +14,28 @@
  Allows consumer to register a block to sample the next CMSampleBufferRef and
  automatically leverages Core image to convert the pixel buffer to a UIImage.
  Returned image will be a copy.
+
+ The capture callback only retains the pixel buffer, the conversion happens on a background queue and the blocks are
+ called on the main thread.
  */
 @interface SCManagedVideoFrameSampler : NSObject <SCManagedCapturerListener>
 
 - (void)sampleNextFrame:(void (^)(UIImage *frame, CMTime presentationTime))completeBlock;
 
+/**
+ targetSize bounds the size of the returned image, which is scaled down (aspect fit) and converted in a single pass.
+ CGSizeZero returns the frame at full resolution.
+ */
+- (void)sampleNextFrameWithTargetSize:(CGSize)targetSize
+                           completion:(void (^)(UIImage *frame, CMTime presentationTime))completeBlock;
+
+/**
+ Samples frameCount frames, one every frameStride frames starting with the next one, e.g. for a thumbnail strip.
+ Frames which couldn't be converted are left out of both arrays, presentationTimes holds CMTime NSValues.
+ */
+- (void)sampleFrames:(NSUInteger)frameCount
+              stride:(NSUInteger)frameStride
+          targetSize:(CGSize)targetSize
+          completion:(void (^)(NSArray<UIImage *> *frames, NSArray<NSValue *> *presentationTimes))completeBlock;
+
 @end
@@ -8,24 +8,88 @@
 
 #import "SCManagedVideoFrameSampler.h"
 
+#import <SCFoundation/SCQueuePerformer.h>
 #import <SCFoundation/SCThreadHelpers.h>
 #import <SCFoundation/UIImage+CVPixelBufferRef.h>
 
+@import AVFoundation;
 @import CoreImage;
 @import ImageIO;
 
+static char *const kSCManagedVideoFrameSamplerQueueLabel = "com.snapchat.managed-video-frame-sampler";
+
+@interface SCManagedVideoFrameSamplerRequest : NSObject
+
+@property (nonatomic, assign) CGSize targetSize;
+@property (nonatomic, assign) NSUInteger frameStride;
+@property (nonatomic, copy) void (^completeBlock)(NSArray<UIImage *> *, NSArray<NSValue *> *);
+// Set instead of completeBlock when sampling the next frame, gets the presentation time even without an image
+@property (nonatomic, copy) void (^frameCompleteBlock)(UIImage *, CMTime);
+// Only touched on the capture callback thread
+@property (nonatomic, assign) NSUInteger remainingFrameCount;
+@property (nonatomic, assign) NSUInteger framesUntilNextSample;
+// Only touched on the conversion queue
+@property (nonatomic, assign) NSUInteger pendingConversionCount;
+@property (nonatomic, strong) NSMutableArray<UIImage *> *frames;
+@property (nonatomic, strong) NSMutableArray<NSValue *> *presentationTimes;
+
+@end
+
+@implementation SCManagedVideoFrameSamplerRequest
+@end
+
 @interface SCManagedVideoFrameSampler ()
 
-@property (nonatomic, copy) void (^frameSampleBlock)(UIImage *, CMTime);
+@property (nonatomic, strong) SCManagedVideoFrameSamplerRequest *request;
 @property (nonatomic, strong) CIContext *ciContext;
 
 @end
 
-@implementation SCManagedVideoFrameSampler
+@implementation SCManagedVideoFrameSampler {
+    SCQueuePerformer *_performer;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _performer = [[SCQueuePerformer alloc] initWithLabel:kSCManagedVideoFrameSamplerQueueLabel
+                                            qualityOfService:QOS_CLASS_UTILITY
+                                                   queueType:DISPATCH_QUEUE_SERIAL
+                                                     context:SCQueuePerformerContextCamera];
+    }
+    return self;
+}
 
 - (void)sampleNextFrame:(void (^)(UIImage *, CMTime))completeBlock
 {
-    _frameSampleBlock = completeBlock;
+    [self sampleNextFrameWithTargetSize:CGSizeZero completion:completeBlock];
+}
+
+- (void)sampleNextFrameWithTargetSize:(CGSize)targetSize completion:(void (^)(UIImage *, CMTime))completeBlock
+{
+    SC_GUARD_ELSE_RETURN(completeBlock);
+    SCManagedVideoFrameSamplerRequest *request = [self _requestWithFrameCount:1 stride:1 targetSize:targetSize];
+    request.frameCompleteBlock = completeBlock;
+    @synchronized(self)
+    {
+        _request = request;
+    }
+}
+
+- (void)sampleFrames:(NSUInteger)frameCount
+              stride:(NSUInteger)frameStride
+          targetSize:(CGSize)targetSize
+          completion:(void (^)(NSArray<UIImage *> *, NSArray<NSValue *> *))completeBlock
+{
+    SC_GUARD_ELSE_RETURN(frameCount > 0 && completeBlock);
+    SCManagedVideoFrameSamplerRequest *request =
+        [self _requestWithFrameCount:frameCount stride:frameStride targetSize:targetSize];
+    request.completeBlock = completeBlock;
+    @synchronized(self)
+    {
+        _request = request;
+    }
 }
 
 #pragma mark - SCManagedCapturerListener
@@ -34,24 +98,93 @@
     didAppendVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer
                 sampleMetadata:(SCManagedCapturerSampleMetadata *)sampleMetadata
 {
-    void (^block)(UIImage *, CMTime) = _frameSampleBlock;
-    _frameSampleBlock = nil;
-
-    if (!block) {
-        return;
+    SCManagedVideoFrameSamplerRequest *request;
+    @synchronized(self)
+    {
+        request = _request;
+        SC_GUARD_ELSE_RETURN(request);
+        if (request.framesUntilNextSample > 0) {
+            --request.framesUntilNextSample;
+            return;
+        }
+        request.framesUntilNextSample = request.frameStride - 1;
+        if (--request.remainingFrameCount == 0) {
+            _request = nil;
+        }
     }
 
+    // Only retain the pixel buffer here, the conversion is off the recording path
     CVImageBufferRef cvImageBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
     CMTime presentationTime = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
-    UIImage *image;
     if (cvImageBuffer) {
-        CGImageRef cgImage = SCCreateCGImageFromPixelBufferRef(cvImageBuffer);
-        image = [[UIImage alloc] initWithCGImage:cgImage scale:1.0 orientation:UIImageOrientationRight];
-        CGImageRelease(cgImage);
+        CVPixelBufferRetain(cvImageBuffer);
+    }
+    [_performer perform:^{
+        UIImage *image;
+        if (cvImageBuffer) {
+            image = [self _imageFromPixelBuffer:cvImageBuffer targetSize:request.targetSize];
+            CVPixelBufferRelease(cvImageBuffer);
+        }
+        if (image) {
+            [request.frames addObject:image];
+            [request.presentationTimes addObject:[NSValue valueWithCMTime:presentationTime]];
+        }
+        if (--request.pendingConversionCount == 0) {
+            void (^frameBlock)(UIImage *, CMTime) = request.frameCompleteBlock;
+            if (frameBlock) {
+                runOnMainThreadAsynchronously(^{
+                    frameBlock(image, presentationTime);
+                });
+                return;
+            }
+            NSArray<UIImage *> *frames = [request.frames copy];
+            NSArray<NSValue *> *presentationTimes = [request.presentationTimes copy];
+            void (^block)(NSArray<UIImage *> *, NSArray<NSValue *> *) = request.completeBlock;
+            runOnMainThreadAsynchronously(^{
+                block(frames, presentationTimes);
+            });
+        }
+    }];
+}
+
+#pragma mark - Private methods
+
+- (SCManagedVideoFrameSamplerRequest *)_requestWithFrameCount:(NSUInteger)frameCount
+                                                       stride:(NSUInteger)frameStride
+                                                   targetSize:(CGSize)targetSize
+{
+    SCManagedVideoFrameSamplerRequest *request = [[SCManagedVideoFrameSamplerRequest alloc] init];
+    request.targetSize = targetSize;
+    request.frameStride = MAX(frameStride, 1);
+    request.remainingFrameCount = frameCount;
+    request.pendingConversionCount = frameCount;
+    request.frames = [NSMutableArray arrayWithCapacity:frameCount];
+    request.presentationTimes = [NSMutableArray arrayWithCapacity:frameCount];
+    return request;
+}
+
+- (UIImage *)_imageFromPixelBuffer:(CVPixelBufferRef)pixelBuffer targetSize:(CGSize)targetSize
+{
+    size_t width = CVPixelBufferGetWidth(pixelBuffer);
+    size_t height = CVPixelBufferGetHeight(pixelBuffer);
+    // The image is rotated right, so its width is the height of the buffer
+    CGFloat scale = 1;
+    if (targetSize.width > 0 && targetSize.height > 0 && width > 0 && height > 0) {
+        scale = MIN(MIN(targetSize.width / height, targetSize.height / width), 1);
+    }
+    CGImageRef cgImage;
+    if (scale < 1) {
+        // Scale and convert to RGBA in a single pass, rather than converting the full resolution frame first
+        CIImage *ciImage = [[CIImage imageWithCVPixelBuffer:pixelBuffer]
+            imageByApplyingTransform:CGAffineTransformMakeScale(scale, scale)];
+        cgImage = [self.ciContext createCGImage:ciImage fromRect:CGRectIntegral(ciImage.extent)];
+    } else {
+        cgImage = SCCreateCGImageFromPixelBufferRef(pixelBuffer);
     }
-    runOnMainThreadAsynchronously(^{
-        block(image, presentationTime);
-    });
+    SC_GUARD_ELSE_RETURN_VALUE(cgImage, nil);
+    UIImage *image = [[UIImage alloc] initWithCGImage:cgImage scale:1.0 orientation:UIImageOrientationRight];
+    CGImageRelease(cgImage);
+    return image;
 }
 
 - (CIContext *)ciContext
@@ -7,6 +7,7 @@
 //
 
 #import "SCManagedVideoARDataSource.h"
+#import "SCManagedVideoFrameDeliveryLane.h"
 
 #import <SCCameraFoundation/SCManagedVideoDataSource.h>
 
@@ -20,7 +21,8 @@
  * and publish video output frames. SCManagedVideoStreamer also conforms
  * to SCManagedVideoDataSource allowing chained consumption of video frames.
  */
-@interface SCManagedVideoStreamer : NSObject <SCManagedVideoDataSource, SCManagedVideoARDataSource>
+@interface SCManagedVideoStreamer
+    : NSObject <SCManagedVideoDataSource, SCManagedVideoARDataSource, SCManagedVideoFrameDeliveryDataSource>
 
 - (instancetype)initWithSession:(AVCaptureSession *)session
                  devicePosition:(SCManagedCaptureDevicePosition)devicePosition;
@@ -33,4 +35,7 @@
 
 - (void)setupWithARSession:(ARSession *)arSession NS_AVAILABLE_IOS(11_0);
 
+// Lanes of the listeners added with an asynchronous delivery policy, for their delivery statistics
+- (NSArray<SCManagedVideoFrameDeliveryLane *> *)deliveryLanes;
+
 @end
@@ -11,11 +11,13 @@
 #import "ARConfiguration+SCConfiguration.h"
 #import "SCCameraTweaks.h"
 #import "SCCapturerDefines.h"
+#import "SCHotPathTrace.h"
 #import "SCLogger+Camera.h"
 #import "SCManagedCapturePreviewLayerController.h"
 #import "SCMetalUtils.h"
 #import "SCProcessingPipeline.h"
 #import "SCProcessingPipelineBuilder.h"
+#import "SCSampleBufferFactory.h"
 
 #import <SCCameraFoundation/SCManagedVideoDataSourceListenerAnnouncer.h>
 #import <SCFoundation/NSString+SCFormat.h>
@@ -48,6 +50,10 @@ static NSTimeInterval const kSCManagedVideoStreamerStalledDisplay =
 static NSTimeInterval const kSCManagedVideoStreamerARSessionFramerateCap =
     1.0 / (kSCCaptureFrameRate + 1); // Restrict ARSession to 30fps
 static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
+// Frames in flight on the GPU with pipelined processing. These and the frame waiting for a slot count towards
+// _processingBuffersCount, so together with the sticky video path they stay within
+// kSCManagedVideoStreamerMaxProcessingBuffers.
+static int32_t const kSCManagedVideoStreamerMaxPipelinedFrames = 3;
 
 @interface SCManagedVideoStreamer () <AVCaptureVideoDataOutputSampleBufferDelegate, AVCaptureDepthDataOutputDelegate,
                                       AVCaptureDataOutputSynchronizerDelegate, ARSessionDelegate>
@@ -64,6 +70,9 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     SCManagedCaptureDevicePosition _devicePosition;
     BOOL _videoStabilizationEnabledIfSupported;
     SCManagedVideoDataSourceListenerAnnouncer *_announcer;
+    // Lanes announced to in place of their listener, guarded by @synchronized(_deliveryLanes). The lanes hold their
+    // listener weakly, the ones whose listener went away are pruned when listeners are added or removed.
+    NSMutableArray<SCManagedVideoFrameDeliveryLane *> *_deliveryLanes;
 
     BOOL _sampleBufferDisplayEnabled;
     id<SCManagedSampleBufferDisplayController> _sampleBufferDisplayController;
@@ -83,6 +92,16 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     BOOL _keepLateFrames;
     SCQueuePerformer *_callbackPerformer;
     atomic_int _processingBuffersCount;
+
+    // Pipelined processing: frame N+1 is encoded while frame N is still on the GPU.
+    BOOL _pipelinedProcessingEnabled;
+    int32_t _pipelinedFramesCount;
+    // Pipeline the frames in flight were submitted to. Once the pipeline changes, new frames wait until these are
+    // done, so that listeners still see frames in order.
+    SCProcessingPipeline *_pipelinedFramesPipeline;
+    // The newest frame waiting for a free pipeline slot, retained. Older waiting frames are dropped, not queued.
+    CMSampleBufferRef _waitingSampleBuffer;
+    CVPixelBufferRef _waitingDepthDataMap;
 }
 
 @synthesize isStreaming = _isStreaming;
@@ -102,6 +121,7 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     if (self) {
         _sampleBufferDisplayEnabled = YES;
         _announcer = [[SCManagedVideoDataSourceListenerAnnouncer alloc] init];
+        _deliveryLanes = [NSMutableArray array];
         // We discard frames to support lenses in real time
         _keepLateFrames = NO;
         _performer = [[SCQueuePerformer alloc] initWithLabel:kSCManagedVideoStreamerQueueLabel
@@ -110,6 +130,7 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
                                                      context:SCQueuePerformerContextCamera];
 
         _videoOrientation = AVCaptureVideoOrientationLandscapeRight;
+        _pipelinedProcessingEnabled = SCCameraTweaksEnablePipelinedFrameProcessing();
 
         [self setupWithSession:session devicePosition:devicePosition];
         SCLogVideoStreamerInfo(@"init with position:%lu", (unsigned long)devicePosition);
@@ -132,6 +153,11 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     return self;
 }
 
+- (void)dealloc
+{
+    [self _releaseWaitingSampleBuffer];
+}
+
 - (AVCaptureVideoDataOutput *)_newVideoDataOutput
 {
     AVCaptureVideoDataOutput *output = [[AVCaptureVideoDataOutput alloc] init];
@@ -321,6 +347,7 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     [self _cancelFlushOutdatedPreview];
     [_performer perform:^{
         SCLogVideoStreamerInfo(@"stopStreaming in perfome queue");
+        [self _releaseWaitingSampleBuffer];
         [_sampleBufferDisplayController flushOutdatedPreview];
         [self _performCompletionHandlersForWaitUntilSampleBufferDisplayed];
     }];
@@ -423,6 +450,42 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     SCTraceStart();
     SCLogVideoStreamerInfo(@"remove listener:%@", listener);
     [_announcer removeListener:listener];
+    [self _removeDeliveryLanesOfListener:listener];
+}
+
+- (void)addListener:(id<SCManagedVideoDataSourceListener>)listener
+      deliveryPolicy:(SCManagedVideoFrameDeliveryPolicy)deliveryPolicy
+    qualityOfService:(qos_class_t)qualityOfService
+{
+    SCTraceStart();
+    if (deliveryPolicy == SCManagedVideoFrameDeliveryPolicySynchronous) {
+        [self addListener:listener];
+        return;
+    }
+    SC_GUARD_ELSE_RETURN(listener);
+    // Also prunes the lanes of the listeners which went away
+    [self _removeDeliveryLanesOfListener:nil];
+    SCManagedVideoFrameDeliveryLane *deliveryLane;
+    @synchronized(_deliveryLanes)
+    {
+        for (SCManagedVideoFrameDeliveryLane *existingLane in _deliveryLanes) {
+            SC_GUARD_ELSE_RETURN(existingLane.listener != listener);
+        }
+        deliveryLane = [[SCManagedVideoFrameDeliveryLane alloc] initWithListener:listener
+                                                                  deliveryPolicy:deliveryPolicy
+                                                                qualityOfService:qualityOfService];
+        [_deliveryLanes addObject:deliveryLane];
+    }
+    SCLogVideoStreamerInfo(@"add listener:%@ with delivery policy:%lu", listener, (unsigned long)deliveryPolicy);
+    [_announcer addListener:deliveryLane];
+}
+
+- (NSArray<SCManagedVideoFrameDeliveryLane *> *)deliveryLanes
+{
+    @synchronized(_deliveryLanes)
+    {
+        return [_deliveryLanes copy];
+    }
 }
 
 - (void)addProcessingPipeline:(SCProcessingPipeline *)processingPipeline
@@ -472,33 +535,56 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     NSTimeInterval presentationTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
     _lastDisplayedFrameTimestamp = presentationTime;
     NSTimeInterval frameLatency = CACurrentMediaTime() - presentationTime;
+    SCHotPathTrace2(SCHotPathTraceEventVideoStreamerFrame, SCHotPathTracePointer(sampleBuffer),
+                    SCHotPathTraceDouble(frameLatency));
     // Log interval definied in macro LOG_INTERVAL, now is 3.0s
     BOOL shouldLog =
-        (long)(CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer)) * kSCCaptureFrameRate) %
-            ((long)(kSCCaptureFrameRate * kSCLogInterval)) ==
-        0;
+        (long)(presentationTime * kSCCaptureFrameRate) % ((long)(kSCCaptureFrameRate * kSCLogInterval)) == 0;
     if (shouldLog) {
         SCLogVideoStreamerInfo(@"didOutputSampleBuffer:%p", sampleBuffer);
     }
+    if (!_processingPipeline && _pipelinedFramesCount > 0) {
+        // The removed pipeline still has frames on the GPU, this one is displayed after them
+        [self _setWaitingSampleBuffer:sampleBuffer depthData:depthDataMap];
+        return;
+    }
     if (_processingPipeline) {
-        RenderData renderData = {
-            .sampleBuffer = sampleBuffer,
-            .depthDataMap = depthDataMap,
-            .depthBlurPointOfInterest =
-                SCCameraTweaksEnablePortraitModeAutofocus() || SCCameraTweaksEnablePortraitModeTapToFocus()
-                    ? &_portraitModePointOfInterest
-                    : nil,
-        };
+        RenderData renderData = [self _renderDataWithSampleBuffer:sampleBuffer depthData:depthDataMap];
         // Ensure we are doing all render operations (i.e. accessing textures) on performer to prevent race condition
         SCAssertPerformer(_performer);
+        if (_pipelinedProcessingEnabled) {
+            [self _renderPipelined:renderData shouldLog:shouldLog];
+            return;
+        }
         sampleBuffer = [_processingPipeline render:renderData];
 
+        SCHotPathTrace2(SCHotPathTraceEventVideoStreamerRendered, SCHotPathTracePointer(sampleBuffer), NO);
         if (shouldLog) {
             SCLogVideoStreamerInfo(@"rendered sampleBuffer:%p in processingPipeline:%@", sampleBuffer,
                                    _processingPipeline);
         }
     }
 
+    [self _displayAndAnnounceSampleBuffer:sampleBuffer frameLatency:frameLatency shouldLog:shouldLog];
+}
+
+- (RenderData)_renderDataWithSampleBuffer:(CMSampleBufferRef)sampleBuffer depthData:(CVPixelBufferRef)depthDataMap
+{
+    RenderData renderData = {
+        .sampleBuffer = sampleBuffer,
+        .depthDataMap = depthDataMap,
+        .depthBlurPointOfInterest =
+            SCCameraTweaksEnablePortraitModeAutofocus() || SCCameraTweaksEnablePortraitModeTapToFocus()
+                ? &_portraitModePointOfInterest
+                : nil,
+    };
+    return renderData;
+}
+
+- (void)_displayAndAnnounceSampleBuffer:(CMSampleBufferRef)sampleBuffer
+                           frameLatency:(NSTimeInterval)frameLatency
+                              shouldLog:(BOOL)shouldLog
+{
     if (sampleBuffer && _sampleBufferDisplayEnabled) {
         // Send the buffer only if it is valid, set it to be displayed immediately (See the enqueueSampleBuffer method
         // header, need to get attachments array and set the dictionary).
@@ -513,9 +599,10 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
         if (frameLatency >= kSCManagedVideoStreamerMaxAllowedLatency) {
             SCLogVideoStreamerWarning(
                 @"The sample buffer we received is too late, why? presentationTime:%lf frameLatency:%f",
-                presentationTime, frameLatency);
+                CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer)), frameLatency);
         }
         [_sampleBufferDisplayController enqueueSampleBuffer:sampleBuffer];
+        SCHotPathTrace1(SCHotPathTraceEventVideoStreamerDisplayed, SCHotPathTracePointer(sampleBuffer));
         if (shouldLog) {
             SCLogVideoStreamerInfo(@"displayed sampleBuffer:%p in Metal", sampleBuffer);
         }
@@ -523,16 +610,115 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
         [self _performCompletionHandlersForWaitUntilSampleBufferDisplayed];
     }
 
+    SCHotPathTrace2(SCHotPathTraceEventVideoStreamerBeginAnnouncing, SCHotPathTracePointer(sampleBuffer),
+                    _devicePosition);
     if (shouldLog) {
         SCLogVideoStreamerInfo(@"begin annoucing sampleBuffer:%p of devicePosition:%lu", sampleBuffer,
                                (unsigned long)_devicePosition);
     }
     [_announcer managedVideoDataSource:self didOutputSampleBuffer:sampleBuffer devicePosition:_devicePosition];
+    SCHotPathTrace1(SCHotPathTraceEventVideoStreamerEndAnnouncing, SCHotPathTracePointer(sampleBuffer));
     if (shouldLog) {
         SCLogVideoStreamerInfo(@"end annoucing sampleBuffer:%p", sampleBuffer);
     }
 }
 
+#pragma mark - Pipelined Processing
+
+- (void)_renderPipelined:(RenderData)renderData shouldLog:(BOOL)shouldLog
+{
+    SCAssertPerformer(_performer);
+    BOOL pipelineChanged = _pipelinedFramesCount > 0 && _pipelinedFramesPipeline != _processingPipeline;
+    if (_pipelinedFramesCount >= kSCManagedVideoStreamerMaxPipelinedFrames || pipelineChanged) {
+        // Backpressure: only the newest frame waits for a free slot, or for the frames of the previous pipeline to be
+        // done, the one it replaces is dropped.
+        [self _setWaitingSampleBuffer:renderData.sampleBuffer depthData:renderData.depthDataMap];
+        return;
+    }
+
+    CMSampleBufferRef sampleBuffer = (CMSampleBufferRef)CFRetain(renderData.sampleBuffer);
+    CVPixelBufferRef depthDataMap = CVPixelBufferRetain(renderData.depthDataMap);
+    ++_pipelinedFramesCount;
+    atomic_fetch_add(&_processingBuffersCount, 1);
+    SCProcessingPipeline *processingPipeline = _processingPipeline;
+    _pipelinedFramesPipeline = processingPipeline;
+    [processingPipeline render:renderData
+                     performer:_performer
+             completionHandler:^(CMSampleBufferRef processedSampleBuffer) {
+                 // Completion handlers are called in submission order, so listeners still see frames in order.
+                 if (--_pipelinedFramesCount == 0) {
+                     _pipelinedFramesPipeline = nil;
+                 }
+                 atomic_fetch_sub(&_processingBuffersCount, 1);
+                 SCHotPathTrace2(SCHotPathTraceEventVideoStreamerRendered,
+                                 SCHotPathTracePointer(processedSampleBuffer), YES);
+                 if (shouldLog) {
+                     SCLogVideoStreamerInfo(@"rendered sampleBuffer:%p in processingPipeline:%@ (pipelined)",
+                                            processedSampleBuffer, processingPipeline);
+                 }
+                 if (!_performingConfigurations) {
+                     NSTimeInterval presentationTime =
+                         CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(processedSampleBuffer));
+                     [self _displayAndAnnounceSampleBuffer:processedSampleBuffer
+                                              frameLatency:CACurrentMediaTime() - presentationTime
+                                                 shouldLog:shouldLog];
+                 }
+                 CFRelease(sampleBuffer);
+                 CVPixelBufferRelease(depthDataMap);
+                 [self _renderWaitingSampleBufferIfNeeded];
+             }];
+}
+
+- (void)_renderWaitingSampleBufferIfNeeded
+{
+    SC_GUARD_ELSE_RETURN(_waitingSampleBuffer);
+    if (_performingConfigurations) {
+        [self _releaseWaitingSampleBuffer];
+        return;
+    }
+    if (!_processingPipeline && _pipelinedFramesCount > 0) {
+        return;
+    }
+    CMSampleBufferRef sampleBuffer = _waitingSampleBuffer;
+    CVPixelBufferRef depthDataMap = _waitingDepthDataMap;
+    _waitingSampleBuffer = NULL;
+    _waitingDepthDataMap = NULL;
+    atomic_fetch_sub(&_processingBuffersCount, 1);
+    if (_processingPipeline) {
+        [self _renderPipelined:[self _renderDataWithSampleBuffer:sampleBuffer depthData:depthDataMap] shouldLog:NO];
+    } else {
+        // The pipeline was removed while the frame waited
+        NSTimeInterval presentationTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
+        [self _displayAndAnnounceSampleBuffer:sampleBuffer
+                                 frameLatency:CACurrentMediaTime() - presentationTime
+                                    shouldLog:NO];
+    }
+    CFRelease(sampleBuffer);
+    CVPixelBufferRelease(depthDataMap);
+}
+
+- (void)_setWaitingSampleBuffer:(CMSampleBufferRef)sampleBuffer depthData:(CVPixelBufferRef)depthDataMap
+{
+    if (_waitingSampleBuffer) {
+        [self didDropSampleBuffer:_waitingSampleBuffer];
+        [self _releaseWaitingSampleBuffer];
+    }
+    _waitingSampleBuffer = (CMSampleBufferRef)CFRetain(sampleBuffer);
+    _waitingDepthDataMap = CVPixelBufferRetain(depthDataMap);
+    atomic_fetch_add(&_processingBuffersCount, 1);
+}
+
+- (void)_releaseWaitingSampleBuffer
+{
+    if (_waitingSampleBuffer) {
+        CFRelease(_waitingSampleBuffer);
+        _waitingSampleBuffer = NULL;
+        atomic_fetch_sub(&_processingBuffersCount, 1);
+    }
+    CVPixelBufferRelease(_waitingDepthDataMap);
+    _waitingDepthDataMap = NULL;
+}
+
 - (void)didDropSampleBuffer:(CMSampleBufferRef)sampleBuffer
 {
     if (_performingConfigurations) {
@@ -541,6 +727,8 @@ static int32_t const kSCManagedVideoStreamerMaxProcessingBuffers = 15;
     SC_GUARD_ELSE_RETURN([_performer isCurrentPerformer]);
     NSTimeInterval currentProcessingTime = CACurrentMediaTime();
     NSTimeInterval currentSampleTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
+    SCHotPathTrace3(SCHotPathTraceEventVideoStreamerDropped, SCHotPathTracePointer(sampleBuffer),
+                    SCHotPathTraceDouble(currentProcessingTime), SCHotPathTraceDouble(currentSampleTime));
     // Only logging it when sticky tweak is on, which means sticky time is too long, and AVFoundation have to drop the
     // sampleBuffer
     if (_keepLateFrames) {
@@ -690,18 +878,11 @@ didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer
     // Make sure that current frame is no longer being used, otherwise drop current frame.
     SC_GUARD_ELSE_RETURN(self.currentFrame == nil);
 
-    CVPixelBufferRef pixelBuffer = frame.capturedImage;
-    CVPixelBufferLockBaseAddress(pixelBuffer, 0);
-    CMTime time = CMTimeMakeWithSeconds(frame.timestamp, 1000000);
-    CMSampleTimingInfo timing = {kCMTimeInvalid, time, kCMTimeInvalid};
-
-    CMVideoFormatDescriptionRef videoInfo;
-    CMVideoFormatDescriptionCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, &videoInfo);
-
-    CMSampleBufferRef buffer;
-    CMSampleBufferCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, YES, nil, nil, videoInfo, &timing, &buffer);
-    CFRelease(videoInfo);
-    CVPixelBufferUnlockBaseAddress(pixelBuffer, 0);
+    // Wrapping the captured image doesn't touch its pixels, so it doesn't need to be locked
+    CMSampleBufferRef buffer = [[SCSampleBufferFactory sharedFactory]
+        createSampleBufferWithPixelBuffer:frame.capturedImage
+                         presentationTime:CMTimeMakeWithSeconds(frame.timestamp, 1000000)];
+    SC_GUARD_ELSE_RETURN(buffer);
 
     self.currentFrame = frame;
     [self didOutputSampleBuffer:buffer];
@@ -738,6 +919,26 @@ didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer
 
 #pragma mark - Private methods
 
+// Removes the lanes of the listener along with the lanes whose listener went away
+- (void)_removeDeliveryLanesOfListener:(id<SCManagedVideoDataSourceListener>)listener
+{
+    NSMutableArray<SCManagedVideoFrameDeliveryLane *> *removedLanes = [NSMutableArray array];
+    @synchronized(_deliveryLanes)
+    {
+        for (SCManagedVideoFrameDeliveryLane *deliveryLane in _deliveryLanes) {
+            id<SCManagedVideoDataSourceListener> laneListener = deliveryLane.listener;
+            if (!laneListener || laneListener == listener) {
+                [removedLanes addObject:deliveryLane];
+            }
+        }
+        [_deliveryLanes removeObjectsInArray:removedLanes];
+    }
+    for (SCManagedVideoFrameDeliveryLane *deliveryLane in removedLanes) {
+        [_announcer removeListener:deliveryLane];
+        SCLogVideoStreamerInfo(@"removed delivery lane:%@", deliveryLane);
+    }
+}
+
 - (void)_performCompletionHandlersForWaitUntilSampleBufferDisplayed
 {
     for (NSArray *completion in _waitUntilSampleBufferDisplayedBlocks) {
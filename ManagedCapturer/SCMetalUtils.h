@@ -18,6 +18,9 @@ SC_EXTERN_C_BEGIN
 
 #if !TARGET_IPHONE_SIMULATOR
 extern id<MTLDevice> SCGetManagedCaptureMetalDevice(void);
+
+// The camera shaders, loaded once
+extern id<MTLLibrary> SCGetManagedCaptureMetalLibrary(void);
 #endif
 
 static SC_ALWAYS_INLINE BOOL SCDeviceSupportsMetal(void)
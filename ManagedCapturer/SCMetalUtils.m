@@ -8,6 +8,7 @@
 
 #import "SCMetalUtils.h"
 
+#import <SCFoundation/SCLog.h>
 #import <SCFoundation/SCTrace.h>
 
 id<MTLDevice> SCGetManagedCaptureMetalDevice(void)
@@ -23,3 +24,20 @@ id<MTLDevice> SCGetManagedCaptureMetalDevice(void)
 #endif
     return nil;
 }
+
+#if !TARGET_IPHONE_SIMULATOR
+id<MTLLibrary> SCGetManagedCaptureMetalLibrary(void)
+{
+    static dispatch_once_t onceToken;
+    static id<MTLLibrary> library;
+    dispatch_once(&onceToken, ^{
+        NSString *libPath = [[NSBundle mainBundle] pathForResource:@"sccamera-default" ofType:@"metallib"];
+        NSError *error = nil;
+        library = [SCGetManagedCaptureMetalDevice() newLibraryWithFile:libPath error:&error];
+        if (error) {
+            SCLogGeneralError(@"Create metallib error: %@", error.description);
+        }
+    });
+    return library;
+}
+#endif
@@ -0,0 +1,30 @@
+//
+//  SCPlaneCopy.cpp
+//  Snapchat
+//
+
+#include "SCPlaneCopy.h"
+
+#include <cstring>
+
+namespace SC {
+
+void PlaneRegionCopy(const PlaneRegion &region)
+{
+    if (region.rows == 0) {
+        return;
+    }
+    if (region.bytesPerRow == region.sourceBytesPerRow && region.bytesPerRow == region.destinationBytesPerRow) {
+        memcpy(region.destination, region.source, region.bytesPerRow * region.rows);
+        return;
+    }
+    const uint8_t *source = region.source;
+    uint8_t *destination = region.destination;
+    for (size_t row = 0; row < region.rows; ++row) {
+        memcpy(destination, source, region.bytesPerRow);
+        source += region.sourceBytesPerRow;
+        destination += region.destinationBytesPerRow;
+    }
+}
+
+} // namespace SC
@@ -0,0 +1,33 @@
+//
+//  SCPlaneCopy.h
+//  Snapchat
+//
+//  Platform independent copy of a rectangular region between two image planes with different strides, e.g. to crop
+//  the planes of a 420YpCbCr8BiPlanar pixel buffer.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SC {
+
+struct PlaneRegion {
+    // First byte of the region in each plane
+    const uint8_t *source;
+    size_t sourceBytesPerRow;
+    uint8_t *destination;
+    size_t destinationBytesPerRow;
+    // Bytes copied from each row, and number of rows of the region
+    size_t bytesPerRow;
+    size_t rows;
+};
+
+/*
+ Copies the region a row at a time with memcpy, or in one memcpy when both planes are contiguous over it. memcpy is
+ already vectorized, a hand written copy loop is no faster, see SCPlaneCopyBenchmark.
+ */
+void PlaneRegionCopy(const PlaneRegion &region);
+
+} // namespace SC
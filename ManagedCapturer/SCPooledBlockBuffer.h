@@ -0,0 +1,29 @@
+//
+//  SCPooledBlockBuffer.h
+//  Snapchat
+//
+//  CMBlockBuffers wrapping blocks of an SC::BlockPool, the block goes back to the pool once the block buffer is freed.
+//  Objective-C++ only.
+//
+
+#import "SCBlockPool.h"
+
+#import <CoreMedia/CoreMedia.h>
+
+static void SCPooledBlockBufferFreeBlock(void *refCon, void *block, size_t sizeInBytes)
+{
+    static_cast<SC::BlockPool *>(refCon)->releaseBlock(block);
+}
+
+/*
+ Wraps a block acquired from the pool, whose first length bytes are filled, without copying. The block buffer owns
+ the block on success, it is left to the caller otherwise.
+ */
+static inline OSStatus SCPooledBlockBufferCreate(SC::BlockPool *pool, void *block, size_t length,
+                                                 CMBlockBufferRef *blockBufferOut)
+{
+    CMBlockBufferCustomBlockSource blockSource = {kCMBlockBufferCustomBlockSourceVersion, NULL,
+                                                  SCPooledBlockBufferFreeBlock, pool};
+    return CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, block, pool->blockSize(), kCFAllocatorNull,
+                                              &blockSource, 0, length, 0, blockBufferOut);
+}
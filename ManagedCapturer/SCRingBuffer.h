@@ -0,0 +1,96 @@
+//
+//  SCRingBuffer.h
+//  Snapchat
+//
+//  Fixed capacity FIFO ring buffer. It never allocates after construction and takes no locks, it is not thread safe
+//  though, and is meant to be confined to the queue of its owner.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace SC {
+
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity)
+        : _storage(capacity > 0 ? capacity : 1)
+        , _head(0)
+        , _count(0)
+    {
+    }
+
+    size_t capacity() const
+    {
+        return _storage.size();
+    }
+
+    size_t size() const
+    {
+        return _count;
+    }
+
+    bool empty() const
+    {
+        return _count == 0;
+    }
+
+    bool full() const
+    {
+        return _count == _storage.size();
+    }
+
+    // Returns false, leaving the ring untouched, when it is full
+    bool push(const T &item)
+    {
+        if (full()) {
+            return false;
+        }
+        _storage[(_head + _count) % _storage.size()] = item;
+        ++_count;
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        if (empty()) {
+            return false;
+        }
+        item = _storage[_head];
+        _head = (_head + 1) % _storage.size();
+        --_count;
+        return true;
+    }
+
+    // Oldest item first
+    const T &operator[](size_t index) const
+    {
+        return _storage[(_head + index) % _storage.size()];
+    }
+
+    const T &front() const
+    {
+        return (*this)[0];
+    }
+
+    const T &back() const
+    {
+        return (*this)[_count - 1];
+    }
+
+    void clear()
+    {
+        _head = 0;
+        _count = 0;
+    }
+
+private:
+    std::vector<T> _storage;
+    size_t _head;
+    size_t _count;
+};
+
+} // namespace SC
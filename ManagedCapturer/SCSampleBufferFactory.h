@@ -0,0 +1,32 @@
+//
+//  SCSampleBufferFactory.h
+//  Snapchat
+//
+
+#import <CoreMedia/CoreMedia.h>
+#import <CoreVideo/CoreVideo.h>
+#import <Foundation/Foundation.h>
+
+/*
+ @class SCSampleBufferFactory
+    Wraps pixel buffers in sample buffers for the sources which don't get them from AVFoundation: ARKit frames, video
+        files and the processing modules. The video format descriptions are cached by dimensions and pixel format, so
+        a frame of a known format only allocates its sample buffer. Thread safe.
+ */
+@interface SCSampleBufferFactory : NSObject
+
++ (instancetype)sharedFactory;
+
+// Returns a +1 sample buffer with the given timing, NULL on error. The pixel buffer doesn't need to be locked.
+- (CMSampleBufferRef)createSampleBufferWithPixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                            timingInfo:(const CMSampleTimingInfo *)timingInfo CF_RETURNS_RETAINED;
+
+- (CMSampleBufferRef)createSampleBufferWithPixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                      presentationTime:(CMTime)presentationTime CF_RETURNS_RETAINED;
+
+// Core Media objects created since launch, for allocation benchmarks: ideally one sample buffer per frame and a
+// format description per format only
+@property (nonatomic, assign, readonly) NSUInteger sampleBufferCreationCount;
+@property (nonatomic, assign, readonly) NSUInteger formatDescriptionCreationCount;
+
+@end
@@ -0,0 +1,146 @@
+//
+//  SCSampleBufferFactory.m
+//  Snapchat
+//
+
+#import "SCSampleBufferFactory.h"
+
+#import <SCBase/SCMacros.h>
+#import <SCFoundation/SCLog.h>
+
+// Camera, AR and processed frames rarely use more than a couple of formats at once
+static NSUInteger const kSCSampleBufferFactoryMaxFormatDescriptions = 4;
+
+typedef struct SCSampleBufferFactoryFormat {
+    size_t width;
+    size_t height;
+    OSType pixelFormat;
+    CMVideoFormatDescriptionRef formatDescription;
+} SCSampleBufferFactoryFormat;
+
+@implementation SCSampleBufferFactory {
+    // Guarded by @synchronized(self) along with the statistics
+    SCSampleBufferFactoryFormat _formats[kSCSampleBufferFactoryMaxFormatDescriptions];
+    NSUInteger _nextFormatIndex;
+    NSUInteger _sampleBufferCreationCount;
+    NSUInteger _formatDescriptionCreationCount;
+}
+
++ (instancetype)sharedFactory
+{
+    static SCSampleBufferFactory *sharedFactory;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedFactory = [[SCSampleBufferFactory alloc] init];
+    });
+    return sharedFactory;
+}
+
+- (void)dealloc
+{
+    for (NSUInteger index = 0; index < kSCSampleBufferFactoryMaxFormatDescriptions; ++index) {
+        if (_formats[index].formatDescription) {
+            CFRelease(_formats[index].formatDescription);
+        }
+    }
+}
+
+- (NSUInteger)sampleBufferCreationCount
+{
+    @synchronized(self)
+    {
+        return _sampleBufferCreationCount;
+    }
+}
+
+- (NSUInteger)formatDescriptionCreationCount
+{
+    @synchronized(self)
+    {
+        return _formatDescriptionCreationCount;
+    }
+}
+
+- (CMSampleBufferRef)createSampleBufferWithPixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                      presentationTime:(CMTime)presentationTime
+{
+    CMSampleTimingInfo timingInfo = {kCMTimeInvalid, presentationTime, kCMTimeInvalid};
+    return [self createSampleBufferWithPixelBuffer:pixelBuffer timingInfo:&timingInfo];
+}
+
+- (CMSampleBufferRef)createSampleBufferWithPixelBuffer:(CVPixelBufferRef)pixelBuffer
+                                            timingInfo:(const CMSampleTimingInfo *)timingInfo
+{
+    SC_GUARD_ELSE_RETURN_VALUE(pixelBuffer, NULL);
+    CMVideoFormatDescriptionRef formatDescription = [self _copyFormatDescriptionForPixelBuffer:pixelBuffer];
+    SC_GUARD_ELSE_RETURN_VALUE(formatDescription, NULL);
+    CMSampleBufferRef sampleBuffer = NULL;
+    OSStatus status = CMSampleBufferCreateReadyWithImageBuffer(kCFAllocatorDefault, pixelBuffer, formatDescription,
+                                                               timingInfo, &sampleBuffer);
+    CFRelease(formatDescription);
+    if (status != noErr) {
+        SCLogGeneralError(@"[SCSampleBufferFactory] Error creating sample buffer %i", (int)status);
+        return NULL;
+    }
+    @synchronized(self)
+    {
+        ++_sampleBufferCreationCount;
+    }
+    return sampleBuffer;
+}
+
+#pragma mark - Private methods
+
+- (CMVideoFormatDescriptionRef)_copyFormatDescriptionForPixelBuffer:(CVPixelBufferRef)pixelBuffer
+{
+    size_t width = CVPixelBufferGetWidth(pixelBuffer);
+    size_t height = CVPixelBufferGetHeight(pixelBuffer);
+    OSType pixelFormat = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    @synchronized(self)
+    {
+        for (NSUInteger index = 0; index < kSCSampleBufferFactoryMaxFormatDescriptions; ++index) {
+            SCSampleBufferFactoryFormat *format = &_formats[index];
+            // The description also carries the color attachments of the buffer, those have to match as well
+            if (format->formatDescription && format->width == width && format->height == height &&
+                format->pixelFormat == pixelFormat &&
+                CMVideoFormatDescriptionMatchesImageBuffer(format->formatDescription, pixelBuffer)) {
+                return (CMVideoFormatDescriptionRef)CFRetain(format->formatDescription);
+            }
+        }
+    }
+
+    CMVideoFormatDescriptionRef formatDescription = NULL;
+    OSStatus status =
+        CMVideoFormatDescriptionCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, &formatDescription);
+    if (status != noErr) {
+        SCLogGeneralError(@"[SCSampleBufferFactory] Error creating video format description %i", (int)status);
+        return NULL;
+    }
+    @synchronized(self)
+    {
+        ++_formatDescriptionCreationCount;
+        // A stale description of the same dimensions and pixel format is replaced, otherwise the oldest one
+        NSUInteger replacedIndex = _nextFormatIndex;
+        for (NSUInteger index = 0; index < kSCSampleBufferFactoryMaxFormatDescriptions; ++index) {
+            if (_formats[index].formatDescription && _formats[index].width == width &&
+                _formats[index].height == height && _formats[index].pixelFormat == pixelFormat) {
+                replacedIndex = index;
+                break;
+            }
+        }
+        if (replacedIndex == _nextFormatIndex) {
+            _nextFormatIndex = (_nextFormatIndex + 1) % kSCSampleBufferFactoryMaxFormatDescriptions;
+        }
+        SCSampleBufferFactoryFormat *format = &_formats[replacedIndex];
+        if (format->formatDescription) {
+            CFRelease(format->formatDescription);
+        }
+        format->width = width;
+        format->height = height;
+        format->pixelFormat = pixelFormat;
+        format->formatDescription = (CMVideoFormatDescriptionRef)CFRetain(formatDescription);
+    }
+    return formatDescription;
+}
+
+@end
@@ -0,0 +1,245 @@
+//
+//  SCStagingQueue.h
+//  Snapchat
+//
+//  Bounded staging queue for samples waiting on a consumer that isn't ready yet, e.g. an AVAssetWriterInput which is
+//  not readyForMoreMediaData. It is a single producer single consumer ring, lock free on push and pop, and never
+//  allocates after construction.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace SC {
+
+enum class StagingOverflowPolicy {
+    // Drop the oldest staged item to make room for the new one
+    DropOldest,
+    // Wait up to the timeout for the consumer to make room, then drop the oldest staged item
+    BlockWithTimeout,
+    // Items past the capacity go to a reserve allocated along with it. Only once the reserve is full too, the producer
+    // waits up to the timeout for room, and the push fails if there is still none.
+    NeverDrop,
+};
+
+// Updated by the producer, only read them from its side
+struct StagingStatistics {
+    size_t highWaterMark;
+    size_t droppedCount;
+    // Items which went to the reserve
+    size_t reservedCount;
+    // Pushes which failed, NeverDrop only
+    size_t overflowCount;
+    double blockedSeconds;
+};
+
+/*
+ push, notify and statistics are for the producer, pop for the consumer, which may run on another thread. The producer
+ can also drop the oldest item, the two sides race for it with a compare and swap on the head. Both sides can be the
+ same thread, e.g. the queue of the owner.
+
+ Release is called with every item the queue drops or clears, items handed out by pop are owned by the caller. Items
+ are kept in atomics, so T has to be trivially copyable, e.g. a CF type.
+ */
+template <typename T, typename Release>
+class StagingQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "Staged items are kept in atomics");
+
+public:
+    StagingQueue(size_t capacity, StagingOverflowPolicy policy, double timeout = 0, size_t reserve = 0,
+                 Release release = Release())
+        : _capacity(std::max<size_t>(capacity, 1))
+        , _slotCount(_capacity + (policy == StagingOverflowPolicy::NeverDrop ? reserve : 0))
+        , _slots(new std::atomic<T>[_slotCount])
+        , _policy(policy)
+        , _timeout(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout)))
+        , _release(release)
+        , _head(0)
+        , _tail(0)
+        , _producerWaiting(false)
+        , _roomGeneration(0)
+        , _statistics()
+    {
+    }
+
+    ~StagingQueue()
+    {
+        clear();
+    }
+
+    StagingQueue(const StagingQueue &) = delete;
+    StagingQueue &operator=(const StagingQueue &) = delete;
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    // Exact on the producer side while the consumer is idle, a snapshot otherwise
+    size_t size() const
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /*
+     Takes ownership of item. Returns false if it was released instead of staged, which only happens with NeverDrop.
+     drain is called while the producer waits for room, it should pop what the consumer can take without waiting and
+     return whether it popped anything. It lets a producer which is also the consumer make room itself.
+     */
+    template <typename Drain>
+    bool push(const T &item, Drain drain)
+    {
+        size_t limit = _policy == StagingOverflowPolicy::NeverDrop ? _slotCount : _capacity;
+        if (size() >= _capacity) {
+            switch (_policy) {
+            case StagingOverflowPolicy::DropOldest:
+                _dropOldest();
+                break;
+            case StagingOverflowPolicy::BlockWithTimeout:
+                if (!_waitForRoom(limit, drain)) {
+                    _dropOldest();
+                }
+                break;
+            case StagingOverflowPolicy::NeverDrop:
+                if (size() >= limit && !_waitForRoom(limit, drain)) {
+                    _release(item);
+                    ++_statistics.overflowCount;
+                    return false;
+                }
+                if (size() >= _capacity) {
+                    ++_statistics.reservedCount;
+                }
+                break;
+            }
+        }
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        _slots[tail % _slotCount].store(item, std::memory_order_relaxed);
+        _tail.store(tail + 1, std::memory_order_release);
+        _statistics.highWaterMark = std::max(_statistics.highWaterMark, size());
+        return true;
+    }
+
+    bool push(const T &item)
+    {
+        return push(item, [] { return false; });
+    }
+
+    bool pop(T &item)
+    {
+        size_t head = _head.load(std::memory_order_acquire);
+        do {
+            if (head == _tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = _slots[head % _slotCount].load(std::memory_order_relaxed);
+        } while (!_head.compare_exchange_weak(head, head + 1, std::memory_order_seq_cst));
+        if (_producerWaiting.load(std::memory_order_seq_cst)) {
+            notify();
+        }
+        return true;
+    }
+
+    // Wakes up a producer waiting for room so that it drains again, e.g. when the consumer becomes ready
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_roomMutex);
+            ++_roomGeneration;
+        }
+        _roomCondition.notify_one();
+    }
+
+    // Only while the other side is idle
+    void clear()
+    {
+        T item;
+        while (pop(item)) {
+            _release(item);
+        }
+    }
+
+    const StagingStatistics &statistics() const
+    {
+        return _statistics;
+    }
+
+    void resetStatistics()
+    {
+        _statistics = StagingStatistics();
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void _dropOldest()
+    {
+        size_t head = _head.load(std::memory_order_acquire);
+        if (head == _tail.load(std::memory_order_relaxed)) {
+            return;
+        }
+        T oldest = _slots[head % _slotCount].load(std::memory_order_relaxed);
+        // Losing the race means the consumer popped it, which made room as well
+        if (_head.compare_exchange_strong(head, head + 1, std::memory_order_seq_cst)) {
+            _release(oldest);
+            ++_statistics.droppedCount;
+        }
+    }
+
+    template <typename Drain>
+    bool _waitForRoom(size_t limit, Drain drain)
+    {
+        Clock::time_point start = Clock::now();
+        Clock::time_point deadline = start + _timeout;
+        bool room = false;
+        while (!(room = size() < limit)) {
+            if (drain()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_roomMutex);
+            uint64_t generation = _roomGeneration;
+            _producerWaiting.store(true, std::memory_order_seq_cst);
+            // Sequentially consistent with the flag, so that either pop sees it or this sees the popped head
+            bool woken = _roomCondition.wait_until(lock, deadline, [&] {
+                return _roomGeneration != generation ||
+                       _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_seq_cst) < limit;
+            });
+            _producerWaiting.store(false, std::memory_order_relaxed);
+            if (!woken) {
+                room = size() < limit;
+                break;
+            }
+        }
+        _statistics.blockedSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        return room;
+    }
+
+    const size_t _capacity;
+    const size_t _slotCount;
+    const std::unique_ptr<std::atomic<T>[]> _slots;
+    const StagingOverflowPolicy _policy;
+    const Clock::duration _timeout;
+    Release _release;
+    // Monotonic indexes, the slot of an index is index % _slotCount
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+    std::atomic<bool> _producerWaiting;
+    std::mutex _roomMutex;
+    std::condition_variable _roomCondition;
+    uint64_t _roomGeneration;
+    StagingStatistics _statistics;
+};
+
+} // namespace SC
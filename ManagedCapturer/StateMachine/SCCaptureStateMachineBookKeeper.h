@@ -10,16 +10,37 @@
 
 #import <Foundation/Foundation.h>
 
+@class SCCaptureStateMachineRecorder;
+
 /*
  Book keeper is used to record every state transition, and every illegal API call.
+
+ Transitions are timed on a monotonic clock into per (from, to) latency histograms, both for how long the previous
+ state lasted and for how long the transition took. They are flushed to SCLogger every 10 minutes.
  */
 
 @interface SCCaptureStateMachineBookKeeper : NSObject
 
+// When set, the latest API calls are attached to illegal API call reports
+@property (nonatomic, weak) SCCaptureStateMachineRecorder *recorder;
+
 - (void)stateTransitionFrom:(SCCaptureStateMachineStateId)fromId
                          to:(SCCaptureStateMachineStateId)toId
                     context:(NSString *)context;
 
+// Called once the new state became the current one
+- (void)didCompleteStateTransitionFrom:(SCCaptureStateMachineStateId)fromId to:(SCCaptureStateMachineStateId)toId;
+
+// Percentile (0-100) of the duration of the transitions from fromId to toId seen since the last flush
+- (CFTimeInterval)transitionLatencyFrom:(SCCaptureStateMachineStateId)fromId
+                                     to:(SCCaptureStateMachineStateId)toId
+                             percentile:(double)percentile;
+
+// Count, p50, p99 and max of the transition and of the life span of the previous state, keyed by "from>to"
+- (NSDictionary<NSString *, NSDictionary *> *)transitionLatencies;
+
+- (void)flushTransitionLatencies;
+
 - (void)state:(SCCaptureStateMachineStateId)captureState
     illegalAPIcalled:(NSString *)illegalAPIName
            callStack:(NSArray<NSString *> *)callStack
@@ -0,0 +1,195 @@
+//
+//  SCCaptureStateTransitionBookKeeper.mm
+//  Snapchat
+//
+//  Created by Lin Jia on 10/27/17.
+//
+//
+
+#import "SCCaptureStateMachineBookKeeper.h"
+
+#import "SCCaptureStateMachineRecorder.h"
+#import "SCCaptureStateUtil.h"
+#import "SCLatencyHistogram.h"
+#import "SCLogger+Camera.h"
+
+#import <SCFoundation/SCAssertWrapper.h>
+#import <SCLogger/SCCameraMetrics.h>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+
+@import QuartzCore;
+
+static NSString *const kSCCaptureStateMachineTransitionLatencyEvent = @"CAMERA_STATE_TRANSITION_LATENCY";
+
+// Histograms are flushed on the first transition after this interval
+static CFTimeInterval const kSCCaptureStateMachineLatencyFlushInterval = 10 * 60;
+
+namespace {
+
+const NSUInteger kSCCaptureStateTransitionCount = SCCaptureStateMachineStateIdCount * SCCaptureStateMachineStateIdCount;
+
+// Indexed by SCCaptureStateTransitionIndex
+struct SCCaptureStateTransitionHistograms {
+    std::array<SC::LatencyHistogram, kSCCaptureStateTransitionCount> lifeSpans;
+    std::array<SC::LatencyHistogram, kSCCaptureStateTransitionCount> transitions;
+};
+
+NSUInteger SCCaptureStateTransitionIndex(SCCaptureStateMachineStateId fromId, SCCaptureStateMachineStateId toId)
+{
+    return fromId * SCCaptureStateMachineStateIdCount + toId;
+}
+
+uint32_t SCLatencyMicroseconds(CFTimeInterval interval)
+{
+    return (uint32_t)std::min(std::max(interval * USEC_PER_SEC, 0.0), (double)UINT32_MAX);
+}
+
+NSDictionary *SCLatencyDescription(const SC::LatencyHistogram &histogram)
+{
+    return @{
+        @"count" : @(histogram.count()),
+        @"p50_ms" : @(histogram.valueAtPercentile(50) / 1000.0),
+        @"p99_ms" : @(histogram.valueAtPercentile(99) / 1000.0),
+        @"max_ms" : @(histogram.max() / 1000.0)
+    };
+}
+
+} // namespace
+
+@interface SCCaptureStateMachineBookKeeper () {
+    // Only touched on the capturer queue
+    CFTimeInterval _lastStateStartTime;
+    CFTimeInterval _transitionStartTime;
+    CFTimeInterval _lastFlushTime;
+
+    std::unique_ptr<SCCaptureStateTransitionHistograms> _histograms;
+    std::mutex _histogramsMutex;
+}
+@end
+
+@implementation SCCaptureStateMachineBookKeeper
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _histograms.reset(new SCCaptureStateTransitionHistograms());
+        _lastStateStartTime = CACurrentMediaTime();
+        _lastFlushTime = _lastStateStartTime;
+    }
+    return self;
+}
+
+- (void)stateTransitionFrom:(SCCaptureStateMachineStateId)fromId
+                         to:(SCCaptureStateMachineStateId)toId
+                    context:(NSString *)context
+{
+    SC_GUARD_ELSE_RETURN(fromId < SCCaptureStateMachineStateIdCount && toId < SCCaptureStateMachineStateIdCount);
+    CFTimeInterval now = CACurrentMediaTime();
+    {
+        std::lock_guard<std::mutex> lock(_histogramsMutex);
+        _histograms->lifeSpans[SCCaptureStateTransitionIndex(fromId, toId)].record(
+            SCLatencyMicroseconds(now - _lastStateStartTime));
+    }
+    _lastStateStartTime = now;
+    _transitionStartTime = now;
+}
+
+- (void)didCompleteStateTransitionFrom:(SCCaptureStateMachineStateId)fromId to:(SCCaptureStateMachineStateId)toId
+{
+    SC_GUARD_ELSE_RETURN(fromId < SCCaptureStateMachineStateIdCount && toId < SCCaptureStateMachineStateIdCount);
+    CFTimeInterval now = CACurrentMediaTime();
+    {
+        std::lock_guard<std::mutex> lock(_histogramsMutex);
+        _histograms->transitions[SCCaptureStateTransitionIndex(fromId, toId)].record(
+            SCLatencyMicroseconds(now - _transitionStartTime));
+    }
+    if (now - _lastFlushTime > kSCCaptureStateMachineLatencyFlushInterval) {
+        _lastFlushTime = now;
+        [self flushTransitionLatencies];
+    }
+}
+
+- (CFTimeInterval)transitionLatencyFrom:(SCCaptureStateMachineStateId)fromId
+                                     to:(SCCaptureStateMachineStateId)toId
+                             percentile:(double)percentile
+{
+    SC_GUARD_ELSE_RETURN_VALUE(fromId < SCCaptureStateMachineStateIdCount && toId < SCCaptureStateMachineStateIdCount,
+                               0);
+    std::lock_guard<std::mutex> lock(_histogramsMutex);
+    const SC::LatencyHistogram &histogram = _histograms->transitions[SCCaptureStateTransitionIndex(fromId, toId)];
+    return (CFTimeInterval)histogram.valueAtPercentile(percentile) / USEC_PER_SEC;
+}
+
+- (NSDictionary<NSString *, NSDictionary *> *)transitionLatencies
+{
+    NSMutableDictionary<NSString *, NSDictionary *> *latencies = [NSMutableDictionary dictionary];
+    std::lock_guard<std::mutex> lock(_histogramsMutex);
+    for (NSUInteger index = 0; index < kSCCaptureStateTransitionCount; ++index) {
+        if (_histograms->transitions[index].count() == 0) {
+            continue;
+        }
+        auto fromId = SCCaptureStateMachineStateId(index / SCCaptureStateMachineStateIdCount);
+        auto toId = SCCaptureStateMachineStateId(index % SCCaptureStateMachineStateIdCount);
+        NSString *edge = [NSString stringWithFormat:@"%@>%@", SCCaptureStateName(fromId), SCCaptureStateName(toId)];
+        latencies[edge] = @{
+            @"transition" : SCLatencyDescription(_histograms->transitions[index]),
+            @"life_span" : SCLatencyDescription(_histograms->lifeSpans[index])
+        };
+    }
+    return latencies;
+}
+
+- (void)flushTransitionLatencies
+{
+    NSDictionary<NSString *, NSDictionary *> *latencies = [self transitionLatencies];
+    {
+        std::lock_guard<std::mutex> lock(_histogramsMutex);
+        for (auto &histogram : _histograms->transitions) {
+            histogram.reset();
+        }
+        for (auto &histogram : _histograms->lifeSpans) {
+            histogram.reset();
+        }
+    }
+    SC_GUARD_ELSE_RETURN(latencies.count > 0);
+    [[SCLogger sharedInstance] logEvent:kSCCaptureStateMachineTransitionLatencyEvent parameters:latencies];
+}
+
+- (void)state:(SCCaptureStateMachineStateId)captureState
+    illegalAPIcalled:(NSString *)illegalAPIName
+           callStack:(NSArray<NSString *> *)callStack
+             context:(NSString *)context
+
+{
+    SCAssert(callStack, @"call stack empty");
+    SCAssert(illegalAPIName, @"");
+    SCAssert(context, @"Context is empty");
+    SCLogCaptureStateMachineError(@"State: %@, illegal API invoke: %@, at: %@, callstack: %@ \n",
+                                  SCCaptureStateName(captureState), illegalAPIName, [NSDate date], callStack);
+    NSArray<NSString *> *reportedArray =
+        [callStack count] > 15 ? [callStack subarrayWithRange:NSMakeRange(0, 15)] : callStack;
+    NSMutableDictionary *parameters = [@{
+        @"state" : SCCaptureStateName(captureState),
+        @"API" : illegalAPIName,
+        @"call_stack" : reportedArray,
+        @"context" : context
+    } mutableCopy];
+    NSArray<NSDictionary *> *recentCalls = [_recorder recordedCallDescriptions];
+    if (recentCalls.count > 0) {
+        parameters[@"recent_calls"] = recentCalls;
+    }
+    [[SCLogger sharedInstance] logEvent:kSCCameraStateMachineIllegalAPICall parameters:parameters];
+}
+
+- (void)logAPICalled:(NSString *)apiName context:(NSString *)context
+{
+    SCAssert(apiName, @"API name is empty");
+    SCAssert(context, @"Context is empty");
+    SCLogCaptureStateMachineInfo(@"api: %@ context: %@", apiName, context);
+}
+@end
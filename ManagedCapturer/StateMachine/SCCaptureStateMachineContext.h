@@ -27,12 +27,17 @@
 
 @class SCCaptureResource;
 
+@class SCCaptureStateMachineRecorder;
+
 @class SCCapturerToken;
 
 @interface SCCaptureStateMachineContext : NSObject
 
 - (instancetype)initWithResource:(SCCaptureResource *)resource;
 
+// Latest API calls, only recorded when the tweak is on, nil otherwise
+@property (nonatomic, strong, readonly) SCCaptureStateMachineRecorder *recorder;
+
 - (void)initializeCaptureWithDevicePositionAsynchronously:(SCManagedCaptureDevicePosition)devicePosition
                                         completionHandler:(dispatch_block_t)completionHandler
                                                   context:(NSString *)context;
@@ -7,7 +7,9 @@
 //
 
 #import "SCCaptureStateMachineContext.h"
+#import "SCCaptureStateMachineContext_Private.h"
 
+#import "SCCameraTweaks.h"
 #import "SCCaptureBaseState.h"
 #import "SCCaptureImageState.h"
 #import "SCCaptureImageWhileRecordingState.h"
@@ -17,6 +19,7 @@
 #import "SCCaptureRunningState.h"
 #import "SCCaptureScanningState.h"
 #import "SCCaptureStateMachineBookKeeper.h"
+#import "SCCaptureStateMachineRecorder.h"
 #import "SCCaptureStateUtil.h"
 #import "SCCaptureUninitializedState.h"
 #import "SCCaptureWorker.h"
@@ -33,17 +36,28 @@
 @interface SCCaptureStateMachineContext () <SCCaptureStateDelegate> {
     SCQueuePerformer *_queuePerformer;
 
-    // Cache all the states.
-    NSMutableDictionary<SCCaptureStateKey *, SCCaptureBaseState *> *_states;
+    // All the states, indexed by their id. There is no instance of the base state.
+    SCCaptureBaseState *_states[SCCaptureStateMachineStateIdCount];
     SCCaptureBaseState *_currentState;
     SCCaptureStateMachineBookKeeper *_bookKeeper;
     SCCaptureResource *_captureResource;
 }
 @end
 
+static NSUInteger const kSCCaptureStateMachineRecordedCallCount = 64;
+
 @implementation SCCaptureStateMachineContext
 
 - (instancetype)initWithResource:(SCCaptureResource *)resource
+{
+    SCCaptureStateMachineRecorder *recorder;
+    if (SCCameraTweaksRecordCaptureStateMachineCalls()) {
+        recorder = [[SCCaptureStateMachineRecorder alloc] initWithCapacity:kSCCaptureStateMachineRecordedCallCount];
+    }
+    return [self initWithResource:resource recorder:recorder];
+}
+
+- (instancetype)initWithResource:(SCCaptureResource *)resource recorder:(SCCaptureStateMachineRecorder *)recorder
 {
     self = [super init];
     if (self) {
@@ -51,84 +65,44 @@
         SCAssert(resource.queuePerformer, @"");
         _captureResource = resource;
         _queuePerformer = resource.queuePerformer;
-        _states = [[NSMutableDictionary<SCCaptureStateKey *, SCCaptureBaseState *> alloc] init];
         _bookKeeper = [[SCCaptureStateMachineBookKeeper alloc] init];
+        [self _createStates];
+        _recorder = recorder;
+        _bookKeeper.recorder = recorder;
         [self _setCurrentState:SCCaptureUninitializedStateId payload:nil context:SCCapturerContext];
     }
     return self;
 }
 
+- (void)_createStates
+{
+    Class stateClasses[SCCaptureStateMachineStateIdCount] = {
+        [SCCaptureUninitializedStateId] = [SCCaptureUninitializedState class],
+        [SCCaptureInitializedStateId] = [SCCaptureInitializedState class],
+        [SCCaptureImageStateId] = [SCCaptureImageState class],
+        [SCCaptureImageWhileRecordingStateId] = [SCCaptureImageWhileRecordingState class],
+        [SCCaptureRunningStateId] = [SCCaptureRunningState class],
+        [SCCaptureRecordingStateId] = [SCCaptureRecordingState class],
+        [SCCaptureScanningStateId] = [SCCaptureScanningState class],
+    };
+    for (NSUInteger stateId = 0; stateId < SCCaptureStateMachineStateIdCount; ++stateId) {
+        if (!stateClasses[stateId]) {
+            continue;
+        }
+        _states[stateId] =
+            [[stateClasses[stateId] alloc] initWithPerformer:_queuePerformer bookKeeper:_bookKeeper delegate:self];
+        SCAssert([_states[stateId] stateId] == stateId, @"State %@ at the wrong index",
+                 SCCaptureStateName([_states[stateId] stateId]));
+    }
+}
+
 - (void)_setCurrentState:(SCCaptureStateMachineStateId)stateId
                  payload:(SCStateTransitionPayload *)payload
                  context:(NSString *)context
 {
-    switch (stateId) {
-    case SCCaptureUninitializedStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureUninitializedState *uninitializedState =
-                [[SCCaptureUninitializedState alloc] initWithPerformer:_queuePerformer
-                                                            bookKeeper:_bookKeeper
-                                                              delegate:self];
-            [_states setObject:uninitializedState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    case SCCaptureInitializedStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureInitializedState *initializedState =
-                [[SCCaptureInitializedState alloc] initWithPerformer:_queuePerformer
-                                                          bookKeeper:_bookKeeper
-                                                            delegate:self];
-            [_states setObject:initializedState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    case SCCaptureRunningStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureRunningState *runningState =
-                [[SCCaptureRunningState alloc] initWithPerformer:_queuePerformer bookKeeper:_bookKeeper delegate:self];
-            [_states setObject:runningState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    case SCCaptureImageStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureImageState *captureImageState =
-                [[SCCaptureImageState alloc] initWithPerformer:_queuePerformer bookKeeper:_bookKeeper delegate:self];
-            [_states setObject:captureImageState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    case SCCaptureImageWhileRecordingStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureImageWhileRecordingState *captureImageWhileRecordingState =
-                [[SCCaptureImageWhileRecordingState alloc] initWithPerformer:_queuePerformer
-                                                                  bookKeeper:_bookKeeper
-                                                                    delegate:self];
-            [_states setObject:captureImageWhileRecordingState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    case SCCaptureScanningStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureScanningState *scanningState =
-                [[SCCaptureScanningState alloc] initWithPerformer:_queuePerformer bookKeeper:_bookKeeper delegate:self];
-            [_states setObject:scanningState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    case SCCaptureRecordingStateId:
-        if (![_states objectForKey:@(stateId)]) {
-            SCCaptureRecordingState *recordingState = [[SCCaptureRecordingState alloc] initWithPerformer:_queuePerformer
-                                                                                              bookKeeper:_bookKeeper
-                                                                                                delegate:self];
-            [_states setObject:recordingState forKey:@(stateId)];
-        }
-        _currentState = [_states objectForKey:@(stateId)];
-        break;
-    default:
-        SCAssert(NO, @"illigal state Id");
-        break;
+    SCAssert(stateId < SCCaptureStateMachineStateIdCount && _states[stateId], @"illigal state Id");
+    if (stateId < SCCaptureStateMachineStateIdCount && _states[stateId]) {
+        _currentState = _states[stateId];
     }
     [_currentState didBecomeCurrentState:payload resource:_captureResource context:context];
 }
@@ -139,14 +113,21 @@
 {
     [SCCaptureWorker setupCapturePreviewLayerController];
 
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState initializeCaptureWithDevicePosition:devicePosition
-                                                  resource:_captureResource
-                                         completionHandler:completionHandler
-                                                   context:context];
-    }];
+    [self _performAPI:@"initializeCapture"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine initializeCaptureWithDevicePositionAsynchronously:devicePosition
+                                                          completionHandler:^{
+                                                          }
+                                                                    context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState initializeCaptureWithDevicePosition:devicePosition
+                                                     resource:_captureResource
+                                            completionHandler:completionHandler
+                                                      context:context];
+        }];
 }
 
 - (SCCapturerToken *)startRunningWithContext:(NSString *)context completionHandler:(dispatch_block_t)completionHandler
@@ -154,14 +135,21 @@
     [[SCLogger sharedInstance] updateLogTimedEventStart:kSCCameraMetricsOpen uniqueId:@""];
 
     SCCapturerToken *token = [[SCCapturerToken alloc] initWithIdentifier:context];
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState startRunningWithCapturerToken:token
-                                            resource:_captureResource
-                                   completionHandler:completionHandler
-                                             context:context];
-    }];
+    [self _performAPI:@"startRunning"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [tokens setObject:[stateMachine startRunningWithContext:context
+                                                  completionHandler:^{
+                                                  }]
+                       forKey:token];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState startRunningWithCapturerToken:token
+                                               resource:_captureResource
+                                      completionHandler:completionHandler
+                                                context:context];
+        }];
 
     return token;
 }
@@ -170,14 +158,21 @@
                    completionHandler:(sc_managed_capturer_stop_running_completion_handler_t)completionHandler
                              context:(NSString *)context
 {
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState stopRunningWithCapturerToken:token
-                                           resource:_captureResource
-                                  completionHandler:completionHandler
-                                            context:context];
-    }];
+    [self _performAPI:@"stopRunning"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine stopRunningWithCapturerToken:[tokens objectForKey:token] ?: token
+                                     completionHandler:^(BOOL succeed){
+                                     }
+                                               context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState stopRunningWithCapturerToken:token
+                                              resource:_captureResource
+                                     completionHandler:completionHandler
+                                               context:context];
+        }];
 }
 
 - (void)stopRunningWithCapturerToken:(SCCapturerToken *)token
@@ -185,27 +180,38 @@
                    completionHandler:(sc_managed_capturer_stop_running_completion_handler_t)completionHandler
                              context:(NSString *)context
 {
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState stopRunningWithCapturerToken:token
-                                           resource:_captureResource
-                                  completionHandler:completionHandler
-                                            context:context];
-    }
-                       after:delay];
+    [self _performAPI:@"stopRunningAfterDelay"
+        context:context
+        after:delay
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine stopRunningWithCapturerToken:[tokens objectForKey:token] ?: token
+                                                 after:delay
+                                     completionHandler:^(BOOL succeed){
+                                     }
+                                               context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState stopRunningWithCapturerToken:token
+                                              resource:_captureResource
+                                     completionHandler:completionHandler
+                                               context:context];
+        }];
 }
 
 - (void)prepareForRecordingAsynchronouslyWithAudioConfiguration:(SCAudioConfiguration *)configuration
                                                         context:(NSString *)context
 {
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState prepareForRecordingWithResource:_captureResource
-                                    audioConfiguration:configuration
-                                               context:context];
-    }];
+    [self _performAPI:@"prepareForRecording"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine prepareForRecordingAsynchronouslyWithAudioConfiguration:configuration context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState prepareForRecordingWithResource:_captureResource
+                                       audioConfiguration:configuration
+                                                  context:context];
+        }];
 }
 
 - (void)startRecordingWithOutputSettings:(SCManagedVideoCapturerOutputSettings *)outputSettings
@@ -216,36 +222,55 @@
                        completionHandler:(sc_managed_capturer_start_recording_completion_handler_t)completionHandler
                                  context:(NSString *)context
 {
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState startRecordingWithResource:_captureResource
-                               audioConfiguration:configuration
-                                   outputSettings:outputSettings
-                                      maxDuration:maxDuration
-                                          fileURL:fileURL
-                                 captureSessionID:captureSessionID
-                                completionHandler:completionHandler
-                                          context:context];
-    }];
+    [self _performAPI:@"startRecording"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine startRecordingWithOutputSettings:outputSettings
+                                        audioConfiguration:configuration
+                                               maxDuration:maxDuration
+                                                   fileURL:fileURL
+                                          captureSessionID:captureSessionID
+                                         completionHandler:^(SCVideoCaptureSessionInfo sessionInfo, NSError *error){
+                                         }
+                                                   context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState startRecordingWithResource:_captureResource
+                                  audioConfiguration:configuration
+                                      outputSettings:outputSettings
+                                         maxDuration:maxDuration
+                                             fileURL:fileURL
+                                    captureSessionID:captureSessionID
+                                   completionHandler:completionHandler
+                                             context:context];
+        }];
 }
 
 - (void)stopRecordingWithContext:(NSString *)context
 {
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState stopRecordingWithResource:_captureResource context:context];
-    }];
+    [self _performAPI:@"stopRecording"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine stopRecordingWithContext:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState stopRecordingWithResource:_captureResource context:context];
+        }];
 }
 
 - (void)cancelRecordingWithContext:(NSString *)context
 {
-    SCTraceResumeToken resumeToken = SCTraceCapture();
-    [_queuePerformer perform:^{
-        SCTraceResume(resumeToken);
-        [_currentState cancelRecordingWithResource:_captureResource context:context];
-    }];
+    [self _performAPI:@"cancelRecording"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine cancelRecordingWithContext:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState cancelRecordingWithResource:_captureResource context:context];
+        }];
 }
 
 - (void)captureStillImageAsynchronouslyWithAspectRatio:(CGFloat)aspectRatio
@@ -254,27 +279,87 @@
                                          (sc_managed_capturer_capture_still_image_completion_handler_t)completionHandler
                                                context:(NSString *)context
 {
-    [_queuePerformer perform:^() {
-        [_currentState captureStillImageWithResource:_captureResource
-                                         aspectRatio:aspectRatio
-                                    captureSessionID:captureSessionID
-                                   completionHandler:completionHandler
-                                             context:context];
-    }];
+    [self _performAPI:@"captureStillImage"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine
+                captureStillImageAsynchronouslyWithAspectRatio:aspectRatio
+                                              captureSessionID:captureSessionID
+                                             completionHandler:^(UIImage *fullScreenImage, NSDictionary *metadata,
+                                                                 NSError *error, SCManagedCapturerState *state){
+                                             }
+                                                       context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState captureStillImageWithResource:_captureResource
+                                            aspectRatio:aspectRatio
+                                       captureSessionID:captureSessionID
+                                      completionHandler:completionHandler
+                                                context:context];
+        }];
 }
 
 - (void)startScanAsynchronouslyWithScanConfiguration:(SCScanConfiguration *)configuration context:(NSString *)context
 {
-    [_queuePerformer perform:^() {
-        [_currentState startScanWithScanConfiguration:configuration resource:_captureResource context:context];
-    }];
+    [self _performAPI:@"startScan"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine startScanAsynchronouslyWithScanConfiguration:configuration context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState startScanWithScanConfiguration:configuration resource:_captureResource context:context];
+        }];
 }
 
 - (void)stopScanAsynchronouslyWithCompletionHandler:(dispatch_block_t)completionHandler context:(NSString *)context
 {
-    [_queuePerformer perform:^() {
-        [_currentState stopScanWithCompletionHandler:completionHandler resource:_captureResource context:context];
-    }];
+    [self _performAPI:@"stopScan"
+        context:context
+        after:0
+        replayBlock:^(SCCaptureStateMachineContext *stateMachine, SCCaptureStateMachineReplayTokens *tokens) {
+            [stateMachine stopScanAsynchronouslyWithCompletionHandler:^{
+            }
+                                                              context:context];
+        }
+        block:^(SCCaptureBaseState *currentState) {
+            [currentState stopScanWithCompletionHandler:completionHandler resource:_captureResource context:context];
+        }];
+}
+
+- (SCCaptureStateMachineBookKeeper *)bookKeeper
+{
+    return _bookKeeper;
+}
+
+- (SCCaptureStateMachineStateId)currentStateId
+{
+    SCAssertPerformer(_queuePerformer);
+    return [_currentState stateId];
+}
+
+// Records the call, then passes it to the state which is current once it runs on the capturer queue
+- (void)_performAPI:(NSString *)apiName
+            context:(NSString *)context
+              after:(NSTimeInterval)delay
+        replayBlock:(sc_capture_state_machine_replay_block_t)replayBlock
+              block:(void (^)(SCCaptureBaseState *currentState))block
+{
+    SCCaptureStateMachineRecordedCall *call =
+        [_recorder recordCall:apiName context:context delay:delay replayBlock:replayBlock];
+    SCTraceResumeToken resumeToken = SCTraceCapture();
+    dispatch_block_t performBlock = ^{
+        SCTraceResume(resumeToken);
+        [call willExecuteInState:[_currentState stateId]];
+        block(_currentState);
+        [call didExecuteInState:[_currentState stateId]];
+    };
+    if (delay <= 0) {
+        [_queuePerformer perform:performBlock];
+    } else {
+        [_queuePerformer perform:performBlock after:delay];
+    }
 }
 
 - (void)currentState:(SCCaptureBaseState *)state
@@ -296,6 +381,7 @@
 
     [_bookKeeper stateTransitionFrom:[state stateId] to:newState context:context];
     [self _setCurrentState:newState payload:payload context:context];
+    [_bookKeeper didCompleteStateTransitionFrom:[state stateId] to:newState];
 }
 
 @end
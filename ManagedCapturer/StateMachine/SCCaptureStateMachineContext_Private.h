@@ -0,0 +1,23 @@
+//
+//  SCCaptureStateMachineContext_Private.h
+//  Snapchat
+//
+
+#import "SCCaptureStateMachineContext.h"
+#import "SCCaptureStateUtil.h"
+
+#import <Foundation/Foundation.h>
+
+@class SCCaptureStateMachineBookKeeper;
+
+@interface SCCaptureStateMachineContext ()
+
+// Records the calls into the recorder, which can be nil, whatever the tweak says
+- (instancetype)initWithResource:(SCCaptureResource *)resource recorder:(SCCaptureStateMachineRecorder *)recorder;
+
+@property (nonatomic, strong, readonly) SCCaptureStateMachineBookKeeper *bookKeeper;
+
+// Only called on the capturer queue
+- (SCCaptureStateMachineStateId)currentStateId;
+
+@end
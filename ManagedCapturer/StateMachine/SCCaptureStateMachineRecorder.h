@@ -0,0 +1,63 @@
+//
+//  SCCaptureStateMachineRecorder.h
+//  Snapchat
+//
+
+#import "SCCaptureStateUtil.h"
+
+#import <Foundation/Foundation.h>
+
+/*
+ Recorder keeps the latest API calls made on a SCCaptureStateMachineContext, with the state each call ran in, how long
+ it waited on the capturer queue and how long it ran. The book keeper attaches them to illegal API call reports, and
+ they can be replayed in order on another state machine context to reproduce a sequence.
+ */
+
+@class SCCaptureStateMachineContext;
+
+@class SCCapturerToken;
+
+// Tokens handed out by the replayed startRunning calls, keyed by the recorded ones
+typedef NSMapTable<SCCapturerToken *, SCCapturerToken *> SCCaptureStateMachineReplayTokens;
+
+// Completion handlers are not replayed, replay blocks pass no-op ones instead
+typedef void (^sc_capture_state_machine_replay_block_t)(SCCaptureStateMachineContext *stateMachine,
+                                                         SCCaptureStateMachineReplayTokens *tokens);
+
+@interface SCCaptureStateMachineRecordedCall : NSObject
+
+@property (nonatomic, copy, readonly) NSString *apiName;
+@property (nonatomic, copy, readonly) NSString *context;
+@property (nonatomic, assign, readonly) SCCaptureStateMachineStateId fromState;
+@property (nonatomic, assign, readonly) SCCaptureStateMachineStateId toState;
+// Delay the call was scheduled with, e.g. for stopRunningAfterDelay
+@property (nonatomic, assign, readonly) NSTimeInterval delay;
+// Time spent on the capturer queue before the call ran, not counting the delay, and running it
+@property (nonatomic, assign, readonly) CFTimeInterval queueWait;
+@property (nonatomic, assign, readonly) CFTimeInterval duration;
+@property (nonatomic, assign, readonly) BOOL executed;
+
+// Called on the capturer queue around the call
+- (void)willExecuteInState:(SCCaptureStateMachineStateId)state;
+- (void)didExecuteInState:(SCCaptureStateMachineStateId)state;
+
+@end
+
+@interface SCCaptureStateMachineRecorder : NSObject
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+// Called when the API is called, before the call is enqueued. Drops the oldest call once the recorder is full.
+- (SCCaptureStateMachineRecordedCall *)recordCall:(NSString *)apiName
+                                          context:(NSString *)context
+                                            delay:(NSTimeInterval)delay
+                                      replayBlock:(sc_capture_state_machine_replay_block_t)replayBlock;
+
+// Oldest first
+- (NSArray<SCCaptureStateMachineRecordedCall *> *)recordedCalls;
+
+- (NSArray<NSDictionary *> *)recordedCallDescriptions;
+
+- (void)replayOnStateMachine:(SCCaptureStateMachineContext *)stateMachine;
+
+@end
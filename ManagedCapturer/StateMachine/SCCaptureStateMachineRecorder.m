@@ -0,0 +1,133 @@
+//
+//  SCCaptureStateMachineRecorder.m
+//  Snapchat
+//
+
+#import "SCCaptureStateMachineRecorder.h"
+
+#import "SCCapturerToken.h"
+
+#import <SCFoundation/SCAssertWrapper.h>
+
+@import QuartzCore;
+
+@interface SCCaptureStateMachineRecordedCall ()
+
+@property (nonatomic, copy, readwrite) NSString *apiName;
+@property (nonatomic, copy, readwrite) NSString *context;
+@property (nonatomic, assign, readwrite) NSTimeInterval delay;
+@property (nonatomic, assign, readwrite) SCCaptureStateMachineStateId fromState;
+@property (nonatomic, assign, readwrite) SCCaptureStateMachineStateId toState;
+@property (nonatomic, assign, readwrite) CFTimeInterval queueWait;
+@property (nonatomic, assign, readwrite) CFTimeInterval duration;
+@property (nonatomic, copy) sc_capture_state_machine_replay_block_t replayBlock;
+@property (nonatomic, assign) CFTimeInterval enqueueTime;
+@property (nonatomic, assign) CFTimeInterval executeTime;
+@property (nonatomic, assign, readwrite) BOOL executed;
+
+@end
+
+@implementation SCCaptureStateMachineRecordedCall
+
+- (void)willExecuteInState:(SCCaptureStateMachineStateId)state
+{
+    _fromState = state;
+    _executeTime = CACurrentMediaTime();
+    _queueWait = MAX(_executeTime - _enqueueTime - _delay, 0);
+}
+
+- (void)didExecuteInState:(SCCaptureStateMachineStateId)state
+{
+    _toState = state;
+    _duration = CACurrentMediaTime() - _executeTime;
+    _executed = YES;
+}
+
+- (NSDictionary *)callDescription
+{
+    NSMutableDictionary *description = [@{ @"api" : _apiName ?: @"", @"context" : _context ?: @"" } mutableCopy];
+    if (_executed) {
+        description[@"from_state"] = SCCaptureStateName(_fromState);
+        description[@"to_state"] = SCCaptureStateName(_toState);
+        description[@"queue_wait_ms"] = @(_queueWait * 1000);
+        if (_delay > 0) {
+            description[@"delay_ms"] = @(_delay * 1000);
+        }
+        description[@"duration_ms"] = @(_duration * 1000);
+    }
+    return description;
+}
+
+@end
+
+@implementation SCCaptureStateMachineRecorder {
+    NSMutableArray<SCCaptureStateMachineRecordedCall *> *_calls;
+    NSUInteger _capacity;
+    // Index of the oldest call once the recorder is full
+    NSUInteger _head;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        SCAssert(capacity > 0, @"");
+        _capacity = MAX(capacity, 1);
+        _calls = [NSMutableArray arrayWithCapacity:_capacity];
+    }
+    return self;
+}
+
+- (SCCaptureStateMachineRecordedCall *)recordCall:(NSString *)apiName
+                                          context:(NSString *)context
+                                            delay:(NSTimeInterval)delay
+                                      replayBlock:(sc_capture_state_machine_replay_block_t)replayBlock
+{
+    SCCaptureStateMachineRecordedCall *call = [[SCCaptureStateMachineRecordedCall alloc] init];
+    call.apiName = apiName;
+    call.context = context;
+    call.delay = delay;
+    call.replayBlock = replayBlock;
+    call.enqueueTime = CACurrentMediaTime();
+    @synchronized(self)
+    {
+        if (_calls.count < _capacity) {
+            [_calls addObject:call];
+        } else {
+            _calls[_head] = call;
+            _head = (_head + 1) % _capacity;
+        }
+    }
+    return call;
+}
+
+- (NSArray<SCCaptureStateMachineRecordedCall *> *)recordedCalls
+{
+    @synchronized(self)
+    {
+        NSMutableArray<SCCaptureStateMachineRecordedCall *> *calls = [NSMutableArray arrayWithCapacity:_calls.count];
+        for (NSUInteger i = 0; i < _calls.count; ++i) {
+            [calls addObject:_calls[(_head + i) % _calls.count]];
+        }
+        return calls;
+    }
+}
+
+- (NSArray<NSDictionary *> *)recordedCallDescriptions
+{
+    NSMutableArray<NSDictionary *> *descriptions = [NSMutableArray array];
+    for (SCCaptureStateMachineRecordedCall *call in [self recordedCalls]) {
+        [descriptions addObject:[call callDescription]];
+    }
+    return descriptions;
+}
+
+- (void)replayOnStateMachine:(SCCaptureStateMachineContext *)stateMachine
+{
+    SCCaptureStateMachineReplayTokens *tokens = [NSMapTable strongToStrongObjectsMapTable];
+    for (SCCaptureStateMachineRecordedCall *call in [self recordedCalls]) {
+        call.replayBlock(stateMachine, tokens);
+    }
+}
+
+@end
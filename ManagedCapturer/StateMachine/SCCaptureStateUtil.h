@@ -16,8 +16,6 @@
 #define SCLogCaptureStateMachineInfo(fmt, ...) SCLogCoreCameraInfo(@"[SCCaptureStateMachine] " fmt, ##__VA_ARGS__)
 #define SCLogCaptureStateMachineError(fmt, ...) SCLogCoreCameraError(@"[SCCaptureStateMachine] " fmt, ##__VA_ARGS__)
 
-typedef NSNumber SCCaptureStateKey;
-
 typedef NS_ENUM(NSUInteger, SCCaptureStateMachineStateId) {
     SCCaptureBaseStateId = 0,
     SCCaptureUninitializedStateId,
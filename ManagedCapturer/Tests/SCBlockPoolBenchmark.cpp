@@ -0,0 +1,143 @@
+//
+//  SCBlockPoolBenchmark.cpp
+//  Snapchat
+//
+//  Times what SCAudioCaptureSession does with the bytes of an audio queue buffer, copying them to a block from the
+//  pool and giving it back from the consumer thread, against allocating, copying and freeing a block per buffer. The
+//  buffers are 0.2s of 16 bit PCM at 44.1kHz. It doesn't cover the CMBlockBuffer and CMSampleBuffer created around the
+//  block for every buffer either way, which only exist on device.
+//
+
+#include "SCBlockPool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace SC;
+
+namespace {
+
+static const int kIterations = 20000;
+// Same as kNumberOfAudioBuffersInQueue
+static const size_t kBlockCount = 15;
+
+/*
+ Blocks handed to a consumer thread which frees them, like the delegate queue releasing the sample buffers. At most
+ kBlockCount blocks are in flight, the audio queue can't deliver more buffers than it has either.
+ */
+class Consumer {
+public:
+    template <typename Free>
+    explicit Consumer(Free free)
+        : _inFlightCount(0)
+        , _done(false)
+        , _thread([this, free] {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _condition.wait(lock, [this] { return _done || !_blocks.empty(); });
+                if (_blocks.empty()) {
+                    return;
+                }
+                void *block = _blocks.front();
+                _blocks.pop_front();
+                lock.unlock();
+                free(block);
+                lock.lock();
+                --_inFlightCount;
+                _condition.notify_all();
+            }
+        })
+    {
+    }
+
+    ~Consumer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done = true;
+        }
+        _condition.notify_all();
+        _thread.join();
+    }
+
+    // Call before acquiring a block, so that no more than kBlockCount are held at once
+    void waitForRoom()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this] { return _inFlightCount < kBlockCount; });
+        ++_inFlightCount;
+    }
+
+    void hand(void *block)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _blocks.push_back(block);
+        }
+        _condition.notify_all();
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<void *> _blocks;
+    size_t _inFlightCount;
+    bool _done;
+    std::thread _thread;
+};
+
+template <typename Block>
+double NanosecondsPerBuffer(Block block)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        block();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+}
+
+void Benchmark(const char *name, size_t byteSize)
+{
+    std::vector<uint8_t> audioQueueBuffer(byteSize, 0x42);
+    double mallocAndCopy;
+    {
+        Consumer consumer([](void *block) { free(block); });
+        mallocAndCopy = NanosecondsPerBuffer([&] {
+            consumer.waitForRoom();
+            void *block = malloc(byteSize);
+            memcpy(block, audioQueueBuffer.data(), byteSize);
+            consumer.hand(block);
+        });
+    }
+    BlockPool *pool = BlockPool::create(byteSize, kBlockCount);
+    double pooled;
+    {
+        Consumer consumer([pool](void *block) { pool->releaseBlock(block); });
+        pooled = NanosecondsPerBuffer([&] {
+            consumer.waitForRoom();
+            void *block = pool->acquireBlock();
+            memcpy(block, audioQueueBuffer.data(), byteSize);
+            consumer.hand(block);
+        });
+    }
+    printf("%-7s %6zu bytes  malloc and copy %7.0f ns  pooled block %7.0f ns  blocks allocated %zu\n", name, byteSize,
+           mallocAndCopy, pooled, pool->allocatedBlockCount());
+    pool->release();
+}
+
+} // namespace
+
+int main()
+{
+    Benchmark("mono", 44100 / 5 * 2);
+    Benchmark("stereo", 44100 / 5 * 4);
+    return 0;
+}
@@ -0,0 +1,101 @@
+//
+//  SCBlockPoolTests.cpp
+//  Snapchat
+//
+
+#include "SCBlockPool.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace SC;
+
+TEST(SCBlockPoolTests, ReusesTheFreeBlocks)
+{
+    BlockPool *pool = BlockPool::create(256, 2);
+    EXPECT_EQ(2u, pool->allocatedBlockCount());
+    void *first = pool->acquireBlock();
+    void *second = pool->acquireBlock();
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    EXPECT_NE(first, second);
+    memset(first, 0xff, pool->blockSize());
+    pool->releaseBlock(first);
+    EXPECT_EQ(first, pool->acquireBlock());
+    EXPECT_EQ(2u, pool->allocatedBlockCount());
+    pool->releaseBlock(first);
+    pool->releaseBlock(second);
+    pool->release();
+}
+
+TEST(SCBlockPoolTests, GrowsOnceAllBlocksAreInUse)
+{
+    BlockPool *pool = BlockPool::create(64, 1);
+    std::set<void *> blocks;
+    for (int i = 0; i < 4; ++i) {
+        blocks.insert(pool->acquireBlock());
+    }
+    EXPECT_EQ(4u, blocks.size());
+    EXPECT_EQ(4u, pool->allocatedBlockCount());
+    for (void *block : blocks) {
+        pool->releaseBlock(block);
+    }
+    // The grown blocks are kept for reuse
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(1u, blocks.count(pool->acquireBlock()));
+    }
+    EXPECT_EQ(4u, pool->allocatedBlockCount());
+    for (void *block : blocks) {
+        pool->releaseBlock(block);
+    }
+    pool->release();
+}
+
+TEST(SCBlockPoolTests, OutstandingBlocksKeepThePoolAlive)
+{
+    BlockPool *pool = BlockPool::create(128, 2);
+    void *block = pool->acquireBlock();
+    // The owner lets go first, like a session torn down while a consumer still holds a sample buffer
+    pool->release();
+    memset(block, 0, 128);
+    EXPECT_EQ(128u, pool->blockSize());
+    pool->releaseBlock(block);
+}
+
+TEST(SCBlockPoolTests, BlocksCanBeGivenBackFromOtherThreads)
+{
+    BlockPool *pool = BlockPool::create(1024, 4);
+    std::vector<std::vector<void *>> blocks(4);
+    for (std::vector<void *> &threadBlocks : blocks) {
+        for (int i = 0; i < 1000; ++i) {
+            threadBlocks.push_back(pool->acquireBlock());
+        }
+    }
+    std::vector<std::thread> consumers;
+    for (const std::vector<void *> &threadBlocks : blocks) {
+        consumers.emplace_back([pool, &threadBlocks] {
+            for (void *block : threadBlocks) {
+                pool->releaseBlock(block);
+            }
+        });
+    }
+    for (std::thread &consumer : consumers) {
+        consumer.join();
+    }
+    EXPECT_EQ(4000u, pool->allocatedBlockCount());
+    // Every block made it back, none is allocated again
+    std::set<void *> reacquired;
+    for (int i = 0; i < 4000; ++i) {
+        reacquired.insert(pool->acquireBlock());
+    }
+    EXPECT_EQ(4000u, reacquired.size());
+    EXPECT_EQ(4000u, pool->allocatedBlockCount());
+    for (void *block : reacquired) {
+        pool->releaseBlock(block);
+    }
+    pool->release();
+}
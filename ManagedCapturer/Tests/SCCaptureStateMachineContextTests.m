@@ -0,0 +1,630 @@
+//
+//  SCCaptureStateMachineContextTests.m
+//  Snapchat
+//
+//  Drives SCCaptureStateMachineContext and the real SCCapture*State classes on a virtual clock. The camera behind
+//  them, SCCaptureWorker and SCManagedCapturerV1, is mocked, and completes its work after fixed virtual latencies.
+//  Part of the iOS unit test bundle, not of the host build in CMakeLists.txt.
+//
+
+#import "SCCaptureResource.h"
+#import "SCCaptureStateMachineBookKeeper.h"
+#import "SCCaptureStateMachineContext.h"
+#import "SCCaptureStateMachineContext_Private.h"
+#import "SCCaptureStateMachineRecorder.h"
+#import "SCCaptureWorker.h"
+#import "SCCapturerToken.h"
+#import "SCManagedCapturerV1_Private.h"
+
+#import <SCFoundation/SCQueuePerformer.h>
+
+#import <OCMock/OCMock.h>
+#import <XCTest/XCTest.h>
+
+static char *const kSCCaptureStateMachineTestQueueLabel = "com.snapchat.capture-state-machine-test";
+static NSString *const kSCCaptureStateMachineTestContext = @"SCCaptureStateMachineContextTests";
+
+// Latencies of the mocked camera, on the virtual clock
+static NSTimeInterval const kSCCaptureStateMachineTestSetupLatency = 0.3;
+static NSTimeInterval const kSCCaptureStateMachineTestStartRunningLatency = 0.2;
+static NSTimeInterval const kSCCaptureStateMachineTestStopRunningLatency = 0.1;
+static NSTimeInterval const kSCCaptureStateMachineTestCaptureLatency = 0.25;
+
+static NSUInteger const kSCCaptureStateMachineTestSequenceLength = 200;
+
+#pragma mark - SCCaptureStateMachineTestPerformer
+
+/*
+ Capturer queue on a virtual clock. Blocks run on the test thread, only from runUntilIdle and advanceClockBy:, in the
+ order of their due time, then of their scheduling.
+ */
+@interface SCCaptureStateMachineTestPerformer : SCQueuePerformer
+
+@property (nonatomic, assign, readonly) NSTimeInterval virtualTime;
+
+// Runs the blocks due by now, including the ones they schedule
+- (void)runUntilIdle;
+
+- (void)advanceClockBy:(NSTimeInterval)interval;
+
+@end
+
+@interface SCCaptureStateMachineTestScheduledBlock : NSObject
+
+@property (nonatomic, assign) NSTimeInterval fireTime;
+@property (nonatomic, assign) NSUInteger sequenceNumber;
+@property (nonatomic, copy) dispatch_block_t block;
+
+@end
+
+@implementation SCCaptureStateMachineTestScheduledBlock
+@end
+
+@implementation SCCaptureStateMachineTestPerformer {
+    NSMutableArray<SCCaptureStateMachineTestScheduledBlock *> *_scheduledBlocks;
+    NSUInteger _nextSequenceNumber;
+    BOOL _running;
+}
+
+- (instancetype)init
+{
+    self = [super initWithLabel:kSCCaptureStateMachineTestQueueLabel
+               qualityOfService:QOS_CLASS_USER_INITIATED
+                      queueType:DISPATCH_QUEUE_SERIAL
+                        context:SCQueuePerformerContextCamera];
+    if (self) {
+        _scheduledBlocks = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)isCurrentPerformer
+{
+    return _running;
+}
+
+- (void)perform:(dispatch_block_t)block
+{
+    [self perform:block after:0];
+}
+
+- (void)perform:(dispatch_block_t)block after:(NSTimeInterval)delay
+{
+    SCCaptureStateMachineTestScheduledBlock *scheduledBlock = [[SCCaptureStateMachineTestScheduledBlock alloc] init];
+    scheduledBlock.fireTime = _virtualTime + MAX(delay, 0);
+    scheduledBlock.sequenceNumber = _nextSequenceNumber++;
+    scheduledBlock.block = block;
+    [_scheduledBlocks addObject:scheduledBlock];
+}
+
+- (void)performImmediatelyIfCurrentPerformer:(dispatch_block_t)block
+{
+    if (_running) {
+        block();
+    } else {
+        [self perform:block];
+    }
+}
+
+- (void)runUntilIdle
+{
+    [self advanceClockBy:0];
+}
+
+- (void)advanceClockBy:(NSTimeInterval)interval
+{
+    NSTimeInterval targetTime = _virtualTime + MAX(interval, 0);
+    while (YES) {
+        SCCaptureStateMachineTestScheduledBlock *nextBlock = nil;
+        for (SCCaptureStateMachineTestScheduledBlock *scheduledBlock in _scheduledBlocks) {
+            if (scheduledBlock.fireTime <= targetTime &&
+                (!nextBlock || scheduledBlock.fireTime < nextBlock.fireTime ||
+                 (scheduledBlock.fireTime == nextBlock.fireTime &&
+                  scheduledBlock.sequenceNumber < nextBlock.sequenceNumber))) {
+                nextBlock = scheduledBlock;
+            }
+        }
+        if (!nextBlock) {
+            break;
+        }
+        [_scheduledBlocks removeObject:nextBlock];
+        _virtualTime = MAX(_virtualTime, nextBlock.fireTime);
+        _running = YES;
+        nextBlock.block();
+        _running = NO;
+    }
+    _virtualTime = targetTime;
+}
+
+@end
+
+#pragma mark - SCCaptureStateMachineContextTests
+
+typedef NS_ENUM(NSUInteger, SCCaptureStateMachineTestCall) {
+    SCCaptureStateMachineTestCallInitializeCapture = 0,
+    SCCaptureStateMachineTestCallStartRunning,
+    SCCaptureStateMachineTestCallStopRunning,
+    SCCaptureStateMachineTestCallPrepareForRecording,
+    SCCaptureStateMachineTestCallStartRecording,
+    SCCaptureStateMachineTestCallStopRecording,
+    SCCaptureStateMachineTestCallCancelRecording,
+    SCCaptureStateMachineTestCallCaptureStillImage,
+    SCCaptureStateMachineTestCallStartScan,
+    SCCaptureStateMachineTestCallStopScan,
+    SCCaptureStateMachineTestCallAdvanceClock,
+    SCCaptureStateMachineTestCallCount,
+};
+
+// Whether the real states handle the call without reporting it to the book keeper
+static BOOL SCCaptureStateMachineTestCallIsLegal(SCCaptureStateMachineTestCall call,
+                                                 SCCaptureStateMachineStateId stateId, NSUInteger tokenCount)
+{
+    BOOL running = (stateId == SCCaptureRunningStateId);
+    switch (call) {
+    case SCCaptureStateMachineTestCallInitializeCapture:
+        return stateId == SCCaptureUninitializedStateId;
+    case SCCaptureStateMachineTestCallStartRunning:
+        return stateId == SCCaptureInitializedStateId || running;
+    case SCCaptureStateMachineTestCallStopRunning:
+        // The last token only stops the session from running or scanning, the states assert otherwise
+        return tokenCount > 1 || (tokenCount == 1 && (running || stateId == SCCaptureScanningStateId));
+    case SCCaptureStateMachineTestCallPrepareForRecording:
+    case SCCaptureStateMachineTestCallStartRecording:
+    case SCCaptureStateMachineTestCallStartScan:
+        return running;
+    case SCCaptureStateMachineTestCallStopRecording:
+        return stateId == SCCaptureRecordingStateId;
+    case SCCaptureStateMachineTestCallCancelRecording:
+        return running || stateId == SCCaptureRecordingStateId || stateId == SCCaptureScanningStateId;
+    case SCCaptureStateMachineTestCallCaptureStillImage:
+        return running || stateId == SCCaptureRecordingStateId;
+    case SCCaptureStateMachineTestCallStopScan:
+        return stateId != SCCaptureUninitializedStateId;
+    case SCCaptureStateMachineTestCallAdvanceClock:
+    case SCCaptureStateMachineTestCallCount:
+        return YES;
+    }
+    return NO;
+}
+
+@interface SCCaptureStateMachineContextTests : XCTestCase
+@end
+
+@implementation SCCaptureStateMachineContextTests {
+    id _workerMock;
+    id _capturerMock;
+    SCCaptureStateMachineTestPerformer *_performer;
+    SCCaptureResource *_resource;
+    SCCaptureStateMachineContext *_stateMachine;
+    NSUInteger _illegalCallCount;
+    NSUInteger _captureCount;
+    NSUInteger _cancelRecordingCount;
+}
+
+- (void)setUp
+{
+    [super setUp];
+    _workerMock = OCMClassMock([SCCaptureWorker class]);
+    OCMStub([_workerMock startRunningWithCaptureResource:[OCMArg any]
+                                                   token:[OCMArg any]
+                                       completionHandler:[OCMArg any]])
+        .andDo(^(NSInvocation *invocation) {
+            __unsafe_unretained SCCaptureResource *resource;
+            __unsafe_unretained SCCapturerToken *token;
+            __unsafe_unretained dispatch_block_t completionHandler;
+            [invocation getArgument:&resource atIndex:2];
+            [invocation getArgument:&token atIndex:3];
+            [invocation getArgument:&completionHandler atIndex:4];
+            [resource.tokenSet addObject:token];
+            if (completionHandler) {
+                [resource.queuePerformer perform:completionHandler after:kSCCaptureStateMachineTestStartRunningLatency];
+            }
+        });
+    OCMStub([_workerMock stopRunningWithCaptureResource:[OCMArg any]
+                                                  token:[OCMArg any]
+                                      completionHandler:[OCMArg any]])
+        .andDo(^(NSInvocation *invocation) {
+            __unsafe_unretained SCCaptureResource *resource;
+            __unsafe_unretained SCCapturerToken *token;
+            __unsafe_unretained sc_managed_capturer_stop_running_completion_handler_t completionHandler;
+            [invocation getArgument:&resource atIndex:2];
+            [invocation getArgument:&token atIndex:3];
+            [invocation getArgument:&completionHandler atIndex:4];
+            XCTAssertTrue([resource.tokenSet containsObject:token], @"Stopping %@ which isn't running", token);
+            [resource.tokenSet removeObject:token];
+            BOOL succeed = (resource.tokenSet.count == 0);
+            if (completionHandler) {
+                sc_managed_capturer_stop_running_completion_handler_t handler = [completionHandler copy];
+                [resource.queuePerformer perform:^{
+                    handler(succeed);
+                }
+                                           after:kSCCaptureStateMachineTestStopRunningLatency];
+            }
+            [invocation setReturnValue:&succeed];
+        });
+    OCMStub([_workerMock captureStillImageWithCaptureResource:[OCMArg any]
+                                                  aspectRatio:0
+                                             captureSessionID:[OCMArg any]
+                                       shouldCaptureFromVideo:NO
+                                            completionHandler:[OCMArg any]
+                                                      context:[OCMArg any]])
+        .ignoringNonObjectArgs()
+        .andDo(^(NSInvocation *invocation) {
+            __unsafe_unretained SCCaptureResource *resource;
+            __unsafe_unretained sc_managed_capturer_capture_still_image_completion_handler_t completionHandler;
+            [invocation getArgument:&resource atIndex:2];
+            [invocation getArgument:&completionHandler atIndex:6];
+            ++_captureCount;
+            if (completionHandler) {
+                sc_managed_capturer_capture_still_image_completion_handler_t handler = [completionHandler copy];
+                [resource.queuePerformer perform:^{
+                    handler(nil, nil, nil, nil);
+                }
+                                           after:kSCCaptureStateMachineTestCaptureLatency];
+            }
+        });
+    OCMStub([_workerMock cancelRecordingWithCaptureResource:[OCMArg any]]).andDo(^(NSInvocation *invocation) {
+        ++_cancelRecordingCount;
+    });
+
+    // Like the real one, the capturer shares its resource with the state machine and stops through the worker
+    _capturerMock = OCMClassMock([SCManagedCapturerV1 class]);
+    OCMStub([_capturerMock sharedInstance]).andReturn(_capturerMock);
+    OCMStub([_capturerMock setupWithDevicePosition:SCManagedCaptureDevicePositionBack completionHandler:[OCMArg any]])
+        .ignoringNonObjectArgs()
+        .andDo(^(NSInvocation *invocation) {
+            __unsafe_unretained dispatch_block_t completionHandler;
+            [invocation getArgument:&completionHandler atIndex:3];
+            _resource.tokenSet = [NSMutableSet set];
+            if (completionHandler) {
+                [_performer perform:completionHandler after:kSCCaptureStateMachineTestSetupLatency];
+            }
+        });
+    OCMStub([_capturerMock stopRunningWithCaptureToken:[OCMArg any]
+                                     completionHandler:[OCMArg any]
+                                               context:[OCMArg any]])
+        .andDo(^(NSInvocation *invocation) {
+            __unsafe_unretained SCCapturerToken *token;
+            __unsafe_unretained sc_managed_capturer_stop_running_completion_handler_t completionHandler;
+            [invocation getArgument:&token atIndex:2];
+            [invocation getArgument:&completionHandler atIndex:3];
+            BOOL succeed = [SCCaptureWorker stopRunningWithCaptureResource:_resource
+                                                                     token:token
+                                                         completionHandler:completionHandler];
+            [invocation setReturnValue:&succeed];
+        });
+
+    _stateMachine = [self _stateMachineWithRecorder:nil];
+}
+
+- (void)tearDown
+{
+    [_capturerMock stopMocking];
+    [_workerMock stopMocking];
+    _stateMachine = nil;
+    _resource = nil;
+    _performer = nil;
+    [super tearDown];
+}
+
+#pragma mark - Tests
+
+- (void)testStartRunningCaptureStillImageThenStartRecording
+{
+    __block NSUInteger completedCount = 0;
+    [_stateMachine initializeCaptureWithDevicePositionAsynchronously:SCManagedCaptureDevicePositionBack
+                                                   completionHandler:^{
+                                                       ++completedCount;
+                                                   }
+                                                             context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureInitializedStateId];
+    [_stateMachine startRunningWithContext:kSCCaptureStateMachineTestContext
+                         completionHandler:^{
+                             ++completedCount;
+                         }];
+    [self _expectState:SCCaptureRunningStateId];
+    XCTAssertEqual(_resource.tokenSet.count, 1u);
+
+    [_stateMachine captureStillImageAsynchronouslyWithAspectRatio:1
+                                                 captureSessionID:nil
+                                                completionHandler:^(UIImage *fullScreenImage, NSDictionary *metadata,
+                                                                    NSError *error, SCManagedCapturerState *state) {
+                                                    ++completedCount;
+                                                }
+                                                          context:kSCCaptureStateMachineTestContext];
+    // The image state hands the capture to the worker and goes back to running right away
+    [self _expectState:SCCaptureRunningStateId];
+    XCTAssertEqual(_captureCount, 1u);
+
+    [_stateMachine startRecordingWithOutputSettings:nil
+                                 audioConfiguration:nil
+                                        maxDuration:10
+                                            fileURL:nil
+                                   captureSessionID:nil
+                                  completionHandler:nil
+                                            context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureRecordingStateId];
+    OCMVerify([_workerMock startRecordingWithCaptureResource:_resource
+                                              outputSettings:nil
+                                          audioConfiguration:nil
+                                                 maxDuration:10
+                                                     fileURL:nil
+                                            captureSessionID:nil
+                                           completionHandler:nil]);
+
+    XCTAssertEqual(completedCount, 0u);
+    [_performer advanceClockBy:1];
+    XCTAssertEqual(completedCount, 3u);
+    XCTAssertEqual(_illegalCallCount, 0u);
+}
+
+- (void)testCaptureStillImageWhileRecordingCancelsTheRecordingOnceCaptured
+{
+    [self _startRunning];
+    [_stateMachine startRecordingWithOutputSettings:nil
+                                 audioConfiguration:nil
+                                        maxDuration:10
+                                            fileURL:nil
+                                   captureSessionID:nil
+                                  completionHandler:nil
+                                            context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureRecordingStateId];
+
+    __block BOOL captured = NO;
+    [_stateMachine captureStillImageAsynchronouslyWithAspectRatio:1
+                                                 captureSessionID:nil
+                                                completionHandler:^(UIImage *fullScreenImage, NSDictionary *metadata,
+                                                                    NSError *error, SCManagedCapturerState *state) {
+                                                    captured = YES;
+                                                }
+                                                          context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureRunningStateId];
+    XCTAssertEqual(_cancelRecordingCount, 0u);
+    [_performer advanceClockBy:kSCCaptureStateMachineTestCaptureLatency / 2];
+    XCTAssertFalse(captured);
+    XCTAssertEqual(_cancelRecordingCount, 0u);
+    [_performer advanceClockBy:kSCCaptureStateMachineTestCaptureLatency / 2];
+    XCTAssertTrue(captured);
+    XCTAssertEqual(_cancelRecordingCount, 1u);
+    [self _expectState:SCCaptureRunningStateId];
+    XCTAssertEqual(_illegalCallCount, 0u);
+}
+
+- (void)testStopRunningAfterDelayRunsOnTheVirtualClock
+{
+    SCCapturerToken *token = [self _startRunning];
+    __block BOOL stopped = NO;
+    [_stateMachine stopRunningWithCapturerToken:token
+                                          after:1
+                              completionHandler:^(BOOL succeed) {
+                                  stopped = succeed;
+                              }
+                                        context:kSCCaptureStateMachineTestContext];
+    [_performer advanceClockBy:0.9];
+    [self _expectState:SCCaptureRunningStateId];
+    [_performer advanceClockBy:0.1];
+    [self _expectState:SCCaptureInitializedStateId];
+    XCTAssertFalse(stopped);
+    [_performer advanceClockBy:kSCCaptureStateMachineTestStopRunningLatency];
+    XCTAssertTrue(stopped);
+}
+
+- (void)testStopRunningKeepsRunningWhileOtherTokensAreLeft
+{
+    SCCapturerToken *firstToken = [self _startRunning];
+    SCCapturerToken *secondToken =
+        [_stateMachine startRunningWithContext:kSCCaptureStateMachineTestContext completionHandler:nil];
+    [_stateMachine startScanAsynchronouslyWithScanConfiguration:nil context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureScanningStateId];
+
+    [_stateMachine stopRunningWithCapturerToken:firstToken
+                              completionHandler:nil
+                                        context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureScanningStateId];
+    [_stateMachine stopRunningWithCapturerToken:secondToken
+                              completionHandler:nil
+                                        context:kSCCaptureStateMachineTestContext];
+    [self _expectState:SCCaptureInitializedStateId];
+    XCTAssertEqual(_resource.tokenSet.count, 0u);
+    XCTAssertEqual(_illegalCallCount, 0u);
+}
+
+- (void)testRandomSequencesFollowTheTransitionsAndReplay
+{
+    for (unsigned int seed = 1; seed <= 8; ++seed) {
+        SCCaptureStateMachineRecorder *recorder =
+            [[SCCaptureStateMachineRecorder alloc] initWithCapacity:kSCCaptureStateMachineTestSequenceLength];
+        _stateMachine = [self _stateMachineWithRecorder:recorder];
+        [self _runRandomSequenceWithSeed:seed length:kSCCaptureStateMachineTestSequenceLength checkingEachCall:YES];
+        [_performer advanceClockBy:1];
+        XCTAssertEqual(_illegalCallCount, 0u, @"seed %u", seed);
+        NSArray<SCCaptureStateMachineRecordedCall *> *calls = [recorder recordedCalls];
+
+        // Replayed back to back on a fresh state machine, with the tokens remapped, the calls move it the same way
+        SCCaptureStateMachineRecorder *replayRecorder =
+            [[SCCaptureStateMachineRecorder alloc] initWithCapacity:kSCCaptureStateMachineTestSequenceLength];
+        SCCaptureStateMachineContext *replayStateMachine = [self _stateMachineWithRecorder:replayRecorder];
+        [recorder replayOnStateMachine:replayStateMachine];
+        [_performer runUntilIdle];
+        NSArray<SCCaptureStateMachineRecordedCall *> *replayedCalls = [replayRecorder recordedCalls];
+        XCTAssertEqual(replayedCalls.count, calls.count, @"seed %u", seed);
+        for (NSUInteger i = 0; i < MIN(calls.count, replayedCalls.count); ++i) {
+            XCTAssertTrue(replayedCalls[i].executed);
+            XCTAssertEqualObjects(replayedCalls[i].apiName, calls[i].apiName, @"seed %u call %lu", seed,
+                                  (unsigned long)i);
+            XCTAssertEqual(replayedCalls[i].fromState, calls[i].fromState, @"seed %u call %lu", seed, (unsigned long)i);
+            XCTAssertEqual(replayedCalls[i].toState, calls[i].toState, @"seed %u call %lu", seed, (unsigned long)i);
+        }
+    }
+}
+
+- (void)testTransitionsAreTimedByTheBookKeeper
+{
+    [self _startRunning];
+    NSDictionary<NSString *, NSDictionary *> *latencies = [_stateMachine.bookKeeper transitionLatencies];
+    XCTAssertEqual(latencies.count, 2u);
+    XCTAssertNotNil(latencies[@"SCCaptureUninitializedStateId>SCCaptureInitializedStateId"]);
+    XCTAssertNotNil(latencies[@"SCCaptureInitializedStateId>SCCaptureRunningStateId"]);
+}
+
+- (void)testPerformanceOfRandomSequences
+{
+    __block unsigned int seed = 1;
+    [self measureBlock:^{
+        _stateMachine = [self _stateMachineWithRecorder:nil];
+        [self _runRandomSequenceWithSeed:seed++ length:1000 checkingEachCall:NO];
+    }];
+}
+
+#pragma mark - Private methods
+
+- (SCCaptureStateMachineContext *)_stateMachineWithRecorder:(SCCaptureStateMachineRecorder *)recorder
+{
+    _performer = [[SCCaptureStateMachineTestPerformer alloc] init];
+    _resource = [[SCCaptureResource alloc] init];
+    _resource.queuePerformer = _performer;
+    _illegalCallCount = 0;
+    SCCaptureStateMachineContext *stateMachine =
+        [[SCCaptureStateMachineContext alloc] initWithResource:_resource recorder:recorder];
+    // The states hold on to the same book keeper, the partial mock only counts what they report
+    id bookKeeperMock = OCMPartialMock(stateMachine.bookKeeper);
+    OCMStub([bookKeeperMock state:SCCaptureBaseStateId
+                 illegalAPIcalled:[OCMArg any]
+                        callStack:[OCMArg any]
+                          context:[OCMArg any]])
+        .ignoringNonObjectArgs()
+        .andDo(^(NSInvocation *invocation) {
+            ++_illegalCallCount;
+        });
+    return stateMachine;
+}
+
+- (SCCaptureStateMachineStateId)_currentStateId
+{
+    __block SCCaptureStateMachineStateId stateId = SCCaptureBaseStateId;
+    [_performer perform:^{
+        stateId = [_stateMachine currentStateId];
+    }];
+    [_performer runUntilIdle];
+    return stateId;
+}
+
+- (void)_expectState:(SCCaptureStateMachineStateId)stateId
+{
+    SCCaptureStateMachineStateId currentStateId = [self _currentStateId];
+    XCTAssertEqual(currentStateId, stateId, @"In %@ instead of %@", SCCaptureStateName(currentStateId),
+                   SCCaptureStateName(stateId));
+}
+
+- (SCCapturerToken *)_startRunning
+{
+    [_stateMachine initializeCaptureWithDevicePositionAsynchronously:SCManagedCaptureDevicePositionBack
+                                                   completionHandler:nil
+                                                             context:kSCCaptureStateMachineTestContext];
+    SCCapturerToken *token =
+        [_stateMachine startRunningWithContext:kSCCaptureStateMachineTestContext completionHandler:nil];
+    [self _expectState:SCCaptureRunningStateId];
+    return token;
+}
+
+// Makes random calls legal in the current state, and checks that the state machine lands where it should after each
+
+- (void)_runRandomSequenceWithSeed:(unsigned int)seed length:(NSUInteger)length checkingEachCall:(BOOL)checkingEachCall
+{
+    NSMutableArray<SCCapturerToken *> *tokens = [NSMutableArray array];
+    SCCaptureStateMachineStateId stateId = [self _currentStateId];
+    for (NSUInteger i = 0; i < length; ++i) {
+        SCCaptureStateMachineTestCall call = rand_r(&seed) % SCCaptureStateMachineTestCallCount;
+        if (!SCCaptureStateMachineTestCallIsLegal(call, stateId, tokens.count)) {
+            continue;
+        }
+        SCCaptureStateMachineStateId expectedStateId = stateId;
+        switch (call) {
+        case SCCaptureStateMachineTestCallInitializeCapture:
+            [_stateMachine initializeCaptureWithDevicePositionAsynchronously:SCManagedCaptureDevicePositionBack
+                                                           completionHandler:nil
+                                                                     context:kSCCaptureStateMachineTestContext];
+            expectedStateId = SCCaptureInitializedStateId;
+            break;
+        case SCCaptureStateMachineTestCallStartRunning:
+            [tokens addObject:[_stateMachine startRunningWithContext:kSCCaptureStateMachineTestContext
+                                                   completionHandler:nil]];
+            expectedStateId = SCCaptureRunningStateId;
+            break;
+        case SCCaptureStateMachineTestCallStopRunning: {
+            NSUInteger tokenIndex = rand_r(&seed) % tokens.count;
+            [_stateMachine stopRunningWithCapturerToken:tokens[tokenIndex]
+                                      completionHandler:nil
+                                                context:kSCCaptureStateMachineTestContext];
+            [tokens removeObjectAtIndex:tokenIndex];
+            if (tokens.count == 0) {
+                expectedStateId = SCCaptureInitializedStateId;
+            }
+            break;
+        }
+        case SCCaptureStateMachineTestCallPrepareForRecording:
+            [_stateMachine prepareForRecordingAsynchronouslyWithAudioConfiguration:nil
+                                                                           context:kSCCaptureStateMachineTestContext];
+            break;
+        case SCCaptureStateMachineTestCallStartRecording:
+            [_stateMachine startRecordingWithOutputSettings:nil
+                                         audioConfiguration:nil
+                                                maxDuration:10
+                                                    fileURL:nil
+                                           captureSessionID:nil
+                                          completionHandler:nil
+                                                    context:kSCCaptureStateMachineTestContext];
+            expectedStateId = SCCaptureRecordingStateId;
+            break;
+        case SCCaptureStateMachineTestCallStopRecording:
+            [_stateMachine stopRecordingWithContext:kSCCaptureStateMachineTestContext];
+            expectedStateId = SCCaptureRunningStateId;
+            break;
+        case SCCaptureStateMachineTestCallCancelRecording:
+            [_stateMachine cancelRecordingWithContext:kSCCaptureStateMachineTestContext];
+            if (stateId == SCCaptureRecordingStateId) {
+                expectedStateId = SCCaptureRunningStateId;
+            }
+            break;
+        case SCCaptureStateMachineTestCallCaptureStillImage:
+            [_stateMachine captureStillImageAsynchronouslyWithAspectRatio:1
+                                                         captureSessionID:nil
+                                                        completionHandler:nil
+                                                                  context:kSCCaptureStateMachineTestContext];
+            // Both image states go back to running once the capture started
+            expectedStateId = SCCaptureRunningStateId;
+            break;
+        case SCCaptureStateMachineTestCallStartScan:
+            [_stateMachine startScanAsynchronouslyWithScanConfiguration:nil
+                                                                context:kSCCaptureStateMachineTestContext];
+            expectedStateId = SCCaptureScanningStateId;
+            break;
+        case SCCaptureStateMachineTestCallStopScan:
+            [_stateMachine stopScanAsynchronouslyWithCompletionHandler:nil context:kSCCaptureStateMachineTestContext];
+            if (stateId == SCCaptureScanningStateId) {
+                expectedStateId = SCCaptureRunningStateId;
+            }
+            break;
+        case SCCaptureStateMachineTestCallAdvanceClock:
+        case SCCaptureStateMachineTestCallCount:
+            // Lets the completion handlers of the mocked camera run in between the calls
+            [_performer advanceClockBy:(rand_r(&seed) % 500) / 1000.0];
+            break;
+        }
+        if (!checkingEachCall) {
+            stateId = expectedStateId;
+            continue;
+        }
+        stateId = [self _currentStateId];
+        XCTAssertEqual(stateId, expectedStateId, @"Call %lu of seed %u", (unsigned long)i, seed);
+        BOOL runningState = (stateId == SCCaptureRunningStateId || stateId == SCCaptureRecordingStateId ||
+                             stateId == SCCaptureScanningStateId);
+        XCTAssertEqual(runningState, _resource.tokenSet.count > 0, @"Call %lu of seed %u", (unsigned long)i, seed);
+        if (stateId != expectedStateId) {
+            return;
+        }
+    }
+    [_performer runUntilIdle];
+}
+
+@end
@@ -0,0 +1,164 @@
+//
+//  SCDepthRangeTests.cpp
+//  Snapchat
+//
+
+#include "SCDepthRange.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const uint16_t kHalfZero = 0x0000;
+const uint16_t kHalfQuarter = 0x3400;
+const uint16_t kHalfHalf = 0x3800;
+const uint16_t kHalfOne = 0x3C00;
+const uint16_t kHalfTwo = 0x4000;
+const uint16_t kHalfMinusOne = 0xBC00;
+const uint16_t kHalfInfinity = 0x7C00;
+const uint16_t kHalfNaN = 0x7E00;
+const uint16_t kHalfNegativeNaN = 0xFE00;
+
+// width x height plane with rows padded to bytesPerRow, filled with value
+struct HalfFloatPlane {
+    size_t width;
+    size_t height;
+    size_t bytesPerRow;
+    std::vector<uint16_t> pixels;
+
+    HalfFloatPlane(size_t planeWidth, size_t planeHeight, uint16_t value)
+        : width(planeWidth)
+        , height(planeHeight)
+        , bytesPerRow((planeWidth + 3) * sizeof(uint16_t))
+        , pixels(bytesPerRow / sizeof(uint16_t) * planeHeight, kHalfNaN)
+    {
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                set(x, y, value);
+            }
+        }
+    }
+
+    void set(size_t x, size_t y, uint16_t value)
+    {
+        pixels[y * bytesPerRow / sizeof(uint16_t) + x] = value;
+    }
+
+    SCDepthRange normalizingRange() const
+    {
+        return SCDepthNormalizingRangeOfHalfFloatPlane(pixels.data(), width, height, bytesPerRow);
+    }
+};
+
+} // namespace
+
+TEST(SCDepthRangeTests, HalfFloatToFloat)
+{
+    EXPECT_EQ(0.0f, SCDepthHalfFloatToFloat(kHalfZero));
+    EXPECT_EQ(1.0f, SCDepthHalfFloatToFloat(kHalfOne));
+    EXPECT_EQ(-1.0f, SCDepthHalfFloatToFloat(kHalfMinusOne));
+    EXPECT_EQ(0.25f, SCDepthHalfFloatToFloat(kHalfQuarter));
+    EXPECT_EQ(std::ldexp(1.0f, -24), SCDepthHalfFloatToFloat(0x0001));
+    EXPECT_TRUE(std::isinf(SCDepthHalfFloatToFloat(kHalfInfinity)));
+    EXPECT_TRUE(std::isnan(SCDepthHalfFloatToFloat(kHalfNaN)));
+}
+
+TEST(SCDepthRangeTests, RangeSkipsNaNsAndRowPadding)
+{
+    HalfFloatPlane plane(37, 5, kHalfHalf);
+    plane.set(3, 1, kHalfMinusOne);
+    plane.set(36, 4, kHalfTwo);
+    plane.set(0, 0, kHalfNaN);
+    plane.set(1, 0, kHalfNegativeNaN);
+    SCDepthRange range;
+    ASSERT_EQ(1, SCDepthRangeOfHalfFloatPlane(plane.pixels.data(), plane.width, plane.height, plane.bytesPerRow,
+                                              &range));
+    EXPECT_EQ(-1.0f, range.minimum);
+    EXPECT_EQ(2.0f, range.maximum);
+}
+
+TEST(SCDepthRangeTests, RangeFailsWithoutValidValues)
+{
+    HalfFloatPlane plane(8, 8, kHalfNaN);
+    SCDepthRange range = {3, 4};
+    EXPECT_EQ(0, SCDepthRangeOfHalfFloatPlane(plane.pixels.data(), plane.width, plane.height, plane.bytesPerRow,
+                                              &range));
+    EXPECT_EQ(0, SCDepthRangeOfHalfFloatPlane(plane.pixels.data(), 0, 0, plane.bytesPerRow, &range));
+    EXPECT_EQ(0, SCDepthRangeOfHalfFloatPlane(nullptr, 8, 8, 16, &range));
+    EXPECT_EQ(3.0f, range.minimum);
+}
+
+TEST(SCDepthRangeTests, NormalizingRangeFallsBackToZeroToOne)
+{
+    HalfFloatPlane plane(8, 4, kHalfQuarter);
+    plane.set(2, 2, kHalfTwo);
+    SCDepthRange range = plane.normalizingRange();
+    EXPECT_EQ(0.25f, range.minimum);
+    EXPECT_EQ(2.0f, range.maximum);
+
+    for (uint16_t value : {kHalfNaN, kHalfHalf}) {
+        // All NaN, then a single value
+        range = HalfFloatPlane(8, 4, value).normalizingRange();
+        EXPECT_EQ(0.0f, range.minimum);
+        EXPECT_EQ(1.0f, range.maximum);
+    }
+    range = SCDepthNormalizingRangeOfHalfFloatPlane(plane.pixels.data(), 0, 0, plane.bytesPerRow);
+    EXPECT_EQ(1.0f, range.maximum - range.minimum);
+
+    plane.set(3, 3, kHalfInfinity);
+    range = plane.normalizingRange();
+    EXPECT_EQ(0.0f, range.minimum);
+    EXPECT_EQ(1.0f, range.maximum);
+}
+
+TEST(SCDepthRangeTests, FocusRectIsTheSquareAroundThePointFromTheBottom)
+{
+    SCDepthRect rect;
+    ASSERT_EQ(1, SCDepthFocusRectMake(0.5, 0.25, 64, 48, &rect));
+    EXPECT_EQ(30u, rect.x);
+    // The point is 12 rows from the bottom, the square spans bottom up rows 10 to 13
+    EXPECT_EQ(34u, rect.y);
+    EXPECT_EQ((size_t)kSCDepthFocusRectSize, rect.width);
+    EXPECT_EQ((size_t)kSCDepthFocusRectSize, rect.height);
+}
+
+TEST(SCDepthRangeTests, FocusRectIsClippedToTheMap)
+{
+    SCDepthRect rect;
+    ASSERT_EQ(1, SCDepthFocusRectMake(0, 1, 64, 48, &rect));
+    EXPECT_EQ(0u, rect.x);
+    EXPECT_EQ(0u, rect.y);
+    EXPECT_EQ(2u, rect.width);
+    EXPECT_EQ(2u, rect.height);
+    ASSERT_EQ(1, SCDepthFocusRectMake(1, 0, 64, 48, &rect));
+    EXPECT_EQ(62u, rect.x);
+    EXPECT_EQ(46u, rect.y);
+    EXPECT_EQ(2u, rect.width);
+    EXPECT_EQ(2u, rect.height);
+    EXPECT_EQ(0, SCDepthFocusRectMake(-1, 0.5, 64, 48, &rect));
+    EXPECT_EQ(0, SCDepthFocusRectMake(0.5, 2, 64, 48, &rect));
+}
+
+TEST(SCDepthRangeTests, MaximumOfRectOnlyLooksInTheRect)
+{
+    HalfFloatPlane plane(16, 16, kHalfQuarter);
+    plane.set(0, 0, kHalfTwo);
+    plane.set(5, 6, kHalfOne);
+    plane.set(4, 5, kHalfNaN);
+    SCDepthRect rect = {4, 5, 4, 4};
+    float maximum = 0;
+    ASSERT_EQ(1, SCDepthMaximumOfHalfFloatPlaneRect(plane.pixels.data(), plane.bytesPerRow, rect, &maximum));
+    EXPECT_EQ(1.0f, maximum);
+
+    for (size_t y = 5; y < 9; ++y) {
+        for (size_t x = 4; x < 8; ++x) {
+            plane.set(x, y, kHalfNaN);
+        }
+    }
+    maximum = 7;
+    EXPECT_EQ(0, SCDepthMaximumOfHalfFloatPlaneRect(plane.pixels.data(), plane.bytesPerRow, rect, &maximum));
+    EXPECT_EQ(7.0f, maximum);
+}
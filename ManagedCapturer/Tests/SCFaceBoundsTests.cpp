@@ -0,0 +1,107 @@
+//
+//  SCFaceBoundsTests.cpp
+//  Snapchat
+//
+
+#include "SCFaceBounds.h"
+
+#include <gtest/gtest.h>
+
+using namespace SC;
+
+namespace {
+
+SCFaceRect SquareRect(double side)
+{
+    return {0, 0, side, side};
+}
+
+} // namespace
+
+TEST(SCFaceBoundsTests, AddFaceSkipsFacesBelowTheMinimumArea)
+{
+    SCFaceBoundsList faces = {};
+    EXPECT_FALSE(AddFace(faces, 1, SquareRect(0.1), 0.02));
+    EXPECT_TRUE(AddFace(faces, 2, SquareRect(0.2), 0.02));
+    EXPECT_EQ(1u, faces.count);
+    EXPECT_EQ(nullptr, FindFace(faces, 1));
+    EXPECT_NE(nullptr, FindFace(faces, 2));
+}
+
+TEST(SCFaceBoundsTests, AddFaceKeepsTheLastFaceWithTheSameId)
+{
+    SCFaceBoundsList faces = {};
+    EXPECT_TRUE(AddFace(faces, 7, SquareRect(0.2)));
+    EXPECT_TRUE(AddFace(faces, 7, SquareRect(0.4)));
+    ASSERT_EQ(1u, faces.count);
+    EXPECT_DOUBLE_EQ(0.4, FindFace(faces, 7)->rect.width);
+}
+
+TEST(SCFaceBoundsTests, AddFaceIgnoresASmallDuplicateOfALargeFace)
+{
+    SCFaceBoundsList faces = {};
+    AddFace(faces, 7, SquareRect(0.4), 0.02);
+    EXPECT_FALSE(AddFace(faces, 7, SquareRect(0.1), 0.02));
+    ASSERT_EQ(1u, faces.count);
+    EXPECT_DOUBLE_EQ(0.4, FindFace(faces, 7)->rect.width);
+}
+
+TEST(SCFaceBoundsTests, AddFaceKeepsTheLargestFacesOnceFull)
+{
+    SCFaceBoundsList faces = {};
+    for (int64_t faceID = 0; faceID < kSCFaceBoundsMaxCount; ++faceID) {
+        EXPECT_TRUE(AddFace(faces, faceID, SquareRect(0.01 * (faceID + 1))));
+    }
+    // A small face past the capacity is dropped, a large one replaces the smallest face
+    EXPECT_FALSE(AddFace(faces, 100, SquareRect(0.005)));
+    EXPECT_TRUE(AddFace(faces, 101, SquareRect(0.9)));
+    EXPECT_EQ((size_t)kSCFaceBoundsMaxCount, faces.count);
+    EXPECT_EQ(nullptr, FindFace(faces, 0));
+    EXPECT_EQ(nullptr, FindFace(faces, 100));
+    EXPECT_EQ(101, PreferredFace(faces)->faceID);
+    // Updating a face already in the full list doesn't drop anything
+    EXPECT_TRUE(AddFace(faces, 1, SquareRect(0.95)));
+    EXPECT_EQ((size_t)kSCFaceBoundsMaxCount, faces.count);
+    EXPECT_EQ(1, PreferredFace(faces)->faceID);
+}
+
+TEST(SCFaceBoundsTests, NormalizedFaceRectFlipsVertically)
+{
+    SCFaceRect rect = NormalizedFaceRect({100, 50, 200, 100}, 1000, 500, false);
+    EXPECT_DOUBLE_EQ(0.1, rect.x);
+    EXPECT_DOUBLE_EQ(0.1, rect.y);
+    EXPECT_DOUBLE_EQ(0.2, rect.width);
+    EXPECT_DOUBLE_EQ(0.2, rect.height);
+    EXPECT_DOUBLE_EQ(0.7, NormalizedFaceRect({100, 50, 200, 100}, 1000, 500, true).y);
+}
+
+TEST(SCFaceBoundsTests, PreferredFaceIsTheLargestWithAPositiveArea)
+{
+    SCFaceBoundsList faces = {};
+    EXPECT_EQ(nullptr, PreferredFace(faces));
+    AddFace(faces, 1, SquareRect(0));
+    EXPECT_EQ(nullptr, PreferredFace(faces));
+    AddFace(faces, 2, SquareRect(0.3));
+    AddFace(faces, 3, SquareRect(0.2));
+    EXPECT_EQ(2, PreferredFace(faces)->faceID);
+}
+
+TEST(SCFaceBoundsTests, FaceContainingPointExcludesTheMaxEdges)
+{
+    SCFaceBoundsList faces = {};
+    AddFace(faces, 1, {0.2, 0.2, 0.2, 0.2});
+    EXPECT_EQ(1, FaceContainingPoint(faces, 0.2, 0.3)->faceID);
+    EXPECT_EQ(nullptr, FaceContainingPoint(faces, 0.4, 0.3));
+}
+
+TEST(SCFaceBoundsTests, ShouldRetargetFace)
+{
+    SCFaceBounds targeted = {1, {0.2, 0.2, 0.2, 0.2}};
+    EXPECT_TRUE(ShouldRetargetFace(nullptr, targeted));
+    EXPECT_TRUE(ShouldRetargetFace(&targeted, {2, targeted.rect}));
+    EXPECT_FALSE(ShouldRetargetFace(&targeted, {1, {0.21, 0.21, 0.2, 0.2}}));
+    // Center out of the targeted bounds
+    EXPECT_TRUE(ShouldRetargetFace(&targeted, {1, {0.35, 0.2, 0.2, 0.2}}));
+    // Area changed by more than 20%
+    EXPECT_TRUE(ShouldRetargetFace(&targeted, {1, {0.19, 0.19, 0.23, 0.23}}));
+}
@@ -0,0 +1,76 @@
+//
+//  SCFrameHealthSamplerBenchmark.cpp
+//  Snapchat
+//
+//  Times FrameHealthSample on synthetic 1080p frames against what SCManagedFrameHealthChecker used to do: copy the
+//  whole bitmap, then convert the samples of each channel to floats before summing them.
+//
+
+#include "SCFrameHealthSampler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace SC;
+
+namespace {
+
+static const int kIterations = 2000;
+
+template <typename Block>
+double NanosecondsPerIteration(Block block)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        block();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+}
+
+float CopyAndSumAsFloats(const FrameHealthImage &image)
+{
+    std::vector<uint8_t> copy(image.data, image.data + image.bytesPerRow * image.height);
+    size_t pixels = image.width * image.height;
+    size_t stride = pixels > kFrameHealthMaxSamples ? pixels / kFrameHealthMaxSamples : 1;
+    size_t count = pixels > kFrameHealthMaxSamples ? kFrameHealthMaxSamples : pixels;
+    std::vector<float> channel(count);
+    float total = 0;
+    for (size_t c = 0; c < 4; ++c) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t index = i * stride;
+            channel[i] = copy[(index / image.width) * image.bytesPerRow + (index % image.width) * 4 + c];
+        }
+        float sum = 0;
+        for (float value : channel) {
+            sum += value;
+        }
+        total += sum / count;
+    }
+    return total;
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<uint8_t> bgra(1080 * 4 * 1920);
+    for (size_t i = 0; i < bgra.size(); ++i) {
+        bgra[i] = (uint8_t)(i * 31);
+    }
+    std::vector<uint8_t> luma(1920 * 1080);
+    memcpy(luma.data(), bgra.data(), luma.size());
+    FrameHealthImage bgraImage = {bgra.data(), 1080, 1920, 1080 * 4, FrameHealthPixelFormat::BGRA, false};
+    FrameHealthImage lumaImage = {luma.data(), 1920, 1080, 1920, FrameHealthPixelFormat::Luma, true};
+
+    volatile float sink = 0;
+    double copyAndSum = NanosecondsPerIteration([&] { sink = sink + CopyAndSumAsFloats(bgraImage); });
+    double sampleBGRA = NanosecondsPerIteration([&] { sink = sink + FrameHealthSample(bgraImage).averageR; });
+    double sampleLuma = NanosecondsPerIteration([&] { sink = sink + FrameHealthSample(lumaImage).averageR; });
+    printf("1080p BGRA copy and float sum: %10.0f ns\n", copyAndSum);
+    printf("1080p BGRA FrameHealthSample:  %10.0f ns\n", sampleBGRA);
+    printf("1080p luma FrameHealthSample:  %10.0f ns\n", sampleLuma);
+    return 0;
+}
@@ -0,0 +1,186 @@
+//
+//  SCFrameHealthSamplerTests.cpp
+//  Snapchat
+//
+
+#include "SCFrameHealthSampler.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace SC;
+
+namespace {
+
+// Rows are padded with 0xFF, which must never be sampled
+struct SyntheticFrame {
+    std::vector<uint8_t> bytes;
+    FrameHealthImage image;
+
+    SyntheticFrame(size_t width, size_t height, FrameHealthPixelFormat format, bool lumaVideoRange = false)
+    {
+        size_t bytesPerPixel = format == FrameHealthPixelFormat::Luma ? 1 : 4;
+        size_t bytesPerRow = width * bytesPerPixel + 64;
+        bytes.assign(bytesPerRow * height, 0xFF);
+        image = {bytes.data(), width, height, bytesPerRow, format, lumaVideoRange};
+    }
+
+    void fill(const uint8_t *pixel)
+    {
+        size_t bytesPerPixel = image.format == FrameHealthPixelFormat::Luma ? 1 : 4;
+        for (size_t row = 0; row < image.height; ++row) {
+            for (size_t column = 0; column < image.width; ++column) {
+                for (size_t i = 0; i < bytesPerPixel; ++i) {
+                    bytes[row * image.bytesPerRow + column * bytesPerPixel + i] = pixel[i];
+                }
+            }
+        }
+    }
+
+    void fillGray(uint8_t value, uint8_t alpha = 255)
+    {
+        uint8_t pixel[4] = {value, value, value, alpha};
+        fill(pixel);
+    }
+};
+
+FrameHealthClassification Classify(const SyntheticFrame &frame)
+{
+    return FrameHealthClassify(FrameHealthSample(frame.image));
+}
+
+} // namespace
+
+TEST(SCFrameHealthSamplerTests, ClassifiesBGRAFrames)
+{
+    SyntheticFrame frame(1080, 1920, FrameHealthPixelFormat::BGRA);
+    frame.fillGray(0);
+    EXPECT_EQ(FrameHealthClassification::TotallyBlack, Classify(frame));
+    frame.fillGray(12);
+    EXPECT_EQ(FrameHealthClassification::PossiblyBlack, Classify(frame));
+    frame.fillGray(128);
+    EXPECT_EQ(FrameHealthClassification::Healthy, Classify(frame));
+}
+
+TEST(SCFrameHealthSamplerTests, ClassifiesFullRangeLumaFrames)
+{
+    SyntheticFrame frame(1920, 1080, FrameHealthPixelFormat::Luma);
+    frame.fillGray(0);
+    EXPECT_EQ(FrameHealthClassification::TotallyBlack, Classify(frame));
+    frame.fillGray(12);
+    EXPECT_EQ(FrameHealthClassification::PossiblyBlack, Classify(frame));
+    frame.fillGray(128);
+    EXPECT_EQ(FrameHealthClassification::Healthy, Classify(frame));
+}
+
+TEST(SCFrameHealthSamplerTests, ClassifiesVideoRangeLumaFrames)
+{
+    SyntheticFrame frame(1920, 1080, FrameHealthPixelFormat::Luma, true);
+    frame.fillGray(16);
+    EXPECT_EQ(FrameHealthClassification::TotallyBlack, Classify(frame));
+    // Below black is still black
+    frame.fillGray(4);
+    EXPECT_EQ(FrameHealthClassification::TotallyBlack, Classify(frame));
+    frame.fillGray(26);
+    EXPECT_EQ(FrameHealthClassification::PossiblyBlack, Classify(frame));
+    frame.fillGray(128);
+    EXPECT_EQ(FrameHealthClassification::Healthy, Classify(frame));
+}
+
+TEST(SCFrameHealthSamplerTests, VideoRangeLumaMatchesTheRGBThreshold)
+{
+    // Y 33 converts to RGB 19.8 and Y 34 to RGB 20.96, on each side of the RGB threshold of 20
+    SyntheticFrame frame(1920, 1080, FrameHealthPixelFormat::Luma, true);
+    frame.fillGray(33);
+    FrameHealthStatistics statistics = FrameHealthSample(frame.image);
+    EXPECT_TRUE(statistics.sampledLuma);
+    EXPECT_NEAR(17 * 255.0 / 219, statistics.averageR, 0.01);
+    EXPECT_EQ(FrameHealthClassification::PossiblyBlack, FrameHealthClassify(statistics));
+    frame.fillGray(34);
+    EXPECT_EQ(FrameHealthClassification::Healthy, Classify(frame));
+    frame.fillGray(235);
+    EXPECT_FLOAT_EQ(255, FrameHealthSample(frame.image).averageR);
+    frame.fillGray(255);
+    EXPECT_FLOAT_EQ(255, FrameHealthSample(frame.image).averageR);
+}
+
+TEST(SCFrameHealthSamplerTests, TranslucentFramesAreNotBlack)
+{
+    SyntheticFrame frame(720, 1280, FrameHealthPixelFormat::RGBA);
+    frame.fillGray(0, 10);
+    EXPECT_EQ(FrameHealthClassification::Healthy, Classify(frame));
+}
+
+TEST(SCFrameHealthSamplerTests, ReadsChannelsInPixelFormatOrder)
+{
+    uint8_t pixel[4] = {10, 20, 30, 255};
+    SyntheticFrame bgra(1080, 1920, FrameHealthPixelFormat::BGRA);
+    bgra.fill(pixel);
+    FrameHealthStatistics statistics = FrameHealthSample(bgra.image);
+    EXPECT_FLOAT_EQ(30, statistics.averageR);
+    EXPECT_FLOAT_EQ(20, statistics.averageG);
+    EXPECT_FLOAT_EQ(10, statistics.averageB);
+    EXPECT_FLOAT_EQ(255, statistics.averageA);
+
+    SyntheticFrame rgba(1080, 1920, FrameHealthPixelFormat::RGBA);
+    rgba.fill(pixel);
+    statistics = FrameHealthSample(rgba.image);
+    EXPECT_FLOAT_EQ(10, statistics.averageR);
+    EXPECT_FLOAT_EQ(20, statistics.averageG);
+    EXPECT_FLOAT_EQ(30, statistics.averageB);
+    EXPECT_FALSE(statistics.sampledLuma);
+}
+
+TEST(SCFrameHealthSamplerTests, SamplesAtMostMaxSamples)
+{
+    SyntheticFrame frame(1920, 1080, FrameHealthPixelFormat::Luma);
+    frame.fillGray(50);
+    FrameHealthStatistics statistics = FrameHealthSample(frame.image);
+    EXPECT_LE(statistics.sampleCount, kFrameHealthMaxSamples);
+    EXPECT_GT(statistics.sampleCount, kFrameHealthMaxSamples - 16);
+    EXPECT_FLOAT_EQ(50, statistics.averageR);
+
+    statistics = FrameHealthSample(frame.image, 100);
+    EXPECT_LE(statistics.sampleCount, 100u);
+    EXPECT_FLOAT_EQ(50, statistics.averageR);
+}
+
+TEST(SCFrameHealthSamplerTests, SpreadsSamplesOverTheFrame)
+{
+    // Top half black and bottom half white, the samples must land in both
+    SyntheticFrame frame(1080, 1920, FrameHealthPixelFormat::BGRA);
+    frame.fillGray(255);
+    for (size_t row = 0; row < frame.image.height / 2; ++row) {
+        for (size_t byte = 0; byte < frame.image.width * 4; byte += 4) {
+            frame.bytes[row * frame.image.bytesPerRow + byte] = 0;
+            frame.bytes[row * frame.image.bytesPerRow + byte + 1] = 0;
+            frame.bytes[row * frame.image.bytesPerRow + byte + 2] = 0;
+        }
+    }
+    FrameHealthStatistics statistics = FrameHealthSample(frame.image);
+    EXPECT_NEAR(127.5, statistics.averageR, 255.0 * 16 / kFrameHealthMaxSamples);
+}
+
+TEST(SCFrameHealthSamplerTests, SamplesFramesNarrowerThanARun)
+{
+    SyntheticFrame luma(7, 5, FrameHealthPixelFormat::Luma);
+    luma.fillGray(12);
+    FrameHealthStatistics statistics = FrameHealthSample(luma.image);
+    EXPECT_EQ(35u, statistics.sampleCount);
+    EXPECT_EQ(FrameHealthClassification::PossiblyBlack, FrameHealthClassify(statistics));
+
+    SyntheticFrame bgra(3, 3, FrameHealthPixelFormat::BGRA);
+    bgra.fillGray(0);
+    statistics = FrameHealthSample(bgra.image);
+    EXPECT_EQ(9u, statistics.sampleCount);
+    EXPECT_EQ(FrameHealthClassification::TotallyBlack, FrameHealthClassify(statistics));
+}
+
+TEST(SCFrameHealthSamplerTests, EmptyFramesAreHealthy)
+{
+    FrameHealthImage image = {nullptr, 1920, 1080, 1920, FrameHealthPixelFormat::Luma, false};
+    FrameHealthStatistics statistics = FrameHealthSample(image);
+    EXPECT_EQ(0u, statistics.sampleCount);
+    EXPECT_EQ(FrameHealthClassification::Healthy, FrameHealthClassify(statistics));
+}
@@ -0,0 +1,57 @@
+//
+//  SCHotPathTraceBenchmark.cpp
+//  Snapchat
+//
+//  Times the three messages the streamer has for every frame (output, displayed and announced) formatted with
+//  snprintf, like a log would before any NSString or os_log cost, against recording them to the trace, with the trace
+//  enabled and disabled at runtime. Release builds compile the trace out, which costs nothing.
+//
+
+#include "SCHotPathTrace.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+static const int kIterations = 200000;
+
+template <typename Block>
+double NanosecondsPerFrame(Block block)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        block(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+}
+
+} // namespace
+
+int main()
+{
+    char buffer[256];
+    volatile size_t sink = 0;
+    double formatted = NanosecondsPerFrame([&](int i) {
+        void *sampleBuffer = (void *)(uintptr_t)(0x10000 + i);
+        sink = sink + snprintf(buffer, sizeof(buffer), "didOutputSampleBuffer:%p latency:%f", sampleBuffer, i * 1e-5);
+        sink = sink + snprintf(buffer, sizeof(buffer), "displayed sampleBuffer:%p", sampleBuffer);
+        sink = sink + snprintf(buffer, sizeof(buffer), "begin annoucing sampleBuffer:%p of devicePosition:%lu",
+                               sampleBuffer, (unsigned long)(i & 1));
+    });
+    auto trace = [](int i) {
+        void *sampleBuffer = (void *)(uintptr_t)(0x10000 + i);
+        SCHotPathTrace2(SCHotPathTraceEventVideoStreamerFrame, SCHotPathTracePointer(sampleBuffer),
+                        SCHotPathTraceDouble(i * 1e-5));
+        SCHotPathTrace1(SCHotPathTraceEventVideoStreamerDisplayed, SCHotPathTracePointer(sampleBuffer));
+        SCHotPathTrace2(SCHotPathTraceEventVideoStreamerBeginAnnouncing, SCHotPathTracePointer(sampleBuffer), i & 1);
+    };
+    SCHotPathTraceSetEnabled(1);
+    double traced = NanosecondsPerFrame(trace);
+    SCHotPathTraceSetEnabled(0);
+    double disabled = NanosecondsPerFrame(trace);
+    printf("3 messages per frame  snprintf %6.1f ns  traced %6.1f ns  disabled at runtime %6.1f ns\n", formatted,
+           traced, disabled);
+    return 0;
+}
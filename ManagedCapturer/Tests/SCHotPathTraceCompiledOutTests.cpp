@@ -0,0 +1,36 @@
+//
+//  SCHotPathTraceCompiledOutTests.cpp
+//  Snapchat
+//
+//  The host build has the trace compiled in, this checks what release builds get.
+//
+
+#undef SC_HOT_PATH_TRACE_ENABLED
+#define SC_HOT_PATH_TRACE_ENABLED 0
+
+#include "SCHotPathTrace.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+int sEvaluatedCount = 0;
+
+uint64_t CountEvaluation()
+{
+    return ++sEvaluatedCount;
+}
+
+} // namespace
+
+TEST(SCHotPathTraceCompiledOutTests, ArgumentsAreNotEvaluated)
+{
+    SCHotPathTrace1(SCHotPathTraceEventMetadataFaces, CountEvaluation());
+    SCHotPathTrace3(SCHotPathTraceEventVideoStreamerDropped, CountEvaluation(), CountEvaluation(), CountEvaluation());
+    EXPECT_EQ(0, sEvaluatedCount);
+}
+
+TEST(SCHotPathTraceCompiledOutTests, SnapshotsCanStillBeDecoded)
+{
+    EXPECT_EQ("", SC::DecodeHotPathTrace(nullptr, 0));
+}
@@ -0,0 +1,124 @@
+//
+//  SCHotPathTraceTests.cpp
+//  Snapchat
+//
+
+#include "SCHotPathTrace.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace SC;
+
+namespace {
+
+std::vector<std::string> DecodedLinesContaining(const std::string &text)
+{
+    std::vector<uint8_t> snapshot = HotPathTraceSnapshot();
+    std::istringstream decoded(DecodeHotPathTrace(snapshot.data(), snapshot.size()));
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(decoded, line)) {
+        if (line.find(text) != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST(SCHotPathTraceTests, RecordsAreDroppedWhileDisabled)
+{
+    SCHotPathTraceSetEnabled(0);
+    SCHotPathTrace1(SCHotPathTraceEventVideoStreamerDisplayed, 0xd15ab1ed);
+    EXPECT_TRUE(DecodedLinesContaining("displayed sampleBuffer:0xd15ab1ed").empty());
+    SCHotPathTraceSetEnabled(1);
+    SCHotPathTrace1(SCHotPathTraceEventVideoStreamerDisplayed, 0xd15ab1ed);
+    SCHotPathTraceSetEnabled(0);
+    EXPECT_EQ(1u, DecodedLinesContaining("displayed sampleBuffer:0xd15ab1ed").size());
+}
+
+TEST(SCHotPathTraceTests, RecordsDecodeWithTheFormatOfTheirEvent)
+{
+    SCHotPathTraceSetEnabled(1);
+    SCHotPathTrace1(SCHotPathTraceEventVideoCapturerFrame, -1234);
+    SCHotPathTrace2(SCHotPathTraceEventVideoStreamerFrame, SCHotPathTracePointer((void *)0xabc),
+                    SCHotPathTraceDouble(0.25));
+    SCHotPathTrace(SCHotPathTraceEventCapacityAnalyzerFrame, SCHotPathTraceDouble(0.5), 400,
+                   SCHotPathTraceDouble(-1.5), SCHotPathTraceDouble(0.75));
+    SCHotPathTraceSetEnabled(0);
+    EXPECT_EQ(1u, DecodedLinesContaining("Obtained video data source at time -1234").size());
+    EXPECT_EQ(1u, DecodedLinesContaining("didOutputSampleBuffer:0xabc latency:0.250000").size());
+    EXPECT_EQ(1u,
+              DecodedLinesContaining("ExposureTime: 0.500000, ISO: 400, Brightness: -1.500000, Luma: 0.750000").size());
+}
+
+TEST(SCHotPathTraceTests, FullRingsKeepTheNewestRecordsInOrder)
+{
+    SCHotPathTraceSetEnabled(1);
+    std::thread([] {
+        for (uint64_t count = 0; count < 5000; ++count) {
+            SCHotPathTrace1(SCHotPathTraceEventMetadataFaces, count);
+        }
+    }).join();
+    SCHotPathTraceSetEnabled(0);
+    std::vector<std::string> lines = DecodedLinesContaining("metadata objects:");
+    ASSERT_FALSE(lines.empty());
+    EXPECT_LT(lines.size(), 5000u);
+    size_t last = 5000 - lines.size();
+    for (const std::string &line : lines) {
+        EXPECT_NE(std::string::npos, line.find("metadata objects:" + std::to_string(last++)));
+    }
+}
+
+TEST(SCHotPathTraceTests, ThreadsReuseTheRingsOfExitedThreads)
+{
+    SCHotPathTraceSetEnabled(1);
+    size_t ringCount = HotPathTraceRingCount();
+    for (uint64_t thread = 0; thread < 8; ++thread) {
+        std::thread([thread] { SCHotPathTrace2(SCHotPathTraceEventFaceDetectorFrame, 0xfeed, thread); }).join();
+    }
+    EXPECT_LE(HotPathTraceRingCount(), ringCount + 1);
+    std::vector<std::thread> threads;
+    for (uint64_t thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 100; ++i) {
+                SCHotPathTrace2(SCHotPathTraceEventFaceDetectorFrame, 0xbeef, 0);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    SCHotPathTraceSetEnabled(0);
+    EXPECT_LE(HotPathTraceRingCount(), ringCount + 4);
+    // The records of exited threads stay around until their ring is taken again
+    EXPECT_EQ(1u, DecodedLinesContaining("sampleBuffer:0xfeed detection interval:7").size());
+    EXPECT_EQ(400u, DecodedLinesContaining("sampleBuffer:0xbeef").size());
+}
+
+TEST(SCHotPathTraceTests, DecodingRejectsOtherData)
+{
+    std::vector<uint8_t> garbage(64, 0x5a);
+    EXPECT_EQ("", DecodeHotPathTrace(garbage.data(), garbage.size()));
+    EXPECT_EQ("", DecodeHotPathTrace(nullptr, 0));
+}
+
+TEST(SCHotPathTraceTests, TruncatedSnapshotsDecodeTheWholeRecords)
+{
+    SCHotPathTraceSetEnabled(1);
+    SCHotPathTrace1(SCHotPathTraceEventVideoStreamerEndAnnouncing, 1);
+    SCHotPathTrace1(SCHotPathTraceEventVideoStreamerEndAnnouncing, 2);
+    SCHotPathTraceSetEnabled(0);
+    std::vector<uint8_t> snapshot = HotPathTraceSnapshot();
+    std::string decoded = DecodeHotPathTrace(snapshot.data(), snapshot.size());
+    std::string truncated = DecodeHotPathTrace(snapshot.data(), snapshot.size() - 1);
+    EXPECT_NE(std::string::npos, decoded.find("end annoucing sampleBuffer:0x2"));
+    EXPECT_EQ(std::string::npos, truncated.find("end annoucing sampleBuffer:0x2"));
+    EXPECT_EQ(0u, decoded.find(truncated));
+}
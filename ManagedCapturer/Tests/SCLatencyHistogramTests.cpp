@@ -0,0 +1,97 @@
+//
+//  SCLatencyHistogramTests.cpp
+//  Snapchat
+//
+
+#include "SCLatencyHistogram.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace SC;
+
+TEST(SCLatencyHistogramTests, EmptyHistogram)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(0u, histogram.count());
+    EXPECT_EQ(0u, histogram.min());
+    EXPECT_EQ(0u, histogram.max());
+    EXPECT_EQ(0, histogram.mean());
+    EXPECT_EQ(0u, histogram.valueAtPercentile(50));
+}
+
+TEST(SCLatencyHistogramTests, SmallValuesAreExact)
+{
+    LatencyHistogram histogram;
+    const uint32_t subBucketCount = LatencyHistogram::kSubBucketCount;
+    for (uint32_t value = 0; value < subBucketCount; ++value) {
+        histogram.record(value);
+    }
+    for (uint32_t value = 0; value < subBucketCount; ++value) {
+        double percentile = 100.0 * (value + 1) / subBucketCount;
+        EXPECT_EQ(value, histogram.valueAtPercentile(percentile));
+    }
+    EXPECT_DOUBLE_EQ(7.5, histogram.mean());
+}
+
+TEST(SCLatencyHistogramTests, BucketsCoverEveryValueInOrder)
+{
+    // Copied, the assertions take their arguments by reference
+    const uint32_t bucketCount = LatencyHistogram::kBucketCount;
+    uint32_t previousIndex = 0;
+    for (uint64_t value = 1; value <= UINT32_MAX; value = value * 5 / 4 + 1) {
+        uint32_t index = LatencyHistogram::bucketIndex((uint32_t)value);
+        ASSERT_LT(index, bucketCount);
+        ASSERT_GE(index, previousIndex);
+        ASSERT_GE(LatencyHistogram::highestEquivalentValue(index), value);
+        previousIndex = index;
+    }
+    EXPECT_EQ(bucketCount - 1, LatencyHistogram::bucketIndex(UINT32_MAX));
+    EXPECT_EQ(UINT32_MAX, LatencyHistogram::highestEquivalentValue(bucketCount - 1));
+}
+
+TEST(SCLatencyHistogramTests, PercentilesAreWithinTheBucketPrecision)
+{
+    std::mt19937 random(7);
+    std::lognormal_distribution<double> latency(9, 1.5);
+    std::vector<uint32_t> values;
+    LatencyHistogram histogram;
+    for (int i = 0; i < 100000; ++i) {
+        uint32_t value = (uint32_t)std::min(latency(random), 4e9);
+        values.push_back(value);
+        histogram.record(value);
+    }
+    std::sort(values.begin(), values.end());
+    for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+        uint32_t exact = values[(size_t)(percentile / 100 * values.size()) - 1];
+        uint32_t estimate = histogram.valueAtPercentile(percentile);
+        EXPECT_GE(estimate, exact) << percentile;
+        EXPECT_LE(estimate, exact + exact / 8 + 1) << percentile;
+    }
+    EXPECT_EQ(values.front(), histogram.valueAtPercentile(0));
+    EXPECT_EQ(values.back(), histogram.valueAtPercentile(100));
+}
+
+TEST(SCLatencyHistogramTests, AddMergesAndResetClears)
+{
+    LatencyHistogram first;
+    LatencyHistogram second;
+    first.record(10);
+    first.record(1000);
+    second.record(5);
+    second.record(100000);
+    first.add(second);
+    EXPECT_EQ(4u, first.count());
+    EXPECT_EQ(5u, first.min());
+    EXPECT_EQ(100000u, first.max());
+    EXPECT_DOUBLE_EQ((10 + 1000 + 5 + 100000) / 4.0, first.mean());
+    first.reset();
+    EXPECT_EQ(0u, first.count());
+    EXPECT_EQ(0u, first.valueAtPercentile(99));
+    // Adding an empty histogram leaves the min alone
+    second.add(first);
+    EXPECT_EQ(5u, second.min());
+}
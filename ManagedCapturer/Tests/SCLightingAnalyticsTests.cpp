@@ -0,0 +1,223 @@
+//
+//  SCLightingAnalyticsTests.cpp
+//  Snapchat
+//
+
+#include "SCLightingAnalytics.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace SC;
+
+namespace {
+
+struct SyntheticPlane {
+    std::vector<uint8_t> bytes;
+    LumaPlane plane;
+
+    // Rows are padded with 0xFF, which must never be sampled
+    SyntheticPlane(size_t width, size_t height, uint8_t blackLevel = 0, uint8_t whiteLevel = 255)
+    {
+        size_t bytesPerRow = width + 32;
+        bytes.assign(bytesPerRow * height, 0xFF);
+        plane = {bytes.data(), width, height, bytesPerRow, blackLevel, whiteLevel};
+    }
+
+    void fill(uint8_t luma)
+    {
+        for (size_t row = 0; row < plane.height; ++row) {
+            std::fill_n(bytes.begin() + row * plane.bytesPerRow, plane.width, luma);
+        }
+    }
+};
+
+enum { kBright = 0, kNormal = 1, kDark = 2 };
+
+// Shaped like the lighting condition table of SCManagedDeviceCapacityAnalyzer
+const LightingLevel kLevels[] = {
+    {kBright, 2, 0.6f, 4, 2},
+    {kNormal, -2, 0.2f, 4, 2},
+    {kDark, 0, 0, 4, 2},
+};
+const LightingHysteresisTable kTable = {kLevels, 3, 0.5f, 0.05f};
+
+LightingSample Brightness(float brightness)
+{
+    return {brightness, false, {}};
+}
+
+LightingSample BrightnessAndLuma(float brightness, float mean, float brightClippedFraction = 0)
+{
+    LightingSample sample = {brightness, true, {}};
+    sample.lumaStatistics.mean = mean;
+    sample.lumaStatistics.brightClippedFraction = brightClippedFraction;
+    return sample;
+}
+
+// Number of updates it takes to leave the current state, 0 if it never does within limit
+size_t UpdatesToSwitch(LightingHysteresis &hysteresis, const LightingSample &sample, size_t limit = 100)
+{
+    for (size_t i = 1; i <= limit; ++i) {
+        if (hysteresis.update(sample)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+TEST(SCLightingAnalyticsTests, StatisticsOfAFullRangePlane)
+{
+    SyntheticPlane gray(1920, 1080);
+    gray.fill(51);
+    LumaStatistics statistics = LumaPlaneStatistics(gray.plane, 1);
+    EXPECT_EQ(1920u * 1080, statistics.sampleCount);
+    EXPECT_FLOAT_EQ(0.2f, statistics.mean);
+    EXPECT_FLOAT_EQ(0, statistics.darkClippedFraction);
+    EXPECT_FLOAT_EQ(0, statistics.brightClippedFraction);
+    EXPECT_FLOAT_EQ(0, statistics.dynamicRange);
+
+    gray.fill(0);
+    statistics = LumaPlaneStatistics(gray.plane, 1);
+    EXPECT_FLOAT_EQ(0, statistics.mean);
+    EXPECT_FLOAT_EQ(1, statistics.darkClippedFraction);
+
+    gray.fill(255);
+    statistics = LumaPlaneStatistics(gray.plane, 1);
+    EXPECT_FLOAT_EQ(1, statistics.mean);
+    EXPECT_FLOAT_EQ(1, statistics.brightClippedFraction);
+}
+
+TEST(SCLightingAnalyticsTests, StatisticsAreNormalizedToTheVideoRange)
+{
+    SyntheticPlane plane(1280, 720, 16, 235);
+    plane.fill(16);
+    LumaStatistics statistics = LumaPlaneStatistics(plane.plane, 1);
+    EXPECT_FLOAT_EQ(0, statistics.mean);
+    EXPECT_FLOAT_EQ(1, statistics.darkClippedFraction);
+    // Below black is clamped
+    plane.fill(4);
+    EXPECT_FLOAT_EQ(0, LumaPlaneStatistics(plane.plane, 1).mean);
+    plane.fill(235);
+    statistics = LumaPlaneStatistics(plane.plane, 1);
+    EXPECT_FLOAT_EQ(1, statistics.mean);
+    EXPECT_FLOAT_EQ(1, statistics.brightClippedFraction);
+    plane.fill(126);
+    EXPECT_NEAR(110.0 / 219, LumaPlaneStatistics(plane.plane, 1).mean, 1e-6);
+}
+
+TEST(SCLightingAnalyticsTests, ClippingAndDynamicRangeOfAHalfBlackHalfWhitePlane)
+{
+    // Left half black and right half white, with a width which leaves a tail after the SIMD chunks
+    SyntheticPlane plane(1001, 64);
+    for (size_t row = 0; row < plane.plane.height; ++row) {
+        uint8_t *bytes = plane.bytes.data() + row * plane.plane.bytesPerRow;
+        std::fill_n(bytes, 500, 2);
+        std::fill_n(bytes + 500, 501, 253);
+    }
+    LumaStatistics statistics = LumaPlaneStatistics(plane.plane, 1);
+    EXPECT_NEAR((500 * 2 + 501 * 253) / 1001.0 / 255, statistics.mean, 1e-5);
+    EXPECT_FLOAT_EQ(500.f / 1001, statistics.darkClippedFraction);
+    EXPECT_FLOAT_EQ(501.f / 1001, statistics.brightClippedFraction);
+    EXPECT_FLOAT_EQ(251.f / 255, statistics.dynamicRange);
+}
+
+TEST(SCLightingAnalyticsTests, RowStepSkipsRows)
+{
+    // Even rows dark and odd rows bright, a step of 2 only sees the dark ones
+    SyntheticPlane plane(640, 480);
+    for (size_t row = 0; row < plane.plane.height; ++row) {
+        std::fill_n(plane.bytes.begin() + row * plane.plane.bytesPerRow, plane.plane.width, row % 2 ? 200 : 20);
+    }
+    LumaStatistics statistics = LumaPlaneStatistics(plane.plane, 2);
+    EXPECT_EQ(640u * 240, statistics.sampleCount);
+    EXPECT_FLOAT_EQ(20.f / 255, statistics.mean);
+    EXPECT_FLOAT_EQ(110.f / 255, LumaPlaneStatistics(plane.plane, 1).mean);
+    // A step of 0 is taken as 1
+    EXPECT_EQ(640u * 480, LumaPlaneStatistics(plane.plane, 0).sampleCount);
+}
+
+TEST(SCLightingAnalyticsTests, InvalidPlanesHaveNoSamples)
+{
+    SyntheticPlane plane(64, 64);
+    LumaPlane invalid = plane.plane;
+    invalid.data = nullptr;
+    EXPECT_EQ(0u, LumaPlaneStatistics(invalid, 1).sampleCount);
+    invalid = plane.plane;
+    invalid.width = 0;
+    EXPECT_EQ(0u, LumaPlaneStatistics(invalid, 1).sampleCount);
+    invalid = plane.plane;
+    invalid.whiteLevel = invalid.blackLevel;
+    EXPECT_EQ(0u, LumaPlaneStatistics(invalid, 1).sampleCount);
+}
+
+TEST(SCLightingAnalyticsTests, HysteresisSwitchesAfterConsecutiveFrames)
+{
+    LightingHysteresis hysteresis(kTable, kNormal);
+    EXPECT_EQ(kNormal, hysteresis.state());
+    EXPECT_EQ(4u, UpdatesToSwitch(hysteresis, Brightness(-5)));
+    EXPECT_EQ(kDark, hysteresis.state());
+    EXPECT_EQ(0u, UpdatesToSwitch(hysteresis, Brightness(-5)));
+    EXPECT_EQ(4u, UpdatesToSwitch(hysteresis, Brightness(5)));
+    EXPECT_EQ(kBright, hysteresis.state());
+}
+
+TEST(SCLightingAnalyticsTests, HysteresisRestartsWhenTheLevelFlickers)
+{
+    LightingHysteresis hysteresis(kTable, kNormal);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(hysteresis.update(Brightness(-5)));
+    }
+    // Back in the current level resets the pending switch, so does another level
+    EXPECT_FALSE(hysteresis.update(Brightness(0)));
+    EXPECT_FALSE(hysteresis.update(Brightness(-5)));
+    EXPECT_FALSE(hysteresis.update(Brightness(-5)));
+    EXPECT_FALSE(hysteresis.update(Brightness(5)));
+    EXPECT_EQ(kNormal, hysteresis.state());
+    EXPECT_EQ(4u, UpdatesToSwitch(hysteresis, Brightness(-5)));
+}
+
+TEST(SCLightingAnalyticsTests, HysteresisIgnoresBrightnessWithinTheMargin)
+{
+    LightingHysteresis hysteresis(kTable, kNormal);
+    EXPECT_FALSE(hysteresis.update(Brightness(-5)));
+    EXPECT_FALSE(hysteresis.update(Brightness(-5)));
+    // Within the margin of the normal bound, neither advances nor resets the pending switch
+    EXPECT_FALSE(hysteresis.update(Brightness(-2.2f)));
+    EXPECT_FALSE(hysteresis.update(Brightness(-1.8f)));
+    EXPECT_FALSE(hysteresis.update(Brightness(-5)));
+    EXPECT_TRUE(hysteresis.update(Brightness(-5)));
+    EXPECT_EQ(kDark, hysteresis.state());
+}
+
+TEST(SCLightingAnalyticsTests, AgreeingLumaSwitchesSooner)
+{
+    LightingHysteresis hysteresis(kTable, kNormal);
+    EXPECT_EQ(2u, UpdatesToSwitch(hysteresis, BrightnessAndLuma(-5, 0.1f)));
+    EXPECT_EQ(kDark, hysteresis.state());
+
+    // Luma of the normal level doesn't confirm the dark one
+    hysteresis.reset(kNormal);
+    EXPECT_EQ(4u, UpdatesToSwitch(hysteresis, BrightnessAndLuma(-5, 0.4f)));
+
+    // Neither does a light source in frame
+    hysteresis.reset(kNormal);
+    EXPECT_EQ(4u, UpdatesToSwitch(hysteresis, BrightnessAndLuma(-5, 0.1f, 0.2f)));
+
+    hysteresis.reset(kDark);
+    EXPECT_EQ(2u, UpdatesToSwitch(hysteresis, BrightnessAndLuma(0, 0.4f)));
+    EXPECT_EQ(kNormal, hysteresis.state());
+    EXPECT_EQ(2u, UpdatesToSwitch(hysteresis, BrightnessAndLuma(5, 0.8f)));
+    EXPECT_EQ(kBright, hysteresis.state());
+}
+
+TEST(SCLightingAnalyticsTests, ResetToAnUnknownStateFallsBackToTheFirstLevel)
+{
+    LightingHysteresis hysteresis(kTable, 42);
+    EXPECT_EQ(kBright, hysteresis.state());
+    hysteresis.reset(kDark);
+    EXPECT_EQ(kDark, hysteresis.state());
+}
@@ -0,0 +1,149 @@
+//
+//  SCPlaneCopyBenchmark.cpp
+//  Snapchat
+//
+//  Times the NV12 crop copy of SCCapturerBufferedVideoWriter, PlaneRegionCopy, against a hand vectorized copy of two
+//  rows per iteration and a cache blocked copy, at the common capture resolutions.
+//
+
+#include "SCPlaneCopy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SC_PLANE_COPY_BENCHMARK_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SC_PLANE_COPY_BENCHMARK_SSE2 1
+#endif
+
+using namespace SC;
+
+namespace {
+
+// kSCIPhoneXCapturedImageVideoCropRatio
+static const double kCropRatio = (397.0 * 739.0) / (375.0 * 812.0);
+static const int kIterations = 200;
+
+inline void Copy64(const uint8_t *source, uint8_t *destination)
+{
+#if SC_PLANE_COPY_BENCHMARK_NEON
+    vst1q_u8(destination, vld1q_u8(source));
+    vst1q_u8(destination + 16, vld1q_u8(source + 16));
+    vst1q_u8(destination + 32, vld1q_u8(source + 32));
+    vst1q_u8(destination + 48, vld1q_u8(source + 48));
+#elif SC_PLANE_COPY_BENCHMARK_SSE2
+    const __m128i *s = reinterpret_cast<const __m128i *>(source);
+    __m128i *d = reinterpret_cast<__m128i *>(destination);
+    _mm_storeu_si128(d, _mm_loadu_si128(s));
+    _mm_storeu_si128(d + 1, _mm_loadu_si128(s + 1));
+    _mm_storeu_si128(d + 2, _mm_loadu_si128(s + 2));
+    _mm_storeu_si128(d + 3, _mm_loadu_si128(s + 3));
+#else
+    memcpy(destination, source, 64);
+#endif
+}
+
+// Two rows per iteration in 64 byte chunks, so that two streams of loads are in flight
+void RowPairCopy(const PlaneRegion &region)
+{
+    size_t row = 0;
+    for (; row + 2 <= region.rows; row += 2) {
+        for (size_t r = row; r < row + 2; ++r) {
+            const uint8_t *source = region.source + r * region.sourceBytesPerRow;
+            uint8_t *destination = region.destination + r * region.destinationBytesPerRow;
+            size_t offset = 0;
+            for (; offset + 64 <= region.bytesPerRow; offset += 64) {
+                Copy64(source + offset, destination + offset);
+            }
+            memcpy(destination + offset, source + offset, region.bytesPerRow - offset);
+        }
+    }
+    for (; row < region.rows; ++row) {
+        memcpy(region.destination + row * region.destinationBytesPerRow,
+               region.source + row * region.sourceBytesPerRow, region.bytesPerRow);
+    }
+}
+
+// 16 rows at a time in 4KB column blocks
+void CacheBlockedCopy(const PlaneRegion &region)
+{
+    static const size_t kBlockRows = 16;
+    static const size_t kBlockBytes = 4096;
+    for (size_t row = 0; row < region.rows; row += kBlockRows) {
+        size_t rows = std::min(kBlockRows, region.rows - row);
+        for (size_t offset = 0; offset < region.bytesPerRow; offset += kBlockBytes) {
+            size_t bytes = std::min(kBlockBytes, region.bytesPerRow - offset);
+            for (size_t r = row; r < row + rows; ++r) {
+                memcpy(region.destination + r * region.destinationBytesPerRow + offset,
+                       region.source + r * region.sourceBytesPerRow + offset, bytes);
+            }
+        }
+    }
+}
+
+size_t AlignedBytesPerRow(size_t bytes)
+{
+    return (bytes + 63) / 64 * 64;
+}
+
+template <typename Copy>
+double MicrosecondsPerFrame(Copy copy, const std::vector<PlaneRegion> &planes)
+{
+    for (const PlaneRegion &plane : planes) {
+        copy(plane);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        for (const PlaneRegion &plane : planes) {
+            copy(plane);
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations;
+}
+
+void Benchmark(const char *name, size_t width, size_t height)
+{
+    size_t croppedWidth = (size_t)(width * kCropRatio) / 2 * 2;
+    size_t croppedHeight = (size_t)(height * kCropRatio) / 2 * 2;
+    size_t offsetX = width - croppedWidth;
+    size_t offsetY = (height - croppedHeight) / 4 * 2;
+    size_t sourceBytesPerRow = AlignedBytesPerRow(width);
+    size_t destinationBytesPerRow = AlignedBytesPerRow(croppedWidth);
+    // The luma plane, then the interleaved chroma plane with half the rows
+    std::vector<uint8_t> source(sourceBytesPerRow * height * 3 / 2, 0x80);
+    std::vector<uint8_t> destination(destinationBytesPerRow * croppedHeight * 3 / 2);
+    std::vector<PlaneRegion> planes;
+    for (size_t plane = 0; plane < 2; ++plane) {
+        size_t sourcePlaneOffset = plane * sourceBytesPerRow * height;
+        size_t destinationPlaneOffset = plane * destinationBytesPerRow * croppedHeight;
+        size_t planeOffsetY = plane ? offsetY / 2 : offsetY;
+        PlaneRegion region;
+        region.source = source.data() + sourcePlaneOffset + planeOffsetY * sourceBytesPerRow + offsetX;
+        region.sourceBytesPerRow = sourceBytesPerRow;
+        region.destination = destination.data() + destinationPlaneOffset;
+        region.destinationBytesPerRow = destinationBytesPerRow;
+        region.bytesPerRow = croppedWidth;
+        region.rows = plane ? croppedHeight / 2 : croppedHeight;
+        planes.push_back(region);
+    }
+    printf("%-6s %4zux%-4zu  PlaneRegionCopy %7.1f us  row pair SIMD %7.1f us  cache blocked %7.1f us\n", name,
+           croppedWidth, croppedHeight, MicrosecondsPerFrame(PlaneRegionCopy, planes),
+           MicrosecondsPerFrame(RowPairCopy, planes), MicrosecondsPerFrame(CacheBlockedCopy, planes));
+}
+
+} // namespace
+
+int main()
+{
+    Benchmark("720p", 1280, 720);
+    Benchmark("1080p", 1920, 1080);
+    Benchmark("4K", 3840, 2160);
+    return 0;
+}
@@ -0,0 +1,53 @@
+//
+//  SCPlaneCopyTests.cpp
+//  Snapchat
+//
+
+#include "SCPlaneCopy.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace SC;
+
+TEST(SCPlaneCopyTests, CopiesTheRegionBetweenStrides)
+{
+    const size_t sourceBytesPerRow = 64;
+    std::vector<uint8_t> source(sourceBytesPerRow * 10);
+    for (size_t i = 0; i < source.size(); ++i) {
+        source[i] = (uint8_t)i;
+    }
+    const size_t destinationBytesPerRow = 48;
+    std::vector<uint8_t> destination(destinationBytesPerRow * 6, 0xEE);
+    PlaneRegion region = {source.data() + 2 * sourceBytesPerRow + 20, sourceBytesPerRow, destination.data(),
+                          destinationBytesPerRow, 40, 6};
+    PlaneRegionCopy(region);
+    for (size_t row = 0; row < 6; ++row) {
+        for (size_t column = 0; column < destinationBytesPerRow; ++column) {
+            uint8_t expected = column < 40 ? source[(row + 2) * sourceBytesPerRow + 20 + column] : 0xEE;
+            ASSERT_EQ(expected, destination[row * destinationBytesPerRow + column]) << row << " " << column;
+        }
+    }
+}
+
+TEST(SCPlaneCopyTests, CopiesContiguousRegionsAtOnce)
+{
+    std::vector<uint8_t> source(32 * 8);
+    for (size_t i = 0; i < source.size(); ++i) {
+        source[i] = (uint8_t)(i * 7);
+    }
+    std::vector<uint8_t> destination(source.size());
+    PlaneRegion region = {source.data(), 32, destination.data(), 32, 32, 8};
+    PlaneRegionCopy(region);
+    EXPECT_EQ(source, destination);
+}
+
+TEST(SCPlaneCopyTests, CopiesNothingWithoutRows)
+{
+    uint8_t source[4] = {1, 2, 3, 4};
+    uint8_t destination[4] = {0, 0, 0, 0};
+    PlaneRegion region = {source, 4, destination, 4, 4, 0};
+    PlaneRegionCopy(region);
+    EXPECT_EQ(0, destination[0]);
+}
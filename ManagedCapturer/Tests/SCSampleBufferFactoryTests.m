@@ -0,0 +1,126 @@
+//
+//  SCSampleBufferFactoryTests.m
+//  Snapchat
+//
+//  Checks the format description cache of SCSampleBufferFactory by its creation counts, and measures wrapping frames
+//  against creating a format description for each, which is what its callers used to do. Part of the iOS unit test
+//  bundle, not of the host build in CMakeLists.txt.
+//
+
+#import "SCSampleBufferFactory.h"
+
+#import <XCTest/XCTest.h>
+
+static NSUInteger const kSCSampleBufferFactoryTestFrameCount = 300;
+
+@interface SCSampleBufferFactoryTests : XCTestCase
+@end
+
+@implementation SCSampleBufferFactoryTests {
+    SCSampleBufferFactory *_factory;
+}
+
+- (void)setUp
+{
+    [super setUp];
+    _factory = [[SCSampleBufferFactory alloc] init];
+}
+
+- (void)testFramesOfTheSameFormatShareTheirFormatDescription
+{
+    CVPixelBufferRef pixelBuffer = [self _createPixelBufferWithWidth:1280 height:720];
+    for (NSUInteger frame = 0; frame < kSCSampleBufferFactoryTestFrameCount; ++frame) {
+        CMSampleBufferRef sampleBuffer =
+            [_factory createSampleBufferWithPixelBuffer:pixelBuffer presentationTime:CMTimeMake(frame, 30)];
+        XCTAssertTrue(sampleBuffer != NULL);
+        XCTAssertEqual(CMSampleBufferGetImageBuffer(sampleBuffer), pixelBuffer);
+        XCTAssertEqual(CMTimeCompare(CMSampleBufferGetPresentationTimeStamp(sampleBuffer), CMTimeMake(frame, 30)), 0);
+        CFRelease(sampleBuffer);
+    }
+    CVPixelBufferRelease(pixelBuffer);
+    XCTAssertEqual(_factory.sampleBufferCreationCount, kSCSampleBufferFactoryTestFrameCount);
+    XCTAssertEqual(_factory.formatDescriptionCreationCount, 1);
+}
+
+- (void)testEachFormatGetsItsOwnFormatDescription
+{
+    CVPixelBufferRef smallPixelBuffer = [self _createPixelBufferWithWidth:640 height:480];
+    CVPixelBufferRef largePixelBuffer = [self _createPixelBufferWithWidth:1920 height:1080];
+    for (NSUInteger frame = 0; frame < 10; ++frame) {
+        CVPixelBufferRef pixelBuffer = frame % 2 ? smallPixelBuffer : largePixelBuffer;
+        CMSampleBufferRef sampleBuffer =
+            [_factory createSampleBufferWithPixelBuffer:pixelBuffer presentationTime:CMTimeMake(frame, 30)];
+        CMVideoDimensions dimensions =
+            CMVideoFormatDescriptionGetDimensions(CMSampleBufferGetFormatDescription(sampleBuffer));
+        XCTAssertEqual(dimensions.width, CVPixelBufferGetWidth(pixelBuffer));
+        XCTAssertEqual(dimensions.height, CVPixelBufferGetHeight(pixelBuffer));
+        CFRelease(sampleBuffer);
+    }
+    CVPixelBufferRelease(smallPixelBuffer);
+    CVPixelBufferRelease(largePixelBuffer);
+    XCTAssertEqual(_factory.formatDescriptionCreationCount, 2);
+}
+
+- (void)testChangedColorAttachmentsGetANewFormatDescription
+{
+    CVPixelBufferRef pixelBuffer = [self _createPixelBufferWithWidth:1280 height:720];
+    CMSampleBufferRef sampleBuffer =
+        [_factory createSampleBufferWithPixelBuffer:pixelBuffer presentationTime:kCMTimeZero];
+    CFRelease(sampleBuffer);
+    CVBufferSetAttachment(pixelBuffer, kCVImageBufferYCbCrMatrixKey, kCVImageBufferYCbCrMatrix_ITU_R_601_4,
+                          kCVAttachmentMode_ShouldPropagate);
+    sampleBuffer = [_factory createSampleBufferWithPixelBuffer:pixelBuffer presentationTime:kCMTimeZero];
+    XCTAssertTrue(
+        CMVideoFormatDescriptionMatchesImageBuffer(CMSampleBufferGetFormatDescription(sampleBuffer), pixelBuffer));
+    CFRelease(sampleBuffer);
+    CVPixelBufferRelease(pixelBuffer);
+    XCTAssertEqual(_factory.formatDescriptionCreationCount, 2);
+}
+
+- (void)testNoPixelBuffer
+{
+    XCTAssertTrue([_factory createSampleBufferWithPixelBuffer:NULL presentationTime:kCMTimeZero] == NULL);
+    XCTAssertEqual(_factory.sampleBufferCreationCount, 0);
+}
+
+- (void)testPerformanceOfWrappingFrames
+{
+    CVPixelBufferRef pixelBuffer = [self _createPixelBufferWithWidth:1280 height:720];
+    [self measureBlock:^{
+        for (NSUInteger frame = 0; frame < kSCSampleBufferFactoryTestFrameCount; ++frame) {
+            CFRelease([_factory createSampleBufferWithPixelBuffer:pixelBuffer presentationTime:CMTimeMake(frame, 30)]);
+        }
+    }];
+    CVPixelBufferRelease(pixelBuffer);
+}
+
+- (void)testPerformanceOfWrappingFramesWithAFormatDescriptionEach
+{
+    CVPixelBufferRef pixelBuffer = [self _createPixelBufferWithWidth:1280 height:720];
+    [self measureBlock:^{
+        for (NSUInteger frame = 0; frame < kSCSampleBufferFactoryTestFrameCount; ++frame) {
+            CMVideoFormatDescriptionRef formatDescription = NULL;
+            CMVideoFormatDescriptionCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, &formatDescription);
+            CMSampleTimingInfo timingInfo = {kCMTimeInvalid, CMTimeMake(frame, 30), kCMTimeInvalid};
+            CMSampleBufferRef sampleBuffer = NULL;
+            CMSampleBufferCreateReadyWithImageBuffer(kCFAllocatorDefault, pixelBuffer, formatDescription, &timingInfo,
+                                                     &sampleBuffer);
+            CFRelease(sampleBuffer);
+            CFRelease(formatDescription);
+        }
+    }];
+    CVPixelBufferRelease(pixelBuffer);
+}
+
+#pragma mark - Private methods
+
+- (CVPixelBufferRef)_createPixelBufferWithWidth:(size_t)width height:(size_t)height
+{
+    CVPixelBufferRef pixelBuffer = NULL;
+    CVPixelBufferCreate(kCFAllocatorDefault, width, height, kCVPixelFormatType_420YpCbCr8BiPlanarFullRange,
+                        (__bridge CFDictionaryRef) @{(id)kCVPixelBufferIOSurfacePropertiesKey : @{}}, &pixelBuffer);
+    XCTAssertTrue(pixelBuffer != NULL);
+    return pixelBuffer;
+}
+
+@end
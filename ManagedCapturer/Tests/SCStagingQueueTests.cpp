@@ -0,0 +1,245 @@
+//
+//  SCStagingQueueTests.cpp
+//  Snapchat
+//
+
+#include "SCStagingQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace SC;
+
+namespace {
+
+struct CountingRelease {
+    std::atomic<size_t> *releasedCount;
+
+    void operator()(uint64_t) const
+    {
+        ++*releasedCount;
+    }
+};
+
+typedef StagingQueue<uint64_t, CountingRelease> TestStagingQueue;
+
+std::vector<uint64_t> PopAll(TestStagingQueue &queue)
+{
+    std::vector<uint64_t> items;
+    uint64_t item;
+    while (queue.pop(item)) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+} // namespace
+
+TEST(SCStagingQueueTests, DropOldestKeepsTheNewestItems)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(3, StagingOverflowPolicy::DropOldest, 0, 0, CountingRelease{&released});
+    for (uint64_t item = 1; item <= 5; ++item) {
+        EXPECT_TRUE(queue.push(item));
+    }
+    EXPECT_EQ(3u, queue.size());
+    EXPECT_EQ(2u, released.load());
+    EXPECT_EQ(2u, queue.statistics().droppedCount);
+    EXPECT_EQ(3u, queue.statistics().highWaterMark);
+    EXPECT_EQ((std::vector<uint64_t>{3, 4, 5}), PopAll(queue));
+}
+
+TEST(SCStagingQueueTests, BlockWithTimeoutDrainsBeforeDropping)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(2, StagingOverflowPolicy::BlockWithTimeout, 1, 0, CountingRelease{&released});
+    queue.push(1);
+    queue.push(2);
+    std::vector<uint64_t> drained;
+    queue.push(3, [&] {
+        uint64_t item;
+        bool popped = queue.pop(item);
+        drained.push_back(item);
+        return popped;
+    });
+    EXPECT_EQ((std::vector<uint64_t>{1}), drained);
+    EXPECT_EQ(0u, queue.statistics().droppedCount);
+    EXPECT_EQ((std::vector<uint64_t>{2, 3}), PopAll(queue));
+}
+
+TEST(SCStagingQueueTests, BlockWithTimeoutDropsTheOldestOnceTimedOut)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(2, StagingOverflowPolicy::BlockWithTimeout, 0.02, 0, CountingRelease{&released});
+    queue.push(1);
+    queue.push(2);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(queue.push(3));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    EXPECT_EQ(1u, queue.statistics().droppedCount);
+    EXPECT_GE(queue.statistics().blockedSeconds, 0.02);
+    EXPECT_EQ(1u, released.load());
+    EXPECT_EQ((std::vector<uint64_t>{2, 3}), PopAll(queue));
+}
+
+TEST(SCStagingQueueTests, BlockWithTimeoutWakesUpWhenTheConsumerPops)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(1, StagingOverflowPolicy::BlockWithTimeout, 10, 0, CountingRelease{&released});
+    queue.push(1);
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t item;
+        EXPECT_TRUE(queue.pop(item));
+        EXPECT_EQ(1u, item);
+    });
+    auto start = std::chrono::steady_clock::now();
+    queue.push(2);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    consumer.join();
+    EXPECT_EQ(0u, queue.statistics().droppedCount);
+    EXPECT_EQ((std::vector<uint64_t>{2}), PopAll(queue));
+}
+
+TEST(SCStagingQueueTests, NotifyMakesTheProducerDrainAgain)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(1, StagingOverflowPolicy::BlockWithTimeout, 10, 0, CountingRelease{&released});
+    queue.push(1);
+    // The consumer becomes ready later on, like an AVAssetWriterInput notifying readyForMoreMediaData
+    std::atomic<bool> ready(false);
+    std::thread writer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ready = true;
+        queue.notify();
+    });
+    size_t drainCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    queue.push(2, [&] {
+        ++drainCount;
+        uint64_t item;
+        return ready && queue.pop(item);
+    });
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    writer.join();
+    EXPECT_GE(drainCount, 1u);
+    EXPECT_EQ(0u, queue.statistics().droppedCount);
+    EXPECT_EQ((std::vector<uint64_t>{2}), PopAll(queue));
+}
+
+TEST(SCStagingQueueTests, NeverDropUsesTheReserveThenFails)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(2, StagingOverflowPolicy::NeverDrop, 0.001, 3, CountingRelease{&released});
+    for (uint64_t item = 1; item <= 5; ++item) {
+        EXPECT_TRUE(queue.push(item));
+    }
+    EXPECT_EQ(3u, queue.statistics().reservedCount);
+    EXPECT_FALSE(queue.push(6));
+    EXPECT_EQ(1u, queue.statistics().overflowCount);
+    EXPECT_EQ(1u, released.load());
+    EXPECT_EQ(0u, queue.statistics().droppedCount);
+    EXPECT_EQ(5u, queue.statistics().highWaterMark);
+    EXPECT_EQ((std::vector<uint64_t>{1, 2, 3, 4, 5}), PopAll(queue));
+}
+
+TEST(SCStagingQueueTests, ClearReleasesTheStagedItems)
+{
+    std::atomic<size_t> released(0);
+    {
+        TestStagingQueue queue(4, StagingOverflowPolicy::DropOldest, 0, 0, CountingRelease{&released});
+        queue.push(1);
+        queue.push(2);
+        queue.clear();
+        EXPECT_TRUE(queue.empty());
+        EXPECT_EQ(2u, released.load());
+        queue.push(3);
+    }
+    EXPECT_EQ(3u, released.load());
+}
+
+namespace {
+
+struct StressResult {
+    std::vector<uint64_t> popped;
+    size_t released;
+    StagingStatistics statistics;
+};
+
+// A producer pushing at a camera like rate, and a writer which stalls every so often
+StressResult RunStress(StagingOverflowPolicy policy, size_t capacity, size_t reserve, double timeout, size_t count)
+{
+    std::atomic<size_t> released(0);
+    TestStagingQueue queue(capacity, policy, timeout, reserve, CountingRelease{&released});
+    std::atomic<bool> producing(true);
+    StressResult result;
+    std::thread writer([&] {
+        std::mt19937 random(42);
+        uint64_t item;
+        while (true) {
+            if (queue.pop(item)) {
+                result.popped.push_back(item);
+            } else if (!producing) {
+                break;
+            }
+            if (random() % 64 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(random() % 2000));
+            }
+        }
+    });
+    for (uint64_t item = 0; item < count; ++item) {
+        queue.push(item);
+        if (item % 16 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    producing = false;
+    writer.join();
+    result.released = released;
+    result.statistics = queue.statistics();
+    return result;
+}
+
+void ExpectInOrderWithoutDuplicates(const std::vector<uint64_t> &items)
+{
+    for (size_t i = 1; i < items.size(); ++i) {
+        ASSERT_LT(items[i - 1], items[i]);
+    }
+}
+
+} // namespace
+
+TEST(SCStagingQueueTests, StressDropOldest)
+{
+    StressResult result = RunStress(StagingOverflowPolicy::DropOldest, 8, 0, 0, 20000);
+    ExpectInOrderWithoutDuplicates(result.popped);
+    EXPECT_EQ(20000u, result.popped.size() + result.released);
+    EXPECT_EQ(result.statistics.droppedCount, result.released);
+    EXPECT_LE(result.statistics.highWaterMark, 8u);
+}
+
+TEST(SCStagingQueueTests, StressBlockWithTimeout)
+{
+    StressResult result = RunStress(StagingOverflowPolicy::BlockWithTimeout, 8, 0, 0.0005, 20000);
+    ExpectInOrderWithoutDuplicates(result.popped);
+    EXPECT_EQ(20000u, result.popped.size() + result.released);
+    EXPECT_EQ(result.statistics.droppedCount, result.released);
+    EXPECT_LE(result.statistics.highWaterMark, 8u);
+}
+
+TEST(SCStagingQueueTests, StressNeverDrop)
+{
+    StressResult result = RunStress(StagingOverflowPolicy::NeverDrop, 8, 120, 1, 20000);
+    ASSERT_EQ(20000u, result.popped.size());
+    for (uint64_t item = 0; item < result.popped.size(); ++item) {
+        ASSERT_EQ(item, result.popped[item]);
+    }
+    EXPECT_EQ(0u, result.released);
+    EXPECT_EQ(0u, result.statistics.overflowCount);
+    EXPECT_LE(result.statistics.highWaterMark, 128u);
+}
@@ -25,6 +25,8 @@
  */
 @class SCManagedDeviceCapacityAnalyzer;
 
+@class SCCaptureSetupGraph;
+
 @class SCManagedCapturePreviewLayerController;
 
 @class ARSession;
@@ -222,6 +224,9 @@ typedef enum : NSUInteger {
 
 @property (nonatomic, readwrite, strong) SCBlackCameraDetector *blackCameraDetector;
 
+// Steps of setupWithCaptureResource:devicePosition:, kept for the ones deferred until the capturer runs
+@property (nonatomic, readwrite, strong) SCCaptureSetupGraph *setupGraph;
+
 @property (nonatomic, readwrite, strong) id<SCDeviceMotionProvider> deviceMotionProvider;
 
 @property (nonatomic, readwrite, strong) id<SCManagedCapturerARImageCaptureProvider> arImageCaptureProvider;
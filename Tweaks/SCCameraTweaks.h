@@ -109,6 +109,26 @@ static inline BOOL SCCameraTweaksSmoothAutoFocusWhileRecording(void)
     return FBTweakValue(@"Camera", @"Core Camera", @"Smooth autofocus while recording", YES);
 }
 
+static inline BOOL SCCameraTweaksEnableParallelCameraSetup(void)
+{
+    return FBTweakValue(@"Camera", @"Core Camera", @"Parallel and deferred setup", NO);
+}
+
+static inline BOOL SCCameraTweaksRecordCaptureStateMachineCalls(void)
+{
+    return FBTweakValue(@"Camera", @"Core Camera", @"Record state machine calls", NO);
+}
+
+static inline BOOL SCCameraTweaksBlockOnVideoWriterStagingOverflow(void)
+{
+    return FBTweakValue(@"Camera", @"Recording", @"Block on Video Writer Overflow", NO);
+}
+
+static inline BOOL SCCameraTweaksEnableVideoRecordingPreRoll(void)
+{
+    return FBTweakValue(@"Camera", @"Recording", @"Pre-roll from record press", NO);
+}
+
 static inline NSInteger SCCameraExposureAdjustmentMode(void)
 {
     return [FBTweakValue(
@@ -191,11 +211,30 @@ static inline CGFloat SCCameraTweaksSmoothZoomMinStepLength()
     return FBTweakValue(@"Camera", @"Zoom Strategy - Linear Interpolation", @"Min step length", 0.05);
 }
 
+static inline NSInteger SCCameraTweaksSavitzkyGolayZoomWindowSize(void)
+{
+    return [FBTweakValue(@"Camera", @"Zoom Strategy - Savitzky-Golay Filter", @"Window size", (id) @9,
+                         (@{ @5 : @"5",
+                             @7 : @"7",
+                             @9 : @"9",
+                             @11 : @"11" })) integerValue];
+}
+
 static inline CGFloat SCCameraTweaksExposureDeadline()
 {
     return FBTweakValue(@"Camera", @"Adjust Exposure", @"Exposure Deadline", 0.2);
 }
 
+static inline BOOL SCCameraTweaksEnableLumaAnalytics(void)
+{
+    return FBTweakValue(@"Camera", @"Lighting Analytics", @"Luma Statistics", NO);
+}
+
+static inline NSInteger SCCameraTweaksLumaAnalyticsFrameInterval(void)
+{
+    return FBTweakValue(@"Camera", @"Lighting Analytics", @"Frame Interval", 6, 1, 30);
+}
+
 static inline BOOL SCCameraTweaksKillFrontCamera(void)
 {
     return SCTweakValueWithHalt(@"Camera", @"Debugging", @"Kill Front Camera", NO);
@@ -271,6 +310,21 @@ static inline BOOL SCCameraTweaksDepthToGrayscaleOverride(void)
     return FBTweakValue(@"Camera", @"Core Camera - Portrait Mode", @"Depth to Grayscale Override", NO);
 }
 
+static inline BOOL SCCameraTweaksEnableFusedMetalProcessing(void)
+{
+    return FBTweakValue(@"Camera", @"Core Camera - Processing Pipeline", @"Fused Metal Execution", NO);
+}
+
+static inline BOOL SCCameraTweaksEnablePipelinedFrameProcessing(void)
+{
+    return FBTweakValue(@"Camera", @"Core Camera - Processing Pipeline", @"Pipelined Frame Processing", NO);
+}
+
+static inline BOOL SCCameraTweaksProfileMetalProcessingModules(void)
+{
+    return FBTweakValue(@"Camera", @"Core Camera - Processing Pipeline", @"Per-Module GPU Timing", NO);
+}
+
 static inline SCCameraTweaksStrategyType SCCameraTweaksEnableHandsFreeXToCancelStrategy(void)
 {
     NSNumber *strategy = SCTweakValueWithHalt(@"Camera", @"Hands-Free Recording", @"X to Cancel",
@@ -361,6 +415,11 @@ static inline int SCCameraTweaksFaceFocusDetectionFrequency()
     return FBTweakValue(@"Camera", @"Core Camera - Face Focus", @"Detection Frequency", 3, 1, 30);
 }
 
+static inline BOOL SCCameraTweaksFaceFocusAdaptiveDetectionFrequency()
+{
+    return FBTweakValue(@"Camera", @"Core Camera - Face Focus", @"Adaptive Detection Frequency", NO);
+}
+
 static inline BOOL SCCameraTweaksFaceFocusMinFaceSizeRespectABTesting()
 {
     return SCTweakValueWithHalt(@"Camera", @"Core Camera - Face Focus", @"Min Face Size Respect AB", YES);
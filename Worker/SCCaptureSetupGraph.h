@@ -0,0 +1,47 @@
+//
+//  SCCaptureSetupGraph.h
+//  Snapchat
+//
+
+#import <Foundation/Foundation.h>
+
+@class SCCaptureResource;
+
+typedef NS_OPTIONS(NSUInteger, SCCaptureSetupStepOptions) {
+    SCCaptureSetupStepOptionNone = 0,
+    // The step only touches state its dependencies are done with, so it can run on a worker concurrently with the
+    // steps it doesn't depend on
+    SCCaptureSetupStepOptionConcurrent = 1 << 0,
+    // The step isn't needed for the first preview frame, it only runs with runDeferredSteps
+    SCCaptureSetupStepOptionDeferred = 1 << 1,
+};
+
+// Steps are handed the capture resource when they run rather than capturing it, since the resource keeps the graph
+typedef void (^SCCaptureSetupStepBlock)(SCCaptureResource *captureResource);
+
+/*
+ Declarative list of the steps setting up the capturer. Every step names the steps it depends on, which have to be
+ added before it, so the steps run in the order they were added, except concurrent ones which are only waited for
+ when a step depending on them is about to run, or at the end of the phase.
+
+ Each phase logs the duration of its steps along with its critical path. Not thread safe, meant to be used on the
+ capturer queue.
+ */
+@interface SCCaptureSetupGraph : NSObject
+
+- (instancetype)initWithName:(NSString *)name;
+
+- (void)addStepWithName:(NSString *)name
+           dependencies:(NSArray<NSString *> *)dependencies
+                options:(SCCaptureSetupStepOptions)options
+                  block:(SCCaptureSetupStepBlock)block;
+
+// Runs the steps which are not deferred, returns once they are all done
+- (void)runStepsWithCaptureResource:(SCCaptureResource *)captureResource;
+
+// Runs the deferred steps which haven't run yet, returns once they are all done
+- (void)runDeferredStepsWithCaptureResource:(SCCaptureResource *)captureResource;
+
+@property (nonatomic, readonly) BOOL hasPendingDeferredSteps;
+
+@end
@@ -0,0 +1,177 @@
+//
+//  SCCaptureSetupGraph.m
+//  Snapchat
+//
+
+#import "SCCaptureSetupGraph.h"
+
+#import "SCManagedCapturerLogging.h"
+
+#import <SCFoundation/SCAssertWrapper.h>
+#import <SCLogger/SCLogger.h>
+
+@import QuartzCore;
+
+static NSString *const kSCCaptureSetupGraphEvent = @"CAMERA_SETUP_STEPS";
+
+@interface SCCaptureSetupStep : NSObject
+
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, copy) NSArray<NSString *> *dependencies;
+@property (nonatomic, assign) SCCaptureSetupStepOptions options;
+@property (nonatomic, copy) SCCaptureSetupStepBlock block;
+// Set while the step runs on a worker
+@property (nonatomic, strong) dispatch_group_t group;
+@property (nonatomic, assign) BOOL started;
+@property (nonatomic, assign) CFTimeInterval startTime;
+@property (nonatomic, assign) CFTimeInterval endTime;
+
+@end
+
+@implementation SCCaptureSetupStep
+
+- (void)runWithCaptureResource:(SCCaptureResource *)captureResource
+{
+    _startTime = CACurrentMediaTime();
+    _block(captureResource);
+    _endTime = CACurrentMediaTime();
+    // Release what the block captured
+    _block = nil;
+}
+
+@end
+
+@implementation SCCaptureSetupGraph {
+    NSString *_name;
+    NSMutableArray<SCCaptureSetupStep *> *_steps;
+    NSMutableDictionary<NSString *, SCCaptureSetupStep *> *_stepsByName;
+}
+
+- (instancetype)initWithName:(NSString *)name
+{
+    self = [super init];
+    if (self) {
+        _name = [name copy];
+        _steps = [NSMutableArray array];
+        _stepsByName = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)addStepWithName:(NSString *)name
+           dependencies:(NSArray<NSString *> *)dependencies
+                options:(SCCaptureSetupStepOptions)options
+                  block:(SCCaptureSetupStepBlock)block
+{
+    SCAssert(!_stepsByName[name], @"Setup step %@ added twice", name);
+    for (NSString *dependency in dependencies) {
+        SCAssert(_stepsByName[dependency], @"Setup step %@ depends on %@ which isn't added yet", name, dependency);
+        SCAssert((options & SCCaptureSetupStepOptionDeferred) ||
+                     !(_stepsByName[dependency].options & SCCaptureSetupStepOptionDeferred),
+                 @"Setup step %@ depends on deferred step %@", name, dependency);
+    }
+    SCCaptureSetupStep *step = [[SCCaptureSetupStep alloc] init];
+    step.name = name;
+    step.dependencies = dependencies ?: @[];
+    step.options = options;
+    step.block = block;
+    [_steps addObject:step];
+    _stepsByName[name] = step;
+}
+
+- (void)runStepsWithCaptureResource:(SCCaptureResource *)captureResource
+{
+    [self _runStepsDeferred:NO captureResource:captureResource];
+}
+
+- (void)runDeferredStepsWithCaptureResource:(SCCaptureResource *)captureResource
+{
+    [self _runStepsDeferred:YES captureResource:captureResource];
+}
+
+- (BOOL)hasPendingDeferredSteps
+{
+    for (SCCaptureSetupStep *step in _steps) {
+        if (!step.started && (step.options & SCCaptureSetupStepOptionDeferred)) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+#pragma mark - Private methods
+
+- (void)_runStepsDeferred:(BOOL)deferred captureResource:(SCCaptureResource *)captureResource
+{
+    CFTimeInterval startTime = CACurrentMediaTime();
+    NSMutableArray<SCCaptureSetupStep *> *phaseSteps = [NSMutableArray array];
+    for (SCCaptureSetupStep *step in _steps) {
+        if (step.started || deferred != !!(step.options & SCCaptureSetupStepOptionDeferred)) {
+            continue;
+        }
+        for (NSString *dependency in step.dependencies) {
+            [self _waitForStep:_stepsByName[dependency]];
+        }
+        step.started = YES;
+        if (step.options & SCCaptureSetupStepOptionConcurrent) {
+            step.group = dispatch_group_create();
+            dispatch_group_async(step.group, dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^{
+                [step runWithCaptureResource:captureResource];
+            });
+        } else {
+            [step runWithCaptureResource:captureResource];
+        }
+        [phaseSteps addObject:step];
+    }
+    for (SCCaptureSetupStep *step in phaseSteps) {
+        [self _waitForStep:step];
+    }
+    if (phaseSteps.count > 0) {
+        [self _logPhase:(deferred ? @"deferred" : @"startup") steps:phaseSteps startTime:startTime];
+    }
+}
+
+- (void)_waitForStep:(SCCaptureSetupStep *)step
+{
+    if (step.group) {
+        dispatch_group_wait(step.group, DISPATCH_TIME_FOREVER);
+        step.group = nil;
+    }
+}
+
+- (void)_logPhase:(NSString *)phase steps:(NSArray<SCCaptureSetupStep *> *)steps startTime:(CFTimeInterval)startTime
+{
+    CFTimeInterval endTime = CACurrentMediaTime();
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
+    SCCaptureSetupStep *lastStep = nil;
+    for (SCCaptureSetupStep *step in steps) {
+        parameters[[step.name stringByAppendingString:@"_ms"]] = @((step.endTime - step.startTime) * 1000);
+        if (!lastStep || step.endTime > lastStep.endTime) {
+            lastStep = step;
+        }
+    }
+    // Walk back from the step finishing last through the dependency of the phase finishing last
+    NSMutableArray<NSString *> *criticalPath = [NSMutableArray array];
+    for (SCCaptureSetupStep *step = lastStep; step;) {
+        [criticalPath insertObject:step.name atIndex:0];
+        SCCaptureSetupStep *latestDependency = nil;
+        for (NSString *dependency in step.dependencies) {
+            SCCaptureSetupStep *dependencyStep = _stepsByName[dependency];
+            if ([steps containsObject:dependencyStep] &&
+                (!latestDependency || dependencyStep.endTime > latestDependency.endTime)) {
+                latestDependency = dependencyStep;
+            }
+        }
+        step = latestDependency;
+    }
+    NSString *criticalPathDescription = [criticalPath componentsJoinedByString:@">"];
+    parameters[@"graph"] = _name;
+    parameters[@"phase"] = phase;
+    parameters[@"total_ms"] = @((endTime - startTime) * 1000);
+    parameters[@"critical_path"] = criticalPathDescription;
+    SCLogCapturerInfo(@"%@ %@ setup took %.1fms, critical path: %@", _name, phase, (endTime - startTime) * 1000,
+                      criticalPathDescription);
+    [[SCLogger sharedInstance] logEvent:kSCCaptureSetupGraphEvent parameters:parameters];
+}
+
+@end
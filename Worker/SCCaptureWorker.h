@@ -29,6 +29,10 @@
 + (void)setupWithCaptureResource:(SCCaptureResource *)captureResource
                   devicePosition:(SCManagedCaptureDevicePosition)devicePosition;
 
+// Runs the setup steps deferred until the capturer starts running, if they haven't run yet. Anything using the video
+// capturer, scanner, face detector or black camera detector before the capturer runs has to call it first.
++ (void)runDeferredSetupWithCaptureResource:(SCCaptureResource *)captureResource;
+
 + (void)setupCapturePreviewLayerController;
 
 + (void)startRunningWithCaptureResource:(SCCaptureResource *)captureResource
@@ -16,6 +16,7 @@
 #import "SCCaptureFaceDetector.h"
 #import "SCCaptureMetadataOutputDetector.h"
 #import "SCCaptureSessionFixer.h"
+#import "SCCaptureSetupGraph.h"
 #import "SCManagedCaptureDevice+SCManagedCapturer.h"
 #import "SCManagedCaptureDeviceDefaultZoomHandler.h"
 #import "SCManagedCaptureDeviceHandler.h"
@@ -177,24 +178,101 @@ static UIImageOrientation SCMirroredImageOrientation(UIImageOrientation orientat
                                                            liveVideoStreaming:NO
                                                            lensProcessorReady:NO];
 
-    [self configLensesProcessorWithCaptureResource:captureResource];
-    [self configARSessionWithCaptureResource:captureResource];
-    [self configCaptureDeviceHandlerWithCaptureResource:captureResource];
-    [self configAVCaptureSessionWithCaptureResource:captureResource];
-    [self configImageCapturerWithCaptureResource:captureResource];
-    [self configDeviceCapacityAnalyzerWithCaptureResource:captureResource];
-    [self configVideoDataSourceWithCaptureResource:captureResource devicePosition:devicePosition];
-    [self configVideoScannerWithCaptureResource:captureResource];
-    [self configVideoCapturerWithCaptureResource:captureResource];
+    SCCaptureSetupStepOptions concurrent = SCCaptureSetupStepOptionNone;
+    SCCaptureSetupStepOptions deferred = SCCaptureSetupStepOptionNone;
+    if (SCCameraTweaksEnableParallelCameraSetup()) {
+        concurrent = SCCaptureSetupStepOptionConcurrent;
+        deferred = SCCaptureSetupStepOptionDeferred;
+    }
+    SCCaptureSetupGraph *graph = [[SCCaptureSetupGraph alloc] initWithName:@"capturer"];
+    [graph addStepWithName:@"lenses_processor"
+              dependencies:nil
+                   options:SCCaptureSetupStepOptionNone
+                     block:^(SCCaptureResource *resource) {
+                         [self configLensesProcessorWithCaptureResource:resource];
+                     }];
+    // Creating the ARSession only needs the lenses processor, so it overlaps with the AVCaptureSession setup
+    [graph addStepWithName:@"ar_session"
+              dependencies:@[ @"lenses_processor" ]
+                   options:concurrent
+                     block:^(SCCaptureResource *resource) {
+                         [self configARSessionWithCaptureResource:resource];
+                     }];
+    [graph addStepWithName:@"capture_device_handler"
+              dependencies:nil
+                   options:SCCaptureSetupStepOptionNone
+                     block:^(SCCaptureResource *resource) {
+                         [self configCaptureDeviceHandlerWithCaptureResource:resource];
+                     }];
+    [graph addStepWithName:@"av_capture_session"
+              dependencies:@[ @"capture_device_handler" ]
+                   options:SCCaptureSetupStepOptionNone
+                     block:^(SCCaptureResource *resource) {
+                         [self configAVCaptureSessionWithCaptureResource:resource];
+                     }];
+    [graph addStepWithName:@"image_capturer"
+              dependencies:@[ @"lenses_processor", @"av_capture_session" ]
+                   options:SCCaptureSetupStepOptionNone
+                     block:^(SCCaptureResource *resource) {
+                         [self configImageCapturerWithCaptureResource:resource];
+                     }];
+    [graph addStepWithName:@"device_capacity_analyzer"
+              dependencies:@[ @"image_capturer" ]
+                   options:SCCaptureSetupStepOptionNone
+                     block:^(SCCaptureResource *resource) {
+                         [self configDeviceCapacityAnalyzerWithCaptureResource:resource];
+                     }];
+    [graph addStepWithName:@"video_data_source"
+              dependencies:@[
+                  @"lenses_processor", @"ar_session", @"av_capture_session", @"image_capturer",
+                  @"device_capacity_analyzer"
+              ]
+                   options:SCCaptureSetupStepOptionNone
+                     block:^(SCCaptureResource *resource) {
+                         [self configVideoDataSourceWithCaptureResource:resource devicePosition:devicePosition];
+                     }];
+    // Not needed for the first preview frame
+    [graph addStepWithName:@"video_scanner"
+              dependencies:@[ @"video_data_source", @"device_capacity_analyzer" ]
+                   options:deferred
+                     block:^(SCCaptureResource *resource) {
+                         [self configVideoScannerWithCaptureResource:resource];
+                     }];
+    [graph addStepWithName:@"video_capturer"
+              dependencies:@[ @"lenses_processor" ]
+                   options:deferred
+                     block:^(SCCaptureResource *resource) {
+                         [self configVideoCapturerWithCaptureResource:resource];
+                     }];
 
     if (!SCIsSimulator()) {
         // We don't want it enabled for simulator
-        [self configBlackCameraDetectorWithCaptureResource:captureResource];
+        [graph addStepWithName:@"black_camera_detector"
+                  dependencies:@[ @"video_data_source" ]
+                       options:deferred
+                         block:^(SCCaptureResource *resource) {
+                             [self configBlackCameraDetectorWithCaptureResource:resource];
+                         }];
     }
 
     if (SCCameraTweaksEnableFaceDetectionFocus(captureResource.state.devicePosition)) {
-        [self configureCaptureFaceDetectorWithCaptureResource:captureResource];
+        [graph addStepWithName:@"face_detector"
+                  dependencies:@[ @"video_data_source" ]
+                       options:deferred
+                         block:^(SCCaptureResource *resource) {
+                             [self configureCaptureFaceDetectorWithCaptureResource:resource];
+                         }];
     }
+
+    captureResource.setupGraph = graph;
+    [graph runStepsWithCaptureResource:captureResource];
+}
+
++ (void)runDeferredSetupWithCaptureResource:(SCCaptureResource *)captureResource
+{
+    SCAssertPerformer(captureResource.queuePerformer);
+    SC_GUARD_ELSE_RETURN(captureResource.setupGraph.hasPendingDeferredSteps);
+    [captureResource.setupGraph runDeferredStepsWithCaptureResource:captureResource];
 }
 
 + (void)setupCapturePreviewLayerController
@@ -386,6 +464,8 @@ static UIImageOrientation SCMirroredImageOrientation(UIImageOrientation orientat
         [self startStreaming:captureResource];
     }
     SCTraceEndSection();
+    // The session is started, finish what the first preview frame didn't need
+    [self runDeferredSetupWithCaptureResource:captureResource];
 
     if (!captureResource.notificationRegistered) {
         captureResource.notificationRegistered = YES;
@@ -722,6 +802,7 @@ static UIImageOrientation SCMirroredImageOrientation(UIImageOrientation orientat
                         completionHandler:(sc_managed_capturer_start_recording_completion_handler_t)completionHandler
 {
     SCTraceODPCompatibleStart(2);
+    [self runDeferredSetupWithCaptureResource:captureResource];
     if (captureResource.videoRecording) {
         if (completionHandler) {
             runOnMainThreadAsynchronously(^{
@@ -1072,6 +1153,7 @@ static UIImageOrientation SCMirroredImageOrientation(UIImageOrientation orientat
                                          resource:(SCCaptureResource *)resource
 {
     SCAssertPerformer(resource.queuePerformer);
+    [self runDeferredSetupWithCaptureResource:resource];
     [resource.videoCapturer prepareForRecordingWithAudioConfiguration:configuration];
 }
 
@@ -1089,6 +1171,7 @@ static UIImageOrientation SCMirroredImageOrientation(UIImageOrientation orientat
 {
     SCTraceODPCompatibleStart(2);
     SCLogCapturerInfo(@"Start scan. ScanConfiguration:%@", configuration);
+    [self runDeferredSetupWithCaptureResource:resource];
     [SCCaptureWorker startStreaming:resource];
     [resource.videoScanner startScanAsynchronouslyWithScanConfiguration:configuration];
 }